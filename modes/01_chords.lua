@@ -1,5 +1,8 @@
 MODE_NAME = "Chords"
 SLIDER_LABELS = {"Root", "Type", "Velocity", "Length"}
+DETERMINISTIC = true
+SWITCH_OFF_EVENTS = false
+PARALLEL_SAFE = true
 
 
 --[[
@@ -132,3 +135,40 @@ function process_event(track, event)
 
   return {}  -- Return value is ignored; events are in internal buffer
 end
+
+
+-- ============================================================================
+-- process_input() - Live MIDI input, harmonized as it is played
+-- ============================================================================
+
+-- Triad for each degree of the major scale on the Mode 0 root (I ii iii IV V vi vii);
+-- notes outside the scale get a major triad
+local live_triads = {
+  [0] = chord_types[1], [2] = chord_types[2], [4] = chord_types[2], [5] = chord_types[1],
+  [7] = chord_types[1], [9] = chord_types[2], [11] = chord_types[3],
+}
+
+-- Pitches sounding for each held input note: released as played, even if
+-- the root has changed since
+local live_chords = {}
+
+function process_input(msg)
+  if msg.type == "note_on" then
+    local chord = live_triads[(msg.note - transpose) % 12] or chord_types[1]
+    local pitches = {}
+    for i, interval in ipairs(chord) do
+      local pitch = math.min(127, msg.note + interval)
+      note(pitch, math.max(1, math.min(127, msg.velocity + velocity_offset)))
+      pitches[i] = pitch
+    end
+    live_chords[msg.note] = pitches
+  elseif msg.type == "note_off" then
+    local pitches = live_chords[msg.note]
+    if pitches then
+      for i, pitch in ipairs(pitches) do
+        off(pitch)
+      end
+      live_chords[msg.note] = nil
+    end
+  end
+end
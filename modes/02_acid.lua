@@ -1,5 +1,8 @@
 MODE_NAME = "Acid"
 SLIDER_LABELS = {"Pitch", "Length", "Slide", "Filter"}
+DETERMINISTIC = true
+SWITCH_OFF_EVENTS = false
+PARALLEL_SAFE = true
 
 
 --[[
@@ -12,10 +12,15 @@
   - S4: Velocity (for all notes)
 
   Tracks represent rows, steps represent columns.
+
+  Uses the process_step() batch hook: the whole column arrives in one call,
+  together with the real step number.
 ]]--
 
 MODE_NAME = "Cellular Automaton"
 SLIDER_LABELS = {"Survive", "Birth", "Pitch", "Velocity"}
+SWITCH_OFF_EVENTS = true  -- Live cells play even where the switch is off
+PARALLEL_SAFE = true
 
 -- Grid state: 8 tracks x 16 steps (true = alive)
 local grid = {}
@@ -31,10 +36,6 @@ for t = 0, 7 do
     end
 end
 
--- Step counter to know when to evolve
-local current_step = 0
-local last_step = -1
-
 function init(context)
     print("Cellular Automaton initialized on channel " .. context.midi_channel)
 end
@@ -82,39 +83,39 @@ function evolve_grid(survival_threshold, birth_threshold)
     end
 end
 
-function process_event(track, event)
-    -- Track current step (0-15)
-    local step = current_step % 16
-
-    -- Seed the grid with programmed events on first pass
-    if event.switch and not grid[track][step] then
-        grid[track][step] = true
+function process_step(step, events)
+    -- Seed the grid with programmed events
+    for track = 0, 7 do
+        if events[track + 1].switch then
+            grid[track][step] = true
+        end
     end
 
-    -- Evolve grid at step 0 (once per bar)
-    if step == 0 and current_step ~= last_step then
+    -- Evolve grid at step 0 (once per bar), rules from track 1
+    if step == 0 then
         -- Map S1 to survival rule (0-127 -> 2-4)
-        local survival = 2 + math.floor((event.pots[1] * 2) / 127)
+        local survival = 2 + math.floor((events[1].pots[1] * 2) / 127)
         -- Map S2 to birth rule (0-127 -> 2-4)
-        local birth = 2 + math.floor((event.pots[2] * 2) / 127)
+        local birth = 2 + math.floor((events[1].pots[2] * 2) / 127)
 
         evolve_grid(survival, birth)
-        last_step = current_step
     end
 
-    -- Play note if cell is alive
-    if grid[track][step] then
-        -- Base pitch from S3, offset by track number
-        local base_pitch = event.pots[3]
-        local pitch = base_pitch + track * 2  -- Each track 2 semitones apart
+    -- Play a note for every live cell in this column
+    for track = 0, 7 do
+        if grid[track][step] then
+            local event = events[track + 1]
 
-        -- Velocity from S4
-        local velocity = event.pots[4]
-        if velocity < 20 then velocity = 80 end  -- Default if not set
+            -- Base pitch from S3, offset by track number
+            local base_pitch = event.pots[3]
+            local pitch = base_pitch + track * 2  -- Each track 2 semitones apart
 
-        note(pitch, velocity)
-        off(pitch, 100)
-    end
+            -- Velocity from S4
+            local velocity = event.pots[4]
+            if velocity < 20 then velocity = 80 end  -- Default if not set
 
-    current_step = current_step + 1
+            note(pitch, velocity)
+            off(pitch, 100)
+        end
+    end
 end
@@ -1,5 +1,8 @@
 MODE_NAME = "Arp"
 SLIDER_LABELS = {"Root", "Pattern", "Velocity", "Length"}
+DETERMINISTIC = true
+SWITCH_OFF_EVENTS = false
+PARALLEL_SAFE = true
 
 
 --[[
@@ -1,5 +1,8 @@
 MODE_NAME = "Euclidean"
 SLIDER_LABELS = {"Hits", "Rotate", "Note", "Velocity"}
+DETERMINISTIC = true
+SWITCH_OFF_EVENTS = false
+PARALLEL_SAFE = true
 
 
 --[[
@@ -1,5 +1,7 @@
 MODE_NAME = "Random"
 SLIDER_LABELS = {"Prob", "Pitch", "Range", "Vel"}
+SWITCH_OFF_EVENTS = false
+PARALLEL_SAFE = true
 
 
 --[[
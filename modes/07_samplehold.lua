@@ -1,5 +1,7 @@
 MODE_NAME = "Glitch"
 SLIDER_LABELS = {"Sample", "Quant", "Glitch", "Mod"}
+SWITCH_OFF_EVENTS = false
+PARALLEL_SAFE = true
 
 
 --[[
@@ -15,6 +15,8 @@
 
 MODE_NAME = "Wave Table Scanner"
 SLIDER_LABELS = {"Speed", "Dir", "Quant", "Velocity"}
+SWITCH_OFF_EVENTS = false
+PARALLEL_SAFE = true
 
 -- Scan position for each track (0.0 to 16.0)
 local scan_pos = {0, 2, 4, 6, 8, 10, 12, 14}
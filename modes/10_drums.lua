@@ -30,6 +30,9 @@
 -- Mode metadata
 MODE_NAME = "Drums"
 SLIDER_LABELS = {"Velocity", "Length", "S3", "S4"}
+DETERMINISTIC = true
+SWITCH_OFF_EVENTS = false
+PARALLEL_SAFE = true
 
 -- MIDI note assignments for drum sounds (General MIDI Drum Map)
 local drum_map = {
@@ -15,6 +15,8 @@
 
 MODE_NAME = "MIDI Mangler"
 SLIDER_LABELS = {"Crush", "Steal", "Reverse", "Time"}
+SWITCH_OFF_EVENTS = false
+PARALLEL_SAFE = true
 
 -- Note buffer for reverse playback
 local note_buffer = {}
@@ -119,3 +121,29 @@ function process_event(track, event)
         off(glitch_pitch, 80)
     end
 end
+
+-- Live input: played notes come out detuned and with crushed velocity, with the
+-- odd octave glitch. The pitch each key became is kept so its note-off matches.
+local live_notes = {}
+
+function process_input(msg)
+    if msg.type == "note_on" then
+        local pitch = msg.note + math.floor((lcg_random() - 0.5) * 4)
+        pitch = math.max(0, math.min(127, pitch))
+        local velocity = math.max(1, bit_crush(msg.velocity, 2))
+        live_notes[msg.note] = pitch
+        note(pitch, velocity)
+
+        if lcg_random() < 0.3 then
+            local glitch_pitch = math.min(127, pitch + 12)
+            note(glitch_pitch, velocity // 2, 30)  -- Delayed glitch
+            off(glitch_pitch, 60)
+        end
+    elseif msg.type == "note_off" then
+        local pitch = live_notes[msg.note]
+        if pitch then
+            off(pitch)
+            live_notes[msg.note] = nil
+        end
+    end
+end
@@ -11,10 +11,16 @@
   - S4: Note length variance (0 = uniform, 127 = highly varied)
 
   Each track maintains its own Markov chain state.
+
+  The 128x128 transition table is compiled into per-note candidate lists by
+  background(), which the engine runs in small slices between steps. New
+  transitions are picked up once the next compile finishes.
 ]]--
 
 MODE_NAME = "Markov Chain"
 SLIDER_LABELS = {"Memory", "Creative", "Scale", "Variance"}
+SWITCH_OFF_EVENTS = false
+PARALLEL_SAFE = true
 
 -- Transition table: [from_note][to_note] = count
 local transitions = {}
@@ -25,6 +31,9 @@ local current_note = {60, 62, 64, 65, 67, 69, 71, 72}
 -- Note history for learning
 local note_history = {}
 
+-- Bumped on every learned transition; background() recompiles when it changes
+local learn_version = 0
+
 -- Initialize transition table
 for i = 0, 127 do
     transitions[i] = {}
@@ -72,22 +81,43 @@ function learn_transition(from_note, to_note, memory_amount)
         -- Increase transition count (weighted by memory)
         local weight = 1 + math.floor(memory_amount * 3)
         transitions[from_note][to_note] = transitions[from_note][to_note] + weight
+        learn_version = learn_version + 1
     end
 end
 
--- Choose next note based on Markov chain
-function generate_next_note(from_note, creativity)
-    local total_weight = 0
-    local candidates = {}
-
-    -- Gather all possible next notes with weights
-    for to_note = 0, 127 do
-        local weight = transitions[from_note][to_note]
-        if weight > 0 then
-            total_weight = total_weight + weight
-            table.insert(candidates, {note = to_note, weight = weight})
+-- Compile transitions into {version, [from] = {total, candidates}} (runs time-sliced)
+function background()
+    local previous = background_result()
+    if previous and previous.version == learn_version then
+        return previous  -- Nothing new learned
+    end
+
+    local version = learn_version
+    local compiled = {version = version}
+    for from_note = 0, 127 do
+        local row = transitions[from_note]
+        local total_weight = 0
+        local candidates = {}
+        for to_note = 0, 127 do
+            local weight = row[to_note]
+            if weight > 0 then
+                total_weight = total_weight + weight
+                candidates[#candidates + 1] = {note = to_note, weight = weight}
+            end
+        end
+        if total_weight > 0 then
+            compiled[from_note] = {total = total_weight, candidates = candidates}
         end
     end
+    return compiled
+end
+
+-- Choose next note based on Markov chain
+function generate_next_note(from_note, creativity)
+    local compiled = background_result()
+    local entry = compiled and compiled[from_note]
+    local total_weight = entry and entry.total or 0
+    local candidates = entry and entry.candidates
 
     -- If no learned transitions, use random walk
     if total_weight == 0 then
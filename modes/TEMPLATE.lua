@@ -7,6 +7,22 @@ MODE_NAME = "[Your Mode Name]"
 -- Slider labels (optional - provides GUI labels for S1-S4)
 SLIDER_LABELS = {"[S1 Label]", "[S2 Label]", "[S3 Label]", "[S4 Label]"}
 
+-- Deterministic (optional) - set to true if process_event() output depends only on
+-- (track, event) and init() context: no randomness, no state carried between calls.
+-- The engine then renders each bar once and replays it until an event changes.
+-- DETERMINISTIC = true
+
+-- Switch-off events (optional, default true) - set to false if process_event()
+-- returns immediately when event.switch is false; the engine then skips the call.
+-- SWITCH_OFF_EVENTS = false
+
+-- Memory budget (optional) - Lua heap limit for this mode in KB
+-- MEMORY_BUDGET_KB = 64
+
+-- Parallel safe (optional) - set to true if the mode never calls led() or patterns.*;
+-- the desktop engine may then render it on a worker thread alongside other modes.
+-- PARALLEL_SAFE = true
+
 --[[
   GRUVBOK Mode Template
 
@@ -140,6 +156,32 @@ function process_event(track, event)
 end
 
 
+-- ============================================================================
+-- process_input() - Live MIDI input (optional)
+-- ============================================================================
+--
+-- Called as soon as a channel message arrives on the MIDI input, while this
+-- mode is selected. Output with no delta is sent at once, off the step grid.
+--
+-- Parameters:
+--   msg (table):
+--     .type        - "note_on", "note_off", "cc", "pitch_bend", "aftertouch",
+--                    "poly_aftertouch", "program" or "other"
+--     .channel     - 0-15
+--     .data1/data2 - Raw data bytes
+--     .note/.velocity, .controller/.value, .value - Per type, see docs/LUA_API.md
+--
+--[[
+function process_input(msg)
+  if msg.type == "note_on" then
+    note(msg.note, msg.velocity)
+  elseif msg.type == "note_off" then
+    off(msg.note)
+  end
+end
+]]--
+
+
 -- ============================================================================
 -- Helper functions (optional)
 -- ============================================================================
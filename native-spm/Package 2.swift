@@ -19,8 +19,10 @@ let package = Package(
             path: "Sources/GRUVBOKCore",
             sources: [
                 "src/core/engine.cpp",
-                "src/core/event.cpp",
-                "src/core/pattern.cpp",
+                "src/core/pattern_ops.cpp",
+                "src/core/autosave_writer.cpp",
+                "src/core/edit_journal.cpp",
+                "src/core/mapped_song_file.cpp",
                 "src/core/song.cpp",
                 "src/hardware/audio_output.cpp",
                 "src/hardware/midi_scheduler.cpp",
@@ -22,11 +22,19 @@ let package = Package(
             path: "Sources/GRUVBOKCore",
             sources: [
                 "src/core/engine.cpp",
-                "src/core/event.cpp",
-                "src/core/pattern.cpp",
+                "src/core/clock_sync.cpp",
+                "src/core/pattern_ops.cpp",
+                "src/core/autosave_writer.cpp",
+                "src/core/edit_journal.cpp",
+                "src/core/mapped_song_file.cpp",
+                "src/core/song_loader.cpp",
+                "src/core/undo_history.cpp",
+                "src/core/worker_pool.cpp",
                 "src/core/song.cpp",
+                "src/core/log.cpp",
                 "src/hardware/audio_output.cpp",
                 "src/hardware/midi_scheduler.cpp",
+                "src/hardware/din_output.cpp",
                 "src/lua_bridge/lua_api.cpp",
                 "src/lua_bridge/lua_context.cpp",
                 "src/lua_bridge/mode_loader.cpp"
@@ -0,0 +1,268 @@
+#include "autosave_writer.h"
+#include "edit_journal.h"
+#include "song_format.h"
+
+namespace gruvbok {
+
+AutosaveWriter::AutosaveWriter()
+    : incremental_(false)
+    , changed_{}
+    , mapped_(nullptr)
+    , busy_(false)
+    , written_(0)
+    , last_size_(0)
+#ifndef NO_EXCEPTIONS
+    , job_pending_(false)
+    , job_done_(false)
+    , job_ok_(false)
+    , quit_(false) {
+    worker_ = std::thread(&AutosaveWriter::workerLoop, this);
+}
+#else
+    , next_slice_(0)
+    , ok_(true) {
+}
+#endif
+
+AutosaveWriter::~AutosaveWriter() {
+#ifndef NO_EXCEPTIONS
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    wake_.notify_one();
+    worker_.join();  // Finishes a pending job first
+#endif
+}
+
+bool AutosaveWriter::start(std::unique_ptr<Song>& snapshot, const std::string& filepath) {
+    if (busy_ || !snapshot) {
+        return false;
+    }
+
+    incremental_ = false;
+    return begin(snapshot, filepath);
+}
+
+bool AutosaveWriter::startIncremental(std::unique_ptr<Song>& snapshot, const std::string& filepath,
+                                      const PatternMasks& changed) {
+    if (busy_ || !snapshot) {
+        return false;
+    }
+
+    incremental_ = true;
+    changed_ = changed;
+    return begin(snapshot, filepath);
+}
+
+bool AutosaveWriter::begin(std::unique_ptr<Song>& snapshot, const std::string& filepath) {
+    snapshot_ = std::move(snapshot);
+    filepath_ = filepath;
+    buffer_.clear();
+    written_ = 0;
+    busy_ = true;
+
+#ifndef NO_EXCEPTIONS
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_pending_ = true;
+        job_done_ = false;
+    }
+    wake_.notify_one();
+#else
+    next_slice_ = 0;
+    ok_ = true;
+#endif
+    return true;
+}
+
+AutosaveWriter::Status AutosaveWriter::poll() {
+    if (!busy_) {
+        return Status::IDLE;
+    }
+
+#ifndef NO_EXCEPTIONS
+    bool ok;
+    {
+        std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+        if (!lock.owns_lock() || !job_done_) {
+            return Status::BUSY;  // Never wait on the worker
+        }
+        job_done_ = false;
+        ok = job_ok_;
+    }
+    return finish(ok);
+#else
+    ok_ = runSlice(next_slice_++) && ok_;
+    if (next_slice_ < NUM_SLICES) {
+        return Status::BUSY;
+    }
+    return finish(ok_);
+#endif
+}
+
+AutosaveWriter::Status AutosaveWriter::wait() {
+#ifndef NO_EXCEPTIONS
+    if (!busy_) {
+        return Status::IDLE;
+    }
+
+    bool ok;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [this] { return job_done_; });
+        job_done_ = false;
+        ok = job_ok_;
+    }
+    return finish(ok);
+#else
+    Status status = poll();
+    while (status == Status::BUSY) {
+        status = poll();
+    }
+    return status;
+#endif
+}
+
+void AutosaveWriter::setMappedFile(MappedSongFile* file) {
+    if (!busy_) {
+        mapped_ = file;
+    }
+}
+
+bool AutosaveWriter::runSlice(int slice) {
+    if (mapped_) {
+        return runMappedSlice(slice);
+    }
+
+    if (slice == 0) {
+        if (!incremental_) {
+            snapshot_->encodeBinaryHeader(buffer_);
+        }
+        return true;
+    }
+    if (slice <= Song::NUM_MODES) {
+        int mode_num = slice - 1;
+        if (!incremental_) {
+            snapshot_->encodeBinaryMode(mode_num, buffer_);
+            return true;
+        }
+        for (Mode::PatternMask bits = changed_[mode_num]; bits; bits &= bits - 1) {
+            snapshot_->encodeBinaryPatch(mode_num, lowestSetBit(bits), buffer_);
+        }
+        return true;
+    }
+
+#ifndef NO_EXCEPTIONS
+    bool ok = incremental_ ? SongFormat::appendFile(filepath_, buffer_)
+                           : SongFormat::writeFileAtomic(filepath_, buffer_);
+    written_ = buffer_.size();
+    if (ok) {
+        // The file now covers every journaled edit made before the snapshot
+        std::remove(EditJournal::pathFor(filepath_).c_str());
+    }
+    return ok;
+#else
+    // For embedded: Write to flash/SD
+    // This will be implemented in Teensy-specific code
+    return false;
+#endif
+}
+
+bool AutosaveWriter::runMappedSlice(int slice) {
+    if (slice == 0) {
+        return true;
+    }
+    if (slice <= Song::NUM_MODES) {
+        // Only the touched 512-byte blocks get dirtied in the page cache
+        int mode_num = slice - 1;
+        const auto all = static_cast<Mode::PatternMask>(
+            Mode::NUM_PATTERNS == 64 ? ~uint64_t(0) : (uint64_t(1) << Mode::NUM_PATTERNS) - 1);
+        for (Mode::PatternMask bits = incremental_ ? changed_[mode_num] : all; bits; bits &= bits - 1) {
+            int pattern_num = lowestSetBit(bits);
+            mapped_->setPattern(mode_num, pattern_num, (*snapshot_)[mode_num][pattern_num]);
+            written_ += sizeof(Pattern);
+        }
+        return true;
+    }
+
+    bool ok = mapped_->sync(true);
+#ifndef NO_EXCEPTIONS
+    if (ok) {
+        std::remove(EditJournal::pathFor(filepath_).c_str());
+    }
+#endif
+    return ok;
+}
+
+AutosaveWriter::Status AutosaveWriter::finish(bool ok) {
+    if (ok) {
+        last_size_ = written_;
+    }
+    snapshot_.reset();  // Releases pattern blocks on this thread
+    busy_ = false;
+    return ok ? Status::SAVED : Status::FAILED;
+}
+
+void AutosaveWriter::appendJournal(const std::string& filepath, const std::vector<uint8_t>& batch) {
+#ifndef NO_EXCEPTIONS
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!journal_pending_.empty() && journal_path_ != EditJournal::pathFor(filepath)) {
+            journal_pending_.clear();  // Autosave path changed; the old journal is moot
+        }
+        journal_path_ = EditJournal::pathFor(filepath);
+        journal_pending_.insert(journal_pending_.end(), batch.begin(), batch.end());
+    }
+    wake_.notify_one();
+#else
+    // For embedded: Append to flash/SD
+    // This will be implemented in Teensy-specific code
+    (void)filepath;
+    (void)batch;
+#endif
+}
+
+#ifndef NO_EXCEPTIONS
+void AutosaveWriter::workerLoop() {
+    std::vector<uint8_t> journal;
+    std::string journal_path;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [this] { return job_pending_ || !journal_pending_.empty() || quit_; });
+        if (!job_pending_ && journal_pending_.empty()) {
+            return;  // quit_ with nothing left to do
+        }
+        bool run_job = job_pending_;
+        job_pending_ = false;
+        journal.swap(journal_pending_);
+        journal_pending_.clear();
+        journal_path = journal_path_;
+
+        // snapshot_/filepath_/buffer_ belong to the worker until job_done_ is set
+        lock.unlock();
+        bool ok = true;
+        if (run_job) {
+            for (int slice = 0; slice < NUM_SLICES && ok; ++slice) {
+                ok = runSlice(slice);
+            }
+        }
+        // After the save, which empties the journal: batches taken with the
+        // job may postdate its snapshot. Older ones are harmless to replay.
+        if (!journal.empty()) {
+            SongFormat::appendFile(journal_path, journal);
+            journal.clear();
+        }
+        lock.lock();
+
+        if (run_job) {
+            job_ok_ = ok;
+            job_done_ = true;
+            wake_.notify_all();  // A wait() in progress
+        }
+    }
+}
+#endif
+
+} // namespace gruvbok
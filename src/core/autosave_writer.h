@@ -0,0 +1,116 @@
+#pragma once
+
+#include "song.h"
+#include "mapped_song_file.h"
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+#ifndef NO_EXCEPTIONS
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+namespace gruvbok {
+
+/**
+ * Writes song snapshots to disk off the real-time path
+ *
+ * The engine hands over a copy of the song (cheap: patterns are shared
+ * copy-on-write, so only patterns edited since the last save are copied) and
+ * polls for the result once per update(). The work is split into slices:
+ * header, one slice per mode, then the file write.
+ *
+ * A full save rewrites the file; an incremental save appends one record per
+ * changed pattern to a file written by a full save (see Song::saveBinaryPatch).
+ * With a MappedSongFile attached, saves copy patterns into the mapping
+ * instead (all of them, or just the changed ones) and msync it.
+ *
+ * - Desktop: a worker thread runs all slices; the write is atomic (see SongFormat).
+ * - NO_EXCEPTIONS (embedded): no threads; each poll() runs one slice, so a
+ *   save costs a bounded amount of time per loop.
+ *
+ * The worker only reads the snapshot. The snapshot is created and destroyed
+ * on the polling thread, because the pattern pool is not thread-safe.
+ */
+class AutosaveWriter {
+public:
+    enum class Status {
+        IDLE,    // No save in progress
+        BUSY,    // Save in progress
+        SAVED,   // Last save finished (reported once)
+        FAILED   // Last save failed (reported once)
+    };
+
+    AutosaveWriter();
+    ~AutosaveWriter();  // Waits for a save in progress to finish
+
+    AutosaveWriter(const AutosaveWriter&) = delete;
+    AutosaveWriter& operator=(const AutosaveWriter&) = delete;
+
+    using PatternMasks = std::array<Mode::PatternMask, Song::NUM_MODES>;
+
+    // Start saving snapshot to filepath; returns false (and drops nothing) if busy
+    bool start(std::unique_ptr<Song>& snapshot, const std::string& filepath);
+
+    // Same, but only append the patterns flagged in changed
+    bool startIncremental(std::unique_ptr<Song>& snapshot, const std::string& filepath,
+                          const PatternMasks& changed);
+
+    // Save into a mapped file instead of writing filepath (nullptr = off).
+    // Only while idle; the file must outlive the writer or be detached first.
+    void setMappedFile(MappedSongFile* file);
+
+    // Queue an encoded EditJournal batch for filepath's journal (written in order,
+    // after any save in progress)
+    void appendJournal(const std::string& filepath, const std::vector<uint8_t>& batch);
+
+    // Non-blocking; advances the save on embedded builds
+    Status poll();
+
+    // Blocking: returns once a save in progress has finished, with its result
+    // as poll() would report it (desktop sleeps until the worker is done,
+    // embedded runs the remaining slices)
+    Status wait();
+
+    bool isBusy() const { return busy_; }
+    size_t getLastSize() const { return last_size_; }  // Bytes written (or appended) by the last successful save
+
+    static constexpr int NUM_SLICES = Song::NUM_MODES + 2;  // Header, modes, write
+
+private:
+    bool begin(std::unique_ptr<Song>& snapshot, const std::string& filepath);
+    bool runSlice(int slice);  // false on failure
+    bool runMappedSlice(int slice);
+    Status finish(bool ok);
+
+    std::unique_ptr<Song> snapshot_;
+    std::string filepath_;
+    std::vector<uint8_t> buffer_;
+    bool incremental_;
+    PatternMasks changed_;
+    MappedSongFile* mapped_;
+    bool busy_;
+    size_t written_;
+    size_t last_size_;
+
+#ifndef NO_EXCEPTIONS
+    void workerLoop();
+
+    std::thread worker_;
+    std::mutex mutex_;
+    std::condition_variable wake_;  // Worker: a job or journal batch; wait(): job_done_
+    bool job_pending_;  // Guarded by mutex_
+    bool job_done_;
+    bool job_ok_;
+    bool quit_;
+    std::vector<uint8_t> journal_pending_;
+    std::string journal_path_;
+#else
+    int next_slice_;
+    bool ok_;
+#endif
+};
+
+} // namespace gruvbok
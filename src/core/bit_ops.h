@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+namespace gruvbok {
+
+/**
+ * Small bit-scan helpers for the occupancy masks
+ * (GCC/Clang builtins; portable loops as fallback)
+ */
+
+// Smallest unsigned type with at least Bits bits (mask storage for N items)
+template <int Bits>
+struct MaskFor {
+    static_assert(Bits > 0 && Bits <= 64, "Masks hold at most 64 items");
+    using type = typename std::conditional<(Bits <= 8), uint8_t,
+                 typename std::conditional<(Bits <= 16), uint16_t,
+                 typename std::conditional<(Bits <= 32), uint32_t, uint64_t>::type>::type>::type;
+};
+
+// Index of the lowest set bit (x must be non-zero)
+template <typename T>
+inline int lowestSetBit(T x) {
+#if defined(__GNUC__)
+    return sizeof(T) > 4 ? __builtin_ctzll(static_cast<unsigned long long>(x))
+                         : __builtin_ctz(static_cast<uint32_t>(x));
+#else
+    int n = 0;
+    while (!(x & 1u)) { x >>= 1; ++n; }
+    return n;
+#endif
+}
+
+// Index of the highest set bit (x must be non-zero)
+template <typename T>
+inline int highestSetBit(T x) {
+#if defined(__GNUC__)
+    return sizeof(T) > 4 ? 63 - __builtin_clzll(static_cast<unsigned long long>(x))
+                         : 31 - __builtin_clz(static_cast<uint32_t>(x));
+#else
+    int n = 0;
+    while (x >>= 1) ++n;
+    return n;
+#endif
+}
+
+// Number of set bits
+template <typename T>
+inline int popCount(T x) {
+#if defined(__GNUC__)
+    return sizeof(T) > 4 ? __builtin_popcountll(static_cast<unsigned long long>(x))
+                         : __builtin_popcount(static_cast<uint32_t>(x));
+#else
+    int n = 0;
+    for (; x; x &= x - 1) ++n;
+    return n;
+#endif
+}
+
+} // namespace gruvbok
@@ -0,0 +1,137 @@
+#include "clock_sync.h"
+#include <algorithm>
+#include <cmath>
+
+namespace gruvbok {
+
+ClockSync::ClockSync()
+    : running_(false)
+    , have_clock_(false)
+    , tick_(-1)
+    , last_clock_us_(0)
+    , phase_us_(0.0)
+    , period_us_(0.0)
+    , jitter_us_(0.0)
+    , samples_(0)
+    , outlier_run_(0)
+    , outliers_(0)
+    , song_position_(0) {
+}
+
+void ClockSync::reset() {
+    *this = ClockSync();
+}
+
+ClockSync::Transport ClockSync::receive(const MidiInputEvent& event) {
+    switch (event.data[0]) {
+        case 0xF8:  // Clock
+            receiveClock(event.timestamp_us);
+            return Transport::NONE;
+        case 0xFA:  // Start: the next clock is the first tick of the song
+            running_ = true;
+            song_position_ = 0;
+            tick_ = -1;
+            return Transport::START;
+        case 0xFB:  // Continue from the song position
+            running_ = true;
+            tick_ = static_cast<int64_t>(song_position_) * TICKS_PER_STEP - 1;
+            return Transport::CONTINUE;
+        case 0xFC:  // Stop
+            running_ = false;
+            return Transport::STOP;
+        case 0xF2:  // Song Position Pointer: 14-bit count of 16th notes (only sent while stopped)
+            if (event.size >= 3) {
+                song_position_ = static_cast<uint32_t>(event.data[1] & 0x7F) | (static_cast<uint32_t>(event.data[2] & 0x7F) << 7);
+            }
+            return Transport::NONE;
+        default:
+            return Transport::NONE;
+    }
+}
+
+void ClockSync::receiveClock(uint32_t time_us) {
+    if (running_) {
+        tick_++;
+    }
+
+    if (!have_clock_) {
+        have_clock_ = true;
+        last_clock_us_ = time_us;
+        phase_us_ = 0.0;
+        samples_ = 0;
+        return;
+    }
+
+    double elapsed = static_cast<double>(static_cast<int32_t>(time_us - last_clock_us_));
+    last_clock_us_ = time_us;
+
+    if (period_us_ <= 0.0 || elapsed > TIMEOUT_US) {
+        // Second tick ever, or the clock paused: measure from scratch
+        period_us_ = elapsed > TIMEOUT_US ? period_us_ : elapsed;
+        phase_us_ = 0.0;
+        samples_ = period_us_ > 0.0 ? 1 : 0;
+        outlier_run_ = 0;
+        return;
+    }
+
+    double residual = elapsed - (phase_us_ + period_us_);
+    if (std::fabs(residual) > period_us_ * 0.5) {
+        outliers_++;
+        if (++outlier_run_ < REACQUIRE_OUTLIERS) {
+            // Keep the prediction: where this tick should have been
+            phase_us_ = phase_us_ + period_us_ - elapsed;
+            return;
+        }
+        // The master really changed tempo
+        period_us_ = elapsed;
+        phase_us_ = 0.0;
+        jitter_us_ = 0.0;
+        samples_ = 1;
+        outlier_run_ = 0;
+        return;
+    }
+    outlier_run_ = 0;
+
+    // Expanding-memory gains (a least-squares line through the first n ticks),
+    // settling at the steady-state minimums
+    samples_++;
+    double n = static_cast<double>(samples_);
+    double alpha = std::max(MIN_ALPHA, 2.0 * (2.0 * n - 1.0) / (n * (n + 1.0)));
+    double beta = std::max(MIN_BETA, 6.0 / (n * (n + 1.0)));
+
+    phase_us_ = -(1.0 - alpha) * residual;  // Filtered tick time, relative to this arrival
+    period_us_ += beta * residual;
+    jitter_us_ += (std::fabs(residual) - jitter_us_) / 16.0;
+}
+
+double ClockSync::getPosition(uint32_t now_us) const {
+    if (!have_clock_ || period_us_ <= 0.0) {
+        return static_cast<double>(tick_);
+    }
+    double since = static_cast<double>(static_cast<int32_t>(now_us - last_clock_us_)) - phase_us_;
+    double ticks = std::clamp(since / period_us_, 0.0, 1.0);
+    return static_cast<double>(tick_) + ticks;
+}
+
+bool ClockSync::hasClock(uint32_t now_us) const {
+    return have_clock_ && static_cast<int32_t>(now_us - last_clock_us_) < static_cast<int32_t>(TIMEOUT_US);
+}
+
+bool ClockSync::isLocked(uint32_t now_us) const {
+    return hasClock(now_us) && samples_ >= LOCK_SAMPLES && jitter_us_ < period_us_ * 0.15;
+}
+
+uint8_t ClockSync::getLockQuality(uint32_t now_us) const {
+    if (!hasClock(now_us) || period_us_ <= 0.0) {
+        return 0;
+    }
+    double settled = std::min(1.0, static_cast<double>(samples_) / LOCK_SAMPLES);
+    double steadiness = std::clamp(1.0 - jitter_us_ / (period_us_ * 0.25), 0.0, 1.0);
+    return static_cast<uint8_t>(std::lround(100.0 * settled * steadiness));
+}
+
+double ClockSync::getTempo() const {
+    return period_us_ > 0.0 ? 60000000.0 / (period_us_ * 24.0) : 0.0;
+}
+
+} // namespace gruvbok
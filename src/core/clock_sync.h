@@ -0,0 +1,80 @@
+#pragma once
+
+#include "../hardware/hardware_interface.h"
+#include <cstdint>
+
+namespace gruvbok {
+
+/**
+ * Follows an external MIDI clock (24 PPQN) and transport
+ *
+ * Clock ticks feed an alpha-beta tracker of the tick period and phase. Its
+ * gains start wide (a least-squares fit of the ticks seen so far, so the
+ * tempo is usable within a beat) and settle at fixed minimums that average
+ * out USB/driver jitter over about a beat. A tick far from its predicted
+ * time is ignored as an outlier; several in a row mean the master jumped
+ * tempo, and tracking restarts from there.
+ *
+ * getPosition() extrapolates the filtered phase rather than reporting raw
+ * tick arrivals, so steps timed from it don't inherit the input jitter.
+ * It never runs more than one tick past the last clock received, so a
+ * master that stops sending clock stops the position too.
+ *
+ * Positions are in clock ticks: the first clock after Start is tick 0, the
+ * first after Continue is the last Song Position Pointer (x 6 ticks).
+ */
+class ClockSync {
+public:
+    enum class Transport : uint8_t {
+        NONE,
+        START,
+        CONTINUE,
+        STOP
+    };
+
+    static constexpr int TICKS_PER_STEP = 6;  // 16th-note steps at 24 PPQN
+
+    ClockSync();
+
+    void reset();
+
+    // Feed one received message (non-real-time messages other than Song
+    // Position are ignored); returns the transport change it causes
+    Transport receive(const MidiInputEvent& event);
+
+    // Filtered position in ticks at now_us (same clock as the event timestamps)
+    double getPosition(uint32_t now_us) const;
+
+    bool isRunning() const { return running_; }    // Between Start/Continue and Stop
+    bool hasClock(uint32_t now_us) const;           // A clock arrived recently
+    bool isLocked(uint32_t now_us) const;           // Tempo and phase are trustworthy
+    uint8_t getLockQuality(uint32_t now_us) const;  // 0-100, from the jitter left after filtering
+
+    double getTempo() const;                        // BPM, 0 = not measured yet
+    double getJitterUs() const { return jitter_us_; }  // Mean |tick error| before filtering
+    uint32_t getSongPosition() const { return song_position_; }  // In 16th notes
+    uint32_t getOutliers() const { return outliers_; }          // Ticks rejected as jitter
+
+private:
+    static constexpr double MIN_ALPHA = 0.1;
+    static constexpr double MIN_BETA = MIN_ALPHA * MIN_ALPHA / (2.0 - MIN_ALPHA);
+    static constexpr int LOCK_SAMPLES = 24;        // A beat of clean ticks
+    static constexpr int REACQUIRE_OUTLIERS = 3;   // Consecutive, before restarting
+    static constexpr uint32_t TIMEOUT_US = 250000; // No clock for this long: unlocked
+
+    void receiveClock(uint32_t time_us);
+
+    bool running_;
+    bool have_clock_;
+    int64_t tick_;             // Index of the last tick received (-1 before the first)
+    uint32_t last_clock_us_;   // Raw arrival of the last tick
+    double phase_us_;          // Filtered time of the last tick (relative to last_clock_us_)
+    double period_us_;         // Filtered tick period, 0 = unknown
+    double jitter_us_;
+    int samples_;              // Ticks since tracking (re)started
+    int outlier_run_;
+    uint32_t outliers_;
+    uint32_t song_position_;
+};
+
+} // namespace gruvbok
@@ -0,0 +1,126 @@
+#include "edit_journal.h"
+#include "song_format.h"
+
+namespace gruvbok {
+
+EditJournal::EditJournal()
+    : patterns_{}
+    , has_patterns_(false) {
+}
+
+void EditJournal::recordEvent(int mode, int pattern, int track, int step, uint32_t raw) {
+    events_.push_back({static_cast<uint8_t>(mode), static_cast<uint8_t>(pattern),
+                       static_cast<uint8_t>(track), static_cast<uint8_t>(step), raw});
+}
+
+void EditJournal::recordPattern(int mode, int pattern) {
+    patterns_[mode] |= static_cast<Mode::PatternMask>(Mode::PatternMask(1) << pattern);
+    has_patterns_ = true;
+}
+
+void EditJournal::takeBatch(const Song& song, std::vector<uint8_t>& out) {
+    if (empty()) {
+        return;
+    }
+
+    size_t start = out.size();
+    size_t count = events_.size();
+    for (Mode::PatternMask bits : patterns_) {
+        count += popCount(bits);
+    }
+    SongFormat::putU8(out, BATCH_TAG);
+    SongFormat::putVarint(out, static_cast<uint32_t>(count));
+
+    for (const EventRecord& e : events_) {
+        SongFormat::putU8(out, EVENT_TAG);
+        SongFormat::putU8(out, e.mode);
+        SongFormat::putU8(out, e.pattern);
+        SongFormat::putU8(out, e.track);
+        SongFormat::putU8(out, e.step);
+        SongFormat::putU32(out, e.raw);
+    }
+
+    // Whole patterns last: they hold the latest contents, which must win
+    for (int mode_num = 0; mode_num < Song::NUM_MODES; ++mode_num) {
+        for (Mode::PatternMask bits = patterns_[mode_num]; bits; bits &= bits - 1) {
+            song.encodeBinaryPatch(mode_num, lowestSetBit(bits), out);
+        }
+    }
+
+    SongFormat::putU32(out, SongFormat::crc32(out.data() + start, out.size() - start));
+    clear();
+}
+
+void EditJournal::clear() {
+    events_.clear();
+    patterns_.fill(0);
+    has_patterns_ = false;
+}
+
+int EditJournal::replay(const std::vector<uint8_t>& data, Song& song) {
+    const uint8_t* p = data.data();
+    const uint8_t* end = p + data.size();
+
+    // Parsed records of one batch, applied only once its CRC checks out
+    struct Record {
+        int mode;
+        int pattern;
+        int track;   // -1 = whole pattern
+        int step;
+        uint32_t raw;
+        size_t pattern_index;
+    };
+    std::vector<Record> records;
+    std::vector<Pattern> patterns;
+
+    int batches = 0;
+    while (p != end) {
+        const uint8_t* batch = p;
+        uint8_t tag;
+        uint32_t count;
+        if (!SongFormat::getU8(p, end, tag) || tag != BATCH_TAG || !SongFormat::getVarint(p, end, count)) {
+            break;
+        }
+
+        records.clear();
+        patterns.clear();
+        bool ok = true;
+        for (uint32_t i = 0; i < count && ok; ++i) {
+            if (p != end && *p == EVENT_TAG) {
+                uint8_t kind, mode, pattern, track, step;
+                uint32_t raw;
+                ok = SongFormat::getU8(p, end, kind) && SongFormat::getU8(p, end, mode) &&
+                     SongFormat::getU8(p, end, pattern) && SongFormat::getU8(p, end, track) &&
+                     SongFormat::getU8(p, end, step) && SongFormat::getU32(p, end, raw) &&
+                     mode < Song::NUM_MODES && pattern < Mode::NUM_PATTERNS &&
+                     track < Pattern::NUM_TRACKS && step < Track::NUM_EVENTS;
+                records.push_back({mode, pattern, track, step, raw, 0});
+            } else {
+                Record r{0, 0, -1, 0, 0, patterns.size()};
+                patterns.emplace_back();
+                ok = Song::decodeBinaryPatch(p, end, r.mode, r.pattern, patterns.back());
+                records.push_back(r);
+            }
+        }
+
+        uint32_t crc;
+        if (!ok || !SongFormat::getU32(p, end, crc) ||
+            crc != SongFormat::crc32(batch, static_cast<size_t>(p - 4 - batch))) {
+            break;  // Torn or corrupt: this and anything after it is lost
+        }
+
+        for (const Record& r : records) {
+            if (r.track < 0) {
+                song.getMode(r.mode).setPattern(r.pattern, patterns[r.pattern_index]);
+            } else {
+                Event event;
+                event.setRawData(r.raw);
+                song.setEvent(r.mode, r.pattern, r.track, r.step, event);
+            }
+        }
+        batches++;
+    }
+    return batches;
+}
+
+} // namespace gruvbok
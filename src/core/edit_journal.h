@@ -0,0 +1,68 @@
+#pragma once
+
+#include "song.h"
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace gruvbok {
+
+/**
+ * Write-ahead journal of song edits, for crash recovery between autosaves
+ *
+ * The engine records every edit here and hands the encoded batch to the
+ * AutosaveWriter every few hundred ms, which appends it to
+ * "<autosave file>.journal". A completed autosave covers everything recorded
+ * before it, so the writer then empties the journal. Recovery loads the
+ * autosave and replays the journal on top (see replay()).
+ *
+ * Records hold absolute values, so replaying edits the snapshot already
+ * contains is harmless.
+ *
+ * Journal file: a sequence of batches
+ *   u8 'B', varint record count, records, u32 CRC32 of the batch before it
+ * Records:
+ *   u8 'E', u8 mode, u8 pattern, u8 track, u8 step, u32 raw event
+ *   a pattern record as appended to binary song files (Song::encodeBinaryPatch)
+ * Replay stops at the first batch that doesn't check out (a torn append).
+ */
+class EditJournal {
+public:
+    EditJournal();
+
+    // Record edits (cheap; nothing is encoded until takeBatch())
+    void recordEvent(int mode, int pattern, int track, int step, uint32_t raw);
+    void recordPattern(int mode, int pattern);  // Whole pattern, contents taken at takeBatch()
+
+    bool empty() const { return events_.empty() && !has_patterns_; }
+    size_t size() const { return events_.size(); }
+
+    // Encode the pending records as one batch (appended to out) and drop them
+    void takeBatch(const Song& song, std::vector<uint8_t>& out);
+
+    // Drop pending records (a save that covers them has started)
+    void clear();
+
+    // Apply a journal file to song; returns the number of batches applied
+    static int replay(const std::vector<uint8_t>& data, Song& song);
+    static std::string pathFor(const std::string& song_path) { return song_path + ".journal"; }
+
+private:
+    struct EventRecord {
+        uint8_t mode;
+        uint8_t pattern;
+        uint8_t track;
+        uint8_t step;
+        uint32_t raw;
+    };
+
+    std::vector<EventRecord> events_;
+    std::array<Mode::PatternMask, Song::NUM_MODES> patterns_;
+    bool has_patterns_;
+
+    static constexpr uint8_t BATCH_TAG = 'B';
+    static constexpr uint8_t EVENT_TAG = 'E';
+};
+
+} // namespace gruvbok
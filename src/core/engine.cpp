@@ -1,6 +1,9 @@
 #include "engine.h"
-#include <iostream>
+#include "bit_ops.h"
+#include "song_format.h"
+#include "log.h"
 #include <algorithm>
+#include <cmath>
 
 namespace gruvbok {
 
@@ -20,12 +23,40 @@ Engine::Engine(Song* song, HardwareInterface* hardware, ModeLoader* mode_loader)
     , global_scale_root_(0)  // C
     , global_scale_type_(0)  // Ionian/Major
     , dirty_(false)
+    , dirty_all_(false)
+    , dirty_patterns_{}
     , last_autosave_time_(0)
+    , autosave_path_("/tmp/gruvbok_autosave.bin")
+    , autosave_writer_(std::make_unique<AutosaveWriter>())
+    , autosave_file_valid_(false)
+    , autosave_records_(0)
+    , last_journal_flush_time_(0)
+    , undo_pattern_count_(0)
+    , undo_chord_held_(false)
+    , b16_alone_(false)
+    , buttons_down_{}
+    , commands_run_(0)
+    , midi_input_count_(0)
+    , midi_input_history_{}
+    , live_input_count_(0)
+    , live_latency_count_(0)
+    , live_latency_us_(0)
+    , live_latency_max_us_(0)
+    , live_latency_total_us_(0)
+    , snapshot_version_(0)
+    , mode_meters_{}
+    , song_loader_(std::make_unique<SongLoader>())
+    , bars_since_song_change_(0)
+    , song_changes_(0)
+    , song_load_failures_(0)
     , last_step_time_(0)
     , step_interval_ms_(0)
     , clock_start_time_(0)
     , clock_pulse_count_(0)
     , clock_interval_ms_(0.0)
+    , sync_mode_(SyncMode::INTERNAL)
+    , next_step_tick_(0)
+    , next_clock_tick_(0)
     , led_pattern_(LEDPattern::TEMPO_BEAT)
     , led_on_(false)
     , led_brightness_(255)
@@ -33,7 +64,8 @@ Engine::Engine(Song* song, HardwareInterface* hardware, ModeLoader* mode_loader)
     , led_phase_start_time_(0)
     , led_blink_count_(0)
     , lua_reinit_pending_(false)
-    , last_tempo_change_time_(0) {
+    , last_tempo_change_time_(0)
+    , background_next_mode_(1) {
 
     // Validate required dependencies
     // For embedded builds (Teensy), these should never be null
@@ -45,6 +77,9 @@ Engine::Engine(Song* song, HardwareInterface* hardware, ModeLoader* mode_loader)
         mode_velocity_offsets_[i] = 0;
         mode_pattern_overrides_[i] = -1;  // -1 means use default pattern
     }
+    for (auto& channel : live_note_modes_) {
+        std::fill(std::begin(channel), std::end(channel), -1);
+    }
 
     // Set sensible default instruments for each mode (General MIDI)
     mode_programs_[0] = 0;    // Mode 0: Song sequencer (no MIDI output)
@@ -84,6 +119,13 @@ void Engine::start() {
     clock_start_time_ = last_step_time_;
     clock_pulse_count_ = 0;
 
+    // Following a master: join its grid at its next 16th (tick 0 right after a Start)
+    if (sync_mode_ == SyncMode::EXTERNAL) {
+        double position = std::max(0.0, clock_sync_.getPosition(hardware_->getMicros()));
+        next_clock_tick_ = static_cast<int64_t>(std::ceil(position));
+        next_step_tick_ = static_cast<int64_t>(std::ceil(position / ClockSync::TICKS_PER_STEP)) * ClockSync::TICKS_PER_STEP;
+    }
+
     // Initialize Lua modes and send Program Change messages for all instruments
     reinitLuaModes();
 
@@ -94,12 +136,22 @@ void Engine::start() {
 void Engine::stop() {
     is_playing_ = false;
     scheduler_->clear();
+    releaseLiveNotes();
 
     // Send MIDI stop message
     scheduler_->sendStop();
 }
 
 void Engine::update() {
+    // Edits from other threads land here, before anything reads the song this tick
+    processCommands();
+
+    // Patterns edited since the last update are done with: record them for undo
+    flushPatternEdits();
+
+    // Incoming MIDI the hardware queued since the last update
+    processMidiInput();
+
     // Update MIDI scheduler
     scheduler_->update();
 
@@ -118,10 +170,22 @@ void Engine::update() {
     // Check for autosave (dirty flag + 20 second timer)
     checkAutosave();
 
+    // Pick up songs loaded in the background
+    checkSongQueue();
+
     // Handle input
     handleInput();
 
     if (!is_playing_) {
+        runBackgroundSlice();
+        publishSnapshot();
+        return;
+    }
+
+    if (sync_mode_ == SyncMode::EXTERNAL) {
+        followExternalClock();
+        runBackgroundSlice();
+        publishSnapshot();
         return;
     }
 
@@ -140,23 +204,371 @@ void Engine::update() {
 
     // Check if it's time for next step
     if (current_time - last_step_time_ >= step_interval_ms_) {
-        processStep();
+        playStep();
         last_step_time_ = current_time;
+        advanceStep();
+    }
+
+    // Spend leftover time before the next step on background work
+    runBackgroundSlice();
+    publishSnapshot();
+}
+
+void Engine::playStep() {
+    // Song changes land on a bar boundary, before the bar's first step
+    if (current_step_ == 0 && next_song_ && bars_since_song_change_ >= song_queue_.front().bars) {
+        swapInNextSong();
+    }
+
+    processStep();
+}
+
+void Engine::advanceStep() {
+    current_step_ = (current_step_ + 1) % 16;
+
+    // Mode 0 runs at 1/16th speed: advance song_mode_step_ when current_step_ wraps to 0
+    if (current_step_ == 0) {
+        bars_since_song_change_++;
+        int old_step = song_mode_step_;
+        song_mode_step_ = (song_mode_step_ + 1) % song_mode_loop_length_;
+        logDebug(LogCategory::ENGINE, "Mode 0 step: %d -> %d (loop length: %d)",
+                 old_step, song_mode_step_, song_mode_loop_length_);
+    }
+}
+
+void Engine::setSyncMode(SyncMode mode) {
+    if (mode == sync_mode_) {
+        return;
+    }
+    if (is_playing_) {
+        stop();
+    }
+    sync_mode_ = mode;
+}
+
+void Engine::followTransport(ClockSync::Transport transport) {
+    switch (transport) {
+        case ClockSync::Transport::START:
+            start();
+            break;
+        case ClockSync::Transport::CONTINUE: {
+            // Pick up at the master's Song Position (in 16ths), which a Start would reset
+            uint32_t position = clock_sync_.getSongPosition();
+            is_playing_ = true;
+            current_step_ = static_cast<int>(position % 16);
+            song_mode_step_ = static_cast<int>((position / 16) % static_cast<uint32_t>(song_mode_loop_length_));
+            last_step_time_ = hardware_->getMillis();
+            next_step_tick_ = static_cast<int64_t>(position) * ClockSync::TICKS_PER_STEP;
+            next_clock_tick_ = next_step_tick_;
+            reinitLuaModes();
+            scheduler_->sendContinue();
+            break;
+        }
+        case ClockSync::Transport::STOP:
+            if (is_playing_) {
+                stop();
+            }
+            break;
+        case ClockSync::Transport::NONE:
+            break;
+    }
+}
 
-        // Advance step
-        current_step_ = (current_step_ + 1) % 16;
+void Engine::followExternalClock() {
+    uint32_t now_us = hardware_->getMicros();
+    double position = clock_sync_.getPosition(now_us);
 
-        // Mode 0 runs at 1/16th speed: advance song_mode_step_ when current_step_ wraps to 0
-        if (current_step_ == 0) {
-            int old_step = song_mode_step_;
-            song_mode_step_ = (song_mode_step_ + 1) % song_mode_loop_length_;
-            // Debug logging for Mode 0 step advancement
-            std::cout << "Mode 0 step: " << old_step << " -> " << song_mode_step_
-                     << " (loop length: " << song_mode_loop_length_ << ")" << std::endl;
+    // Pass the clock on, timed from the filtered position rather than the raw (jittery) arrivals
+    while (static_cast<double>(next_clock_tick_) <= position) {
+        sendMidiClock();
+        next_clock_tick_++;
+    }
+
+    if (position >= static_cast<double>(next_step_tick_)) {
+        playStep();
+        last_step_time_ = hardware_->getMillis();
+        advanceStep();
+        next_step_tick_ += ClockSync::TICKS_PER_STEP;
+
+        // A whole step behind (clock burst after a stall): skip the missed steps
+        // rather than play them back to back
+        while (position >= static_cast<double>(next_step_tick_)) {
+            advanceStep();
+            next_step_tick_ += ClockSync::TICKS_PER_STEP;
+        }
+    }
+
+    // Follow the master's tempo once it's trustworthy (step length for background
+    // work, Lua modes' tempo); a whole BPM of hysteresis keeps jitter from retriggering reinits
+    if (clock_sync_.isLocked(now_us)) {
+        double tempo = clock_sync_.getTempo();
+        if (std::fabs(tempo - tempo_) >= 1.0) {
+            setTempo(static_cast<int>(std::lround(tempo)));
+        }
+    }
+}
+
+void Engine::publishSnapshot() {
+    EngineSnapshot& snap = snapshots_.getWriteBuffer();
+    snap.version = ++snapshot_version_;
+    snap.time_ms = hardware_->getMillis();
+
+    snap.playing = is_playing_;
+    snap.tempo = tempo_;
+
+    uint32_t now_us = hardware_->getMicros();
+    snap.external_sync = sync_mode_ == SyncMode::EXTERNAL;
+    snap.sync_locked = clock_sync_.isLocked(now_us);
+    snap.sync_quality = clock_sync_.getLockQuality(now_us);
+    snap.sync_tempo = static_cast<float>(clock_sync_.getTempo());
+    snap.sync_jitter_ms = static_cast<float>(clock_sync_.getJitterUs() / 1000.0);
+
+    snap.mode = current_mode_;
+    snap.pattern = current_pattern_;
+    snap.track = current_track_;
+    snap.step = current_step_;
+    snap.song_mode_step = song_mode_step_;
+    snap.song_mode_loop_length = song_mode_loop_length_;
+    snap.target_mode = target_mode_;
+
+    snap.dirty = dirty_;
+    snap.autosaving = autosave_writer_->isBusy();
+    snap.can_undo = canUndo();
+    snap.can_redo = canRedo();
+    snap.song_changes = song_changes_;
+    snap.queued_songs = static_cast<int>(song_queue_.size());
+    snap.song_load_failures = song_load_failures_;
+    snap.song_name[song_name_.copy(snap.song_name, sizeof(snap.song_name) - 1)] = '\0';
+    snap.song_path[song_path_.copy(snap.song_path, sizeof(snap.song_path) - 1)] = '\0';
+
+    snap.led_on = led_on_;
+    snap.led_brightness = led_brightness_;
+    snap.led_pattern = static_cast<uint8_t>(led_pattern_);
+
+    const MidiScheduler::NoteMask& notes = scheduler_->getActiveNotes();
+    for (int channel = 0; channel < 16; ++channel) {
+        for (int word = 0; word < 4; ++word) {
+            snap.active_notes[channel][word] = notes[channel][word];
+        }
+    }
+    for (int mode = 0; mode < Song::NUM_MODES; ++mode) {
+        snap.mode_meters[mode] = mode_meters_[mode];
+    }
+
+    snap.midi_input_count = midi_input_count_;
+    for (int i = 0; i < EngineSnapshot::MIDI_INPUT_HISTORY; ++i) {
+        snap.midi_input[i] = midi_input_history_[i];
+    }
+
+    snap.live_input_count = live_input_count_;
+    snap.live_latency_count = live_latency_count_;
+    snap.live_latency_us = live_latency_us_;
+    snap.live_latency_avg_us = live_latency_count_ ? static_cast<uint32_t>(live_latency_total_us_ / live_latency_count_) : 0;
+    snap.live_latency_max_us = live_latency_max_us_;
+
+    const MidiScheduler::ControllerStats& controllers = scheduler_->getControllerStats();
+    snap.controller_rate_limit = scheduler_->getControllerRateLimit(MidiScheduler::Port::EXTERNAL);
+    snap.controllers_coalesced = controllers.coalesced;
+    snap.controllers_repeats = controllers.repeats;
+    snap.controllers_deferred = controllers.deferred;
+
+    // Same choice of track as handleInput(): Mode 0 buttons edit its pattern sequence
+    snap.edit_mode = current_mode_;
+    snap.edit_pattern = current_mode_ == 0 ? 0 : current_pattern_;
+    snap.edit_track = current_mode_ == 0 ? 0 : current_track_;
+    const Song& song = *song_;
+    const Track& track = song.getMode(current_mode_).getPattern(current_pattern_).getTrack(current_track_);
+    const Track& edit_track = song.getMode(snap.edit_mode).getPattern(snap.edit_pattern).getTrack(snap.edit_track);
+    for (int step = 0; step < Track::NUM_EVENTS; ++step) {
+        snap.track_events[step] = track[step];
+        snap.edit_events[step] = edit_track[step];
+    }
+
+    snapshots_.publish();
+}
+
+bool Engine::postCommand(EngineCommand command, CommandReply* reply) {
+    command.reply = reply;
+    return commands_.push(command);
+}
+
+void Engine::processMidiInput() {
+    MidiInputEvent event;
+    while (hardware_->readMidiInput(event)) {
+        midi_input_history_[midi_input_count_ % EngineSnapshot::MIDI_INPUT_HISTORY] = event;
+        midi_input_count_++;
+
+        // Clock and transport are tracked either way, so switching to external sync locks at once
+        ClockSync::Transport transport = clock_sync_.receive(event);
+        if (sync_mode_ == SyncMode::EXTERNAL) {
+            followTransport(transport);
         }
+
+        playLiveInput(event);
     }
 }
 
+void Engine::playLiveInput(const MidiInputEvent& event) {
+    if (!mode_loader_ || event.data[0] < 0x80 || event.data[0] >= 0xF0) {
+        return;  // Channel messages only
+    }
+
+    // The mode being edited (in Mode 0, the target mode)
+    int mode_num = current_mode_ == 0 ? target_mode_ : current_mode_;
+
+    // A note-off goes to the mode that took its note-on, whatever is selected now
+    uint8_t type = event.data[0] & 0xF0;
+    int8_t& held_by = live_note_modes_[event.data[0] & 0x0F][event.data[1] & 0x7F];
+    bool note_on = event.size >= 3 && type == 0x90 && event.data[2] > 0;
+    bool note_off = event.size >= 3 && (type == 0x80 || (type == 0x90 && event.data[2] == 0));
+    if (note_off && held_by >= 0) {
+        mode_num = held_by;
+        held_by = -1;
+    }
+
+    LuaContext* lua_mode = mode_loader_->getMode(mode_num);
+    if (!lua_mode || !lua_mode->isValid() || !lua_mode->getManifest().has_input_hook) {
+        return;
+    }
+    if (note_on) {
+        held_by = static_cast<int8_t>(mode_num);
+    }
+
+    live_input_count_++;
+    if (!runInputHook(mode_num, event)) {
+        return;
+    }
+
+    live_latency_us_ = hardware_->getMicros() - event.timestamp_us;
+    live_latency_max_us_ = std::max(live_latency_max_us_, live_latency_us_);
+    live_latency_total_us_ += live_latency_us_;
+    live_latency_count_++;
+}
+
+bool Engine::runInputHook(int mode_num, const MidiInputEvent& event) {
+    LuaContext* lua_mode = mode_loader_->getMode(mode_num);
+    if (!lua_mode || !lua_mode->isValid() || !lua_mode->getManifest().has_input_hook) {
+        return false;
+    }
+
+    std::vector<ScheduledMidiEvent> output = lua_mode->callProcessInput(event);
+    if (output.empty()) {
+        return false;
+    }
+
+    // Send now instead of at the next update(); delayed events wait in the scheduler
+    scheduler_->schedule(output);
+    scheduler_->update();
+    updateMeter(mode_num, output);
+    return true;
+}
+
+void Engine::releaseLiveNotes() {
+    if (!mode_loader_) {
+        return;
+    }
+    for (int channel = 0; channel < 16; ++channel) {
+        for (int note = 0; note < 128; ++note) {
+            int8_t& held_by = live_note_modes_[channel][note];
+            if (held_by < 0) {
+                continue;
+            }
+            MidiInputEvent note_off = {hardware_->getMicros(), 3,
+                                       {static_cast<uint8_t>(0x80 | channel), static_cast<uint8_t>(note), 0}};
+            int mode_num = held_by;
+            held_by = -1;
+            runInputHook(mode_num, note_off);
+        }
+    }
+}
+
+void Engine::processCommands() {
+    EngineCommand command{};
+    while (commands_.pop(command)) {
+        int value = 0;
+        bool ok = runCommand(command, value);
+        if (command.reply) {
+            command.reply->complete(ok ? CommandReply::Status::DONE : CommandReply::Status::REJECTED, value);
+        }
+        commands_run_.fetch_add(1, std::memory_order_release);
+    }
+}
+
+bool Engine::runCommand(const EngineCommand& command, int& value) {
+    using Type = EngineCommand::Type;
+    bool mode_ok = command.mode < Song::NUM_MODES;
+    bool pattern_ok = command.pattern < Mode::NUM_PATTERNS;
+    bool track_ok = command.track < Pattern::NUM_TRACKS;
+    bool address_ok = mode_ok && pattern_ok && track_ok && command.step < Track::NUM_EVENTS;
+
+    switch (command.type) {
+        case Type::SET_EVENT: {
+            if (!address_ok) return false;
+            Event event;
+            event.setRawData(command.raw);
+            setEvent(command.mode, command.pattern, command.track, command.step, event);
+            if (command.mode == 0) {
+                calculateMode0LoopLength();
+            }
+            return true;
+        }
+        case Type::SET_EVENT_POT:
+            if (!address_ok || command.pot >= 4) return false;
+            setEventPot(command.mode, command.pattern, command.track, command.step, command.pot,
+                        static_cast<uint8_t>(std::clamp(command.value, 0, 127)));
+            return true;
+        case Type::BEGIN_EDIT:
+            beginEdit();
+            return true;
+        case Type::END_EDIT:
+            endEdit();
+            return true;
+        case Type::UNDO:
+            value = undo() ? 1 : 0;
+            return true;
+        case Type::REDO:
+            value = redo() ? 1 : 0;
+            return true;
+        case Type::START:
+            start();
+            return true;
+        case Type::STOP:
+            stop();
+            return true;
+        case Type::SET_TEMPO:
+            setTempo(command.value);
+            return true;
+        case Type::SET_MODE:
+            if (!mode_ok) return false;
+            setMode(command.mode);
+            return true;
+        case Type::SET_PATTERN:
+            if (!pattern_ok) return false;
+            setPattern(command.pattern);
+            return true;
+        case Type::SET_TRACK:
+            if (!track_ok) return false;
+            setTrack(command.track);
+            return true;
+        case Type::SET_MODE_PROGRAM:
+            if (!mode_ok) return false;
+            setModeProgram(command.mode, static_cast<uint8_t>(std::clamp(command.value, 0, 127)));
+            return true;
+        case Type::SET_SYNC_MODE:
+            setSyncMode(command.value ? SyncMode::EXTERNAL : SyncMode::INTERNAL);
+            return true;
+        case Type::SET_CONTROLLER_RATE_LIMIT:
+            if (command.raw > static_cast<uint32_t>(MidiScheduler::Port::INTERNAL)) return false;
+            setControllerRateLimit(static_cast<MidiScheduler::Port>(command.raw),
+                                   static_cast<uint32_t>(std::max(command.value, 0)));
+            return true;
+        case Type::RESTORE_AUTOSAVE:
+            value = restoreAutosave() ? 1 : 0;
+            return true;
+    }
+    return false;
+}
+
 void Engine::setTempo(int bpm) {
     tempo_ = std::clamp(bpm, 1, 1000);
     calculateStepInterval();
@@ -186,23 +598,21 @@ void Engine::setTrack(int track) {
 }
 
 void Engine::toggleCurrentSwitch() {
-    Mode& mode = song_->getMode(current_mode_);
-    Pattern& pattern = mode.getPattern(current_pattern_);
-    Event& event = pattern.getEvent(current_track_, current_step_);
+    const Song& song = *song_;
+    Event event = song.getMode(current_mode_).getPattern(current_pattern_).getEvent(current_track_, current_step_);
 
     event.setSwitch(!event.getSwitch());
-    markDirty();
+    setEvent(current_mode_, current_pattern_, current_track_, current_step_, event);
 }
 
 void Engine::setCurrentPot(int pot, uint8_t value) {
     if (pot < 0 || pot >= 4) return;
 
-    Mode& mode = song_->getMode(current_mode_);
-    Pattern& pattern = mode.getPattern(current_pattern_);
-    Event& event = pattern.getEvent(current_track_, current_step_);
+    const Song& song = *song_;
+    Event event = song.getMode(current_mode_).getPattern(current_pattern_).getEvent(current_track_, current_step_);
 
     event.setPot(pot, value);
-    markDirty();
+    setEvent(current_mode_, current_pattern_, current_track_, current_step_, event);
 }
 
 void Engine::setEventPot(int mode, int pattern, int track, int step, int pot, uint8_t value) {
@@ -213,13 +623,150 @@ void Engine::setEventPot(int mode, int pattern, int track, int step, int pot, ui
     if (step < 0 || step >= Track::NUM_EVENTS) return;
     if (pot < 0 || pot >= 4) return;
 
-    // Get the event and set the pot value directly
-    Mode& m = song_->getMode(mode);
-    Pattern& p = m.getPattern(pattern);
-    Event& e = p.getEvent(track, step);
+    // Copy the event, change one pot, write it back
+    const Song& song = *song_;
+    Event e = song.getMode(mode).getPattern(pattern).getEvent(track, step);
 
     e.setPot(pot, value);
-    markDirty();
+    setEvent(mode, pattern, track, step, e);
+}
+
+void Engine::setEvent(int mode, int pattern, int track, int step, const Event& event) {
+    // Bounds checking
+    if (mode < 0 || mode >= Song::NUM_MODES) return;
+    if (pattern < 0 || pattern >= Mode::NUM_PATTERNS) return;
+    if (track < 0 || track >= Pattern::NUM_TRACKS) return;
+    if (step < 0 || step >= Track::NUM_EVENTS) return;
+
+    // All edits funnel through here: Song::setEvent keeps the occupancy masks current
+    const Song& song = *song_;
+    const Event& e = song.getMode(mode).getPattern(pattern).getEvent(track, step);
+    if (e.getRawData() == event.getRawData()) return;  // No change, keep cache and dirty flag as they are
+
+    flushPatternEdits();  // Keeps the history in edit order
+    undo_history_.record(mode, pattern, track, step, e.getRawData(), event.getRawData());
+    writeEvent(mode, pattern, track, step, event);
+}
+
+void Engine::writeEvent(int mode, int pattern, int track, int step, const Event& event) {
+    song_->setEvent(mode, pattern, track, step, event);
+    invalidateBarCache(mode, pattern, step);
+    markDirty(mode, pattern);
+    journal_.recordEvent(mode, pattern, track, step, event.getRawData());
+}
+
+Pattern* Engine::editPattern(int mode, int pattern) {
+    if (mode < 0 || mode >= Song::NUM_MODES) return nullptr;
+    if (pattern < 0 || pattern >= Mode::NUM_PATTERNS) return nullptr;
+
+    // Keep the pattern as it was so undo can diff it later
+    bool pending = false;
+    for (int i = 0; i < undo_pattern_count_; ++i) {
+        pending |= undo_patterns_[i].mode == mode && undo_patterns_[i].pattern == pattern;
+    }
+    if (!pending) {
+        if (undo_pattern_count_ == static_cast<int>(undo_patterns_.size())) {
+            flushPatternEdits();
+        }
+        const Song& song = *song_;
+        undo_patterns_[undo_pattern_count_++] = {mode, pattern, song.getMode(mode).getPattern(pattern)};
+    }
+
+    // Non-const access marks the pattern's occupancy masks stale
+    Pattern& p = song_->getMode(mode).getPattern(pattern);
+    invalidateBarCache(mode, pattern);
+    markDirty(mode, pattern);
+    journal_.recordPattern(mode, pattern);
+    return &p;
+}
+
+void Engine::flushPatternEdits() {
+    if (undo_pattern_count_ == 0) {
+        return;
+    }
+
+    // Everything held at once is one undo step (e.g. both sides of a swap)
+    undo_history_.beginTransaction();
+    const Song& song = *song_;
+    for (int i = 0; i < undo_pattern_count_; ++i) {
+        const PendingPattern& edit = undo_patterns_[i];
+        const Pattern& after = song.getMode(edit.mode).getPattern(edit.pattern);
+        for (int track = 0; track < Pattern::NUM_TRACKS; ++track) {
+            for (int step = 0; step < Track::NUM_EVENTS; ++step) {
+                undo_history_.record(edit.mode, edit.pattern, track, step,
+                                     edit.before[track][step].getRawData(), after[track][step].getRawData());
+            }
+        }
+    }
+    undo_pattern_count_ = 0;
+    undo_history_.endTransaction();
+}
+
+void Engine::beginEdit() {
+    flushPatternEdits();  // Pattern edits before this belong to the previous step
+    undo_history_.beginTransaction();
+}
+
+void Engine::endEdit() {
+    flushPatternEdits();
+    undo_history_.endTransaction();
+}
+
+bool Engine::undo() {
+    flushPatternEdits();
+    bool mode0 = false;
+    bool ok = undo_history_.undo([&](int mode, int pattern, int track, int step, uint32_t raw) {
+        Event event;
+        event.setRawData(raw);
+        writeEvent(mode, pattern, track, step, event);
+        mode0 |= mode == 0;
+    });
+    if (mode0) {
+        calculateMode0LoopLength();
+    }
+    return ok;
+}
+
+bool Engine::redo() {
+    flushPatternEdits();
+    bool mode0 = false;
+    bool ok = undo_history_.redo([&](int mode, int pattern, int track, int step, uint32_t raw) {
+        Event event;
+        event.setRawData(raw);
+        writeEvent(mode, pattern, track, step, event);
+        mode0 |= mode == 0;
+    });
+    if (mode0) {
+        calculateMode0LoopLength();
+    }
+    return ok;
+}
+
+void Engine::clearUndoHistory() {
+    undo_history_.clear();
+    undo_pattern_count_ = 0;
+}
+
+void Engine::invalidateRenderCache() {
+    for (auto& mode_caches : bar_cache_) {
+        for (auto& cache : mode_caches) {
+            if (cache) cache->rendered_steps = 0;
+        }
+    }
+}
+
+void Engine::invalidateBarCache(int mode, int pattern, int step) {
+    BarCache* cache = bar_cache_[mode][pattern].get();
+    if (cache) {
+        cache->rendered_steps &= static_cast<uint16_t>(~(1u << step));
+    }
+}
+
+void Engine::invalidateBarCache(int mode, int pattern) {
+    BarCache* cache = bar_cache_[mode][pattern].get();
+    if (cache) {
+        cache->rendered_steps = 0;
+    }
 }
 
 void Engine::calculateStepInterval() {
@@ -248,9 +795,23 @@ void Engine::processStep() {
         applyMode0Parameters();
     }
 
+    // Meters fall by a quarter per step unless this step's notes push them up
+    for (uint8_t& meter : mode_meters_) {
+        meter = static_cast<uint8_t>(meter < 4 ? 0 : meter - meter / 4);
+    }
+
     // Determine which pattern to play for each mode
     // Mode 0: Follow pattern sequence from mode_pattern_overrides_
     // Modes 1-15: Loop current_pattern_ only (for editing)
+    //
+    // Each mode renders into its own buffer; the buffers are scheduled in mode
+    // order afterwards. With a mode pool, consecutive PARALLEL_SAFE modes render
+    // together on the pool. They can't edit the song, so the output is the same
+    // as rendering one mode after another; any other mode renders alone, in order,
+    // after the modes before it (its pattern edits may change what later modes see).
+    const Song& song = *song_;
+    int scheduled_count = 0;
+    int batch_start = 0;
     for (int mode_num = 1; mode_num < Song::NUM_MODES; ++mode_num) {
         int pattern_to_play;
 
@@ -264,25 +825,56 @@ void Engine::processStep() {
             pattern_to_play = current_pattern_;
         }
 
-        Mode& mode = song_->getMode(mode_num);
-        Pattern& pattern = mode.getPattern(pattern_to_play);
+        const Mode& mode = song.getMode(mode_num);
 
         LuaContext* lua_mode = mode_loader_->getMode(mode_num);
+        if (!lua_mode || !lua_mode->isValid()) {
+            continue;
+        }
 
-        if (lua_mode && lua_mode->isValid()) {
-            // Process all tracks for this mode
-            for (int track = 0; track < Pattern::NUM_TRACKS; ++track) {
-                const Event& event = pattern.getEvent(track, current_step_);
-
-                // Call Lua to process event
-                // TODO: Pass global scale and velocity offset to Lua
-                auto midi_events = lua_mode->callProcessEvent(track, event);
+        // Empty pattern: nothing to do for modes that only react to switch-on events
+        if (!lua_mode->getManifest().wants_switch_off && mode.getTrackMask(pattern_to_play) == 0) {
+            continue;
+        }
 
-                // Schedule returned MIDI events
-                scheduler_->schedule(midi_events);
+        StepJob& job = step_jobs_[scheduled_count++];
+        job.mode_num = mode_num;
+        job.pattern = pattern_to_play;
+        job.lua_mode = lua_mode;
+        job.render = true;
+
+        if (lua_mode->isDeterministic()) {
+            // Deterministic mode: render this step once, then replay it on every loop
+            std::unique_ptr<BarCache>& cache = bar_cache_[mode_num][pattern_to_play];
+            if (!cache) {
+                cache = std::make_unique<BarCache>();
             }
+            if (cache->generation != lua_mode->getGeneration()) {
+                cache->generation = lua_mode->getGeneration();
+                cache->rendered_steps = 0;
+            }
+
+            uint16_t step_bit = static_cast<uint16_t>(1u << current_step_);
+            job.output = &cache->steps[current_step_];
+            job.render = !(cache->rendered_steps & step_bit);
+            cache->rendered_steps |= step_bit;
+        } else {
+            // TODO: Pass global scale and velocity offset to Lua
+            job.output = &mode_output_[mode_num];
+        }
+
+        if (!mode_pool_ || !lua_mode->getManifest().parallel_safe) {
+            renderStepJobs(batch_start, scheduled_count - 1);  // Everything before this mode
+            renderStepJobs(scheduled_count - 1, scheduled_count);
+            batch_start = scheduled_count;
         }
     }
+    renderStepJobs(batch_start, scheduled_count);
+
+    for (int i = 0; i < scheduled_count; ++i) {
+        scheduler_->schedule(*step_jobs_[i].output);
+        updateMeter(step_jobs_[i].mode_num, *step_jobs_[i].output);
+    }
 
     // LED tempo indicator: blink on every beat (every 4 steps)
     if (current_step_ % 4 == 0) {
@@ -290,6 +882,85 @@ void Engine::processStep() {
     }
 }
 
+void Engine::renderStepJobs(int first, int last) {
+    const Song& song = *song_;  // Const access: non-const getMode() marks the mode stale
+    auto render = [this, first, &song](int i) {
+        StepJob& job = step_jobs_[first + i];
+        if (job.render) {
+            job.output->clear();
+            renderModeStep(job.lua_mode, song.getMode(job.mode_num), job.pattern, *job.output);
+        }
+    };
+    if (last - first > 1 && mode_pool_) {
+        mode_pool_->run(last - first, render);
+    } else {
+        for (int i = 0; i < last - first; ++i) {
+            render(i);
+        }
+    }
+}
+
+void Engine::setModeThreads(int threads) {
+    // Desktop only: NO_EXCEPTIONS builds have no threads to run modes on
+#ifndef NO_EXCEPTIONS
+    threads = std::clamp(threads, 0, Song::NUM_MODES - 1);
+    mode_pool_.reset(threads > 0 ? new WorkerPool(threads) : nullptr);
+#else
+    (void)threads;
+#endif
+}
+
+int Engine::getModeThreads() const {
+    return mode_pool_ ? mode_pool_->getThreadCount() : 0;
+}
+
+void Engine::updateMeter(int mode, const std::vector<ScheduledMidiEvent>& events) {
+    for (const ScheduledMidiEvent& event : events) {
+        if (event.data.size() >= 3 && (event.data[0] & 0xF0) == 0x90) {
+            mode_meters_[mode] = std::max(mode_meters_[mode], event.data[2]);
+        }
+    }
+}
+
+void Engine::renderModeStep(LuaContext* lua_mode, const Mode& mode, int pattern_num,
+                            std::vector<ScheduledMidiEvent>& out) {
+    const ModeManifest& manifest = lua_mode->getManifest();
+    const Pattern& pattern = mode.getPattern(pattern_num);
+
+    // Tracks with switch on at this step, from the occupancy masks
+    uint8_t step_tracks = 0;
+    for (uint32_t tracks = mode.getTrackMask(pattern_num); tracks; tracks &= tracks - 1) {
+        int track = lowestSetBit(tracks);
+        if (mode.getSwitchMask(pattern_num, track) & (1u << current_step_)) {
+            step_tracks |= static_cast<uint8_t>(1u << track);
+        }
+    }
+
+    if (manifest.has_step_hook) {
+        if (!step_tracks && !manifest.wants_switch_off) {
+            return;  // Nothing the mode could respond to
+        }
+
+        // Batch hook: one Lua call for all tracks
+        Event step_events[Pattern::NUM_TRACKS];
+        for (int track = 0; track < Pattern::NUM_TRACKS; ++track) {
+            step_events[track] = pattern.getEvent(track, current_step_);
+        }
+
+        auto midi_events = lua_mode->callProcessStep(current_step_, step_events, Pattern::NUM_TRACKS);
+        out.insert(out.end(), midi_events.begin(), midi_events.end());
+        return;
+    }
+
+    // Modes that ignore switch-off events only see the tracks that are on
+    uint32_t tracks_to_call = manifest.wants_switch_off ? ((1u << Pattern::NUM_TRACKS) - 1) : step_tracks;
+    for (; tracks_to_call; tracks_to_call &= tracks_to_call - 1) {
+        int track = lowestSetBit(tracks_to_call);
+        auto midi_events = lua_mode->callProcessEvent(track, pattern.getEvent(track, current_step_));
+        out.insert(out.end(), midi_events.begin(), midi_events.end());
+    }
+}
+
 void Engine::handleInput() {
     // Read rotary pots for global controls
     uint8_t r1 = hardware_->readRotaryPot(0);  // Mode: 0-14
@@ -303,14 +974,14 @@ void Engine::handleInput() {
         setMode(new_mode);
     }
 
-    // Map R2 to tempo (0-127 -> 60-240 BPM for now)
+    // Map R2 to tempo (0-127 -> 60-240 BPM for now); an external clock sets it instead
     int new_tempo = 60 + (r2 * 180) / 127;
-    if (std::abs(new_tempo - tempo_) > 5) {  // Hysteresis
+    if (sync_mode_ == SyncMode::INTERNAL && std::abs(new_tempo - tempo_) > 5) {  // Hysteresis
         setTempo(new_tempo);
     }
 
-    // Map R3 to pattern (0-127 -> 0-31)
-    int new_pattern = std::min((r3 * 32) / 128, 31);
+    // Map R3 to pattern (0-127 -> 0 to NUM_PATTERNS-1)
+    int new_pattern = std::min((r3 * Mode::NUM_PATTERNS) / 128, Mode::NUM_PATTERNS - 1);
     if (new_pattern != current_pattern_) {
         setPattern(new_pattern);
     }
@@ -330,10 +1001,51 @@ void Engine::handleInput() {
         }
     }
 
-    // Read buttons (B1-B16) to toggle steps
-    // When a button is pressed, parameter-lock the current slider values to that event
+    // Scan the buttons once: a step toggles on the scan its button goes down,
+    // however many scans it is held for
+    bool pressed[16];
     for (int btn = 0; btn < 16; ++btn) {
-        if (hardware_->readButton(btn)) {
+        bool down = hardware_->readButton(btn);
+        pressed[btn] = down && !buttons_down_[btn];
+        buttons_down_[btn] = down;
+    }
+
+    // B16 held with B1 = undo, with B2 = redo (once per chord; the chord doesn't edit)
+    bool b16 = buttons_down_[15];
+    bool b1 = buttons_down_[0];
+    bool b2 = buttons_down_[1];
+    if (b16 && (b1 || b2)) {
+        if (!undo_chord_held_) {
+            undo_chord_held_ = true;
+            if (b1) {
+                undo();
+            } else {
+                redo();
+            }
+        }
+        b16_alone_ = false;
+        return;
+    }
+    if (undo_chord_held_) {
+        if (b16 || b1 || b2) {
+            return;  // Keys of the chord still coming up: none of them edits
+        }
+        undo_chord_held_ = false;
+    }
+
+    // B16 usually goes down a scan or more before B1/B2, so its own step only
+    // toggles when it is released without having been part of a chord
+    bool b16_tapped = !b16 && b16_alone_;
+    b16_alone_ = b16;
+
+    pressed[15] = b16_tapped;
+
+    // Buttons (B1-B16) pressed this scan toggle their steps
+    // When a button is pressed, parameter-lock the current slider values to that event.
+    // Everything pressed in one scan is one undo step.
+    beginEdit();
+    for (int btn = 0; btn < 16; ++btn) {
+        if (pressed[btn]) {
             // In Mode 0, buttons write to Mode 0 Pattern 0 Track 0 (pattern sequence)
             // In other modes, buttons write to current mode/pattern/track
             int edit_mode, edit_pattern, edit_track;
@@ -352,9 +1064,8 @@ void Engine::handleInput() {
             }
 
             // Toggle the event
-            Mode& mode = song_->getMode(edit_mode);
-            Pattern& pattern = mode.getPattern(edit_pattern);
-            Event& event = pattern.getEvent(edit_track, btn);
+            const Song& song = *song_;
+            Event event = song.getMode(edit_mode).getPattern(edit_pattern).getEvent(edit_track, btn);
 
             // Toggle switch
             event.setSwitch(!event.getSwitch());
@@ -367,13 +1078,15 @@ void Engine::handleInput() {
                 }
             }
 
-            // Mark dirty and recalculate Mode 0 loop length if in Mode 0
-            markDirty();
+            // Write back (updates masks, render cache, dirty flag), then
+            // recalculate Mode 0 loop length if in Mode 0
+            setEvent(edit_mode, edit_pattern, edit_track, btn, event);
             if (current_mode_ == 0) {
                 calculateMode0LoopLength();
             }
         }
     }
+    endEdit();
 
     // NOTE: We no longer continuously write slider values to the current step.
     // Slider values are only saved when you press a button to create an event.
@@ -516,7 +1229,10 @@ void Engine::updateLED() {
 void Engine::reinitLuaModes() {
     // Reinitialize all Lua modes with current tempo and Mode 0 context
     // This is called after tempo changes (debounced)
-    std::cout << "Reinitializing Lua modes with tempo=" << tempo_ << " BPM" << std::endl;
+    logInfo(LogCategory::LUA, "Reinitializing modes with tempo=%d BPM", tempo_);
+
+    // Let the modes release what held keys are sounding while they still know what that is
+    releaseLiveNotes();
 
     LuaInitContext context;
     context.tempo = tempo_;
@@ -563,14 +1279,14 @@ bool Engine::initAudioOutput(const std::string& soundfont_path) {
 
     // Initialize FluidSynth
     if (!audio_output_->init()) {
-        std::cerr << "[Engine] Failed to initialize audio output\n";
+        logError(LogCategory::AUDIO, "Failed to initialize audio output");
         return false;
     }
 
     // Load SoundFont if provided
     if (!soundfont_path.empty()) {
         if (!audio_output_->loadSoundFont(soundfont_path)) {
-            std::cerr << "[Engine] Failed to load SoundFont: " << soundfont_path << "\n";
+            logError(LogCategory::AUDIO, "Failed to load SoundFont: %s", soundfont_path);
             return false;
         }
     }
@@ -578,24 +1294,40 @@ bool Engine::initAudioOutput(const std::string& soundfont_path) {
     // Connect to scheduler
     scheduler_->setAudioOutput(audio_output_.get());
 
-    std::cout << "[Engine] Audio output initialized successfully\n";
+    logInfo(LogCategory::AUDIO, "Audio output initialized");
     return true;
 }
 
 void Engine::setUseInternalAudio(bool use_internal) {
     scheduler_->setUseInternalAudio(use_internal);
     if (use_internal && audio_output_ && audio_output_->isReady()) {
-        std::cout << "[Engine] Using internal audio (FluidSynth)\n";
+        logInfo(LogCategory::AUDIO, "Using internal audio (FluidSynth)");
     }
 }
 
 void Engine::setUseExternalMIDI(bool use_external) {
     scheduler_->setUseExternalMIDI(use_external);
     if (use_external) {
-        std::cout << "[Engine] Using external MIDI\n";
+        logInfo(LogCategory::MIDI, "Using external MIDI");
     }
 }
 
+void Engine::setControllerRateLimit(MidiScheduler::Port port, uint32_t max_per_second) {
+    scheduler_->setControllerRateLimit(port, max_per_second);
+}
+
+uint32_t Engine::getControllerRateLimit(MidiScheduler::Port port) const {
+    return scheduler_->getControllerRateLimit(port);
+}
+
+const MidiScheduler::ControllerStats& Engine::getControllerStats() const {
+    return scheduler_->getControllerStats();
+}
+
+void Engine::midiOutputChanged() {
+    scheduler_->forgetSentControllers(MidiScheduler::Port::EXTERNAL);
+}
+
 bool Engine::isUsingInternalAudio() const {
     return scheduler_->isUsingInternalAudio();
 }
@@ -626,18 +1358,11 @@ float Engine::getAudioGain() const {
 // ============================================================================
 
 void Engine::calculateMode0LoopLength() {
-    // Scan Mode 0, Pattern 0, Track 0 only (Mode 0 uses only Track 0)
-    // Find the highest step number with switch on
-    Mode& mode0 = song_->getMode(0);
-    Pattern& pattern = mode0.getPattern(0);
-
-    int max_step = -1;  // Start at -1 so first active step sets it
-    for (int step = 0; step < 16; ++step) {
-        const Event& event = pattern.getEvent(0, step);  // Track 0 only
-        if (event.getSwitch()) {
-            max_step = step;  // Keep updating to find the highest active step
-        }
-    }
+    // Mode 0, Pattern 0, Track 0 only (Mode 0 uses only Track 0)
+    // The highest step with switch on is the highest bit of the track's switch mask
+    const Song& song = *song_;
+    uint16_t switches = song.getMode(0).getSwitchMask(0, 0);
+    int max_step = switches ? highestSetBit(switches) : -1;
 
     // Loop length is max_step + 1 (e.g., if B4 is pressed, max_step=3, loop_length=4)
     song_mode_loop_length_ = max_step + 1;
@@ -647,8 +1372,8 @@ void Engine::calculateMode0LoopLength() {
         song_mode_loop_length_ = 16;
     }
 
-    std::cout << "[Mode 0] Loop length: " << song_mode_loop_length_
-              << " steps (last active: " << max_step << ")" << std::endl;
+    logDebug(LogCategory::ENGINE, "Mode 0 loop length: %d steps (last active: %d)",
+             song_mode_loop_length_, max_step);
 }
 
 void Engine::parseMode0Event(const Event& event, int target_mode) {
@@ -662,9 +1387,9 @@ void Engine::parseMode0Event(const Event& event, int target_mode) {
         return;  // Event is off, don't override
     }
 
-    // S1: Pattern (0-127 maps to 0-31)
+    // S1: Pattern (0-127 maps to 0 to NUM_PATTERNS-1)
     uint8_t s1 = event.getPot(0);
-    int pattern = (s1 * 32) / 128;
+    int pattern = (s1 * Mode::NUM_PATTERNS) / 128;
     mode_pattern_overrides_[target_mode] = pattern;
 
     // S2: Scale root (0-127 maps to 0-11)
@@ -684,17 +1409,17 @@ void Engine::parseMode0Event(const Event& event, int target_mode) {
 void Engine::applyMode0Parameters() {
     // Read Mode 0 Track 0 event at the current song_mode_step_
     // Mode 0 uses only Track 0 to set pattern for ALL modes simultaneously
-    Mode& mode0 = song_->getMode(0);
-    Pattern& pattern = mode0.getPattern(0);
+    const Song& song = *song_;
+    const Pattern& pattern = song.getMode(0).getPattern(0);
 
     // Get event for current song mode step (Track 0 only)
     const Event& event = pattern.getEvent(0, song_mode_step_);
 
     // If this step is active, apply pattern to all modes 1-14
     if (event.getSwitch()) {
-        // S1: Pattern (0-127 maps to 0-31)
+        // S1: Pattern (0-127 maps to 0 to NUM_PATTERNS-1)
         uint8_t s1 = event.getPot(0);
-        int selected_pattern = (s1 * 32) / 128;
+        int selected_pattern = (s1 * Mode::NUM_PATTERNS) / 128;
 
         // Apply this pattern to all modes 1-14
         for (int mode_num = 1; mode_num < Song::NUM_MODES; ++mode_num) {
@@ -710,32 +1435,218 @@ void Engine::applyMode0Parameters() {
 
 void Engine::markDirty() {
     dirty_ = true;
+    dirty_all_ = true;
+}
+
+void Engine::markDirty(int mode, int pattern) {
+    dirty_ = true;
+    dirty_patterns_[mode] |= static_cast<Mode::PatternMask>(Mode::PatternMask(1) << pattern);
+}
+
+bool Engine::isPatternDirty(int mode, int pattern) const {
+    if (mode < 0 || mode >= Song::NUM_MODES) return false;
+    if (pattern < 0 || pattern >= Mode::NUM_PATTERNS) return false;
+    return dirty_all_ || ((dirty_patterns_[mode] >> pattern) & 1);
+}
+
+void Engine::clearDirty() {
+    dirty_ = false;
+    dirty_all_ = false;
+    dirty_patterns_.fill(0);
 }
 
 void Engine::checkAutosave() {
+    uint32_t current_time = hardware_->getMillis();
+
+    // Journal: the last few hundred ms of edits go to disk in one small
+    // append. Only valid on top of a save from this session that had every
+    // change tracked (otherwise a full save is started below).
+    bool journal_ready = !journal_.empty() &&
+                         (current_time - last_journal_flush_time_ >= JOURNAL_FLUSH_MS ||
+                          journal_.size() >= JOURNAL_MAX_PENDING);
+    bool journal_blocked = journal_ready && (!autosave_file_valid_ || dirty_all_);
+    if (journal_ready && !journal_blocked) {
+        journal_batch_.clear();
+        journal_.takeBatch(*song_, journal_batch_);
+        autosave_writer_->appendJournal(autosave_path_, journal_batch_);
+        last_journal_flush_time_ = current_time;
+    }
+
+    // Report a save that finished in the background
+    switch (autosave_writer_->poll()) {
+        case AutosaveWriter::Status::SAVED:
+            logInfo(LogCategory::SONG, "Autosaved to %s (%u bytes)", autosave_path_,
+                    autosave_writer_->getLastSize());
+            break;
+        case AutosaveWriter::Status::FAILED:
+            logError(LogCategory::SONG, "Autosave to %s failed", autosave_path_);
+            // Try again next interval. Rewrite the whole file: a failed append
+            // may have left a torn record that would hide later ones.
+            markDirty();
+            autosave_file_valid_ = false;
+            triggerLEDPattern(LEDPattern::ERROR);
+            break;
+        case AutosaveWriter::Status::BUSY:
+            return;  // One save at a time
+        case AutosaveWriter::Status::IDLE:
+            break;
+    }
+
     if (!dirty_) {
         return;  // Nothing to save
     }
 
-    uint32_t current_time = hardware_->getMillis();
-    if (current_time - last_autosave_time_ >= AUTOSAVE_INTERVAL_MS) {
-        // Perform autosave (binary format for flash efficiency)
-        std::string save_path = "/tmp/gruvbok_autosave.bin";
+    // Save on the interval, or right away when journaled edits have no valid
+    // base to be replayed onto
+    if (current_time - last_autosave_time_ >= AUTOSAVE_INTERVAL_MS || journal_blocked) {
+        // Snapshot now (patterns are shared copy-on-write, so this only copies
+        // patterns edited since the last save); encoding and file I/O happen
+        // off this path. Edits made from here on mark the song dirty again.
+        std::unique_ptr<Song> snapshot = std::make_unique<Song>(*song_);
+
+        // Append just the changed patterns when the file allows it
+        int records = 0;
+        for (Mode::PatternMask bits : dirty_patterns_) {
+            records += popCount(bits);
+        }
+        bool full = dirty_all_ || !autosave_file_valid_ || autosave_records_ + records > AUTOSAVE_MAX_RECORDS;
+
+        bool started = full ? autosave_writer_->start(snapshot, autosave_path_)
+                            : autosave_writer_->startIncremental(snapshot, autosave_path_, dirty_patterns_);
+        if (started) {
+            autosave_file_valid_ = true;  // Unless the save fails, see above
+            autosave_records_ = full ? 0 : autosave_records_ + records;
+            clearDirty();
+            journal_.clear();  // The snapshot covers them
+            last_journal_flush_time_ = current_time;
+            last_autosave_time_ = current_time;
+            triggerLEDPattern(LEDPattern::SAVING);
+        }
+    }
+}
 
-        // Trigger LED pattern for saving
-        triggerLEDPattern(LEDPattern::SAVING);
+void Engine::setAutosaveFile(MappedSongFile* file) {
+    // Let a save in progress finish into its current target first (its
+    // result doesn't matter, the new target gets a full save)
+    autosave_writer_->wait();
 
-        if (song_->saveBinary(save_path)) {
-            std::cout << "[Autosave] Saved to " << save_path << " (binary format)" << std::endl;
-            dirty_ = false;
-            last_autosave_time_ = current_time;
-        } else {
-            std::cerr << "[Autosave] Failed to save to " << save_path << std::endl;
+    if (file) {
+        if (binary_autosave_path_.empty()) {
+            binary_autosave_path_ = autosave_path_;
+        }
+        setAutosavePath(file->getPath());
+    } else if (!binary_autosave_path_.empty()) {
+        setAutosavePath(binary_autosave_path_);
+        binary_autosave_path_.clear();
+    }
+    autosave_writer_->setMappedFile(file);
+    markDirty();  // The new target holds none of this song yet
+}
+
+bool Engine::restoreAutosave() {
+#ifndef NO_EXCEPTIONS
+    if (!song_->loadBinary(autosave_path_)) {
+        return false;
+    }
+
+    std::vector<uint8_t> journal;
+    int batches = 0;
+    if (SongFormat::readFile(EditJournal::pathFor(autosave_path_), journal)) {
+        batches = EditJournal::replay(journal, *song_);
+    }
+    logInfo(LogCategory::SONG, "Restored %s + %d journal batches", autosave_path_, batches);
+
+    invalidateRenderCache();
+    calculateMode0LoopLength();
+
+    // Fold the journal into a fresh save
+    journal_.clear();
+    clearUndoHistory();
+    markDirty();
+    autosave_file_valid_ = false;
+    last_autosave_time_ = hardware_->getMillis() - AUTOSAVE_INTERVAL_MS;
+    return true;
+#else
+    // For embedded: Read from flash/SD
+    // This will be implemented in Teensy-specific code
+    return false;
+#endif
+}
+
+// ============================================================================
+// Song Queue
+// ============================================================================
+
+void Engine::queueSong(const std::string& filepath, int bars) {
+    song_queue_.push_back({filepath, std::max(0, bars)});
+    checkSongQueue();  // Start loading right away if nothing is ahead of it
+}
+
+void Engine::clearSongQueue() {
+    song_loader_->cancel();
+    song_queue_.clear();
+    next_song_.reset();
+}
+
+void Engine::checkSongQueue() {
+    switch (song_loader_->poll()) {
+        case SongLoader::Status::LOADED:
+            next_song_ = song_loader_->takeSong();
+            break;
+        case SongLoader::Status::FAILED:
+            logError(LogCategory::SONG, "Failed to load %s", song_loader_->getPath());
+            song_queue_.pop_front();
+            song_load_failures_++;
             triggerLEDPattern(LEDPattern::ERROR);
+            break;
+        case SongLoader::Status::BUSY:
+        case SongLoader::Status::IDLE:
+            break;
+    }
+
+    // One song in memory at a time: load the next once the last has been swapped in
+    while (!next_song_ && !song_loader_->isBusy() && !song_queue_.empty()) {
+        if (song_loader_->start(song_queue_.front().path)) {
+            break;
         }
+        logError(LogCategory::SONG, "Can't load %s", song_queue_.front().path);
+        song_queue_.pop_front();
+        song_load_failures_++;
+        triggerLEDPattern(LEDPattern::ERROR);
+    }
+
+    // Nothing playing: no bar to wait for
+    if (next_song_ && !is_playing_) {
+        swapInNextSong();
     }
 }
 
+void Engine::swapInNextSong() {
+    song_path_ = song_queue_.front().path;
+    song_name_ = song_loader_->getName();
+    int tempo = song_loader_->getTempo();
+    song_queue_.pop_front();
+
+    // Pointer swaps only; the old song's blocks are released here, on this thread
+    song_->swap(*next_song_);
+    next_song_.reset();
+    song_changes_++;
+    bars_since_song_change_ = 0;
+    song_mode_step_ = 0;  // The new song starts from the top of its Mode 0 sequence
+
+    invalidateRenderCache();
+    calculateMode0LoopLength();
+    journal_.clear();  // Edits to the old song must not be replayed onto this one
+    clearUndoHistory();
+    markDirty();  // Whole song replaced (autosave rewrites its file)
+    if (tempo > 0) {
+        setTempo(tempo);
+    }
+    logInfo(LogCategory::SONG, "Now playing %s", song_path_);
+
+    checkSongQueue();  // Start loading the next one
+}
+
 // ============================================================================
 // MIDI Program Mapping
 // ============================================================================
@@ -760,8 +1671,7 @@ void Engine::setModeProgram(int mode, uint8_t program) {
         MidiMessage msg(program_change, 0);
         hardware_->sendMidiMessage(msg);
 
-        std::cout << "[Engine] Set Mode " << mode << " (channel " << static_cast<int>(channel)
-                  << ") to program " << static_cast<int>(program) << std::endl;
+        logInfo(LogCategory::AUDIO, "Set Mode %d (channel %u) to program %u", mode, channel, program);
     }
 
     markDirty();
@@ -774,4 +1684,28 @@ uint8_t Engine::getModeProgram(int mode) const {
     return mode_programs_[mode];
 }
 
+void Engine::runBackgroundSlice() {
+    if (!mode_loader_) return;
+
+    // Only use genuinely idle time while playing; a slice is bounded by
+    // BACKGROUND_INSTRUCTION_BUDGET, so the guard keeps it off the step edge
+    if (is_playing_) {
+        uint32_t elapsed = hardware_->getMillis() - last_step_time_;
+        if (elapsed + BACKGROUND_GUARD_MS >= step_interval_ms_) {
+            return;
+        }
+    }
+
+    // One slice per update, round-robin over modes 1-14 that define background()
+    for (int i = 0; i < Song::NUM_MODES - 1; ++i) {
+        int mode_num = 1 + (background_next_mode_ - 1 + i) % (Song::NUM_MODES - 1);
+        LuaContext* lua_mode = mode_loader_->getMode(mode_num);
+        if (lua_mode && lua_mode->isValid() && lua_mode->hasBackground()) {
+            lua_mode->resumeBackground(BACKGROUND_INSTRUCTION_BUDGET);
+            background_next_mode_ = 1 + mode_num % (Song::NUM_MODES - 1);
+            return;
+        }
+    }
+}
+
 } // namespace gruvbok
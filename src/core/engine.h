@@ -1,10 +1,21 @@
 #pragma once
 
 #include "song.h"
+#include "autosave_writer.h"
+#include "clock_sync.h"
+#include "edit_journal.h"
+#include "engine_command.h"
+#include "engine_snapshot.h"
+#include "mpsc_queue.h"
+#include "triple_buffer.h"
+#include "worker_pool.h"
+#include "song_loader.h"
+#include "undo_history.h"
 #include "../hardware/hardware_interface.h"
 #include "../hardware/midi_scheduler.h"
 #include "../hardware/audio_output.h"
 #include "../lua_bridge/mode_loader.h"
+#include <deque>
 #include <memory>
 
 namespace gruvbok {
@@ -31,6 +42,32 @@ public:
     // Main update loop - call frequently
     void update();
 
+    // Edits and transport changes from other threads (GUI, MIDI in, scripts).
+    // Lock-free and safe from any thread; commands run in posting order at the
+    // start of the next update(). Returns false when the queue is full. A reply,
+    // if given, must stay alive until it is done.
+    bool postCommand(EngineCommand command, CommandReply* reply = nullptr);
+    uint32_t getCommandsRun() const { return commands_run_.load(std::memory_order_acquire); }
+
+    // State as of the last update(), for viewers on any one thread (the GUI):
+    // wait-free, never torn. Valid until the next readSnapshot() call.
+    const EngineSnapshot& readSnapshot() {
+        snapshots_.fetch();
+        return snapshots_.getReadBuffer();
+    }
+
+    // Where steps are timed from. EXTERNAL follows incoming MIDI clock and
+    // Start/Stop/Continue/Song Position: the tempo comes from the clock (the
+    // tempo pot is ignored) and steps land on the master's 16th notes.
+    // Changing it stops playback.
+    enum class SyncMode {
+        INTERNAL,
+        EXTERNAL
+    };
+    void setSyncMode(SyncMode mode);
+    SyncMode getSyncMode() const { return sync_mode_; }
+    const ClockSync& getClockSync() const { return clock_sync_; }
+
     // Global controls
     void setTempo(int bpm);  // 0-1000 BPM
     void setMode(int mode);  // 0-14
@@ -49,10 +86,40 @@ public:
     void setModeProgram(int mode, uint8_t program);  // Set GM program for a mode (0-127)
     uint8_t getModeProgram(int mode) const;  // Get GM program for a mode
 
-    // Dirty flag (unsaved changes)
+    // Dirty flags (unsaved changes), per pattern so autosave can write just those
     bool isDirty() const { return dirty_; }
-    void markDirty();
-    void clearDirty() { dirty_ = false; }
+    bool isPatternDirty(int mode, int pattern) const;
+    void markDirty();  // Anything may have changed (next autosave rewrites the file)
+    void markDirty(int mode, int pattern);
+    void clearDirty();
+
+    // Autosave (runs in the background, see AutosaveWriter)
+    void setAutosavePath(const std::string& path) {
+        autosave_path_ = path;
+        autosave_file_valid_ = false;
+    }
+    bool isAutosaving() const { return autosave_writer_->isBusy(); }
+
+    // Autosave into a mapped song file instead (desktop; nullptr = back to
+    // the binary file). The file must stay open while attached.
+    void setAutosaveFile(MappedSongFile* file);
+
+    // Crash recovery: load the autosave and replay its edit journal into the song
+    bool restoreAutosave();
+
+    // Song changes without stopping playback: the file is loaded in the
+    // background and swapped in at a bar boundary, once the current song has
+    // played at least `bars` bars since the last change (0 = the next bar).
+    // When stopped it is swapped in as soon as it loads. Queue several for a
+    // playlist; they load one at a time, in order.
+    void queueSong(const std::string& filepath, int bars = 0);
+    void clearSongQueue();  // Drops waiting songs and any load in progress
+    size_t getQueuedSongCount() const { return song_queue_.size(); }  // Including one loading or waiting
+    bool isNextSongReady() const { return next_song_ != nullptr; }  // Loaded, waiting for its bar
+    int getSongChangeCount() const { return song_changes_; }  // Bumped on every swap
+    int getSongLoadFailureCount() const { return song_load_failures_; }
+    const std::string& getSongPath() const { return song_path_; }  // Last song swapped in, and its metadata
+    const std::string& getSongName() const { return song_name_; }
 
     // Edit current event
     void toggleCurrentSwitch();
@@ -60,6 +127,27 @@ public:
 
     // Direct event editing (for UI table)
     void setEventPot(int mode, int pattern, int track, int step, int pot, uint8_t value);
+    void setEvent(int mode, int pattern, int track, int step, const Event& event);
+
+    // Whole-pattern editing (bulk transforms, see PatternOps). Marks the pattern changed
+    // up front; returns nullptr when out of range. Re-run calculateMode0LoopLength()
+    // after editing Mode 0.
+    // Undo sees the changes at the next edit, undo/redo, endEdit() or update(); at
+    // most two patterns can be held for editing at once (e.g. for PatternOps::swap).
+    Pattern* editPattern(int mode, int pattern);
+    const Song* getSong() const { return song_; }
+
+    // Undo/redo (see UndoHistory). Edits between beginEdit() and endEdit() undo
+    // as one step; calls nest. The history is dropped when the song is replaced.
+    bool undo();
+    bool redo();
+    bool canUndo() const { return undo_history_.canUndo() || undo_pattern_count_ > 0; }
+    bool canRedo() const { return undo_history_.canRedo(); }
+    void beginEdit();
+    void endEdit();
+
+    // Drop all cached bar renders (call after replacing song contents, e.g. on load)
+    void invalidateRenderCache();
 
     // LED pattern control (public enum for external access)
     enum class LEDPattern {
@@ -85,9 +173,21 @@ public:
     void setAudioGain(float gain);
     float getAudioGain() const;
 
+    // CC/pitch bend/aftertouch thinning (see MidiScheduler)
+    void setControllerRateLimit(MidiScheduler::Port port, uint32_t max_per_second);
+    uint32_t getControllerRateLimit(MidiScheduler::Port port) const;
+    const MidiScheduler::ControllerStats& getControllerStats() const;
+    void midiOutputChanged();  // Another device on the MIDI port: resend controller values
+
     // Mode 0 loop length calculation (public so it can be called after loading content)
     void calculateMode0LoopLength();
 
+    // Render PARALLEL_SAFE modes concurrently on `threads` worker threads
+    // besides the engine's own (desktop; 0 = one mode after another, the default).
+    // MIDI output is the same either way.
+    void setModeThreads(int threads);
+    int getModeThreads() const;
+
 private:
     Song* song_;
     HardwareInterface* hardware_;
@@ -116,10 +216,86 @@ private:
     int mode_pattern_overrides_[Song::NUM_MODES]; // Per-mode pattern override (0-31, or -1 for default)
     uint8_t mode_programs_[Song::NUM_MODES];  // Per-mode MIDI program (GM instrument, 0-127)
 
-    // Dirty flag and autosave
+    // Dirty flags and autosave
     bool dirty_;                 // True if data has been modified
+    bool dirty_all_;             // Changes not tracked per pattern
+    AutosaveWriter::PatternMasks dirty_patterns_;  // Bit N of [mode] = pattern N modified
     uint32_t last_autosave_time_;
+    std::string autosave_path_;
+    std::string binary_autosave_path_;  // Restored when a mapped file is detached
+    std::unique_ptr<AutosaveWriter> autosave_writer_;
+    bool autosave_file_valid_;   // File holds a full save from this session that records can be appended to
+    int autosave_records_;       // Pattern records appended since the last full save
     static constexpr uint32_t AUTOSAVE_INTERVAL_MS = 20000;  // 20 seconds
+    static constexpr int AUTOSAVE_MAX_RECORDS = 256;  // Then rewrite the file to fold them in
+
+    // Edits since the last autosave, flushed to the journal in small batches
+    EditJournal journal_;
+    uint32_t last_journal_flush_time_;
+    std::vector<uint8_t> journal_batch_;  // Scratch buffer
+    static constexpr uint32_t JOURNAL_FLUSH_MS = 250;
+    static constexpr size_t JOURNAL_MAX_PENDING = 256;  // Flush early past this many edits
+
+    // Undo history, plus the patterns handed out by editPattern() as they were
+    // before, diffed into the history once the caller is done with them
+    struct PendingPattern {
+        int mode;
+        int pattern;
+        Pattern before;
+    };
+    UndoHistory undo_history_;
+    std::array<PendingPattern, 2> undo_patterns_;
+    int undo_pattern_count_;
+    bool undo_chord_held_;  // B16 + B1/B2 handled, waiting for release
+    bool b16_alone_;        // B16 held, not (yet) part of a chord
+    bool buttons_down_[16]; // At the last scan: steps toggle on the press, not while held
+    void writeEvent(int mode, int pattern, int track, int step, const Event& event);  // No undo record
+    void flushPatternEdits();
+    void clearUndoHistory();
+
+    // Commands posted from other threads
+    static constexpr size_t COMMAND_QUEUE_SIZE = 256;
+    MpscQueue<EngineCommand, COMMAND_QUEUE_SIZE> commands_;
+    std::atomic<uint32_t> commands_run_;
+    void processCommands();  // Drain the queue (engine thread)
+    bool runCommand(const EngineCommand& command, int& value);  // false = rejected
+
+    // Incoming MIDI, drained from the hardware every update()
+    uint32_t midi_input_count_;
+    MidiInputEvent midi_input_history_[EngineSnapshot::MIDI_INPUT_HISTORY];  // Ring, for viewers
+    void processMidiInput();
+
+    // Live input: channel messages go straight to the selected mode's
+    // process_input() and its output is sent at once, off the step grid
+    uint32_t live_input_count_;        // Messages passed to process_input()
+    uint32_t live_latency_count_;      // Of those, ones that sent output
+    uint32_t live_latency_us_;         // Input timestamp to output sent, last one
+    uint32_t live_latency_max_us_;
+    uint64_t live_latency_total_us_;
+    int8_t live_note_modes_[16][128];  // Mode that took each held input note, -1 = none
+    void playLiveInput(const MidiInputEvent& event);
+    bool runInputHook(int mode_num, const MidiInputEvent& event);  // True if it sent output
+    void releaseLiveNotes();  // Note-offs for held input notes, to the modes that took them
+
+    // State published for viewers at the end of every update()
+    TripleBuffer<EngineSnapshot> snapshots_;
+    uint32_t snapshot_version_;
+    uint8_t mode_meters_[Song::NUM_MODES];  // Peak note-on velocity per mode, decaying per step
+    void publishSnapshot();
+
+    // Queued song changes (front = loading, or loaded and waiting for its bar)
+    struct QueuedSong {
+        std::string path;
+        int bars;
+    };
+    std::deque<QueuedSong> song_queue_;
+    std::unique_ptr<SongLoader> song_loader_;
+    std::unique_ptr<Song> next_song_;  // Swapped with *song_, then freed on this thread
+    int bars_since_song_change_;
+    int song_changes_;
+    int song_load_failures_;
+    std::string song_path_;
+    std::string song_name_;
 
     uint32_t last_step_time_;
     uint32_t step_interval_ms_;
@@ -129,6 +305,14 @@ private:
     uint32_t clock_pulse_count_;    // Number of clock pulses sent
     double clock_interval_ms_;      // Interval between clock pulses (float for precision)
 
+    // External sync: positions in the master's clock ticks (see ClockSync)
+    SyncMode sync_mode_;
+    ClockSync clock_sync_;
+    int64_t next_step_tick_;        // Tick the next step plays at
+    int64_t next_clock_tick_;       // Tick the next clock out is sent at
+    void followTransport(ClockSync::Transport transport);
+    void followExternalClock();     // Clock out, steps and tempo from the master
+
     // LED tempo indicator with patterns
     LEDPattern led_pattern_;
     bool led_on_;
@@ -144,10 +328,43 @@ private:
     uint32_t last_tempo_change_time_;
     static constexpr uint32_t TEMPO_DEBOUNCE_MS = 1000;  // Wait 1 second after last tempo change
 
+    // Rendered output of DETERMINISTIC modes per (mode, pattern), allocated on first play.
+    // Edits clear the affected step; a LuaContext generation change clears the bar.
+    struct BarCache {
+        uint32_t generation = 0;      // LuaContext generation the steps were rendered with
+        uint16_t rendered_steps = 0;  // Bit N set = steps[N] holds valid output
+        std::vector<ScheduledMidiEvent> steps[Track::NUM_EVENTS];  // All tracks, track order
+    };
+    std::unique_ptr<BarCache> bar_cache_[Song::NUM_MODES][Mode::NUM_PATTERNS];
+    void invalidateBarCache(int mode, int pattern, int step);
+    void invalidateBarCache(int mode, int pattern);
+
+    // One step's work per mode, rendered (possibly on mode_pool_) then scheduled in mode order
+    struct StepJob {
+        int mode_num;
+        int pattern;
+        LuaContext* lua_mode;
+        std::vector<ScheduledMidiEvent>* output;  // Bar cache step, or mode_output_
+        bool render;                              // false = replay the cached output
+    };
+    StepJob step_jobs_[Song::NUM_MODES];
+    std::vector<ScheduledMidiEvent> mode_output_[Song::NUM_MODES];  // Scratch buffers for non-cached modes
+    std::unique_ptr<WorkerPool> mode_pool_;
+    void renderStepJobs(int first, int last);  // step_jobs_[first, last)
+
+    // Idle-time background() slices for generative modes
+    int background_next_mode_;  // Round-robin position
+    static constexpr int BACKGROUND_INSTRUCTION_BUDGET = 5000;  // Lua VM instructions per slice
+    static constexpr uint32_t BACKGROUND_GUARD_MS = 2;  // Don't start a slice this close to the next step
+
     void calculateStepInterval();
     void calculateClockInterval();
     void sendMidiClock();
     void processStep();
+    void playStep();     // Song swap at the bar, then processStep()
+    void advanceStep();  // Move to the next step (and Mode 0 step at the bar)
+    void renderModeStep(LuaContext* lua_mode, const Mode& mode, int pattern_num, std::vector<ScheduledMidiEvent>& out);
+    void updateMeter(int mode, const std::vector<ScheduledMidiEvent>& events);
     void handleInput();
     void updateLED();
     void reinitLuaModes();  // Reinitialize all Lua modes with current tempo
@@ -158,6 +375,13 @@ private:
 
     // Autosave
     void checkAutosave();
+
+    // Song queue
+    void checkSongQueue();  // Collect finished loads, start the next one
+    void swapInNextSong();
+
+    // Background work
+    void runBackgroundSlice();  // Resume one mode's background() if there is idle time
 };
 
 } // namespace gruvbok
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "event.h"
+#include "../hardware/midi_scheduler.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+namespace gruvbok {
+
+/**
+ * Completion of a posted EngineCommand, for the thread that posted it
+ *
+ * The poster owns the reply and must keep it alive until isDone(). The
+ * engine completes it with a release store once the command has run, so
+ * everything the command changed is visible to a poster that sees isDone().
+ */
+class CommandReply {
+public:
+    enum class Status : uint8_t {
+        PENDING,   // Not run yet
+        DONE,      // Ran; getValue() holds its result
+        REJECTED   // Not run: an index was out of range
+    };
+
+    CommandReply() : status_(Status::PENDING), value_(0) {}
+
+    CommandReply(const CommandReply&) = delete;
+    CommandReply& operator=(const CommandReply&) = delete;
+
+    Status getStatus() const { return status_.load(std::memory_order_acquire); }
+    bool isDone() const { return getStatus() != Status::PENDING; }
+
+    // Result once DONE: 1/0 for undo and redo (something to undo?) and for
+    // restoring the autosave (restored?), else 0
+    int getValue() const { return value_; }
+
+    // Reuse for another command (only once the last one is done)
+    void reset() {
+        value_ = 0;
+        status_.store(Status::PENDING, std::memory_order_relaxed);
+    }
+
+    // Engine side
+    void complete(Status status, int value) {
+        value_ = value;
+        status_.store(status, std::memory_order_release);
+    }
+
+private:
+    std::atomic<Status> status_;
+    int value_;
+};
+
+/**
+ * An edit or transport change posted to the engine from another thread
+ * (see Engine::postCommand). Plain data, so it can be queued without
+ * allocating; build it with the named constructors.
+ */
+struct EngineCommand {
+    enum class Type : uint8_t {
+        SET_EVENT,         // mode, pattern, track, step, raw
+        SET_EVENT_POT,     // mode, pattern, track, step, pot, value
+        BEGIN_EDIT,        // Group the following edits into one undo step
+        END_EDIT,
+        UNDO,
+        REDO,
+        START,
+        STOP,
+        SET_TEMPO,         // value (BPM)
+        SET_MODE,          // mode
+        SET_PATTERN,       // pattern
+        SET_TRACK,         // track
+        SET_MODE_PROGRAM,  // mode, value (GM program)
+        SET_SYNC_MODE,     // value (0 = internal clock, 1 = external MIDI clock)
+        SET_CONTROLLER_RATE_LIMIT,  // raw (MidiScheduler::Port), value (per controller per second, 0 = none)
+        RESTORE_AUTOSAVE   // Crash recovery (see Engine::restoreAutosave)
+    };
+
+    Type type;
+    uint8_t mode;
+    uint8_t pattern;
+    uint8_t track;
+    uint8_t step;
+    uint8_t pot;
+    int32_t value;
+    uint32_t raw;
+    CommandReply* reply;  // May be null
+
+    static EngineCommand setEvent(int mode, int pattern, int track, int step, const Event& event) {
+        EngineCommand c = make(Type::SET_EVENT);
+        c.setAddress(mode, pattern, track, step);
+        c.raw = event.getRawData();
+        return c;
+    }
+    static EngineCommand setEventPot(int mode, int pattern, int track, int step, int pot, uint8_t value) {
+        EngineCommand c = make(Type::SET_EVENT_POT);
+        c.setAddress(mode, pattern, track, step);
+        c.pot = index(pot);
+        c.value = value;
+        return c;
+    }
+    static EngineCommand beginEdit() { return make(Type::BEGIN_EDIT); }
+    static EngineCommand endEdit() { return make(Type::END_EDIT); }
+    static EngineCommand undo() { return make(Type::UNDO); }
+    static EngineCommand redo() { return make(Type::REDO); }
+    static EngineCommand start() { return make(Type::START); }
+    static EngineCommand stop() { return make(Type::STOP); }
+    static EngineCommand setTempo(int bpm) {
+        EngineCommand c = make(Type::SET_TEMPO);
+        c.value = bpm;
+        return c;
+    }
+    static EngineCommand setMode(int mode) {
+        EngineCommand c = make(Type::SET_MODE);
+        c.mode = index(mode);
+        return c;
+    }
+    static EngineCommand setPattern(int pattern) {
+        EngineCommand c = make(Type::SET_PATTERN);
+        c.pattern = index(pattern);
+        return c;
+    }
+    static EngineCommand setTrack(int track) {
+        EngineCommand c = make(Type::SET_TRACK);
+        c.track = index(track);
+        return c;
+    }
+    static EngineCommand setModeProgram(int mode, uint8_t program) {
+        EngineCommand c = make(Type::SET_MODE_PROGRAM);
+        c.mode = index(mode);
+        c.value = program;
+        return c;
+    }
+    static EngineCommand setSyncMode(bool external) {
+        EngineCommand c = make(Type::SET_SYNC_MODE);
+        c.value = external ? 1 : 0;
+        return c;
+    }
+    static EngineCommand setControllerRateLimit(MidiScheduler::Port port, uint32_t max_per_second) {
+        EngineCommand c = make(Type::SET_CONTROLLER_RATE_LIMIT);
+        c.raw = static_cast<uint32_t>(port);
+        c.value = static_cast<int32_t>(std::min<uint32_t>(max_per_second, INT32_MAX));
+        return c;
+    }
+    static EngineCommand restoreAutosave() { return make(Type::RESTORE_AUTOSAVE); }
+
+private:
+    static EngineCommand make(Type type) {
+        return EngineCommand{type, 0, 0, 0, 0, 0, 0, 0, nullptr};
+    }
+    // Out-of-range indices (including negative ones) stay out of range, so the engine rejects them
+    static uint8_t index(int i) { return static_cast<uint8_t>(i < 0 || i > 255 ? 255 : i); }
+    void setAddress(int m, int p, int t, int s) {
+        mode = index(m);
+        pattern = index(p);
+        track = index(t);
+        step = index(s);
+    }
+};
+
+} // namespace gruvbok
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "song.h"
+#include "bit_ops.h"
+#include "../hardware/hardware_interface.h"
+#include <cstdint>
+
+namespace gruvbok {
+
+/**
+ * Engine state published once per Engine::update() for the GUI and other
+ * viewers (see Engine::readSnapshot()). A plain copy: reading it never
+ * touches the live engine or song.
+ */
+struct EngineSnapshot {
+    uint32_t version = 0;  // Bumped on every publish (0 = nothing published yet)
+    uint32_t time_ms = 0;
+
+    // Transport
+    bool playing = false;
+    int tempo = 0;
+
+    // External MIDI clock (see ClockSync)
+    bool external_sync = false;
+    bool sync_locked = false;
+    uint8_t sync_quality = 0;     // 0-100
+    float sync_tempo = 0.0f;      // Measured BPM, 0 = no clock yet
+    float sync_jitter_ms = 0.0f;  // Mean tick error before filtering
+
+    // Positions
+    int mode = 0;
+    int pattern = 0;
+    int track = 0;
+    int step = 0;
+    int song_mode_step = 0;         // Mode 0 position (one step per bar)
+    int song_mode_loop_length = 0;
+    int target_mode = 0;
+
+    // Song state
+    bool dirty = false;
+    bool autosaving = false;
+    bool can_undo = false;
+    bool can_redo = false;
+    int song_changes = 0;
+    int queued_songs = 0;
+    int song_load_failures = 0;
+    char song_name[128] = {};  // Last song swapped in (truncated), and its path
+    char song_path[256] = {};
+
+    // LED
+    bool led_on = false;
+    uint8_t led_brightness = 0;
+    uint8_t led_pattern = 0;  // Engine::LEDPattern
+
+    // Notes sent and not yet released: bit N % 32 of active_notes[channel][N / 32]
+    uint32_t active_notes[16][4] = {};
+
+    // Per-mode output level: peak note-on velocity, decaying every step
+    uint8_t mode_meters[Song::NUM_MODES] = {};
+
+    // Incoming MIDI: total received, and the most recent ones at
+    // midi_input[(midi_input_count - 1 - i) % MIDI_INPUT_HISTORY], i = 0 newest
+    static constexpr int MIDI_INPUT_HISTORY = 16;
+    uint32_t midi_input_count = 0;
+    MidiInputEvent midi_input[MIDI_INPUT_HISTORY] = {};
+
+    // Live input through a mode's process_input(): messages played, and the
+    // latency from input timestamp to output sent over those that sent output
+    uint32_t live_input_count = 0;
+    uint32_t live_latency_count = 0;
+    uint32_t live_latency_us = 0;      // Last
+    uint32_t live_latency_avg_us = 0;
+    uint32_t live_latency_max_us = 0;
+
+    // Controller thinning on the MIDI port (see MidiScheduler): the rate cap per
+    // controller (0 = none), and messages thinned on any port since start
+    uint32_t controller_rate_limit = 0;
+    uint32_t controllers_coalesced = 0;
+    uint32_t controllers_repeats = 0;
+    uint32_t controllers_deferred = 0;
+
+    // Events of the current mode/pattern/track, and of the track the step
+    // buttons edit (Mode 0: pattern 0, track 0 of Mode 0)
+    Event track_events[Track::NUM_EVENTS];
+    int edit_mode = 0;
+    int edit_pattern = 0;
+    int edit_track = 0;
+    Event edit_events[Track::NUM_EVENTS];
+
+    int activeNoteCount() const {
+        int count = 0;
+        for (const auto& channel : active_notes) {
+            for (uint32_t bits : channel) {
+                count += popCount(bits);
+            }
+        }
+        return count;
+    }
+};
+
+} // namespace gruvbok
@@ -20,23 +20,42 @@ namespace gruvbok {
  */
 class Event {
 public:
-    Event();
-    Event(bool switch_state, uint8_t pot0, uint8_t pot1, uint8_t pot2, uint8_t pot3);
+    constexpr Event() : data_(0) {}
+    constexpr Event(bool switch_state, uint8_t pot0, uint8_t pot1, uint8_t pot2, uint8_t pot3)
+        : data_((switch_state ? SWITCH_MASK : 0u) |
+                (packPot(pot0) << POT0_SHIFT) | (packPot(pot1) << POT1_SHIFT) |
+                (packPot(pot2) << POT2_SHIFT) | (packPot(pot3) << POT3_SHIFT)) {}
 
     // Getters
-    bool getSwitch() const;
-    uint8_t getPot(int index) const;  // index: 0-3
+    constexpr bool getSwitch() const { return (data_ & SWITCH_MASK) != 0; }
+    constexpr uint8_t getPot(int index) const {  // index: 0-3 (others read as 0)
+        return (index < 0 || index > 3) ? 0 : getPotUnchecked(index);
+    }
 
     // Setters
-    void setSwitch(bool state);
-    void setPot(int index, uint8_t value);  // value: 0-127
+    constexpr void setSwitch(bool state) {
+        data_ = state ? (data_ | SWITCH_MASK) : (data_ & ~SWITCH_MASK);
+    }
+    constexpr void setPot(int index, uint8_t value) {  // value: 0-127 (clamped); bad index ignored
+        if (index < 0 || index > 3) return;
+        setPotUnchecked(index, value);
+    }
+
+    // Unchecked variants for hot loops (index must be 0-3)
+    constexpr uint8_t getPotUnchecked(int index) const {
+        return static_cast<uint8_t>((data_ >> potShift(index)) & POT_MASK);
+    }
+    constexpr void setPotUnchecked(int index, uint8_t value) {
+        const int shift = potShift(index);
+        data_ = (data_ & ~(POT_MASK << shift)) | (packPot(value) << shift);
+    }
 
     // Clear all data
-    void clear();
+    constexpr void clear() { data_ = 0; }
 
     // Raw data access (for serialization)
-    uint32_t getRawData() const { return data_; }
-    void setRawData(uint32_t raw) { data_ = raw; }
+    constexpr uint32_t getRawData() const { return data_; }
+    constexpr void setRawData(uint32_t raw) { data_ = raw; }
 
 private:
     uint32_t data_;
@@ -48,11 +67,17 @@ private:
     static constexpr int POT3_SHIFT = 22;
     static constexpr uint32_t POT_MASK = 0x7F;  // 7 bits
 
+    // Pots are evenly spaced, so the shift is arithmetic rather than a switch
+    static constexpr int potShift(int index) { return POT0_SHIFT + index * (POT1_SHIFT - POT0_SHIFT); }
+    static constexpr uint32_t packPot(uint8_t value) { return value > POT_MASK ? POT_MASK : value; }
+
     // Compile-time validation of bit packing layout
     static_assert(POT0_SHIFT + 7 <= 32, "POT0 would overflow uint32_t");
     static_assert(POT1_SHIFT + 7 <= 32, "POT1 would overflow uint32_t");
     static_assert(POT2_SHIFT + 7 <= 32, "POT2 would overflow uint32_t");
     static_assert(POT3_SHIFT + 7 <= 32, "POT3 would overflow uint32_t");
+    static_assert(POT2_SHIFT - POT1_SHIFT == POT1_SHIFT - POT0_SHIFT &&
+                  POT3_SHIFT - POT2_SHIFT == POT1_SHIFT - POT0_SHIFT, "Pots must be evenly spaced");
 };
 
 } // namespace gruvbok
@@ -0,0 +1,306 @@
+#include "log.h"
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#ifndef NO_EXCEPTIONS
+#include <chrono>
+#endif
+
+namespace gruvbok {
+
+namespace {
+
+const char* const CATEGORY_NAMES[] = {"Engine", "Song", "Lua", "MIDI", "Audio"};
+static_assert(sizeof(CATEGORY_NAMES) / sizeof(CATEGORY_NAMES[0]) == static_cast<size_t>(LogCategory::COUNT),
+              "One name per log category");
+
+const char* const LEVEL_NAMES[] = {"debug", "info", "warn", "error", "off"};
+
+bool equalsIgnoreCase(const std::string& a, const char* b) {
+    size_t n = std::strlen(b);
+    if (a.size() != n) {
+        return false;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+Logger& Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger()
+    : dropped_(0)
+    , dropped_reported_(0)
+#ifndef NO_EXCEPTIONS
+    , quit_(false)
+#endif
+{
+    for (auto& level : levels_) {
+        level.store(LogLevel::INFO, std::memory_order_relaxed);
+    }
+}
+
+Logger::~Logger() {
+#ifndef NO_EXCEPTIONS
+    stopThread();
+#endif
+}
+
+void Logger::setLevel(LogCategory category, LogLevel level) {
+    levels_[static_cast<int>(category)].store(level, std::memory_order_relaxed);
+}
+
+LogLevel Logger::getLevel(LogCategory category) const {
+    return levels_[static_cast<int>(category)].load(std::memory_order_relaxed);
+}
+
+bool Logger::configure(const std::string& spec) {
+    bool ok = true;
+    size_t pos = 0;
+    while (pos < spec.size()) {
+        size_t end = spec.find(',', pos);
+        if (end == std::string::npos) {
+            end = spec.size();
+        }
+        std::string entry = spec.substr(pos, end - pos);
+        pos = end + 1;
+
+        size_t eq = entry.find('=');
+        if (eq == std::string::npos) {
+            ok = false;
+            continue;
+        }
+        std::string name = entry.substr(0, eq);
+        std::string level_name = entry.substr(eq + 1);
+
+        int level = -1;
+        for (int i = 0; i <= static_cast<int>(LogLevel::OFF); ++i) {
+            if (equalsIgnoreCase(level_name, LEVEL_NAMES[i])) {
+                level = i;
+            }
+        }
+        if (level < 0) {
+            ok = false;
+            continue;
+        }
+
+        bool matched = false;
+        for (int i = 0; i < static_cast<int>(LogCategory::COUNT); ++i) {
+            if (equalsIgnoreCase(name, "all") || equalsIgnoreCase(name, CATEGORY_NAMES[i])) {
+                setLevel(static_cast<LogCategory>(i), static_cast<LogLevel>(level));
+                matched = true;
+            }
+        }
+        ok = ok && matched;
+    }
+    return ok;
+}
+
+void Logger::addSink(Sink sink) {
+    sinks_.push_back(std::move(sink));
+}
+
+void Logger::clearSinks() {
+    sinks_.clear();
+}
+
+size_t Logger::flush(size_t max_records) {
+    size_t delivered = 0;
+    LogRecord record;
+    while (delivered < max_records && queue_.pop(record)) {
+        std::string line = format(record);
+        for (const Sink& sink : sinks_) {
+            sink(record, line.c_str());
+        }
+        delivered++;
+    }
+
+    // Say so when records were lost, once per burst
+    uint32_t dropped = dropped_.load(std::memory_order_relaxed);
+    if (dropped != dropped_reported_) {
+        LogRecord note = {};
+        note.format = "%u log record(s) dropped: queue full";
+        note.category = LogCategory::ENGINE;
+        note.level = LogLevel::WARN;
+        packUint(note, dropped - dropped_reported_);
+        dropped_reported_ = dropped;
+        std::string line = format(note);
+        for (const Sink& sink : sinks_) {
+            sink(note, line.c_str());
+        }
+    }
+    return delivered;
+}
+
+#ifndef NO_EXCEPTIONS
+void Logger::startThread() {
+    if (thread_.joinable()) {
+        return;
+    }
+    quit_ = false;
+    thread_ = std::thread(&Logger::threadLoop, this);
+}
+
+void Logger::stopThread() {
+    if (!thread_.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+}
+
+void Logger::threadLoop() {
+    // Producers never signal (that could block a real-time thread): poll instead
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!quit_) {
+        lock.unlock();
+        flush();
+        lock.lock();
+        wake_.wait_for(lock, std::chrono::milliseconds(20), [this] { return quit_; });
+    }
+    lock.unlock();
+    flush();
+}
+#else
+void Logger::startThread() {}
+void Logger::stopThread() {}
+#endif
+
+std::string Logger::format(const LogRecord& record) {
+    std::string line = "[";
+    line += categoryName(record.category);
+    line += "] ";
+    if (record.level == LogLevel::WARN) {
+        line += "Warning: ";
+    } else if (record.level == LogLevel::ERROR) {
+        line += "Error: ";
+    }
+
+    int arg = 0;
+    const char* text = record.text;
+    const char* text_end = record.text + record.text_used;
+    for (const char* p = record.format; *p; ++p) {
+        if (*p != '%') {
+            line += *p;
+            continue;
+        }
+        if (p[1] == '%') {
+            line += '%';
+            ++p;
+            continue;
+        }
+
+        // Conversion spec: flags, width, precision, then the conversion character
+        const char* start = p++;
+        while (*p && std::strchr("-+ #0123456789.hlzjt", *p)) {
+            ++p;
+        }
+        if (!*p) {
+            break;
+        }
+        if (arg >= record.arg_count) {
+            line += "<?>";
+            continue;
+        }
+
+        // Rebuild the spec with a length modifier that matches the stored type
+        std::string spec;
+        for (const char* s = start; s < p; ++s) {
+            if (!std::strchr("hlzjt", *s)) {
+                spec += *s;
+            }
+        }
+        char buffer[64];
+        const LogRecord::Arg& value = record.args[arg];
+        switch (record.arg_types[arg++]) {
+            case LogRecord::ArgType::INT:
+                spec += "lld";
+                std::snprintf(buffer, sizeof(buffer), spec.c_str(), static_cast<long long>(value.i));
+                break;
+            case LogRecord::ArgType::UINT:
+                spec += std::strchr("xXo", *p) ? std::string("ll") + *p : std::string("llu");
+                std::snprintf(buffer, sizeof(buffer), spec.c_str(), static_cast<unsigned long long>(value.u));
+                break;
+            case LogRecord::ArgType::FLOAT:
+                spec += std::strchr("eEfFgG", *p) ? *p : 'g';
+                std::snprintf(buffer, sizeof(buffer), spec.c_str(), value.f);
+                break;
+            case LogRecord::ArgType::TEXT:
+                if (text < text_end) {
+                    line += text;
+                    text += std::strlen(text) + 1;
+                }
+                continue;
+        }
+        line += buffer;
+    }
+    return line;
+}
+
+const char* Logger::categoryName(LogCategory category) {
+    int index = static_cast<int>(category);
+    return index < static_cast<int>(LogCategory::COUNT) ? CATEGORY_NAMES[index] : "?";
+}
+
+void Logger::stderrSink(const LogRecord& record, const char* line) {
+    (void)record;
+    std::fputs(line, stderr);
+    std::fputc('\n', stderr);
+}
+
+void Logger::pack(LogRecord& record, double value) {
+    if (record.arg_count < LogRecord::MAX_ARGS) {
+        record.arg_types[record.arg_count] = LogRecord::ArgType::FLOAT;
+        record.args[record.arg_count++].f = value;
+    }
+}
+
+void Logger::pack(LogRecord& record, const char* value) {
+    if (record.arg_count >= LogRecord::MAX_ARGS) {
+        return;
+    }
+    record.arg_types[record.arg_count++] = LogRecord::ArgType::TEXT;
+
+    // Copy what fits and always terminate, so a long path can't push out the next argument's slot
+    size_t room = LogRecord::TEXT_SIZE - record.text_used;
+    if (room == 0) {
+        return;
+    }
+    size_t length = value ? std::strlen(value) : 0;
+    if (length > room - 1) {
+        length = room - 1;
+    }
+    if (length) {
+        std::memcpy(record.text + record.text_used, value, length);
+    }
+    record.text[record.text_used + length] = '\0';
+    record.text_used = static_cast<uint8_t>(record.text_used + length + 1);
+}
+
+void Logger::packInt(LogRecord& record, int64_t value) {
+    if (record.arg_count < LogRecord::MAX_ARGS) {
+        record.arg_types[record.arg_count] = LogRecord::ArgType::INT;
+        record.args[record.arg_count++].i = value;
+    }
+}
+
+void Logger::packUint(LogRecord& record, uint64_t value) {
+    if (record.arg_count < LogRecord::MAX_ARGS) {
+        record.arg_types[record.arg_count] = LogRecord::ArgType::UINT;
+        record.args[record.arg_count++].u = value;
+    }
+}
+
+} // namespace gruvbok
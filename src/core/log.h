@@ -0,0 +1,190 @@
+#pragma once
+
+#include "mpsc_queue.h"
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+#ifndef NO_EXCEPTIONS
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+namespace gruvbok {
+
+enum class LogCategory : uint8_t {
+    ENGINE,
+    SONG,      // Loading, saving, autosave
+    LUA,       // Mode scripts, including Lua print()
+    MIDI,
+    AUDIO,
+    COUNT
+};
+
+enum class LogLevel : uint8_t {
+    DEBUG,
+    INFO,
+    WARN,
+    ERROR,
+    OFF
+};
+
+/**
+ * One log call, as recorded: the format string (a literal, never copied),
+ * up to MAX_ARGS typed arguments and the text of any string arguments.
+ * Fixed size, so logging never allocates.
+ */
+struct LogRecord {
+    static constexpr int MAX_ARGS = 4;
+    static constexpr size_t TEXT_SIZE = 120;  // String arguments, '\0'-separated, truncated to fit
+
+    enum class ArgType : uint8_t { INT, UINT, FLOAT, TEXT };
+
+    const char* format;
+    LogCategory category;
+    LogLevel level;
+    uint8_t arg_count;
+    ArgType arg_types[MAX_ARGS];
+    union Arg {
+        int64_t i;
+        uint64_t u;
+        double f;
+    } args[MAX_ARGS];
+    uint8_t text_used;
+    char text[TEXT_SIZE];
+};
+
+/**
+ * Asynchronous logger for the real-time paths
+ *
+ * A log call checks the category's level, packs a LogRecord and pushes it
+ * onto a lock-free queue: no formatting, no allocation, no I/O, from any
+ * thread. Records are formatted ("[Engine] ...") and handed to the sinks
+ * later, on the logger's own thread (startThread(), desktop) or by whoever
+ * calls flush() (Teensy main loop, tests). When the queue is full, records
+ * are counted as dropped rather than blocking the caller.
+ *
+ * Format strings use printf conversions (%d, %u, %s, %.1f, ...); each one
+ * consumes the next argument. Arguments: integers, floating point, C strings
+ * and std::string.
+ */
+class Logger {
+public:
+    using Sink = std::function<void(const LogRecord& record, const char* line)>;
+
+    static constexpr size_t QUEUE_SIZE = 256;
+
+    static Logger& instance();
+
+    Logger();
+    ~Logger();
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    // Records below the category's level are skipped at the call site (default INFO)
+    void setLevel(LogCategory category, LogLevel level);
+    LogLevel getLevel(LogCategory category) const;
+    bool isEnabled(LogCategory category, LogLevel level) const {
+        return level >= levels_[static_cast<int>(category)].load(std::memory_order_relaxed);
+    }
+
+    // Levels from a spec like "engine=debug,lua=warn" or "all=error";
+    // returns false if any entry wasn't understood (the others still apply)
+    bool configure(const std::string& spec);
+
+    // Sinks run on the consuming thread; add them before starting it
+    void addSink(Sink sink);
+    void clearSinks();
+
+    template <typename... Args>
+    void write(LogCategory category, LogLevel level, const char* format, const Args&... args) {
+        static_assert(sizeof...(Args) <= LogRecord::MAX_ARGS, "Too many log arguments");
+        if (!isEnabled(category, level)) {
+            return;
+        }
+        LogRecord record;
+        record.format = format;
+        record.category = category;
+        record.level = level;
+        record.arg_count = 0;
+        record.text_used = 0;
+        int unused[] = {0, (pack(record, args), 0)...};
+        (void)unused;
+        if (!queue_.push(record)) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Format and deliver up to max_records queued records on the calling thread
+    // (one consumer at a time: don't mix with startThread()); returns records delivered
+    size_t flush(size_t max_records = SIZE_MAX);
+
+    // Desktop: consume on a background thread until stopThread() (which flushes)
+    void startThread();
+    void stopThread();
+
+    uint32_t getDropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    // "[Engine] Mode 0 step: 3 -> 4"
+    static std::string format(const LogRecord& record);
+    static const char* categoryName(LogCategory category);
+
+    // Sink writing lines to stderr
+    static void stderrSink(const LogRecord& record, const char* line);
+
+private:
+    static void pack(LogRecord& record, long long value) { packInt(record, value); }
+    static void pack(LogRecord& record, long value) { packInt(record, value); }
+    static void pack(LogRecord& record, int value) { packInt(record, value); }
+    static void pack(LogRecord& record, unsigned long long value) { packUint(record, value); }
+    static void pack(LogRecord& record, unsigned long value) { packUint(record, value); }
+    static void pack(LogRecord& record, unsigned int value) { packUint(record, value); }
+    static void pack(LogRecord& record, uint16_t value) { packUint(record, value); }
+    static void pack(LogRecord& record, uint8_t value) { packUint(record, value); }
+    static void pack(LogRecord& record, bool value) { packUint(record, value); }
+    static void pack(LogRecord& record, double value);
+    static void pack(LogRecord& record, float value) { pack(record, static_cast<double>(value)); }
+    static void pack(LogRecord& record, const char* value);
+    static void pack(LogRecord& record, const std::string& value) { pack(record, value.c_str()); }
+    static void packInt(LogRecord& record, int64_t value);
+    static void packUint(LogRecord& record, uint64_t value);
+
+    std::atomic<LogLevel> levels_[static_cast<int>(LogCategory::COUNT)];
+    MpscQueue<LogRecord, QUEUE_SIZE> queue_;
+    std::atomic<uint32_t> dropped_;
+    uint32_t dropped_reported_;  // Consumer side
+    std::vector<Sink> sinks_;
+
+#ifndef NO_EXCEPTIONS
+    void threadLoop();
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool quit_;
+#endif
+};
+
+// Shorthands for Logger::instance().write()
+template <typename... Args>
+void logDebug(LogCategory category, const char* format, const Args&... args) {
+    Logger::instance().write(category, LogLevel::DEBUG, format, args...);
+}
+template <typename... Args>
+void logInfo(LogCategory category, const char* format, const Args&... args) {
+    Logger::instance().write(category, LogLevel::INFO, format, args...);
+}
+template <typename... Args>
+void logWarn(LogCategory category, const char* format, const Args&... args) {
+    Logger::instance().write(category, LogLevel::WARN, format, args...);
+}
+template <typename... Args>
+void logError(LogCategory category, const char* format, const Args&... args) {
+    Logger::instance().write(category, LogLevel::ERROR, format, args...);
+}
+
+} // namespace gruvbok
@@ -0,0 +1,152 @@
+#include "mapped_song_file.h"
+#include "song_format.h"
+#include <cstring>
+
+#if !defined(NO_EXCEPTIONS) && !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define GRUVBOK_HAS_MMAP 1
+#endif
+
+namespace gruvbok {
+
+// Patterns are addressed in place, so they must be plain blocks of packed words
+static_assert(sizeof(Pattern) == Pattern::NUM_TRACKS * Track::NUM_EVENTS * sizeof(uint32_t),
+              "Pattern must be a plain block of packed events");
+static_assert(MappedSongFile::HEADER_SIZE % alignof(Pattern) == 0, "Patterns must stay aligned in the mapping");
+
+namespace {
+constexpr uint32_t MAPPED_VERSION = 1;  // Fixed layout, see loadBinary()
+}
+
+MappedSongFile::MappedSongFile()
+    : data_(nullptr)
+    , fd_(-1) {
+}
+
+MappedSongFile::~MappedSongFile() {
+    close();
+}
+
+bool MappedSongFile::open(const std::string& filepath, bool create) {
+    close();
+
+#if defined(GRUVBOK_HAS_MMAP) && (!defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+    int fd = ::open(filepath.c_str(), O_RDWR | (create ? O_CREAT : 0), 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    bool is_new = st.st_size == 0;
+    if (is_new && (!create || ftruncate(fd, static_cast<off_t>(FILE_SIZE)) != 0)) {
+        ::close(fd);
+        return false;
+    }
+    if (!is_new && static_cast<size_t>(st.st_size) != FILE_SIZE) {
+        ::close(fd);
+        return false;  // Different geometry or not a v1 file: leave it alone
+    }
+
+    void* addr = mmap(nullptr, FILE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+    uint8_t* data = static_cast<uint8_t*>(addr);
+
+    // Header (the host is little endian, so the words are the file's format)
+    uint32_t header[2];
+    if (is_new) {
+        header[0] = SongFormat::MAGIC;
+        header[1] = MAPPED_VERSION;
+        std::memcpy(data, header, sizeof(header));
+    }
+    std::memcpy(header, data, sizeof(header));
+    if (header[0] != SongFormat::MAGIC || header[1] != MAPPED_VERSION) {
+        munmap(addr, FILE_SIZE);
+        ::close(fd);
+        return false;
+    }
+
+    filepath_ = filepath;
+    data_ = data;
+    fd_ = fd;
+    return true;
+#else
+    (void)filepath;
+    (void)create;
+    return false;
+#endif
+}
+
+void MappedSongFile::close() {
+#ifdef GRUVBOK_HAS_MMAP
+    if (data_) {
+        munmap(data_, FILE_SIZE);  // Dirty pages stay in the page cache and get written back
+        ::close(fd_);
+    }
+#endif
+    data_ = nullptr;
+    fd_ = -1;
+    filepath_.clear();
+}
+
+Pattern* MappedSongFile::patternAt(int mode_num, int pattern_num) const {
+    mode_num = checkIndex(mode_num, Song::NUM_MODES, "Mode number out of range");
+    pattern_num = checkIndex(pattern_num, Mode::NUM_PATTERNS, "Pattern number out of range");
+    size_t index = static_cast<size_t>(mode_num) * Mode::NUM_PATTERNS + pattern_num;
+    return reinterpret_cast<Pattern*>(data_ + HEADER_SIZE + index * sizeof(Pattern));
+}
+
+const Pattern& MappedSongFile::getPattern(int mode_num, int pattern_num) const {
+    return *patternAt(mode_num, pattern_num);
+}
+
+void MappedSongFile::setPattern(int mode_num, int pattern_num, const Pattern& pattern) {
+    std::memcpy(patternAt(mode_num, pattern_num), &pattern, sizeof(Pattern));
+}
+
+void MappedSongFile::loadInto(Song& song) const {
+    song.clear();
+    for (int mode_num = 0; mode_num < Song::NUM_MODES; ++mode_num) {
+        for (int pattern_num = 0; pattern_num < Mode::NUM_PATTERNS; ++pattern_num) {
+            const Pattern& pattern = getPattern(mode_num, pattern_num);
+            const Event* events = &pattern[0][0];
+            for (int i = 0; i < Pattern::NUM_TRACKS * Track::NUM_EVENTS; ++i) {
+                if (events[i].getRawData() != 0) {
+                    song.getMode(mode_num).setPattern(pattern_num, pattern);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+void MappedSongFile::storeFrom(const Song& song) {
+    for (int mode_num = 0; mode_num < Song::NUM_MODES; ++mode_num) {
+        for (int pattern_num = 0; pattern_num < Mode::NUM_PATTERNS; ++pattern_num) {
+            setPattern(mode_num, pattern_num, song[mode_num][pattern_num]);
+        }
+    }
+}
+
+bool MappedSongFile::sync(bool wait) {
+#ifdef GRUVBOK_HAS_MMAP
+    if (!data_) {
+        return false;
+    }
+    return msync(data_, FILE_SIZE, wait ? MS_SYNC : MS_ASYNC) == 0;
+#else
+    (void)wait;
+    return false;
+#endif
+}
+
+} // namespace gruvbok
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "song.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace gruvbok {
+
+/**
+ * Song file mapped into memory (desktop, POSIX)
+ *
+ * Uses the fixed binary v1 layout (magic, version 1, then every event as a
+ * raw little-endian uint32_t in mode/pattern/track/step order), so each
+ * pattern is one 512-byte block at a fixed offset and loadBinary() can read
+ * the file too. The mapping is MAP_SHARED: writes go to the page cache and
+ * reach the disk on sync() or whenever the kernel writes them back.
+ *
+ * Opening is O(1) and getPattern() reads straight from the mapping, so
+ * browsing a library of songs doesn't load anything. loadInto() copies only
+ * the non-empty patterns into a Song's pattern pool.
+ *
+ * Not available on embedded (NO_EXCEPTIONS) or Windows builds: open() fails.
+ */
+class MappedSongFile {
+public:
+    MappedSongFile();
+    ~MappedSongFile();
+
+    MappedSongFile(const MappedSongFile&) = delete;
+    MappedSongFile& operator=(const MappedSongFile&) = delete;
+
+    // Map filepath; a missing file is created empty when create is set
+    bool open(const std::string& filepath, bool create = true);
+    void close();
+    bool isOpen() const { return data_ != nullptr; }
+    const std::string& getPath() const { return filepath_; }
+
+    // Zero-copy view (valid until close())
+    const Pattern& getPattern(int mode_num, int pattern_num) const;
+    void setPattern(int mode_num, int pattern_num, const Pattern& pattern);
+
+    // Whole songs
+    void loadInto(Song& song) const;
+    void storeFrom(const Song& song);
+
+    // Flush dirty pages to disk (wait = block until written)
+    bool sync(bool wait = true);
+
+    static constexpr size_t HEADER_SIZE = 2 * sizeof(uint32_t);
+    static constexpr size_t FILE_SIZE = HEADER_SIZE + static_cast<size_t>(Song::NUM_MODES) * Mode::NUM_PATTERNS * sizeof(Pattern);
+
+private:
+    Pattern* patternAt(int mode_num, int pattern_num) const;
+
+    std::string filepath_;
+    uint8_t* data_;
+    int fd_;
+};
+
+} // namespace gruvbok
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace gruvbok {
+
+/**
+ * Bounded lock-free queue: any number of producer threads, one consumer
+ *
+ * A ring of Capacity slots, each with a sequence number that says whose turn
+ * it is (D. Vyukov's bounded queue). Producers claim a slot with one CAS and
+ * publish it with a release store; the consumer never waits on a producer
+ * and never allocates. push() fails instead of blocking when the ring is full.
+ *
+ * A producer that stalls between claiming and publishing its slot holds up
+ * the slots behind it (pop() reports empty until it publishes).
+ */
+template <typename T, size_t Capacity>
+class MpscQueue {
+public:
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    MpscQueue() : enqueue_pos_(0), dequeue_pos_(0) {
+        for (size_t i = 0; i < Capacity; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // Any thread; returns false when full
+    bool push(const T& value) {
+        Cell* cell;
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells_[pos & (Capacity - 1)];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;  // The consumer hasn't freed this slot yet
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);  // Another producer took it
+            }
+        }
+        cell->value = value;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer thread only; returns false when empty
+    bool pop(T& out) {
+        Cell& cell = cells_[dequeue_pos_ & (Capacity - 1)];
+        size_t seq = cell.sequence.load(std::memory_order_acquire);
+        if (seq != dequeue_pos_ + 1) {
+            return false;
+        }
+        out = cell.value;
+        cell.sequence.store(dequeue_pos_ + Capacity, std::memory_order_release);
+        dequeue_pos_++;
+        return true;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    Cell cells_[Capacity];
+    alignas(64) std::atomic<size_t> enqueue_pos_;  // Own cache line: producers contend here
+    alignas(64) size_t dequeue_pos_;               // Consumer only
+};
+
+} // namespace gruvbok
@@ -2,48 +2,94 @@
 
 #include "event.h"
 #include <array>
+#ifndef NO_EXCEPTIONS
+#include <stdexcept>
+#endif
 
 namespace gruvbok {
 
 /**
- * Track contains 16 Events (one for each button B1-B16)
+ * Range check shared by the data model accessors: throws on desktop,
+ * clamps to [0, count - 1] in NO_EXCEPTIONS (embedded) builds.
  */
-class Track {
+inline int checkIndex(int index, int count, const char* what) {
+#ifndef NO_EXCEPTIONS
+    if (index < 0 || index >= count) {
+        throw std::out_of_range(what);
+    }
+#else
+    (void)what;
+#endif
+    // Clamp to valid range for embedded builds (defensive programming)
+    return index < 0 ? 0 : (index >= count ? count - 1 : index);
+}
+
+/**
+ * Track contains Steps Events (16 = one for each button B1-B16)
+ *
+ * getEvent()/setEvent() are range checked; operator[] is the unchecked
+ * variant for inner loops that already iterate over a valid range.
+ */
+template <int Steps>
+class BasicTrack {
 public:
-    Track();
+    static_assert(Steps > 0 && Steps <= 32, "Steps must be 1-32 (switch masks are 32-bit)");
+
+    BasicTrack() = default;  // Events start empty
+
+    Event& getEvent(int step) { return events_[checkIndex(step, NUM_EVENTS, "Track step out of range")]; }
+    const Event& getEvent(int step) const { return events_[checkIndex(step, NUM_EVENTS, "Track step out of range")]; }
 
-    Event& getEvent(int step);  // step: 0-15
-    const Event& getEvent(int step) const;
+    void setEvent(int step, const Event& event) { getEvent(step) = event; }
+    void clear() { events_.fill(Event()); }
 
-    void setEvent(int step, const Event& event);
-    void clear();
+    // Unchecked access
+    Event& operator[](int step) { return events_[step]; }
+    const Event& operator[](int step) const { return events_[step]; }
 
-    static constexpr int NUM_EVENTS = 16;
+    static constexpr int NUM_EVENTS = Steps;
 
 private:
     std::array<Event, NUM_EVENTS> events_;
 };
 
 /**
- * Pattern contains 8 Tracks
+ * Pattern contains Tracks Tracks
  */
-class Pattern {
+template <int Tracks, int Steps>
+class BasicPattern {
 public:
-    Pattern();
+    static_assert(Tracks > 0 && Tracks <= 8, "Tracks must be 1-8 (track masks are 8-bit)");
 
-    Track& getTrack(int track_num);  // track_num: 0-7
-    const Track& getTrack(int track_num) const;
+    using TrackType = BasicTrack<Steps>;
 
-    Event& getEvent(int track_num, int step);
-    const Event& getEvent(int track_num, int step) const;
+    BasicPattern() = default;
 
-    void setEvent(int track_num, int step, const Event& event);
-    void clear();
+    TrackType& getTrack(int track_num) { return tracks_[checkIndex(track_num, NUM_TRACKS, "Track number out of range")]; }
+    const TrackType& getTrack(int track_num) const { return tracks_[checkIndex(track_num, NUM_TRACKS, "Track number out of range")]; }
 
-    static constexpr int NUM_TRACKS = 8;
+    Event& getEvent(int track_num, int step) { return getTrack(track_num).getEvent(step); }
+    const Event& getEvent(int track_num, int step) const { return getTrack(track_num).getEvent(step); }
+
+    void setEvent(int track_num, int step, const Event& event) { getTrack(track_num).setEvent(step, event); }
+    void clear() {
+        for (auto& track : tracks_) {
+            track.clear();
+        }
+    }
+
+    // Unchecked access
+    TrackType& operator[](int track_num) { return tracks_[track_num]; }
+    const TrackType& operator[](int track_num) const { return tracks_[track_num]; }
+
+    static constexpr int NUM_TRACKS = Tracks;
 
 private:
-    std::array<Track, NUM_TRACKS> tracks_;
+    std::array<TrackType, NUM_TRACKS> tracks_;
 };
 
+// Default geometry: 8 tracks × 16 steps, matching the hardware
+using Track = BasicTrack<16>;
+using Pattern = BasicPattern<8, 16>;
+
 } // namespace gruvbok
@@ -0,0 +1,323 @@
+#include "pattern_ops.h"
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define GRUVBOK_PATTERN_OPS_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define GRUVBOK_PATTERN_OPS_NEON 1
+#endif
+
+namespace gruvbok {
+
+// The raw views below rely on Track/Pattern being plain arrays of packed words
+static_assert(sizeof(Event) == sizeof(uint32_t), "Event must be a single packed word");
+static_assert(sizeof(Track) == Track::NUM_EVENTS * sizeof(uint32_t), "Track must be contiguous events");
+static_assert(sizeof(Pattern) == Pattern::NUM_TRACKS * sizeof(Track), "Pattern must be contiguous tracks");
+static_assert(std::is_standard_layout<Event>::value, "Event must be standard layout");
+
+namespace {
+
+constexpr int NUM_EVENTS = Track::NUM_EVENTS;
+constexpr int PATTERN_WORDS = Pattern::NUM_TRACKS * Track::NUM_EVENTS;
+constexpr int32_t POT_MAX = 127;
+constexpr uint32_t POT_MASK = 0x7F;
+constexpr uint32_t SWITCH_BIT = 0x1;
+
+inline int potShift(int pot) { return 1 + pot * 7; }
+
+inline int32_t saturate(int32_t v, int32_t lo, int32_t hi) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+inline bool stepSelected(size_t i, uint16_t step_mask) {
+    return (step_mask >> (i & (NUM_EVENTS - 1))) & 1u;
+}
+
+#if defined(GRUVBOK_PATTERN_OPS_SSE2) || defined(GRUVBOK_PATTERN_OPS_NEON)
+
+// Lane-select masks for one nibble of a step mask (4 steps = one vector)
+struct LaneMaskTable {
+    uint32_t lanes[16][4] = {};
+    constexpr LaneMaskTable() {
+        for (int n = 0; n < 16; n++) {
+            for (int j = 0; j < 4; j++) {
+                lanes[n][j] = ((n >> j) & 1) ? 0xFFFFFFFFu : 0u;
+            }
+        }
+    }
+};
+constexpr LaneMaskTable kLaneMasks;
+
+#endif
+
+#if defined(GRUVBOK_PATTERN_OPS_SSE2)
+
+using Vec = __m128i;
+
+inline Vec vload(const uint32_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+inline void vstore(uint32_t* p, Vec v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+inline Vec vsplat(int32_t x) { return _mm_set1_epi32(x); }
+inline Vec vand(Vec a, Vec b) { return _mm_and_si128(a, b); }
+inline Vec vor(Vec a, Vec b) { return _mm_or_si128(a, b); }
+inline Vec vclear(Vec a, Vec bits) { return _mm_andnot_si128(bits, a); }  // a & ~bits
+inline Vec vsel(Vec mask, Vec a, Vec b) { return vor(vand(mask, a), vclear(b, mask)); }
+inline Vec vshr(Vec v, int n) { return _mm_srl_epi32(v, _mm_cvtsi32_si128(n)); }
+inline Vec vshl(Vec v, int n) { return _mm_sll_epi32(v, _mm_cvtsi32_si128(n)); }
+inline Vec vadd(Vec a, Vec b) { return _mm_add_epi32(a, b); }
+// SSE2 has no 32-bit min/max; select on compare instead
+inline Vec vmin(Vec a, Vec b) { return vsel(_mm_cmpgt_epi32(a, b), b, a); }
+inline Vec vmax(Vec a, Vec b) { return vsel(_mm_cmplt_epi32(a, b), b, a); }
+// Exact only while both operands and the product fit in 16 bits (pot * SCALE_MAX does)
+inline Vec vmulSmall(Vec a, Vec b) { return _mm_mullo_epi16(a, b); }
+inline Vec vlanes(uint16_t step_mask, size_t i) {
+    const uint32_t* m = kLaneMasks.lanes[(step_mask >> (i & (NUM_EVENTS - 1))) & 0xF];
+    return vload(m);
+}
+inline Vec vswitchMask(Vec w) { return _mm_cmpeq_epi32(vand(w, vsplat(SWITCH_BIT)), vsplat(SWITCH_BIT)); }
+
+#elif defined(GRUVBOK_PATTERN_OPS_NEON)
+
+using Vec = int32x4_t;
+
+inline Vec vload(const uint32_t* p) { return vreinterpretq_s32_u32(vld1q_u32(p)); }
+inline void vstore(uint32_t* p, Vec v) { vst1q_u32(p, vreinterpretq_u32_s32(v)); }
+inline Vec vsplat(int32_t x) { return vdupq_n_s32(x); }
+inline Vec vand(Vec a, Vec b) { return vandq_s32(a, b); }
+inline Vec vor(Vec a, Vec b) { return vorrq_s32(a, b); }
+inline Vec vclear(Vec a, Vec bits) { return vbicq_s32(a, bits); }
+inline Vec vsel(Vec mask, Vec a, Vec b) { return vbslq_s32(vreinterpretq_u32_s32(mask), a, b); }
+inline Vec vshr(Vec v, int n) {
+    return vreinterpretq_s32_u32(vshlq_u32(vreinterpretq_u32_s32(v), vdupq_n_s32(-n)));
+}
+inline Vec vshl(Vec v, int n) {
+    return vreinterpretq_s32_u32(vshlq_u32(vreinterpretq_u32_s32(v), vdupq_n_s32(n)));
+}
+inline Vec vadd(Vec a, Vec b) { return vaddq_s32(a, b); }
+inline Vec vmin(Vec a, Vec b) { return vminq_s32(a, b); }
+inline Vec vmax(Vec a, Vec b) { return vmaxq_s32(a, b); }
+inline Vec vmulSmall(Vec a, Vec b) { return vmulq_s32(a, b); }
+inline Vec vlanes(uint16_t step_mask, size_t i) {
+    return vload(kLaneMasks.lanes[(step_mask >> (i & (NUM_EVENTS - 1))) & 0xF]);
+}
+inline Vec vswitchMask(Vec w) { return vreinterpretq_s32_u32(vtstq_s32(w, vsplat(SWITCH_BIT))); }
+
+#endif
+
+// Lane operations: a scalar form for the tail / fallback and a vector form
+struct AddOp {
+    int32_t delta;
+    int32_t operator()(int32_t v) const { return saturate(v + delta, 0, POT_MAX); }
+#if defined(GRUVBOK_PATTERN_OPS_SSE2) || defined(GRUVBOK_PATTERN_OPS_NEON)
+    Vec operator()(Vec v) const {
+        return vmin(vmax(vadd(v, vsplat(delta)), vsplat(0)), vsplat(POT_MAX));
+    }
+#endif
+};
+
+struct ScaleOp {
+    int32_t scale_q8;
+    int32_t operator()(int32_t v) const { return std::min((v * scale_q8 + 128) >> 8, POT_MAX); }
+#if defined(GRUVBOK_PATTERN_OPS_SSE2) || defined(GRUVBOK_PATTERN_OPS_NEON)
+    Vec operator()(Vec v) const {
+        return vmin(vshr(vadd(vmulSmall(v, vsplat(scale_q8)), vsplat(128)), 8), vsplat(POT_MAX));
+    }
+#endif
+};
+
+struct ClampOp {
+    int32_t lo, hi;
+    int32_t operator()(int32_t v) const { return saturate(v, lo, hi); }
+#if defined(GRUVBOK_PATTERN_OPS_SSE2) || defined(GRUVBOK_PATTERN_OPS_NEON)
+    Vec operator()(Vec v) const { return vmin(vmax(v, vsplat(lo)), vsplat(hi)); }
+#endif
+};
+
+struct FillOp {
+    int32_t value;
+    int32_t operator()(int32_t) const { return value; }
+#if defined(GRUVBOK_PATTERN_OPS_SSE2) || defined(GRUVBOK_PATTERN_OPS_NEON)
+    Vec operator()(Vec) const { return vsplat(value); }
+#endif
+};
+
+inline uint32_t writePot(uint32_t word, int shift, int32_t value) {
+    return (word & ~(POT_MASK << shift)) | (static_cast<uint32_t>(value) << shift);
+}
+
+// Apply op to one pot lane of every selected event
+template <typename Op>
+void transformPotLane(uint32_t* events, size_t count, int pot, uint16_t step_mask, const Op& op) {
+    const int shift = potShift(pot);
+    size_t i = 0;
+
+#if defined(GRUVBOK_PATTERN_OPS_SSE2) || defined(GRUVBOK_PATTERN_OPS_NEON)
+    const Vec lane_bits = vsplat(static_cast<int32_t>(POT_MASK << shift));
+    const Vec pot_mask = vsplat(static_cast<int32_t>(POT_MASK));
+    for (; i + 4 <= count; i += 4) {
+        Vec w = vload(events + i);
+        Vec v = op(vand(vshr(w, shift), pot_mask));
+        Vec sel = vand(vlanes(step_mask, i), lane_bits);
+        vstore(events + i, vor(vclear(w, sel), vand(vshl(v, shift), sel)));
+    }
+#endif
+
+    for (; i < count; i++) {
+        if (!stepSelected(i, step_mask)) continue;
+        int32_t v = static_cast<int32_t>((events[i] >> shift) & POT_MASK);
+        events[i] = writePot(events[i], shift, op(v));
+    }
+}
+
+bool validPot(int pot) { return pot >= 0 && pot < 4; }
+
+} // namespace
+
+uint32_t* PatternOps::raw(Track& track) {
+    return reinterpret_cast<uint32_t*>(&track.getEvent(0));
+}
+
+const uint32_t* PatternOps::raw(const Track& track) {
+    return reinterpret_cast<const uint32_t*>(&track.getEvent(0));
+}
+
+uint32_t* PatternOps::raw(Pattern& pattern) {
+    return reinterpret_cast<uint32_t*>(&pattern.getEvent(0, 0));
+}
+
+const uint32_t* PatternOps::raw(const Pattern& pattern) {
+    return reinterpret_cast<const uint32_t*>(&pattern.getEvent(0, 0));
+}
+
+void PatternOps::rotate(Track& track, int steps) {
+    int n = ((steps % NUM_EVENTS) + NUM_EVENTS) % NUM_EVENTS;
+    if (n == 0) return;
+    uint32_t* w = raw(track);
+    std::rotate(w, w + (NUM_EVENTS - n), w + NUM_EVENTS);
+}
+
+void PatternOps::shift(Track& track, int steps) {
+    uint32_t* w = raw(track);
+    if (steps >= NUM_EVENTS || steps <= -NUM_EVENTS) {
+        std::memset(w, 0, NUM_EVENTS * sizeof(uint32_t));
+    } else if (steps > 0) {
+        std::memmove(w + steps, w, (NUM_EVENTS - steps) * sizeof(uint32_t));
+        std::memset(w, 0, steps * sizeof(uint32_t));
+    } else if (steps < 0) {
+        int n = -steps;
+        std::memmove(w, w + n, (NUM_EVENTS - n) * sizeof(uint32_t));
+        std::memset(w + (NUM_EVENTS - n), 0, n * sizeof(uint32_t));
+    }
+}
+
+void PatternOps::reverse(Track& track) {
+    uint32_t* w = raw(track);
+    std::reverse(w, w + NUM_EVENTS);
+}
+
+void PatternOps::copy(const Pattern& src, Pattern& dst) {
+    if (&src == &dst) return;
+    std::memcpy(raw(dst), raw(src), PATTERN_WORDS * sizeof(uint32_t));
+}
+
+void PatternOps::merge(const Pattern& src, Pattern& dst) {
+    const uint32_t* s = raw(src);
+    uint32_t* d = raw(dst);
+    int i = 0;
+
+#if defined(GRUVBOK_PATTERN_OPS_SSE2) || defined(GRUVBOK_PATTERN_OPS_NEON)
+    for (; i + 4 <= PATTERN_WORDS; i += 4) {
+        Vec sv = vload(s + i);
+        vstore(d + i, vsel(vswitchMask(sv), sv, vload(d + i)));
+    }
+#endif
+
+    for (; i < PATTERN_WORDS; i++) {
+        if (s[i] & SWITCH_BIT) d[i] = s[i];
+    }
+}
+
+void PatternOps::swap(Pattern& a, Pattern& b) {
+    if (&a == &b) return;
+    uint32_t* wa = raw(a);
+    std::swap_ranges(wa, wa + PATTERN_WORDS, raw(b));
+}
+
+void PatternOps::addPot(uint32_t* events, size_t count, int pot, int delta) {
+    if (!validPot(pot) || delta == 0) return;
+    delta = saturate(delta, -POT_MAX, POT_MAX);
+    transformPotLane(events, count, pot, 0xFFFF, AddOp{delta});
+}
+
+void PatternOps::scalePot(uint32_t* events, size_t count, int pot, uint16_t scale_q8) {
+    if (!validPot(pot) || scale_q8 == SCALE_ONE) return;
+    if (scale_q8 > SCALE_MAX) scale_q8 = SCALE_MAX;
+    transformPotLane(events, count, pot, 0xFFFF, ScaleOp{scale_q8});
+}
+
+void PatternOps::clampPot(uint32_t* events, size_t count, int pot, uint8_t lo, uint8_t hi) {
+    if (!validPot(pot)) return;
+    int32_t l = std::min<int32_t>(lo, POT_MAX);
+    int32_t h = std::min<int32_t>(hi, POT_MAX);
+    if (l > h) std::swap(l, h);
+    transformPotLane(events, count, pot, 0xFFFF, ClampOp{l, h});
+}
+
+void PatternOps::fillPot(uint32_t* events, size_t count, int pot, uint8_t value, uint16_t step_mask) {
+    if (!validPot(pot) || step_mask == 0) return;
+    transformPotLane(events, count, pot, step_mask, FillOp{std::min<int32_t>(value, POT_MAX)});
+}
+
+void PatternOps::fillSwitch(uint32_t* events, size_t count, bool on, uint16_t step_mask) {
+    if (step_mask == 0) return;
+    size_t i = 0;
+
+#if defined(GRUVBOK_PATTERN_OPS_SSE2) || defined(GRUVBOK_PATTERN_OPS_NEON)
+    const Vec bit = vsplat(SWITCH_BIT);
+    for (; i + 4 <= count; i += 4) {
+        Vec w = vload(events + i);
+        Vec sel = vand(vlanes(step_mask, i), bit);
+        vstore(events + i, on ? vor(w, sel) : vclear(w, sel));
+    }
+#endif
+
+    for (; i < count; i++) {
+        if (!stepSelected(i, step_mask)) continue;
+        events[i] = on ? (events[i] | SWITCH_BIT) : (events[i] & ~SWITCH_BIT);
+    }
+}
+
+void PatternOps::randomizePot(uint32_t* events, size_t count, int pot, uint8_t lo, uint8_t hi,
+                              uint32_t& seed, uint16_t step_mask) {
+    if (!validPot(pot)) return;
+    int32_t l = std::min<int32_t>(lo, POT_MAX);
+    int32_t h = std::min<int32_t>(hi, POT_MAX);
+    if (l > h) std::swap(l, h);
+    const uint32_t range = static_cast<uint32_t>(h - l + 1);
+    const int shift = potShift(pot);
+    if (seed == 0) seed = 0x9E3779B9u;  // xorshift must not start at zero
+
+    // Serial dependency on the seed, so this one stays scalar
+    for (size_t i = 0; i < count; i++) {
+        if (!stepSelected(i, step_mask)) continue;
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        events[i] = writePot(events[i], shift, l + static_cast<int32_t>(seed % range));
+    }
+}
+
+const char* PatternOps::backend() {
+#if defined(GRUVBOK_PATTERN_OPS_SSE2)
+    return "sse2";
+#elif defined(GRUVBOK_PATTERN_OPS_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+} // namespace gruvbok
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "pattern.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace gruvbok {
+
+/**
+ * Bulk transforms on patterns, working directly on the packed uint32_t
+ * Event layout (see event.h).
+ *
+ * Pot-lane operations take a run of packed events: 16 for a track, 128 for a
+ * pattern (tracks are contiguous), or any multiple for larger spans. They use
+ * SSE2 or NEON when available and a scalar loop otherwise (Teensy).
+ *
+ * Step masks: bit N selects step N of every track in the run (index % 16).
+ * All pot values saturate to 0-127.
+ */
+class PatternOps {
+public:
+    // Packed views (Track = 16 words, Pattern = 128 words in track/step order)
+    static uint32_t* raw(Track& track);
+    static const uint32_t* raw(const Track& track);
+    static uint32_t* raw(Pattern& pattern);
+    static const uint32_t* raw(const Pattern& pattern);
+
+    // Track transforms
+    static void rotate(Track& track, int steps);   // Wraps around; positive = later
+    static void shift(Track& track, int steps);    // Fills vacated steps with empty events
+    static void reverse(Track& track);
+
+    // Pattern transforms
+    static void copy(const Pattern& src, Pattern& dst);
+    static void merge(const Pattern& src, Pattern& dst);  // Switch-on events of src overwrite dst
+    static void swap(Pattern& a, Pattern& b);
+
+    // Pot lanes (pot: 0-3)
+    static void addPot(uint32_t* events, size_t count, int pot, int delta);
+    static void scalePot(uint32_t* events, size_t count, int pot, uint16_t scale_q8);  // 256 = 1.0, max 512 = 2.0
+    static void clampPot(uint32_t* events, size_t count, int pot, uint8_t lo, uint8_t hi);
+
+    // Masked fills
+    static void fillPot(uint32_t* events, size_t count, int pot, uint8_t value, uint16_t step_mask = 0xFFFF);
+    static void fillSwitch(uint32_t* events, size_t count, bool on, uint16_t step_mask = 0xFFFF);
+    static void randomizePot(uint32_t* events, size_t count, int pot, uint8_t lo, uint8_t hi,
+                             uint32_t& seed, uint16_t step_mask = 0xFFFF);
+
+    // Which implementation was compiled in ("sse2", "neon" or "scalar")
+    static const char* backend();
+
+    static constexpr uint16_t SCALE_ONE = 256;
+    static constexpr uint16_t SCALE_MAX = 512;
+};
+
+} // namespace gruvbok
@@ -0,0 +1,203 @@
+#pragma once
+
+#include "pattern.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+namespace gruvbok {
+
+/**
+ * A Pattern plus its bookkeeping, as stored in the pattern pool
+ */
+template <typename PatternT>
+struct BasicPatternBlock {
+    PatternT pattern;
+    uint32_t refs = 0;       // Number of Mode slots pointing here
+    uint32_t hash = 0;       // Content hash (valid while interned)
+    bool interned = false;   // Shared & immutable; listed in the dedup index
+};
+
+/**
+ * Refcounted, deduplicated storage for Pattern blocks (used by Mode)
+ *
+ * Interned blocks are immutable and shared between every slot with identical
+ * content; all empty patterns point at one permanent block. A slot that is
+ * about to be written calls unshare(), which gives it a private copy (or takes
+ * its block out of the index if it was the only user). compact() folds private
+ * blocks back into the index.
+ *
+ * One pool per pattern geometry. Not thread-safe: songs are edited and copied
+ * from one thread.
+ */
+template <typename PatternT>
+class BasicPatternPool {
+public:
+    using Block = BasicPatternBlock<PatternT>;
+
+    static BasicPatternPool& shared() {
+        // Function-local so static Songs (Teensy) can use it during static init
+        static BasicPatternPool pool;
+        return pool;
+    }
+
+    // Permanent all-empty block (acquired)
+    Block* acquireEmpty() {
+        acquire(empty_);
+        return empty_;
+    }
+
+    // Shared block with this content (acquired)
+    Block* intern(const PatternT& pattern) {
+        uint32_t hash = hashPattern(pattern);
+        Block* block = findInterned(pattern, hash);
+        if (block) {
+            acquire(block);
+            return block;
+        }
+
+        block = allocate(pattern);
+        block->refs = 1;
+        block->hash = hash;
+        block->interned = true;
+        index_.emplace(hash, block);
+        return block;
+    }
+
+    // Fold a block into the index; returns the block the slot should hold now
+    Block* intern(Block* block) {
+        if (block->interned) {
+            return block;
+        }
+
+        uint32_t hash = hashPattern(block->pattern);
+        Block* existing = findInterned(block->pattern, hash);
+        if (existing) {
+            acquire(existing);
+            release(block);
+            return existing;
+        }
+
+        block->hash = hash;
+        block->interned = true;
+        index_.emplace(hash, block);
+        return block;
+    }
+
+    // Make *slot safe to write (private, refs == 1)
+    void unshare(Block*& slot) {
+        // Sole user (never the empty block, the pool holds a reference to it):
+        // write in place, but the content will stop matching its hash
+        if (slot->refs == 1) {
+            if (slot->interned) {
+                removeFromIndex(slot);
+                slot->interned = false;
+            }
+            return;
+        }
+
+        Block* copy = allocate(slot->pattern);
+        copy->refs = 1;
+        release(slot);
+        slot = copy;
+    }
+
+    void acquire(Block* block) { block->refs++; }
+
+    void release(Block* block) {
+        if (--block->refs > 0) {
+            return;
+        }
+
+        if (block->interned) {
+            removeFromIndex(block);
+        }
+        live_blocks_--;
+        if (free_list_.size() < MAX_FREE_BLOCKS) {
+            free_list_.push_back(block);
+        } else {
+            delete block;
+        }
+    }
+
+    // Statistics
+    size_t getLiveBlocks() const { return live_blocks_; }
+    size_t getBytesInUse() const { return live_blocks_ * sizeof(Block); }
+
+private:
+    BasicPatternPool()
+        : empty_(nullptr)
+        , live_blocks_(0) {
+        empty_ = intern(PatternT());  // Pool's own reference keeps it alive forever
+    }
+    BasicPatternPool(const BasicPatternPool&) = delete;
+    BasicPatternPool& operator=(const BasicPatternPool&) = delete;
+
+    static uint32_t hashPattern(const PatternT& pattern) {
+        // FNV-1a over the packed event words
+        const Event* events = &pattern[0][0];
+        uint32_t hash = 2166136261u;
+        for (int i = 0; i < PatternT::NUM_TRACKS * PatternT::TrackType::NUM_EVENTS; ++i) {
+            hash ^= events[i].getRawData();
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    static bool samePattern(const PatternT& a, const PatternT& b) {
+        return std::memcmp(&a, &b, sizeof(PatternT)) == 0;
+    }
+
+    Block* allocate(const PatternT& pattern) {
+        Block* block;
+        if (!free_list_.empty()) {
+            block = free_list_.back();
+            free_list_.pop_back();
+        } else {
+            block = new Block();
+        }
+        block->pattern = pattern;
+        block->refs = 0;
+        block->hash = 0;
+        block->interned = false;
+        live_blocks_++;
+        return block;
+    }
+
+    Block* findInterned(const PatternT& pattern, uint32_t hash) const {
+        auto range = index_.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (samePattern(it->second->pattern, pattern)) {
+                return it->second;
+            }
+        }
+        return nullptr;
+    }
+
+    void removeFromIndex(Block* block) {
+        auto range = index_.equal_range(block->hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == block) {
+                index_.erase(it);
+                return;
+            }
+        }
+    }
+
+    static_assert(sizeof(PatternT) == PatternT::NUM_TRACKS * PatternT::TrackType::NUM_EVENTS * sizeof(uint32_t),
+                  "Pattern must be a plain block of packed events");
+
+    Block* empty_;
+    std::unordered_multimap<uint32_t, Block*> index_;
+    std::vector<Block*> free_list_;  // Recycled blocks (no allocation while editing)
+    size_t live_blocks_;
+
+    static constexpr size_t MAX_FREE_BLOCKS = 16;
+};
+
+using PatternBlock = BasicPatternBlock<Pattern>;
+using PatternPool = BasicPatternPool<Pattern>;
+
+} // namespace gruvbok
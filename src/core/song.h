@@ -1,44 +1,354 @@
 #pragma once
 
 #include "pattern.h"
+#include "pattern_pool.h"
+#include "bit_ops.h"
+#include <algorithm>
 #include <array>
 #include <string>
+#include <vector>
+
+// Patterns per mode for the application's Song (1-64). Teensy builds can lower
+// this to save RAM; desktop builds can raise it.
+#ifndef GRUVBOK_NUM_PATTERNS
+#define GRUVBOK_NUM_PATTERNS 32
+#endif
 
 namespace gruvbok {
 
 /**
- * Mode contains 32 Patterns
+ * Mode contains Patterns Patterns
  * Each mode plays on its own MIDI channel
+ *
+ * Occupancy masks (switch-on events) are kept next to the patterns, outside
+ * the Pattern blocks:
+ * - getSwitchMask(p, t): bit N = step N of track t is on
+ * - getTrackMask(p):     bit N = track N has at least one step on
+ * - getPatternMask():    bit N = pattern N has at least one step on
+ *
+ * setEvent() updates them incrementally. Non-const getPattern() hands out a
+ * writable reference, so that pattern's masks are rebuilt on the next query;
+ * don't hold such a reference across a mask query and keep writing through it.
+ *
+ * Patterns live in the shared pattern pool: identical patterns (in particular
+ * empty ones) share one block, and a slot gets its own copy on the first write
+ * (non-const getPattern() or setEvent() with a new value). compact() re-shares
+ * written patterns and invalidates references from non-const getPattern().
+ */
+template <int Patterns, int Tracks, int Steps>
+class BasicMode {
+public:
+    using PatternType = BasicPattern<Tracks, Steps>;
+    using Pool = BasicPatternPool<PatternType>;
+    using Block = typename Pool::Block;
+    using SwitchMask = typename MaskFor<Steps>::type;
+    using TrackMask = uint8_t;
+    using PatternMask = typename MaskFor<Patterns>::type;
+
+    BasicMode() {
+        Pool& pool = Pool::shared();
+        for (auto& block : blocks_) {
+            block = pool.acquireEmpty();
+        }
+        resetMasks();
+    }
+
+    BasicMode(const BasicMode& other)
+        : switch_masks_(other.switch_masks_)
+        , track_masks_(other.track_masks_)
+        , pattern_mask_(other.pattern_mask_)
+        , stale_patterns_(other.stale_patterns_) {
+        Pool& pool = Pool::shared();
+        for (int i = 0; i < NUM_PATTERNS; ++i) {
+            // Shared blocks just gain a reference; private ones may still be
+            // written through a reference held by other, so share a copy instead
+            Block* block = other.blocks_[i];
+            if (block->interned) {
+                pool.acquire(block);
+                blocks_[i] = block;
+            } else {
+                blocks_[i] = pool.intern(block->pattern);
+            }
+        }
+    }
+
+    BasicMode& operator=(const BasicMode& other) {
+        if (this != &other) {
+            BasicMode copy(other);
+            std::swap(blocks_, copy.blocks_);
+            switch_masks_ = other.switch_masks_;
+            track_masks_ = other.track_masks_;
+            pattern_mask_ = other.pattern_mask_;
+            stale_patterns_ = other.stale_patterns_;
+        }
+        return *this;
+    }
+
+    ~BasicMode() {
+        Pool& pool = Pool::shared();
+        for (Block* block : blocks_) {
+            pool.release(block);
+        }
+    }
+
+    PatternType& getPattern(int pattern_num) {  // pattern_num: 0 to NUM_PATTERNS-1
+        pattern_num = checkIndex(pattern_num, NUM_PATTERNS, "Pattern number out of range");
+        stale_patterns_ |= bit(pattern_num);  // Caller may write through the reference
+        Pool::shared().unshare(blocks_[pattern_num]);
+        return blocks_[pattern_num]->pattern;
+    }
+
+    const PatternType& getPattern(int pattern_num) const {
+        return blocks_[checkIndex(pattern_num, NUM_PATTERNS, "Pattern number out of range")]->pattern;
+    }
+
+    // Unchecked read access
+    const PatternType& operator[](int pattern_num) const { return blocks_[pattern_num]->pattern; }
+
+    void setPattern(int pattern_num, const PatternType& pattern) {
+        pattern_num = checkIndex(pattern_num, NUM_PATTERNS, "Pattern number out of range");
+        Pool& pool = Pool::shared();
+        Block* block = pool.intern(pattern);
+        pool.release(blocks_[pattern_num]);
+        blocks_[pattern_num] = block;
+        stale_patterns_ |= bit(pattern_num);
+    }
+
+    void setEvent(int pattern_num, int track_num, int step, const Event& event);
+
+    void clear() {
+        Pool& pool = Pool::shared();
+        for (auto& block : blocks_) {
+            pool.release(block);
+            block = pool.acquireEmpty();
+        }
+        resetMasks();
+    }
+
+    // Share identical patterns again (see class comment)
+    void compact() {
+        Pool& pool = Pool::shared();
+        for (auto& block : blocks_) {
+            block = pool.intern(block);
+        }
+    }
+
+    // Exchange contents with other: pointer swaps only, no pattern copies
+    void swap(BasicMode& other) {
+        std::swap(blocks_, other.blocks_);
+        std::swap(switch_masks_, other.switch_masks_);
+        std::swap(track_masks_, other.track_masks_);
+        std::swap(pattern_mask_, other.pattern_mask_);
+        std::swap(stale_patterns_, other.stale_patterns_);
+    }
+
+    // Occupancy masks
+    SwitchMask getSwitchMask(int pattern_num, int track_num) const {
+        pattern_num = std::max(0, std::min(pattern_num, NUM_PATTERNS - 1));
+        track_num = std::max(0, std::min(track_num, Tracks - 1));
+        refreshMasks();
+        return switch_masks_[pattern_num][track_num];
+    }
+
+    TrackMask getTrackMask(int pattern_num) const {
+        pattern_num = std::max(0, std::min(pattern_num, NUM_PATTERNS - 1));
+        refreshMasks();
+        return track_masks_[pattern_num];
+    }
+
+    PatternMask getPatternMask() const {
+        refreshMasks();
+        return pattern_mask_;
+    }
+
+    static constexpr int NUM_PATTERNS = Patterns;
+
+private:
+    std::array<Block*, NUM_PATTERNS> blocks_;  // Never null
+
+    // Lazily rebuilt for patterns flagged in stale_patterns_
+    mutable std::array<std::array<SwitchMask, Tracks>, NUM_PATTERNS> switch_masks_;
+    mutable std::array<TrackMask, NUM_PATTERNS> track_masks_;
+    mutable PatternMask pattern_mask_;
+    mutable PatternMask stale_patterns_;
+
+    static PatternMask bit(int pattern_num) { return static_cast<PatternMask>(PatternMask(1) << pattern_num); }
+
+    void resetMasks() {
+        for (auto& track_switches : switch_masks_) {
+            track_switches.fill(0);
+        }
+        track_masks_.fill(0);
+        pattern_mask_ = 0;
+        stale_patterns_ = 0;
+    }
+
+    void refreshMasks() const;
+};
+
+/**
+ * Plain copy of a song's events, outside the pattern pool
+ *
+ * The pool isn't thread-safe, so loaders decode files into an image (which
+ * any thread may fill) and BasicSong::assign() moves it into the pool on the
+ * song's thread. Every pattern is stored: about 245KB at the default geometry.
  */
-class Mode {
+template <int Modes, int Patterns, int Tracks, int Steps>
+class BasicSongImage {
 public:
-    Mode();
+    using PatternType = BasicPattern<Tracks, Steps>;
+
+    BasicSongImage()
+        : patterns_(static_cast<size_t>(Modes) * Patterns)
+        , used_{} {
+    }
+
+    const PatternType& getPattern(int mode_num, int pattern_num) const {
+        return patterns_[index(mode_num, pattern_num)];
+    }
 
-    Pattern& getPattern(int pattern_num);  // pattern_num: 0-31
-    const Pattern& getPattern(int pattern_num) const;
+    void setPattern(int mode_num, int pattern_num, const PatternType& pattern) {
+        patterns_[index(mode_num, pattern_num)] = pattern;
+        used_[mode_num] |= uint64_t(1) << pattern_num;
+    }
 
-    void setPattern(int pattern_num, const Pattern& pattern);
-    void clear();
+    const Event& getEvent(int mode_num, int pattern_num, int track_num, int step) const {
+        return getPattern(mode_num, pattern_num).getEvent(track_num, step);
+    }
 
-    static constexpr int NUM_PATTERNS = 32;
+    void setEvent(int mode_num, int pattern_num, int track_num, int step, const Event& event) {
+        patterns_[index(mode_num, pattern_num)].setEvent(track_num, step, event);
+        used_[mode_num] |= uint64_t(1) << pattern_num;
+    }
+
+    // Bit N = pattern N was written (all others are empty)
+    uint64_t getUsedPatterns(int mode_num) const {
+        return used_[checkIndex(mode_num, Modes, "Mode number out of range")];
+    }
+
+    void clear() {
+        for (int mode_num = 0; mode_num < Modes; ++mode_num) {
+            for (uint64_t bits = used_[mode_num]; bits; bits &= bits - 1) {
+                patterns_[static_cast<size_t>(mode_num) * Patterns + lowestSetBit(bits)].clear();
+            }
+        }
+        used_.fill(0);
+    }
+
+    static constexpr int NUM_MODES = Modes;
+    static constexpr int NUM_PATTERNS = Patterns;
+    static constexpr int NUM_TRACKS = Tracks;
+    static constexpr int NUM_STEPS = Steps;
 
 private:
-    std::array<Pattern, NUM_PATTERNS> patterns_;
+    static size_t index(int mode_num, int pattern_num) {
+        mode_num = checkIndex(mode_num, Modes, "Mode number out of range");
+        pattern_num = checkIndex(pattern_num, Patterns, "Pattern number out of range");
+        return static_cast<size_t>(mode_num) * Patterns + pattern_num;
+    }
+
+    std::vector<PatternType> patterns_;
+    std::array<uint64_t, Modes> used_;
 };
 
 /**
- * Song contains 15 Modes (modes 0-14, though mode 0 is boot)
+ * Song contains Modes Modes (modes 0-14 by default, though mode 0 is boot)
  * This is the top-level data structure
+ *
+ * The whole model is templated on its geometry; the application uses the
+ * Song alias below. Accessors are inline; only persistence is compiled in
+ * song.cpp (include song_io.h to persist other geometries).
  */
-class Song {
+template <int Modes, int Patterns, int Tracks, int Steps>
+class BasicSong {
 public:
-    Song();
+    using ModeType = BasicMode<Patterns, Tracks, Steps>;
+    using PatternType = typename ModeType::PatternType;
+    using ModeMask = typename MaskFor<Modes>::type;
+    using ImageType = BasicSongImage<Modes, Patterns, Tracks, Steps>;
 
-    Mode& getMode(int mode_num);  // mode_num: 0-14
-    const Mode& getMode(int mode_num) const;
+    BasicSong() { clear(); }
 
-    void setMode(int mode_num, const Mode& mode);
-    void clear();
+    ModeType& getMode(int mode_num) {  // mode_num: 0 to NUM_MODES-1
+        mode_num = checkIndex(mode_num, NUM_MODES, "Mode number out of range");
+        stale_modes_ |= bit(mode_num);  // Caller may write through the reference
+        return modes_[mode_num];
+    }
+
+    const ModeType& getMode(int mode_num) const {
+        return modes_[checkIndex(mode_num, NUM_MODES, "Mode number out of range")];
+    }
+
+    // Unchecked read access
+    const ModeType& operator[](int mode_num) const { return modes_[mode_num]; }
+
+    void setMode(int mode_num, const ModeType& mode) {
+        mode_num = checkIndex(mode_num, NUM_MODES, "Mode number out of range");
+        modes_[mode_num] = mode;
+        stale_modes_ |= bit(mode_num);
+    }
+
+    void clear() {
+        for (auto& mode : modes_) {
+            mode.clear();
+        }
+        mode_mask_ = 0;
+        stale_modes_ = 0;
+    }
+
+    // Single-event write that keeps the occupancy masks up to date
+    void setEvent(int mode_num, int pattern_num, int track_num, int step, const Event& event) {
+        mode_num = checkIndex(mode_num, NUM_MODES, "Mode number out of range");
+
+        ModeType& mode = modes_[mode_num];
+        mode.setEvent(pattern_num, track_num, step, event);
+
+        if (!(stale_modes_ & bit(mode_num))) {
+            mode_mask_ = mode.getPatternMask() ? (mode_mask_ | bit(mode_num)) : (mode_mask_ & ~bit(mode_num));
+        }
+    }
+
+    // Share identical patterns again across all modes (see Mode)
+    void compact() {
+        for (auto& mode : modes_) {
+            mode.compact();
+        }
+    }
+
+    // Exchange contents with other: pointer swaps only, no pattern copies
+    void swap(BasicSong& other) {
+        for (int mode_num = 0; mode_num < NUM_MODES; ++mode_num) {
+            modes_[mode_num].swap(other.modes_[mode_num]);
+        }
+        std::swap(mode_mask_, other.mode_mask_);
+        std::swap(stale_modes_, other.stale_modes_);
+    }
+
+    // Replace the contents with image's (interns its patterns; see BasicSongImage)
+    void assign(const ImageType& image) {
+        clear();
+        for (int mode_num = 0; mode_num < NUM_MODES; ++mode_num) {
+            uint64_t used = image.getUsedPatterns(mode_num);
+            for (uint64_t bits = used; bits; bits &= bits - 1) {
+                int pattern_num = lowestSetBit(bits);
+                modes_[mode_num].setPattern(pattern_num, image.getPattern(mode_num, pattern_num));
+            }
+            if (used) {
+                stale_modes_ |= bit(mode_num);  // Masks are rebuilt lazily
+            }
+        }
+    }
+
+    // Bit N = mode N has at least one step on (see Mode for the finer masks)
+    ModeMask getModeMask() const {
+        while (stale_modes_) {
+            int mode_num = lowestSetBit(stale_modes_);
+            stale_modes_ &= stale_modes_ - 1;
+            mode_mask_ = modes_[mode_num].getPatternMask() ? (mode_mask_ | bit(mode_num))
+                                                           : (mode_mask_ & ~bit(mode_num));
+        }
+        return mode_mask_;
+    }
 
     // Persistence (JSON format - human readable, desktop only)
     bool save(const std::string& filepath, const std::string& name = "GRUVBOK Song", int tempo = 120);
@@ -48,13 +358,138 @@ public:
     bool saveBinary(const std::string& filepath);
     bool loadBinary(const std::string& filepath);
 
-    static constexpr int NUM_MODES = 15;
+    // Decoding only: fill image from a file without touching a song or the
+    // pattern pool, so any thread may call these. load() and loadBinary() are
+    // these plus assign(). A failed read leaves image unspecified.
+    static bool readJson(const std::string& filepath, ImageType& image,
+                         std::string* out_name = nullptr, int* out_tempo = nullptr);
+    static bool readBinary(const std::string& filepath, ImageType& image);
+
+    // In-memory binary encoding (what saveBinary writes). The header and each
+    // mode's blocks can be produced separately to spread the work out; a song
+    // must not change between the calls.
+    void encodeBinary(std::vector<uint8_t>& out) const;
+    void encodeBinaryHeader(std::vector<uint8_t>& out) const;
+    void encodeBinaryMode(int mode_num, std::vector<uint8_t>& out) const;
+
+    // Incremental binary persistence: append one pattern's current contents to
+    // a file written by saveBinary; loadBinary replays the records in order
+    bool saveBinaryPatch(const std::string& filepath, int mode_num, int pattern_num);
+    void encodeBinaryPatch(int mode_num, int pattern_num, std::vector<uint8_t>& out) const;
+    // Parse one record at p (advanced past it); false if it is malformed or torn
+    static bool decodeBinaryPatch(const uint8_t*& p, const uint8_t* end, int& mode_num, int& pattern_num,
+                                  PatternType& pattern);
 
-    // Calculate memory footprint
-    static size_t getMemoryFootprint();
+    static constexpr int NUM_MODES = Modes;
+
+    // Memory actually held: this object plus each distinct pattern block it uses
+    size_t getMemoryFootprint() const {
+        // Count each block once, however many slots share it
+        std::array<const PatternType*, NUM_MODES * Patterns> used;
+        size_t n = 0;
+        for (const auto& mode : modes_) {
+            for (int pattern_num = 0; pattern_num < Patterns; ++pattern_num) {
+                used[n++] = &mode[pattern_num];
+            }
+        }
+        std::sort(used.begin(), used.end());
+        size_t distinct = std::unique(used.begin(), used.end()) - used.begin();
+
+        return sizeof(BasicSong) + distinct * sizeof(typename ModeType::Block);
+    }
+
+    // Fully populated song without sharing (modes × patterns × tracks × steps × 4 bytes)
+    static constexpr size_t getMaxMemoryFootprint() {
+        return static_cast<size_t>(Modes) * Patterns * Tracks * Steps * sizeof(uint32_t);
+    }
 
 private:
-    std::array<Mode, NUM_MODES> modes_;
+    std::array<ModeType, NUM_MODES> modes_;
+
+    // Lazily rebuilt for modes flagged in stale_modes_ (handed out by non-const getMode())
+    mutable ModeMask mode_mask_;
+    mutable ModeMask stale_modes_;
+
+    static ModeMask bit(int mode_num) { return static_cast<ModeMask>(ModeMask(1) << mode_num); }
+
+    uint64_t getPresentPatterns(int mode_num) const;  // Bit N = pattern N has any data
+    static constexpr uint8_t PATCH_RECORD_TAG = 'P';
 };
 
+// ============================================================================
+// BasicMode out-of-line members
+// ============================================================================
+
+template <int Patterns, int Tracks, int Steps>
+void BasicMode<Patterns, Tracks, Steps>::setEvent(int pattern_num, int track_num, int step, const Event& event) {
+    pattern_num = checkIndex(pattern_num, NUM_PATTERNS, "Pattern number out of range");
+    track_num = checkIndex(track_num, Tracks, "Track number out of range");
+    step = checkIndex(step, Steps, "Step index out of range");
+
+    // Writing the value already there must not cost a private copy
+    Block*& block = blocks_[pattern_num];
+    if (block->pattern[track_num][step].getRawData() == event.getRawData()) {
+        return;
+    }
+
+    // Direct block access: no stale marking, the masks are updated below
+    Pool::shared().unshare(block);
+    block->pattern[track_num][step] = event;
+
+    if (stale_patterns_ & bit(pattern_num)) {
+        return;  // Whole pattern is rebuilt on the next query anyway
+    }
+
+    // Incremental update: step bit -> track bit -> pattern bit
+    SwitchMask& switches = switch_masks_[pattern_num][track_num];
+    SwitchMask step_bit = static_cast<SwitchMask>(SwitchMask(1) << step);
+    switches = event.getSwitch() ? (switches | step_bit) : (switches & ~step_bit);
+
+    TrackMask& tracks = track_masks_[pattern_num];
+    TrackMask track_bit = static_cast<TrackMask>(1u << track_num);
+    tracks = switches ? (tracks | track_bit) : (tracks & ~track_bit);
+
+    pattern_mask_ = tracks ? (pattern_mask_ | bit(pattern_num)) : (pattern_mask_ & ~bit(pattern_num));
+}
+
+template <int Patterns, int Tracks, int Steps>
+void BasicMode<Patterns, Tracks, Steps>::refreshMasks() const {
+    // Rebuild only the patterns that were handed out for writing
+    while (stale_patterns_) {
+        int pattern_num = lowestSetBit(stale_patterns_);
+        stale_patterns_ &= stale_patterns_ - 1;
+
+        const PatternType& pattern = blocks_[pattern_num]->pattern;
+        TrackMask tracks = 0;
+        for (int track_num = 0; track_num < Tracks; ++track_num) {
+            const auto& track = pattern[track_num];
+            SwitchMask switches = 0;
+            for (int step = 0; step < Steps; ++step) {
+                if (track[step].getSwitch()) {
+                    switches |= static_cast<SwitchMask>(SwitchMask(1) << step);
+                }
+            }
+            switch_masks_[pattern_num][track_num] = switches;
+            if (switches) {
+                tracks |= static_cast<TrackMask>(1u << track_num);
+            }
+        }
+        track_masks_[pattern_num] = tracks;
+
+        pattern_mask_ = tracks ? (pattern_mask_ | bit(pattern_num)) : (pattern_mask_ & ~bit(pattern_num));
+    }
+}
+
+// ============================================================================
+// Application geometry
+// ============================================================================
+
+static_assert(GRUVBOK_NUM_PATTERNS >= 1 && GRUVBOK_NUM_PATTERNS <= 64, "GRUVBOK_NUM_PATTERNS must be 1-64");
+
+using Mode = BasicMode<GRUVBOK_NUM_PATTERNS, Pattern::NUM_TRACKS, Track::NUM_EVENTS>;
+using Song = BasicSong<15, GRUVBOK_NUM_PATTERNS, Pattern::NUM_TRACKS, Track::NUM_EVENTS>;
+
+// Compiled once in song.cpp
+extern template class BasicSong<15, GRUVBOK_NUM_PATTERNS, Pattern::NUM_TRACKS, Track::NUM_EVENTS>;
+
 } // namespace gruvbok
@@ -0,0 +1,256 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#ifndef NO_EXCEPTIONS
+#include <cstdio>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#endif
+
+namespace gruvbok {
+
+/**
+ * Building blocks of the binary song format (see song_io.h for the layout):
+ * CRC32, little-endian/varint fields, run-length coding of packed event
+ * words, and crash-safe whole-file writes.
+ */
+class SongFormat {
+public:
+    static constexpr uint32_t MAGIC = 0x47525642;  // "GRVB" in ASCII
+
+    // CRC-32 (IEEE 802.3, as used by zlib/PNG); pass the previous value to continue
+    static uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+        static const CrcTable table;
+        crc = ~crc;
+        for (size_t i = 0; i < size; ++i) {
+            crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    // Writers (append to out)
+    static void putU8(std::vector<uint8_t>& out, uint8_t v) { out.push_back(v); }
+
+    static void putU32(std::vector<uint8_t>& out, uint32_t v) {
+        for (int i = 0; i < 4; ++i) out.push_back(static_cast<uint8_t>(v >> (i * 8)));
+    }
+
+    static void putU64(std::vector<uint8_t>& out, uint64_t v) {
+        for (int i = 0; i < 8; ++i) out.push_back(static_cast<uint8_t>(v >> (i * 8)));
+    }
+
+    static void putVarint(std::vector<uint8_t>& out, uint32_t v) {
+        while (v >= 0x80) {
+            out.push_back(static_cast<uint8_t>(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(v));
+    }
+
+    /**
+     * Readers over [p, end). Return false (and leave p unspecified) when the
+     * field runs past the end or is malformed.
+     */
+    static bool getU8(const uint8_t*& p, const uint8_t* end, uint8_t& v) {
+        if (end - p < 1) return false;
+        v = *p++;
+        return true;
+    }
+
+    static bool getU32(const uint8_t*& p, const uint8_t* end, uint32_t& v) {
+        if (end - p < 4) return false;
+        v = 0;
+        for (int i = 0; i < 4; ++i) v |= static_cast<uint32_t>(*p++) << (i * 8);
+        return true;
+    }
+
+    static bool getU64(const uint8_t*& p, const uint8_t* end, uint64_t& v) {
+        if (end - p < 8) return false;
+        v = 0;
+        for (int i = 0; i < 8; ++i) v |= static_cast<uint64_t>(*p++) << (i * 8);
+        return true;
+    }
+
+    static bool getVarint(const uint8_t*& p, const uint8_t* end, uint32_t& v) {
+        v = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            if (p == end) return false;
+            uint8_t byte = *p++;
+            v |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;  // More than 5 bytes
+    }
+
+    /**
+     * Run-length coding of packed event words. Each token is a varint
+     * (count << 2 | kind):
+     * - RUN_ZERO:    count empty words
+     * - RUN_REPEAT:  one varint word, repeated count times
+     * - RUN_LITERAL: count varint words
+     */
+    static void encodeWords(const uint32_t* words, size_t count, std::vector<uint8_t>& out) {
+        size_t i = 0;
+        while (i < count) {
+            size_t run = 1;
+            while (i + run < count && words[i + run] == words[i]) ++run;
+
+            if (words[i] == 0 || run >= MIN_REPEAT) {
+                putVarint(out, static_cast<uint32_t>(run << 2) | (words[i] == 0 ? RUN_ZERO : RUN_REPEAT));
+                if (words[i] != 0) putVarint(out, words[i]);
+                i += run;
+                continue;
+            }
+
+            // Literals until the next zero word or repeat worth a token
+            size_t start = i;
+            while (i < count && words[i] != 0) {
+                size_t ahead = 1;
+                while (i + ahead < count && ahead < MIN_REPEAT && words[i + ahead] == words[i]) ++ahead;
+                if (ahead >= MIN_REPEAT) break;
+                ++i;
+            }
+            putVarint(out, static_cast<uint32_t>((i - start) << 2) | RUN_LITERAL);
+            for (size_t k = start; k < i; ++k) putVarint(out, words[k]);
+        }
+    }
+
+    static bool decodeWords(const uint8_t* data, size_t size, uint32_t* words, size_t count) {
+        const uint8_t* p = data;
+        const uint8_t* end = data + size;
+        size_t i = 0;
+        while (p != end) {
+            uint32_t token;
+            if (!getVarint(p, end, token)) return false;
+            size_t n = token >> 2;
+            if (n == 0 || n > count - i) return false;
+
+            switch (token & 3) {
+                case RUN_ZERO:
+                    for (size_t k = 0; k < n; ++k) words[i++] = 0;
+                    break;
+                case RUN_REPEAT: {
+                    uint32_t v;
+                    if (!getVarint(p, end, v)) return false;
+                    for (size_t k = 0; k < n; ++k) words[i++] = v;
+                    break;
+                }
+                case RUN_LITERAL:
+                    for (size_t k = 0; k < n; ++k) {
+                        if (!getVarint(p, end, words[i++])) return false;
+                    }
+                    break;
+                default:
+                    return false;
+            }
+        }
+        return i == count;
+    }
+
+#ifndef NO_EXCEPTIONS
+    /**
+     * Replace filepath with data without ever leaving a partial file behind:
+     * write "<filepath>.tmp", fsync, then rename over the original.
+     */
+    static bool writeFileAtomic(const std::string& filepath, const std::vector<uint8_t>& data) {
+        const std::string tmp_path = filepath + ".tmp";
+        FILE* file = std::fopen(tmp_path.c_str(), "wb");
+        if (!file) {
+            return false;
+        }
+
+        bool ok = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+        ok = (std::fflush(file) == 0) && ok;
+#if defined(_WIN32)
+        ok = ok && (_commit(_fileno(file)) == 0);
+#else
+        ok = ok && (fsync(fileno(file)) == 0);
+#endif
+        ok = (std::fclose(file) == 0) && ok;
+        if (!ok) {
+            std::remove(tmp_path.c_str());
+            return false;
+        }
+
+#if defined(_WIN32)
+        std::remove(filepath.c_str());  // rename() doesn't replace on Windows
+#endif
+        if (std::rename(tmp_path.c_str(), filepath.c_str()) != 0) {
+            std::remove(tmp_path.c_str());
+            return false;
+        }
+
+#if !defined(_WIN32)
+        // Make the rename itself durable
+        std::string dir = filepath.substr(0, filepath.find_last_of('/') + 1);
+        int dir_fd = open(dir.empty() ? "." : dir.c_str(), O_RDONLY);
+        if (dir_fd >= 0) {
+            fsync(dir_fd);
+            close(dir_fd);
+        }
+#endif
+        return true;
+    }
+
+    // Append data and fsync (a crash can leave a torn tail; readers must check)
+    static bool appendFile(const std::string& filepath, const std::vector<uint8_t>& data) {
+        FILE* file = std::fopen(filepath.c_str(), "ab");
+        if (!file) {
+            return false;
+        }
+
+        bool ok = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+        ok = (std::fflush(file) == 0) && ok;
+#if defined(_WIN32)
+        ok = ok && (_commit(_fileno(file)) == 0);
+#else
+        ok = ok && (fsync(fileno(file)) == 0);
+#endif
+        ok = (std::fclose(file) == 0) && ok;
+        return ok;
+    }
+
+    static bool readFile(const std::string& filepath, std::vector<uint8_t>& data) {
+        FILE* file = std::fopen(filepath.c_str(), "rb");
+        if (!file) {
+            return false;
+        }
+
+        data.clear();
+        uint8_t buffer[4096];
+        size_t n;
+        while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            data.insert(data.end(), buffer, buffer + n);
+        }
+        bool ok = !std::ferror(file);
+        std::fclose(file);
+        return ok;
+    }
+#endif
+
+private:
+    enum : uint32_t { RUN_ZERO = 0, RUN_REPEAT = 1, RUN_LITERAL = 2 };
+    static constexpr size_t MIN_REPEAT = 3;  // Shorter repeats are cheaper as literals
+
+    struct CrcTable {
+        uint32_t entries[256];
+        CrcTable() {
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k) {
+                    c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+                }
+                entries[i] = c;
+            }
+        }
+    };
+};
+
+} // namespace gruvbok
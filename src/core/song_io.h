@@ -0,0 +1,441 @@
+#pragma once
+
+// Persistence for BasicSong (JSON and binary). song.cpp compiles these for the
+// application's Song; include this header to save/load other geometries.
+
+#include "song.h"
+#include "song_format.h"
+#ifndef NO_EXCEPTIONS
+#include "song_json.h"
+#include <cstdio>
+#include <fstream>
+#endif
+#include <memory>
+
+namespace gruvbok {
+
+template <int Modes, int Patterns, int Tracks, int Steps>
+bool BasicSong<Modes, Patterns, Tracks, Steps>::save(const std::string& filepath, const std::string& name, int tempo) {
+#ifdef NO_EXCEPTIONS
+    // Save/load not available in NO_EXCEPTIONS builds (Teensy will use SD card binary format)
+    (void)filepath;
+    (void)name;
+    (void)tempo;
+    return false;
+#else
+    std::FILE* file = std::fopen(filepath.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+
+    // Streamed in the exact layout of nlohmann::json::dump(2) with sorted keys,
+    // so files match those written from a DOM
+    bool ok;
+    try {
+        SongJsonWriter out(file);
+        bool any = false;
+        out.raw("{\n  \"events\": [");
+
+        // Save only switch-on events (sparse format), walking the occupancy masks
+        // in ascending order so output matches a full scan
+        for (auto modes = getModeMask(); modes; modes &= modes - 1) {
+            int mode_num = lowestSetBit(modes);
+            const ModeType& mode = modes_[mode_num];
+            for (auto patterns = mode.getPatternMask(); patterns; patterns &= patterns - 1) {
+                int pattern_num = lowestSetBit(patterns);
+                const PatternType& pattern = mode.getPattern(pattern_num);
+                for (auto tracks = mode.getTrackMask(pattern_num); tracks; tracks &= tracks - 1) {
+                    int track_num = lowestSetBit(tracks);
+                    for (auto steps = mode.getSwitchMask(pattern_num, track_num); steps; steps &= steps - 1) {
+                        int step = lowestSetBit(steps);
+                        const Event& evt = pattern.getEvent(track_num, step);
+
+                        out.raw(any ? ",\n    {\n      \"mode\": " : "\n    {\n      \"mode\": ");
+                        out.number(mode_num);
+                        out.raw(",\n      \"pattern\": ");
+                        out.number(pattern_num);
+                        out.raw(",\n      \"pots\": [");
+                        for (int pot = 0; pot < 4; ++pot) {
+                            out.raw(pot ? ",\n        " : "\n        ");
+                            out.number(evt.getPot(pot));
+                        }
+                        out.raw("\n      ],\n      \"step\": ");
+                        out.number(step);
+                        out.raw(",\n      \"switch\": true,\n      \"track\": ");
+                        out.number(track_num);
+                        out.raw("\n    }");
+                        any = true;
+                    }
+                }
+            }
+        }
+
+        out.raw(any ? "\n  ],\n  \"name\": " : "],\n  \"name\": ");
+        out.string(name);  // Throws on invalid UTF-8, as dump() does
+        out.raw(",\n  \"tempo\": ");
+        out.number(tempo);
+        out.raw(",\n  \"version\": \"1.0\"\n}");
+        ok = out.finish();
+    } catch (const std::exception& e) {
+        ok = false;
+    }
+    return std::fclose(file) == 0 && ok;
+#endif
+}
+
+template <int Modes, int Patterns, int Tracks, int Steps>
+bool BasicSong<Modes, Patterns, Tracks, Steps>::load(const std::string& filepath, std::string* out_name, int* out_tempo) {
+#ifdef NO_EXCEPTIONS
+    // Save/load not available in NO_EXCEPTIONS builds (Teensy will use SD card binary format)
+    (void)filepath;
+    (void)out_name;
+    (void)out_tempo;
+    return false;
+#else
+    // Decoded aside first: "version" sorts after "events", and a failed load
+    // must leave this song untouched
+    std::unique_ptr<ImageType> image(new ImageType());
+    if (!readJson(filepath, *image, out_name, out_tempo)) {
+        return false;
+    }
+    assign(*image);
+    return true;
+#endif
+}
+
+template <int Modes, int Patterns, int Tracks, int Steps>
+bool BasicSong<Modes, Patterns, Tracks, Steps>::readJson(const std::string& filepath, ImageType& image,
+                                                          std::string* out_name, int* out_tempo) {
+#ifdef NO_EXCEPTIONS
+    // Save/load not available in NO_EXCEPTIONS builds (Teensy will use SD card binary format)
+    (void)filepath;
+    (void)image;
+    (void)out_name;
+    (void)out_tempo;
+    return false;
+#else
+    std::ifstream file(filepath);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    image.clear();
+    SongJsonReader<ImageType> reader(image);
+    bool parsed;
+    try {
+        // Not strict: trailing data after the document is ignored, as before
+        parsed = nlohmann::json::sax_parse(file, &reader, nlohmann::json::input_format_t::json, false);
+    } catch (const std::exception& e) {
+        parsed = false;
+    }
+    file.close();
+
+    // Validate version
+    if (!parsed || !reader.isVersionOk()) {
+        return false;
+    }
+
+    // Load metadata (optional)
+    if (out_name && reader.hasName()) {
+        *out_name = reader.getName();
+    }
+    if (out_tempo && reader.hasTempo()) {
+        *out_tempo = reader.getTempo();
+    }
+    return true;
+#endif
+}
+
+/*
+ * Binary format v2 (little endian, written by saveBinary):
+ *
+ *   u32 magic "GRVB", u32 version = 2
+ *   u8 modes, u8 patterns, u8 tracks, u8 steps
+ *   u64 presence bitmap per mode (bit N = pattern N has data)
+ *   u32 CRC32 of all header bytes above
+ *   per present pattern, in mode/pattern order:
+ *     varint size, size bytes of run-length coded event words
+ *     (SongFormat::encodeWords), u32 CRC32 of those bytes
+ *
+ * followed by any number of appended pattern records (saveBinaryPatch), which
+ * replace the pattern they name, in file order:
+ *   u8 'P', u8 mode, u8 pattern, varint size, size bytes of coded words,
+ *   u32 CRC32 of all record bytes before it
+ * Replay stops at the first record that doesn't check out (a torn append).
+ *
+ * Version 1 (raw uint32 per event, every pattern, no checksum) is still read.
+ */
+
+template <int Modes, int Patterns, int Tracks, int Steps>
+uint64_t BasicSong<Modes, Patterns, Tracks, Steps>::getPresentPatterns(int mode_num) const {
+    // Any non-zero word counts (pots can be set with the switch off)
+    uint64_t present = 0;
+    for (int pattern_num = 0; pattern_num < Patterns; ++pattern_num) {
+        const Event* events = &modes_[mode_num][pattern_num][0][0];
+        for (int i = 0; i < Tracks * Steps; ++i) {
+            if (events[i].getRawData() != 0) {
+                present |= uint64_t(1) << pattern_num;
+                break;
+            }
+        }
+    }
+    return present;
+}
+
+template <int Modes, int Patterns, int Tracks, int Steps>
+void BasicSong<Modes, Patterns, Tracks, Steps>::encodeBinaryHeader(std::vector<uint8_t>& out) const {
+    static_assert(Patterns <= 64, "Presence bitmap holds 64 patterns");
+
+    size_t start = out.size();
+    SongFormat::putU32(out, SongFormat::MAGIC);
+    SongFormat::putU32(out, 2);
+    SongFormat::putU8(out, Modes);
+    SongFormat::putU8(out, Patterns);
+    SongFormat::putU8(out, Tracks);
+    SongFormat::putU8(out, Steps);
+    for (int mode_num = 0; mode_num < NUM_MODES; ++mode_num) {
+        SongFormat::putU64(out, getPresentPatterns(mode_num));
+    }
+    SongFormat::putU32(out, SongFormat::crc32(out.data() + start, out.size() - start));
+}
+
+template <int Modes, int Patterns, int Tracks, int Steps>
+void BasicSong<Modes, Patterns, Tracks, Steps>::encodeBinaryMode(int mode_num, std::vector<uint8_t>& out) const {
+    constexpr int WORDS = Tracks * Steps;
+
+    std::vector<uint8_t> block;
+    uint32_t words[WORDS];
+    for (uint64_t bits = getPresentPatterns(mode_num); bits; bits &= bits - 1) {
+        const Event* events = &modes_[mode_num][lowestSetBit(bits)][0][0];
+        for (int i = 0; i < WORDS; ++i) {
+            words[i] = events[i].getRawData();
+        }
+
+        block.clear();
+        SongFormat::encodeWords(words, WORDS, block);
+        SongFormat::putVarint(out, static_cast<uint32_t>(block.size()));
+        out.insert(out.end(), block.begin(), block.end());
+        SongFormat::putU32(out, SongFormat::crc32(block.data(), block.size()));
+    }
+}
+
+template <int Modes, int Patterns, int Tracks, int Steps>
+void BasicSong<Modes, Patterns, Tracks, Steps>::encodeBinaryPatch(int mode_num, int pattern_num, std::vector<uint8_t>& out) const {
+    constexpr int WORDS = Tracks * Steps;
+    mode_num = checkIndex(mode_num, NUM_MODES, "Mode number out of range");
+    pattern_num = checkIndex(pattern_num, Patterns, "Pattern number out of range");
+
+    uint32_t words[WORDS];
+    const Event* events = &modes_[mode_num][pattern_num][0][0];
+    for (int i = 0; i < WORDS; ++i) {
+        words[i] = events[i].getRawData();
+    }
+    std::vector<uint8_t> block;
+    SongFormat::encodeWords(words, WORDS, block);
+
+    size_t start = out.size();
+    SongFormat::putU8(out, PATCH_RECORD_TAG);
+    SongFormat::putU8(out, static_cast<uint8_t>(mode_num));
+    SongFormat::putU8(out, static_cast<uint8_t>(pattern_num));
+    SongFormat::putVarint(out, static_cast<uint32_t>(block.size()));
+    out.insert(out.end(), block.begin(), block.end());
+    SongFormat::putU32(out, SongFormat::crc32(out.data() + start, out.size() - start));
+}
+
+template <int Modes, int Patterns, int Tracks, int Steps>
+bool BasicSong<Modes, Patterns, Tracks, Steps>::decodeBinaryPatch(const uint8_t*& p, const uint8_t* end,
+                                                                   int& mode_num, int& pattern_num,
+                                                                   PatternType& pattern) {
+    constexpr int WORDS = Tracks * Steps;
+
+    const uint8_t* record = p;
+    uint8_t tag, mode, pattern_index;
+    uint32_t size, crc;
+    if (!SongFormat::getU8(p, end, tag) || tag != PATCH_RECORD_TAG ||
+        !SongFormat::getU8(p, end, mode) || mode >= NUM_MODES ||
+        !SongFormat::getU8(p, end, pattern_index) || pattern_index >= Patterns ||
+        !SongFormat::getVarint(p, end, size) || size > static_cast<size_t>(end - p)) {
+        return false;
+    }
+    const uint8_t* block = p;
+    p += size;
+
+    uint32_t words[WORDS];
+    if (!SongFormat::getU32(p, end, crc) ||
+        crc != SongFormat::crc32(record, static_cast<size_t>(block + size - record)) ||
+        !SongFormat::decodeWords(block, size, words, WORDS)) {
+        return false;
+    }
+
+    mode_num = mode;
+    pattern_num = pattern_index;
+    Event* events = &pattern[0][0];
+    for (int i = 0; i < WORDS; ++i) {
+        events[i].setRawData(words[i]);
+    }
+    return true;
+}
+
+template <int Modes, int Patterns, int Tracks, int Steps>
+void BasicSong<Modes, Patterns, Tracks, Steps>::encodeBinary(std::vector<uint8_t>& out) const {
+    encodeBinaryHeader(out);
+    for (int mode_num = 0; mode_num < NUM_MODES; ++mode_num) {
+        encodeBinaryMode(mode_num, out);
+    }
+}
+
+template <int Modes, int Patterns, int Tracks, int Steps>
+bool BasicSong<Modes, Patterns, Tracks, Steps>::saveBinary(const std::string& filepath) {
+#ifdef NO_EXCEPTIONS
+    // For embedded: Write to flash memory region
+    // This will be implemented in Teensy-specific code
+    (void)filepath;
+    return false;
+#else
+    std::vector<uint8_t> out;
+    encodeBinary(out);
+    return SongFormat::writeFileAtomic(filepath, out);
+#endif
+}
+
+template <int Modes, int Patterns, int Tracks, int Steps>
+bool BasicSong<Modes, Patterns, Tracks, Steps>::saveBinaryPatch(const std::string& filepath, int mode_num, int pattern_num) {
+#ifdef NO_EXCEPTIONS
+    // For embedded: Append to flash memory region
+    // This will be implemented in Teensy-specific code
+    (void)filepath;
+    (void)mode_num;
+    (void)pattern_num;
+    return false;
+#else
+    std::vector<uint8_t> out;
+    encodeBinaryPatch(mode_num, pattern_num, out);
+    return SongFormat::appendFile(filepath, out);
+#endif
+}
+
+template <int Modes, int Patterns, int Tracks, int Steps>
+bool BasicSong<Modes, Patterns, Tracks, Steps>::loadBinary(const std::string& filepath) {
+#ifdef NO_EXCEPTIONS
+    // For embedded: Read from flash memory region
+    // This will be implemented in Teensy-specific code
+    (void)filepath;
+    return false;
+#else
+    // Everything is decoded and checked before the song is touched
+    std::unique_ptr<ImageType> image(new ImageType());
+    if (!readBinary(filepath, *image)) {
+        return false;
+    }
+    assign(*image);  // Interning means empty and repeated patterns never get blocks of their own
+    return true;
+#endif
+}
+
+template <int Modes, int Patterns, int Tracks, int Steps>
+bool BasicSong<Modes, Patterns, Tracks, Steps>::readBinary(const std::string& filepath, ImageType& image) {
+#ifdef NO_EXCEPTIONS
+    // For embedded: Read from flash memory region
+    // This will be implemented in Teensy-specific code
+    (void)filepath;
+    (void)image;
+    return false;
+#else
+    constexpr int WORDS = Tracks * Steps;
+
+    std::vector<uint8_t> data;
+    if (!SongFormat::readFile(filepath, data)) {
+        return false;
+    }
+
+    const uint8_t* p = data.data();
+    const uint8_t* end = p + data.size();
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    if (!SongFormat::getU32(p, end, magic) || magic != SongFormat::MAGIC ||
+        !SongFormat::getU32(p, end, version)) {
+        return false;
+    }
+
+    image.clear();
+    if (version == 1) {
+        // Raw event data for all modes, in hierarchy order
+        if (static_cast<size_t>(end - p) != static_cast<size_t>(NUM_MODES) * Patterns * WORDS * sizeof(uint32_t)) {
+            return false;
+        }
+        PatternType pattern;
+        for (int mode_num = 0; mode_num < NUM_MODES; ++mode_num) {
+            for (int pattern_num = 0; pattern_num < Patterns; ++pattern_num) {
+                Event* events = &pattern[0][0];
+                for (int i = 0; i < WORDS; ++i) {
+                    uint32_t packed;
+                    SongFormat::getU32(p, end, packed);
+                    events[i].setRawData(packed);
+                }
+                image.setPattern(mode_num, pattern_num, pattern);
+            }
+        }
+    } else if (version == 2) {
+        uint8_t modes, patterns, tracks, steps;
+        if (!SongFormat::getU8(p, end, modes) || !SongFormat::getU8(p, end, patterns) ||
+            !SongFormat::getU8(p, end, tracks) || !SongFormat::getU8(p, end, steps)) {
+            return false;
+        }
+        // Smaller songs load into the first modes/patterns; the grid must match
+        if (modes > NUM_MODES || patterns > Patterns || tracks != Tracks || steps != Steps) {
+            return false;
+        }
+
+        std::vector<uint64_t> present(modes);
+        for (auto& bits : present) {
+            if (!SongFormat::getU64(p, end, bits)) return false;
+            if (patterns < 64 && (bits >> patterns)) return false;
+        }
+        uint32_t header_crc;
+        size_t header_size = static_cast<size_t>(p - data.data());
+        if (!SongFormat::getU32(p, end, header_crc) ||
+            header_crc != SongFormat::crc32(data.data(), header_size)) {
+            return false;
+        }
+
+        uint32_t words[WORDS];
+        PatternType pattern;
+        for (int mode_num = 0; mode_num < modes; ++mode_num) {
+            for (uint64_t bits = present[mode_num]; bits; bits &= bits - 1) {
+                uint32_t size, crc;
+                if (!SongFormat::getVarint(p, end, size) || size > static_cast<size_t>(end - p)) {
+                    return false;
+                }
+                const uint8_t* block = p;
+                p += size;
+                if (!SongFormat::getU32(p, end, crc) || crc != SongFormat::crc32(block, size) ||
+                    !SongFormat::decodeWords(block, size, words, WORDS)) {
+                    return false;
+                }
+
+                Event* events = &pattern[0][0];
+                for (int i = 0; i < WORDS; ++i) {
+                    events[i].setRawData(words[i]);
+                }
+                image.setPattern(mode_num, lowestSetBit(bits), pattern);
+            }
+        }
+
+        // Appended pattern records; a bad one ends the log (torn append)
+        while (p != end) {
+            int mode_num, pattern_num;
+            if (!decodeBinaryPatch(p, end, mode_num, pattern_num, pattern) ||
+                mode_num >= modes || pattern_num >= patterns) {
+                break;
+            }
+            image.setPattern(mode_num, pattern_num, pattern);
+        }
+    } else {
+        return false;
+    }
+
+    return true;
+#endif
+}
+
+} // namespace gruvbok
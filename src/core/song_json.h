@@ -0,0 +1,355 @@
+#pragma once
+
+// Streaming JSON song reader/writer (desktop only), used by BasicSong::save()
+// and load() in song_io.h. Neither side builds a DOM: the writer emits text
+// straight into a buffered file and the reader is a SAX handler that writes
+// straight into Events.
+
+#ifndef NO_EXCEPTIONS
+
+#include "song.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "../../external/nlohmann/json.hpp"
+
+namespace gruvbok {
+
+/**
+ * Buffered text output for the song writer. Produces exactly what
+ * nlohmann::json::dump(2) produces for the same document, so files stay
+ * byte-identical to those written by earlier versions.
+ */
+class SongJsonWriter {
+public:
+    explicit SongJsonWriter(std::FILE* file) : file_(file), ok_(true) { buffer_.reserve(BUFFER_SIZE); }
+
+    void raw(const char* text) { buffer_.append(text); flushIfFull(); }
+    void raw(const std::string& text) { buffer_.append(text); flushIfFull(); }
+    void number(int value) {
+        char text[12];
+        char* p = text + sizeof(text);
+        unsigned magnitude = value < 0 ? 0u - static_cast<unsigned>(value) : static_cast<unsigned>(value);
+        do {
+            *--p = static_cast<char>('0' + magnitude % 10);
+            magnitude /= 10;
+        } while (magnitude);
+        if (value < 0) {
+            *--p = '-';
+        }
+        buffer_.append(p, text + sizeof(text));
+        flushIfFull();
+    }
+    void string(const std::string& value) { raw(nlohmann::json(value).dump()); }  // Same escaping as dump()
+
+    bool finish() {
+        flush();
+        return ok_;
+    }
+
+private:
+    void flushIfFull() {
+        if (buffer_.size() >= BUFFER_SIZE) flush();
+    }
+    void flush() {
+        if (!buffer_.empty() && std::fwrite(buffer_.data(), 1, buffer_.size(), file_) != buffer_.size()) {
+            ok_ = false;
+        }
+        buffer_.clear();
+    }
+
+    static constexpr size_t BUFFER_SIZE = 64 * 1024;
+
+    std::FILE* file_;
+    std::string buffer_;
+    bool ok_;
+};
+
+/**
+ * SAX handler that decodes a song document into a BasicSongImage
+ *
+ * Accepts the flat layout written by save():
+ *   {"events": [{"mode", "pattern", "track", "step", "switch", "pots"}, ...],
+ *    "name", "tempo", "version": "1.0"}
+ * and the nested layout from docs/SONG_FORMAT.md (examples/demo_song.grv):
+ *   {"format_version": "1.0", "metadata": {"title", "tempo"},
+ *    "modes": {"<n>": {"patterns": {"<n>": {"tracks": {"<n>": {"events": [
+ *        {"step", "switch", "pots"}, ...]}}}}}}}
+ *
+ * Events missing a field or out of range are skipped; a field of the wrong
+ * type fails the load, as the DOM reader did. Keys may come in any order.
+ */
+template <typename ImageT>
+class SongJsonReader : public nlohmann::json_sax<nlohmann::json> {
+public:
+    using number_integer_t = nlohmann::json::number_integer_t;
+    using number_unsigned_t = nlohmann::json::number_unsigned_t;
+    using number_float_t = nlohmann::json::number_float_t;
+    using string_t = nlohmann::json::string_t;
+    using binary_t = nlohmann::json::binary_t;
+
+    explicit SongJsonReader(ImageT& image) : image_(image), version_ok_(false), has_name_(false), has_tempo_(false), tempo_(0) {
+        stack_.push_back({Context::DOCUMENT, std::string(), -1, -1, -1});
+    }
+
+    bool isVersionOk() const { return version_ok_; }
+    bool hasName() const { return has_name_; }
+    bool hasTempo() const { return has_tempo_; }
+    const std::string& getName() const { return name_; }
+    int getTempo() const { return tempo_; }
+
+    // Scalars
+    bool null() override { return scalar(Value::OTHER, 0, false, nullptr); }
+    bool boolean(bool val) override { return scalar(Value::BOOLEAN, 0, val, nullptr); }
+    bool number_integer(number_integer_t val) override { return scalar(Value::NUMBER, val, false, nullptr); }
+    bool number_unsigned(number_unsigned_t val) override { return scalar(Value::NUMBER, static_cast<int64_t>(val), false, nullptr); }
+    bool number_float(number_float_t val, const string_t&) override {
+        // Truncated like the integer fields; kept in range so the cast is defined
+        val = val < -1e9 ? -1e9 : val > 1e9 ? 1e9 : val;
+        return scalar(Value::NUMBER, val == val ? static_cast<int64_t>(val) : 0, false, nullptr);
+    }
+    bool string(string_t& val) override { return scalar(Value::STRING, 0, false, &val); }
+    bool binary(binary_t&) override { return scalar(Value::OTHER, 0, false, nullptr); }
+
+    // Containers
+    bool start_object(std::size_t) override { return open(true); }
+    bool start_array(std::size_t) override { return open(false); }
+    bool end_object() override { return close(); }
+    bool end_array() override { return close(); }
+
+    bool key(string_t& val) override {
+        stack_.back().key = val;
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&) override { return false; }
+
+private:
+    enum class Context {
+        DOCUMENT, ROOT, SKIP, METADATA, EVENTS, EVENT, POTS,
+        MODES, MODE, PATTERNS, PATTERN, TRACKS, TRACK
+    };
+    enum class Value { NUMBER, BOOLEAN, STRING, OTHER };
+
+    struct Frame {
+        Context context;
+        std::string key;       // Last key seen in this object
+        int mode = -1;         // Position from the nested layout
+        int pattern = -1;
+        int track = -1;
+    };
+
+    // Event fields collected until the object closes
+    struct PendingEvent {
+        int mode, pattern, track, step;
+        bool has_mode, has_pattern, has_track, has_step, has_switch, has_pots;
+        bool on;
+        int pot_count;
+        uint8_t pots[4];
+        bool pots_valid;
+    };
+
+    static int parseIndex(const std::string& text) {
+        if (text.empty() || text.size() > 3) return -1;
+        int value = 0;
+        for (char c : text) {
+            if (c < '0' || c > '9') return -1;
+            value = value * 10 + (c - '0');
+        }
+        return value;
+    }
+
+    bool scalar(Value type, int64_t number, bool flag, const std::string* text) {
+        Frame& top = stack_.back();
+        const std::string& key = top.key;
+
+        switch (top.context) {
+            case Context::ROOT:
+                if (key == "version" || key == "format_version") {
+                    version_ok_ = type == Value::STRING && *text == "1.0";
+                } else if (key == "name") {
+                    if (type != Value::STRING) return false;
+                    name_ = *text;
+                    has_name_ = true;
+                } else if (key == "tempo") {
+                    if (type != Value::NUMBER) return false;
+                    tempo_ = static_cast<int>(number);
+                    has_tempo_ = true;
+                }
+                return true;
+
+            case Context::METADATA:
+                if (key == "title" && type == Value::STRING) {
+                    name_ = *text;
+                    has_name_ = true;
+                } else if (key == "tempo" && type == Value::NUMBER) {
+                    tempo_ = static_cast<int>(number);
+                    has_tempo_ = true;
+                }
+                return true;
+
+            case Context::EVENT: {
+                PendingEvent& e = event_;
+                if (key == "switch") {
+                    if (type != Value::BOOLEAN) return false;
+                    e.on = flag;
+                    e.has_switch = true;
+                    return true;
+                }
+                if (key == "pots") {
+                    e.has_pots = true;  // Not an array: event applies, pots don't
+                    e.pots_valid = false;
+                    return true;
+                }
+                int* field = key == "mode" ? &e.mode : key == "pattern" ? &e.pattern
+                           : key == "track" ? &e.track : key == "step" ? &e.step : nullptr;
+                if (!field) return true;
+                if (type != Value::NUMBER) return false;
+                *field = static_cast<int>(number);
+                (key == "mode" ? e.has_mode : key == "pattern" ? e.has_pattern
+                 : key == "track" ? e.has_track : e.has_step) = true;
+                return true;
+            }
+
+            case Context::POTS:
+                if (type != Value::NUMBER) return false;
+                if (event_.pot_count < 4) {
+                    event_.pots[event_.pot_count] = static_cast<uint8_t>(number);
+                }
+                event_.pot_count++;
+                return true;
+
+            case Context::EVENTS:
+                return true;  // Not an object: skipped like other malformed events
+
+            default:
+                return true;
+        }
+    }
+
+    bool open(bool is_object) {
+        const Frame& top = stack_.back();
+        Frame frame{Context::SKIP, std::string(), top.mode, top.pattern, top.track};
+        const std::string& key = top.key;
+
+        switch (top.context) {
+            case Context::DOCUMENT:
+                if (is_object) frame.context = Context::ROOT;
+                break;
+            case Context::ROOT:
+                if (key == "events" && !is_object) frame.context = Context::EVENTS;
+                else if (key == "metadata" && is_object) frame.context = Context::METADATA;
+                else if (key == "modes" && is_object) frame.context = Context::MODES;
+                break;
+            case Context::MODES:
+                if (is_object) {
+                    frame.context = Context::MODE;
+                    frame.mode = parseIndex(key);
+                }
+                break;
+            case Context::MODE:
+                if (key == "patterns" && is_object) frame.context = Context::PATTERNS;
+                break;
+            case Context::PATTERNS:
+                if (is_object) {
+                    frame.context = Context::PATTERN;
+                    frame.pattern = parseIndex(key);
+                }
+                break;
+            case Context::PATTERN:
+                if (key == "tracks" && is_object) frame.context = Context::TRACKS;
+                break;
+            case Context::TRACKS:
+                if (is_object) {
+                    frame.context = Context::TRACK;
+                    frame.track = parseIndex(key);
+                }
+                break;
+            case Context::TRACK:
+                if (key == "events" && !is_object) frame.context = Context::EVENTS;
+                break;
+            case Context::EVENTS:
+                if (is_object) {
+                    frame.context = Context::EVENT;
+                    beginEvent(top);
+                }
+                break;
+            case Context::EVENT:
+                if (key == "pots") {
+                    event_.has_pots = true;
+                    event_.pots_valid = !is_object;
+                    event_.pot_count = 0;
+                    if (!is_object) frame.context = Context::POTS;
+                }
+                break;
+            case Context::POTS:
+                return false;  // Pots must be numbers
+            default:
+                break;
+        }
+
+        stack_.push_back(frame);
+        return true;
+    }
+
+    bool close() {
+        Context context = stack_.back().context;
+        stack_.pop_back();
+
+        if (context == Context::EVENT) {
+            applyEvent();
+        } else if (context == Context::POTS && event_.pot_count != 4) {
+            event_.pots_valid = false;
+        }
+        return true;
+    }
+
+    void beginEvent(const Frame& events) {
+        event_ = PendingEvent();
+        // Nested layout: position comes from the enclosing keys
+        event_.mode = events.mode;
+        event_.pattern = events.pattern;
+        event_.track = events.track;
+        event_.has_mode = events.mode >= 0;
+        event_.has_pattern = events.pattern >= 0;
+        event_.has_track = events.track >= 0;
+    }
+
+    void applyEvent() {
+        const PendingEvent& e = event_;
+        if (!e.has_mode || !e.has_pattern || !e.has_track || !e.has_step || !e.has_switch || !e.has_pots) {
+            return;  // Skip malformed events
+        }
+        if (e.mode < 0 || e.mode >= ImageT::NUM_MODES ||
+            e.pattern < 0 || e.pattern >= ImageT::NUM_PATTERNS ||
+            e.track < 0 || e.track >= ImageT::NUM_TRACKS ||
+            e.step < 0 || e.step >= ImageT::NUM_STEPS) {
+            return;  // Skip out-of-range events
+        }
+
+        // Start from the current event (duplicates overwrite field by field)
+        Event evt = image_.getEvent(e.mode, e.pattern, e.track, e.step);
+        evt.setSwitch(e.on);
+        if (e.pots_valid) {
+            for (int pot = 0; pot < 4; ++pot) {
+                evt.setPot(pot, e.pots[pot]);
+            }
+        }
+        image_.setEvent(e.mode, e.pattern, e.track, e.step, evt);
+    }
+
+    ImageT& image_;
+    std::vector<Frame> stack_;
+    PendingEvent event_{};
+
+    bool version_ok_;
+    bool has_name_;
+    bool has_tempo_;
+    std::string name_;
+    int tempo_;
+};
+
+} // namespace gruvbok
+
+#endif // NO_EXCEPTIONS
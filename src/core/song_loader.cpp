@@ -0,0 +1,148 @@
+#include "song_loader.h"
+#include "song_format.h"
+#ifndef NO_EXCEPTIONS
+#include <fstream>
+#endif
+
+namespace gruvbok {
+
+SongLoader::SongLoader()
+    : tempo_(0)
+    , busy_(false)
+    , cancelled_(false)
+#ifndef NO_EXCEPTIONS
+    , job_pending_(false)
+    , job_done_(false)
+    , job_ok_(false)
+    , quit_(false) {
+    worker_ = std::thread(&SongLoader::workerLoop, this);
+}
+#else
+{
+}
+#endif
+
+SongLoader::~SongLoader() {
+#ifndef NO_EXCEPTIONS
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    wake_.notify_one();
+    worker_.join();  // Finishes a pending job first
+#endif
+}
+
+bool SongLoader::start(const std::string& filepath) {
+#ifndef NO_EXCEPTIONS
+    if (busy_) {
+        return false;
+    }
+
+    filepath_ = filepath;
+    image_.reset(new Song::ImageType());
+    song_.reset();
+    name_.clear();
+    tempo_ = 0;
+    cancelled_ = false;
+    busy_ = true;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_pending_ = true;
+        job_done_ = false;
+    }
+    wake_.notify_one();
+    return true;
+#else
+    // For embedded: Read from SD
+    // This will be implemented in Teensy-specific code
+    (void)filepath;
+    return false;
+#endif
+}
+
+void SongLoader::cancel() {
+    if (busy_) {
+        cancelled_ = true;
+    }
+}
+
+SongLoader::Status SongLoader::poll() {
+    if (!busy_) {
+        return Status::IDLE;
+    }
+
+#ifndef NO_EXCEPTIONS
+    bool ok;
+    {
+        std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+        if (!lock.owns_lock() || !job_done_) {
+            return Status::BUSY;  // Never wait on the worker
+        }
+        job_done_ = false;
+        ok = job_ok_;
+    }
+
+    busy_ = false;
+    if (ok && !cancelled_) {
+        // Interning happens here, on the song's thread
+        song_.reset(new Song());
+        song_->assign(*image_);
+    }
+    image_.reset();
+    if (cancelled_) {
+        return Status::IDLE;
+    }
+    return ok ? Status::LOADED : Status::FAILED;
+#else
+    busy_ = false;
+    return Status::FAILED;
+#endif
+}
+
+bool SongLoader::decode() {
+#ifndef NO_EXCEPTIONS
+    // Binary files start with the magic (little endian); anything else is JSON
+    uint8_t head[4] = {};
+    {
+        std::ifstream file(filepath_, std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+        file.read(reinterpret_cast<char*>(head), sizeof(head));
+    }
+    const uint8_t* p = head;
+    uint32_t magic = 0;
+    SongFormat::getU32(p, head + sizeof(head), magic);
+
+    if (magic == SongFormat::MAGIC) {
+        return Song::readBinary(filepath_, *image_);
+    }
+    return Song::readJson(filepath_, *image_, &name_, &tempo_);
+#else
+    return false;
+#endif
+}
+
+#ifndef NO_EXCEPTIONS
+void SongLoader::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [this] { return job_pending_ || quit_; });
+        if (!job_pending_) {
+            return;  // quit_ with nothing left to do
+        }
+        job_pending_ = false;
+
+        // filepath_/image_/name_/tempo_ belong to the worker until job_done_ is set
+        lock.unlock();
+        bool ok = decode();
+        lock.lock();
+
+        job_ok_ = ok;
+        job_done_ = true;
+    }
+}
+#endif
+
+} // namespace gruvbok
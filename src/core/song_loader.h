@@ -0,0 +1,82 @@
+#pragma once
+
+#include "song.h"
+#include <memory>
+#include <string>
+#ifndef NO_EXCEPTIONS
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+namespace gruvbok {
+
+/**
+ * Loads song files off the real-time path
+ *
+ * A worker reads and decodes the file (JSON, or binary when it starts with the
+ * binary magic) into a Song::ImageType. poll() then builds the Song on the
+ * polling thread, because the pattern pool is not thread-safe, and the result
+ * is collected with takeSong().
+ *
+ * - Desktop: a worker thread does the reading and decoding.
+ * - NO_EXCEPTIONS (embedded): song files can't be loaded yet; start() fails.
+ */
+class SongLoader {
+public:
+    enum class Status {
+        IDLE,    // No load in progress
+        BUSY,    // Load in progress
+        LOADED,  // Last load finished, song ready for takeSong() (reported once)
+        FAILED   // Last load failed (reported once)
+    };
+
+    SongLoader();
+    ~SongLoader();  // Waits for a load in progress to finish
+
+    SongLoader(const SongLoader&) = delete;
+    SongLoader& operator=(const SongLoader&) = delete;
+
+    // Start loading filepath; returns false if busy
+    bool start(const std::string& filepath);
+
+    // Discard the load in progress (poll() reports IDLE when it ends)
+    void cancel();
+
+    // Non-blocking
+    Status poll();
+
+    bool isBusy() const { return busy_; }
+
+    // After LOADED: the song, and the metadata stored with it (JSON only;
+    // tempo is 0 when the file has none)
+    std::unique_ptr<Song> takeSong() { return std::move(song_); }
+    const std::string& getPath() const { return filepath_; }
+    const std::string& getName() const { return name_; }
+    int getTempo() const { return tempo_; }
+
+private:
+    bool decode();  // Runs on the worker
+
+    std::string filepath_;
+    std::unique_ptr<Song::ImageType> image_;
+    std::unique_ptr<Song> song_;
+    std::string name_;
+    int tempo_;
+    bool busy_;
+    bool cancelled_;
+
+#ifndef NO_EXCEPTIONS
+    void workerLoop();
+
+    std::thread worker_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool job_pending_;  // Guarded by mutex_
+    bool job_done_;
+    bool job_ok_;
+    bool quit_;
+#endif
+};
+
+} // namespace gruvbok
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace gruvbok {
+
+/**
+ * Bounded lock-free queue: one producer thread, one consumer thread
+ *
+ * A ring of Capacity slots indexed by two free-running counters, each written
+ * by one side only. push() and pop() are a few loads and one release store;
+ * neither side ever waits for or allocates on behalf of the other. push()
+ * fails instead of blocking when the ring is full.
+ */
+template <typename T, size_t Capacity>
+class SpscQueue {
+public:
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    SpscQueue() : head_(0), tail_(0) {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer thread only; returns false when full
+    bool push(const T& value) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        slots_[tail & (Capacity - 1)] = value;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer thread only; returns false when empty
+    bool pop(T& out) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        out = slots_[head & (Capacity - 1)];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer thread only
+    bool empty() const {
+        return head_.load(std::memory_order_relaxed) == tail_.load(std::memory_order_acquire);
+    }
+
+private:
+    T slots_[Capacity];
+    alignas(64) std::atomic<size_t> head_;  // Next slot to pop (consumer)
+    alignas(64) std::atomic<size_t> tail_;  // Next slot to push (producer)
+};
+
+} // namespace gruvbok
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace gruvbok {
+
+/**
+ * Wait-free single-writer, single-reader triple buffer
+ *
+ * The writer fills getWriteBuffer() and publish()es it; the reader calls
+ * fetch() and reads getReadBuffer(). The three buffers are handed around
+ * with one atomic exchange per publish or fetch, so neither side ever waits
+ * and the reader never sees a buffer the writer is still filling. The reader
+ * always gets the latest published value; intermediate ones may be skipped.
+ */
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : buffers_{}, write_(0), middle_(1), read_(2) {}
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // Writer side
+    T& getWriteBuffer() { return buffers_[write_]; }
+    void publish() {
+        write_ = middle_.exchange(static_cast<uint8_t>(write_ | FRESH), std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Reader side: take the latest published buffer, if there is a new one
+    bool fetch() {
+        if (!(middle_.load(std::memory_order_relaxed) & FRESH)) {
+            return false;
+        }
+        read_ = middle_.exchange(read_, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+    const T& getReadBuffer() const { return buffers_[read_]; }
+
+private:
+    static constexpr uint8_t INDEX = 0x3;
+    static constexpr uint8_t FRESH = 0x4;  // Middle holds a buffer the reader hasn't taken
+
+    T buffers_[3];
+    uint8_t write_;                // Writer only
+    std::atomic<uint8_t> middle_;  // Index | FRESH
+    uint8_t read_;                 // Reader only
+};
+
+} // namespace gruvbok
@@ -0,0 +1,83 @@
+#include "undo_history.h"
+
+namespace gruvbok {
+
+UndoHistory::UndoHistory()
+    : deltas_{}
+    , begin_(0)
+    , cursor_(0)
+    , end_(0)
+    , depth_(0)
+    , open_(false)
+    , open_start_(0)
+    , overflowed_(false) {
+}
+
+void UndoHistory::beginTransaction() {
+    depth_++;
+}
+
+void UndoHistory::endTransaction() {
+    if (depth_ > 0 && --depth_ == 0) {
+        open_ = false;
+        overflowed_ = false;
+    }
+}
+
+void UndoHistory::record(int mode, int pattern, int track, int step, uint32_t old_raw, uint32_t new_raw) {
+    if (old_raw == new_raw || overflowed_) {
+        return;
+    }
+    end_ = cursor_;  // A new edit ends the redo branch
+
+    // Same event again in this transaction (a pot being dragged): keep the first old value
+    if (open_) {
+        Delta& last = at(end_ - 1);
+        if (last.mode == mode && last.pattern == pattern && last.track == track && last.step == step) {
+            last.new_raw = new_raw;
+            return;
+        }
+    }
+
+    if (size() == CAPACITY) {
+        if (open_ && open_start_ == begin_) {
+            // This transaction alone fills the ring: undoing part of it would
+            // leave the song in a state that never existed
+            clear();
+            overflowed_ = inTransaction();
+            return;
+        }
+        dropOldestTransaction();
+    }
+
+    Delta& d = at(end_);
+    d.old_raw = old_raw;
+    d.new_raw = new_raw;
+    d.mode = static_cast<uint8_t>(mode);
+    d.pattern = static_cast<uint8_t>(pattern);
+    d.track = static_cast<uint8_t>(track);
+    d.step = static_cast<uint8_t>(step);
+    d.first = !open_;
+    if (!open_ && inTransaction()) {
+        open_ = true;
+        open_start_ = end_;
+    }
+    end_++;
+    cursor_ = end_;
+}
+
+void UndoHistory::clear() {
+    begin_ = 0;
+    cursor_ = 0;
+    end_ = 0;
+    open_ = false;
+    overflowed_ = false;
+}
+
+void UndoHistory::dropOldestTransaction() {
+    do {
+        begin_++;
+    } while (begin_ != end_ && !at(begin_).first);
+}
+
+} // namespace gruvbok
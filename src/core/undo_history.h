@@ -0,0 +1,104 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace gruvbok {
+
+/**
+ * Undo/redo log of song edits, kept as per-event deltas
+ *
+ * Each edit is stored as (address, old raw event, new raw event) in a fixed
+ * ring of CAPACITY deltas, so memory use never grows and undoing or redoing
+ * touches only the events that changed. Edits are grouped into transactions
+ * (one button press, one GUI drag, one Lua pattern transform) that are undone
+ * and redone as a whole; an edit made outside a transaction is one by itself.
+ *
+ * When the ring is full the oldest transactions are dropped. A single
+ * transaction larger than the ring can't be undone: it clears the history.
+ * Recording a new edit drops everything that could have been redone.
+ */
+class UndoHistory {
+public:
+    static constexpr size_t CAPACITY = 1024;  // Deltas (12 bytes each)
+
+    UndoHistory();
+
+    // Group the edits recorded until the matching end (calls nest)
+    void beginTransaction();
+    void endTransaction();
+    bool inTransaction() const { return depth_ > 0; }
+
+    // Record one event change (no-op when old_raw == new_raw). Repeated edits
+    // of the same event within a transaction fold into one delta.
+    void record(int mode, int pattern, int track, int step, uint32_t old_raw, uint32_t new_raw);
+
+    bool canUndo() const { return cursor_ != begin_; }
+    bool canRedo() const { return cursor_ != end_; }
+
+    // Revert / reapply one transaction through apply(mode, pattern, track, step, raw);
+    // returns false when there is nothing to do
+    template <typename Fn>
+    bool undo(Fn apply) {
+        if (!canUndo()) {
+            return false;
+        }
+        do {
+            const Delta& d = at(--cursor_);
+            apply(d.mode, d.pattern, d.track, d.step, d.old_raw);
+            if (d.first) break;
+        } while (cursor_ != begin_);
+        open_ = false;  // Later edits start a new transaction
+        return true;
+    }
+
+    template <typename Fn>
+    bool redo(Fn apply) {
+        if (!canRedo()) {
+            return false;
+        }
+        do {
+            const Delta& d = at(cursor_++);
+            apply(d.mode, d.pattern, d.track, d.step, d.new_raw);
+        } while (cursor_ != end_ && !at(cursor_).first);
+        open_ = false;
+        return true;
+    }
+
+    void clear();
+
+    size_t size() const { return end_ - begin_; }  // Deltas held, undo and redo
+
+private:
+    struct Delta {
+        uint32_t old_raw;
+        uint32_t new_raw;
+        uint8_t mode;
+        uint8_t pattern;
+        uint8_t track;
+        uint8_t step : 7;
+        uint8_t first : 1;  // First delta of a transaction
+    };
+    static_assert(sizeof(Delta) == 12, "Delta should pack into 12 bytes");
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be a power of two");
+
+    Delta& at(uint32_t index) { return deltas_[index & (CAPACITY - 1)]; }
+    const Delta& at(uint32_t index) const { return deltas_[index & (CAPACITY - 1)]; }
+    void dropOldestTransaction();
+
+    std::array<Delta, CAPACITY> deltas_;
+
+    // Running indices into the ring: [begin_, cursor_) can be undone,
+    // [cursor_, end_) redone
+    uint32_t begin_;
+    uint32_t cursor_;
+    uint32_t end_;
+
+    int depth_;          // Transaction nesting
+    bool open_;          // The current transaction has recorded a delta (at open_start_)
+    uint32_t open_start_;
+    bool overflowed_;    // The current transaction outgrew the ring; ignore the rest of it
+};
+
+} // namespace gruvbok
@@ -0,0 +1,120 @@
+#include "worker_pool.h"
+
+namespace gruvbok {
+
+#ifndef NO_EXCEPTIONS
+
+WorkerPool::WorkerPool(int threads)
+    : batch_(0)
+    , count_(0)
+    , task_(nullptr)
+    , quit_(false)
+    , cursor_(0)
+    , remaining_(0) {
+    for (int i = 0; i < threads; ++i) {
+        threads_.emplace_back(&WorkerPool::workerLoop, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& thread : threads_) {
+        thread.join();
+    }
+}
+
+int WorkerPool::getThreadCount() const {
+    return static_cast<int>(threads_.size());
+}
+
+void WorkerPool::run(int count, const std::function<void(int)>& task) {
+    if (count <= 0) {
+        return;
+    }
+    if (threads_.empty() || count == 1) {
+        for (int i = 0; i < count; ++i) {
+            task(i);
+        }
+        return;
+    }
+
+    uint32_t batch;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        batch = ++batch_;
+        count_ = count;
+        task_ = &task;
+        remaining_.store(count, std::memory_order_relaxed);
+        cursor_.store(static_cast<uint64_t>(batch) << 32, std::memory_order_release);
+    }
+    wake_.notify_all();
+
+    drain(batch, count, &task);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return remaining_.load(std::memory_order_acquire) == 0; });
+    task_ = nullptr;
+}
+
+void WorkerPool::drain(uint32_t batch, int count, const std::function<void(int)>* task) {
+    uint64_t cursor = cursor_.load(std::memory_order_acquire);
+    while (static_cast<uint32_t>(cursor >> 32) == batch &&
+           static_cast<int>(cursor & 0xFFFFFFFFu) < count) {
+        if (!cursor_.compare_exchange_weak(cursor, cursor + 1, std::memory_order_acq_rel)) {
+            continue;  // cursor reloaded; try the next task
+        }
+        (*task)(static_cast<int>(cursor & 0xFFFFFFFFu));
+        if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> lock(mutex_);  // Don't notify between the caller's check and wait
+            done_.notify_one();
+        }
+        cursor = cursor_.load(std::memory_order_acquire);
+    }
+}
+
+void WorkerPool::workerLoop() {
+    uint32_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [&] { return quit_ || batch_ != seen; });
+        if (quit_) {
+            return;
+        }
+        seen = batch_;
+        int count = count_;
+        const std::function<void(int)>* task = task_;
+
+        lock.unlock();
+        if (task) {
+            drain(seen, count, task);
+        }
+        lock.lock();
+    }
+}
+
+#else
+
+WorkerPool::WorkerPool(int threads) {
+    (void)threads;
+}
+
+WorkerPool::~WorkerPool() {
+}
+
+int WorkerPool::getThreadCount() const {
+    return 0;
+}
+
+void WorkerPool::run(int count, const std::function<void(int)>& task) {
+    for (int i = 0; i < count; ++i) {
+        task(i);
+    }
+}
+
+#endif
+
+} // namespace gruvbok
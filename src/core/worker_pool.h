@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#ifndef NO_EXCEPTIONS
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+namespace gruvbok {
+
+/**
+ * Runs a batch of independent tasks on a few threads and waits for all of them
+ *
+ * run(count, task) calls task(0) .. task(count - 1). The calling thread works
+ * on the batch too. Every thread takes the next unclaimed task until none are
+ * left, so a slow task doesn't hold up the tasks queued behind it. Tasks must
+ * not depend on each other or on the order they run in.
+ *
+ * - Desktop: `threads` workers besides the caller.
+ * - NO_EXCEPTIONS (embedded): no threads; run() calls the tasks in order.
+ */
+class WorkerPool {
+public:
+    explicit WorkerPool(int threads);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    void run(int count, const std::function<void(int)>& task);
+
+    int getThreadCount() const;  // Workers, not counting the caller
+
+private:
+#ifndef NO_EXCEPTIONS
+    void workerLoop();
+    void drain(uint32_t batch, int count, const std::function<void(int)>* task);
+
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+
+    // Batch handed to the workers (guarded by mutex_)
+    uint32_t batch_;
+    int count_;
+    const std::function<void(int)>* task_;
+    bool quit_;
+
+    // Batch number << 32 | next unclaimed task. A worker that wakes up late
+    // can't claim tasks of a newer batch.
+    std::atomic<uint64_t> cursor_;
+    std::atomic<int> remaining_;  // Tasks of the current batch not finished yet
+#endif
+};
+
+} // namespace gruvbok
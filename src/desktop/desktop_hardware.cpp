@@ -13,7 +13,9 @@ DesktopHardware::DesktopHardware()
     , midi_initialized_(false)
     , current_port_(-1)
     , current_input_port_(-1)
-    , mirror_mode_enabled_(false) {
+    , mirror_mode_enabled_(false)
+    , batch_writes_(false)
+    , midi_input_dropped_(0) {
 
     buttons_.fill(false);
     rotary_pots_.fill(64);  // Default to middle value
@@ -30,6 +32,7 @@ bool DesktopHardware::init() {
     // Initialize RtMidi
     try {
         midi_out_ = std::make_unique<RtMidiOut>();
+        batch_writes_ = midi_out_->getCurrentApi() == RtMidi::LINUX_ALSA;
 
         unsigned int port_count = midi_out_->getPortCount();
 
@@ -85,6 +88,7 @@ uint8_t DesktopHardware::readSliderPot(int pot) {
 }
 
 void DesktopHardware::sendMidiMessage(const MidiMessage& msg) {
+    flush();  // Keep order with a batch still held
     if (!midi_initialized_ || !midi_out_) {
         return;
     }
@@ -99,6 +103,30 @@ void DesktopHardware::sendMidiMessage(const MidiMessage& msg) {
     }
 }
 
+void DesktopHardware::sendMidiBatch(const MidiMessage* messages, size_t count) {
+    if (!batch_writes_) {
+        HardwareInterface::sendMidiBatch(messages, count);
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        output_batch_.insert(output_batch_.end(), messages[i].data.begin(), messages[i].data.end());
+    }
+}
+
+void DesktopHardware::flush() {
+    if (output_batch_.empty()) {
+        return;
+    }
+    if (midi_initialized_ && midi_out_) {
+        try {
+            midi_out_->sendMessage(output_batch_.data(), output_batch_.size());
+        } catch (RtMidiError& error) {
+            addLog("Error sending MIDI: " + error.getMessage());
+        }
+    }
+    output_batch_.clear();
+}
+
 void DesktopHardware::setLED(bool on) {
     led_state_ = on;
     // No console spam for LED!
@@ -110,6 +138,12 @@ uint32_t DesktopHardware::getMillis() {
     return static_cast<uint32_t>(duration.count());
 }
 
+uint32_t DesktopHardware::getMicros() {
+    auto now = std::chrono::steady_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(now - start_time_);
+    return static_cast<uint32_t>(duration.count());
+}
+
 void DesktopHardware::update() {
     // Nothing to update for desktop (keyboard input handled elsewhere)
 }
@@ -182,6 +216,7 @@ bool DesktopHardware::selectMidiPort(int port) {
 
 // Logging
 void DesktopHardware::addLog(const std::string& message) {
+    std::lock_guard<std::mutex> lock(log_mutex_);
     log_messages_.push_back(message);
     if (log_messages_.size() > MAX_LOG_MESSAGES) {
         log_messages_.pop_front();
@@ -189,7 +224,13 @@ void DesktopHardware::addLog(const std::string& message) {
     // GUI-only logging - no console spam!
 }
 
+std::deque<std::string> DesktopHardware::getLogMessages() const {
+    std::lock_guard<std::mutex> lock(log_mutex_);
+    return log_messages_;
+}
+
 void DesktopHardware::clearLog() {
+    std::lock_guard<std::mutex> lock(log_mutex_);
     log_messages_.clear();
 }
 
@@ -254,46 +295,45 @@ void DesktopHardware::setMirrorMode(bool enabled) {
 }
 
 void DesktopHardware::midiInputCallback(double deltatime, std::vector<unsigned char>* message, void* userData) {
-    (void)deltatime;  // Unused
+    (void)deltatime;  // RtMidi's delta is relative to the previous message; stamp our own clock instead
 
+    auto now = std::chrono::steady_clock::now();
     DesktopHardware* hardware = static_cast<DesktopHardware*>(userData);
     if (!hardware || !message || message->empty()) {
         return;
     }
 
-    // Simple MIDI message logging
-    std::string log = "MIDI IN: ";
-    for (unsigned char byte : *message) {
-        char hex[8];
-        snprintf(hex, sizeof(hex), "%02X ", byte);
-        log += hex;
+    if (message->size() > sizeof(MidiInputEvent::data)) {
+        hardware->midi_input_dropped_.fetch_add(1, std::memory_order_relaxed);  // SysEx
+        return;
     }
 
-    // Parse and describe the message
-    uint8_t status = (*message)[0];
-    uint8_t type = status & 0xF0;
-    uint8_t channel = (status & 0x0F) + 1;
-
-    if (type == 0x90 && message->size() >= 3) {
-        // Note On
-        uint8_t note = (*message)[1];
-        uint8_t velocity = (*message)[2];
-        log += "| Note On: " + std::to_string(note) + " vel=" + std::to_string(velocity) + " ch=" + std::to_string(channel);
-    } else if (type == 0x80 && message->size() >= 3) {
-        // Note Off
-        uint8_t note = (*message)[1];
-        log += "| Note Off: " + std::to_string(note) + " ch=" + std::to_string(channel);
-    } else if (type == 0xB0 && message->size() >= 3) {
-        // Control Change
-        uint8_t cc = (*message)[1];
-        uint8_t value = (*message)[2];
-        log += "| CC: " + std::to_string(cc) + "=" + std::to_string(value) + " ch=" + std::to_string(channel);
-    } else if (status == 0xF8) {
-        // Clock (don't spam log)
+    MidiInputEvent event;
+    event.timestamp_us = static_cast<uint32_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(now - hardware->start_time_).count());
+    event.size = static_cast<uint8_t>(message->size());
+    for (size_t i = 0; i < sizeof(event.data); ++i) {
+        event.data[i] = i < message->size() ? (*message)[i] : 0;
+    }
+
+    if (!hardware->midi_input_.push(event)) {
+        hardware->midi_input_dropped_.fetch_add(1, std::memory_order_relaxed);
         return;
     }
 
-    hardware->addLog(log);
+    // Taking the lock orders the push before a waiter's check, so no wakeup is lost
+    { std::lock_guard<std::mutex> lock(hardware->midi_input_mutex_); }
+    hardware->midi_input_ready_.notify_one();
+}
+
+bool DesktopHardware::readMidiInput(MidiInputEvent& event) {
+    return midi_input_.pop(event);
+}
+
+bool DesktopHardware::waitForMidiInput(uint32_t timeout_ms) {
+    std::unique_lock<std::mutex> lock(midi_input_mutex_);
+    return midi_input_ready_.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                                      [this] { return !midi_input_.empty(); });
 }
 
 } // namespace gruvbok
@@ -1,7 +1,11 @@
 #pragma once
 
 #include "../hardware/hardware_interface.h"
+#include "../core/spsc_queue.h"
+#include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <array>
 #include <chrono>
 #include <string>
@@ -31,9 +35,13 @@ public:
     uint8_t readSliderPot(int pot) override;
 
     void sendMidiMessage(const MidiMessage& msg) override;
+    bool readMidiInput(MidiInputEvent& event) override;
+    void sendMidiBatch(const MidiMessage* messages, size_t count) override;
+    void flush() override;
     void setLED(bool on) override;
     bool getLED() const override { return led_state_; }
     uint32_t getMillis() override;
+    uint32_t getMicros() override;
 
     void update() override;
 
@@ -55,10 +63,15 @@ public:
     int getCurrentMidiInputPort() const { return current_input_port_; }
     bool isMirrorModeEnabled() const { return mirror_mode_enabled_; }
     void setMirrorMode(bool enabled);
+    uint32_t getDroppedMidiInput() const { return midi_input_dropped_.load(std::memory_order_relaxed); }
 
-    // Logging
+    // Engine thread: sleep up to timeout_ms, waking early when MIDI input is
+    // queued; true = input waiting (run the engine so live input isn't held to the frame rate)
+    bool waitForMidiInput(uint32_t timeout_ms);
+
+    // Logging (any thread: the logger's GUI sink calls addLog() on its own thread)
     void addLog(const std::string& message);
-    const std::deque<std::string>& getLogMessages() const { return log_messages_; }
+    std::deque<std::string> getLogMessages() const;
     void clearLog();
 
 private:
@@ -73,10 +86,23 @@ private:
     int current_port_;
     int current_input_port_;
     bool mirror_mode_enabled_;
-    std::deque<std::string> log_messages_;
+
+    // Output bursts: ALSA takes several messages in one write (one drain);
+    // the other RtMidi APIs want one message per call
+    bool batch_writes_;
+    std::vector<unsigned char> output_batch_;  // Held until flush()
+    mutable std::mutex log_mutex_;
+    std::deque<std::string> log_messages_;  // Guarded by log_mutex_
     static constexpr size_t MAX_LOG_MESSAGES = 100;
 
-    // MIDI input callback
+    // Incoming MIDI, from RtMidi's callback thread to the engine thread
+    static constexpr size_t MIDI_INPUT_QUEUE_SIZE = 1024;
+    SpscQueue<MidiInputEvent, MIDI_INPUT_QUEUE_SIZE> midi_input_;
+    std::atomic<uint32_t> midi_input_dropped_;  // Queue full, or SysEx
+    std::mutex midi_input_mutex_;               // Only for waking waitForMidiInput()
+    std::condition_variable midi_input_ready_;
+
+    // MIDI input callback (RtMidi's thread: only timestamps and queues the message, and wakes the engine)
     static void midiInputCallback(double deltatime, std::vector<unsigned char>* message, void* userData);
 };
 
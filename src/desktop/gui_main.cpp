@@ -1,5 +1,6 @@
 #include "../core/song.h"
 #include "../core/engine.h"
+#include "../core/log.h"
 #include "../lua_bridge/mode_loader.h"
 #include "desktop_hardware.h"
 
@@ -17,6 +18,8 @@
 #include <fstream>
 #include <sstream>
 #include <filesystem>
+#include <thread>
+#include <cstdlib>
 
 #ifdef __APPLE__
 #include <mach-o/dyld.h>
@@ -80,6 +83,30 @@ bool Knob(const char* label, int* value, int min_val, int max_val, const char* d
     return value_changed;
 }
 
+// Log line for an incoming MIDI message (formatted here, off the MIDI and engine threads)
+std::string FormatMidiInput(const MidiInputEvent& event) {
+    std::string log = "MIDI IN: ";
+    for (int i = 0; i < event.size; i++) {
+        char hex[8];
+        snprintf(hex, sizeof(hex), "%02X ", event.data[i]);
+        log += hex;
+    }
+
+    // Parse and describe the message
+    uint8_t status = event.data[0];
+    uint8_t type = status & 0xF0;
+    uint8_t channel = (status & 0x0F) + 1;
+
+    if (type == 0x90 && event.size >= 3) {
+        log += "| Note On: " + std::to_string(event.data[1]) + " vel=" + std::to_string(event.data[2]) + " ch=" + std::to_string(channel);
+    } else if (type == 0x80 && event.size >= 3) {
+        log += "| Note Off: " + std::to_string(event.data[1]) + " ch=" + std::to_string(channel);
+    } else if (type == 0xB0 && event.size >= 3) {
+        log += "| CC: " + std::to_string(event.data[1]) + "=" + std::to_string(event.data[2]) + " ch=" + std::to_string(channel);
+    }
+    return log;
+}
+
 int main(int argc, char* argv[]) {
     (void)argc;
     (void)argv;
@@ -177,6 +204,10 @@ int main(int argc, char* argv[]) {
     // Enable external MIDI by default (matches GUI checkbox default)
     engine->setUseExternalMIDI(true);
 
+    // Render parallel-safe modes on spare cores (same MIDI output as one thread)
+    int spare_cores = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+    engine->setModeThreads(std::min(spare_cores, 3));
+
     // Mode 0: Song/Pattern Sequencer - Default pattern chain
     // Patterns 0-3 repeating 4 times each (steps 0-3, 4-7, 8-11, 12-15)
     Mode& mode0 = song->getMode(0);
@@ -322,6 +353,18 @@ int main(int argc, char* argv[]) {
     hardware->addLog("Engine started - playback running");
 
     // Main loop
+    // Engine, Lua and audio log records go to the Log tab and stderr, formatted
+    // on the logger's thread. GRUVBOK_LOG sets levels, e.g. engine=debug,lua=warn
+    Logger& logger = Logger::instance();
+    if (const char* spec = std::getenv("GRUVBOK_LOG")) {
+        logger.configure(spec);
+    }
+    logger.addSink(Logger::stderrSink);
+    logger.addSink([&hardware](const LogRecord&, const char* line) {
+        hardware->addLog(line);
+    });
+    logger.startThread();
+
     bool running = true;
     while (running) {
         // Poll events
@@ -337,6 +380,24 @@ int main(int argc, char* argv[]) {
         // Update engine
         engine->update();
 
+        // Everything drawn below reads engine state from this snapshot, not the live engine
+        const EngineSnapshot& snap = engine->readSnapshot();
+
+        // Mirror mode: log MIDI received since the last frame. Only the newest
+        // MIDI_INPUT_HISTORY messages are kept, so a fast CC sweep shows a sample.
+        static uint32_t midi_input_logged = 0;
+        if (hardware->isMirrorModeEnabled()) {
+            uint32_t unseen = std::min<uint32_t>(snap.midi_input_count - midi_input_logged,
+                                                 EngineSnapshot::MIDI_INPUT_HISTORY);
+            for (uint32_t i = snap.midi_input_count - unseen; i != snap.midi_input_count; ++i) {
+                const MidiInputEvent& event = snap.midi_input[i % EngineSnapshot::MIDI_INPUT_HISTORY];
+                if (event.data[0] != 0xF8 && event.data[0] != 0xFE) {  // Clock, active sensing: don't spam log
+                    hardware->addLog(FormatMidiInput(event));
+                }
+            }
+        }
+        midi_input_logged = snap.midi_input_count;
+
         // Start ImGui frame
         ImGui_ImplSDLRenderer2_NewFrame();
         ImGui_ImplSDL2_NewFrame();
@@ -373,6 +434,7 @@ int main(int argc, char* argv[]) {
                 bool is_selected = (current_port < 0);
                 if (ImGui::Selectable("Virtual Port", is_selected)) {
                     hardware->selectMidiPort(-1);
+                    engine->midiOutputChanged();
                 }
 
                 // Real ports
@@ -381,6 +443,7 @@ int main(int argc, char* argv[]) {
                     std::string port_name = hardware->getMidiPortName(i);
                     if (ImGui::Selectable(port_name.c_str(), is_selected)) {
                         hardware->selectMidiPort(i);
+                        engine->midiOutputChanged();
                     }
                 }
                 ImGui::EndCombo();
@@ -396,24 +459,56 @@ int main(int argc, char* argv[]) {
                 hardware->setMirrorMode(mirror_mode);
             }
 
-            // MIDI Input Port Selector (only show if mirror mode enabled)
-            if (mirror_mode) {
-                ImGui::Text("MIDI Input:");
-                ImGui::SameLine();
+            // External Sync (follow MIDI clock and transport from the input port)
+            ImGui::SameLine();
+            bool external_sync = snap.external_sync;
+            if (ImGui::Checkbox("External Sync", &external_sync)) {
+                engine->postCommand(EngineCommand::setSyncMode(external_sync));
+            }
+
+            // MIDI Input Port Selector (for mirror mode, external sync and live input)
+            ImGui::Text("MIDI Input:");
+            ImGui::SameLine();
 
-                int input_port_count = hardware->getMidiInputPortCount();
-                int current_input_port = hardware->getCurrentMidiInputPort();
+            int input_port_count = hardware->getMidiInputPortCount();
+            int current_input_port = hardware->getCurrentMidiInputPort();
 
-                std::string input_preview = current_input_port < 0 ? "Select Input..." : hardware->getMidiInputPortName(current_input_port);
-                if (ImGui::BeginCombo("##MIDIInputPort", input_preview.c_str())) {
-                    for (int i = 0; i < input_port_count; i++) {
-                        bool is_selected = (current_input_port == i);
-                        std::string port_name = hardware->getMidiInputPortName(i);
-                        if (ImGui::Selectable(port_name.c_str(), is_selected)) {
-                            hardware->selectMidiInputPort(i);
-                        }
+            std::string input_preview = current_input_port < 0 ? "Select Input..." : hardware->getMidiInputPortName(current_input_port);
+            if (ImGui::BeginCombo("##MIDIInputPort", input_preview.c_str())) {
+                for (int i = 0; i < input_port_count; i++) {
+                    bool is_selected = (current_input_port == i);
+                    std::string port_name = hardware->getMidiInputPortName(i);
+                    if (ImGui::Selectable(port_name.c_str(), is_selected)) {
+                        hardware->selectMidiInputPort(i);
                     }
-                    ImGui::EndCombo();
+                }
+                ImGui::EndCombo();
+            }
+
+            ImGui::SameLine();
+            ImGui::Text("Received: %u", snap.midi_input_count);
+            if (hardware->getDroppedMidiInput() > 0) {
+                ImGui::SameLine();
+                ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.2f, 1.0f), "Dropped: %u", hardware->getDroppedMidiInput());
+            }
+
+            // Live input played through the mode's process_input()
+            if (snap.live_latency_count > 0) {
+                ImGui::SameLine();
+                ImVec4 color = snap.live_latency_avg_us < 1000 ? ImVec4(0.4f, 1.0f, 0.4f, 1.0f) : ImVec4(1.0f, 0.6f, 0.2f, 1.0f);
+                ImGui::TextColored(color, "Live latency: %.2f ms (avg %.2f, max %.2f)",
+                                   snap.live_latency_us / 1000.0f, snap.live_latency_avg_us / 1000.0f,
+                                   snap.live_latency_max_us / 1000.0f);
+            }
+
+            if (external_sync) {
+                if (snap.sync_tempo <= 0.0f) {
+                    ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.2f, 1.0f), "Sync: waiting for MIDI clock");
+                } else {
+                    ImVec4 color = snap.sync_locked ? ImVec4(0.4f, 1.0f, 0.4f, 1.0f) : ImVec4(1.0f, 0.6f, 0.2f, 1.0f);
+                    ImGui::TextColored(color, "Sync: %s %u%%  %.1f BPM  jitter %.2f ms",
+                                       snap.sync_locked ? "locked" : "unlocked", static_cast<unsigned>(snap.sync_quality),
+                                       snap.sync_tempo, snap.sync_jitter_ms);
                 }
             }
 
@@ -494,6 +589,18 @@ int main(int argc, char* argv[]) {
                 engine->setUseExternalMIDI(external_midi_enabled);
             }
 
+            // Rate cap for CC/pitch bend/aftertouch on the MIDI port (per controller, 0 = none)
+            ImGui::PushItemWidth(150);
+            int cc_rate = static_cast<int>(snap.controller_rate_limit);
+            if (ImGui::SliderInt("CC Rate Cap (Hz)", &cc_rate, 0, 1000)) {
+                engine->postCommand(EngineCommand::setControllerRateLimit(MidiScheduler::Port::EXTERNAL,
+                                                                          static_cast<uint32_t>(cc_rate)));
+            }
+            ImGui::PopItemWidth();
+            ImGui::SameLine();
+            ImGui::TextColored(ImVec4(0.7f, 0.7f, 0.7f, 1.0f), "Thinned: %u coalesced, %u repeats, %u deferred",
+                               snap.controllers_coalesced, snap.controllers_repeats, snap.controllers_deferred);
+
             // Save/Load Section
             ImGui::Separator();
             ImGui::Text("Song Persistence");
@@ -514,7 +621,7 @@ int main(int argc, char* argv[]) {
             ImGui::PopItemWidth();
             ImGui::SameLine();
             if (ImGui::Button("Save")) {
-                int current_tempo = engine->getTempo();
+                int current_tempo = snap.tempo;
                 if (song->save(save_path_buf, song_name_buf, current_tempo)) {
                     hardware->addLog("✓ Song saved: " + std::string(save_path_buf));
                     engine->triggerLEDPattern(Engine::LEDPattern::SAVING);
@@ -527,7 +634,7 @@ int main(int argc, char* argv[]) {
             if (ImGui::Button("Quick Save")) {
                 // Use last path with timestamp
                 std::string quick_path = "/tmp/gruvbok_autosave_" + std::to_string(hardware->getMillis()) + ".json";
-                int current_tempo = engine->getTempo();
+                int current_tempo = snap.tempo;
                 if (song->save(quick_path, song_name_buf, current_tempo)) {
                     hardware->addLog("✓ Autosaved: " + quick_path);
                     engine->triggerLEDPattern(Engine::LEDPattern::SAVING);
@@ -544,30 +651,76 @@ int main(int argc, char* argv[]) {
             ImGui::InputText("Load Path", load_path_buf, sizeof(load_path_buf));
             ImGui::PopItemWidth();
             ImGui::SameLine();
+            // Song loads stay direct calls: this is the thread that runs
+            // engine->update(), and a path doesn't fit in an EngineCommand
             if (ImGui::Button("Load")) {
+                // Loads in the background; swapped in at the next bar (see below)
                 engine->triggerLEDPattern(Engine::LEDPattern::LOADING);
-                std::string loaded_name;
-                int loaded_tempo = 120;
-                if (song->load(load_path_buf, &loaded_name, &loaded_tempo)) {
-                    hardware->addLog("✓ Song loaded: " + std::string(load_path_buf));
-                    hardware->addLog("  Name: " + loaded_name + ", Tempo: " + std::to_string(loaded_tempo) + " BPM");
+                engine->clearSongQueue();
+                engine->queueSong(load_path_buf);
+                hardware->addLog("Loading: " + std::string(load_path_buf));
+            }
+
+            // Playlist: queue the song to follow the current one after N bars
+            static int queue_bars = 16;
+            ImGui::PushItemWidth(100);
+            ImGui::InputInt("Bars", &queue_bars);
+            ImGui::PopItemWidth();
+            queue_bars = std::max(0, queue_bars);
+            ImGui::SameLine();
+            if (ImGui::Button("Queue Next")) {
+                engine->queueSong(load_path_buf, queue_bars);
+                hardware->addLog("Queued: " + std::string(load_path_buf) + " (after " +
+                                 std::to_string(queue_bars) + " bars)");
+            }
+            if (snap.queued_songs > 0) {
+                ImGui::SameLine();
+                ImGui::Text("%d queued", snap.queued_songs);
+                ImGui::SameLine();
+                if (ImGui::Button("Clear Queue")) {
+                    engine->clearSongQueue();
+                }
+            }
+
+            // Report song changes made by the engine
+            static int seen_song_changes = 0;
+            static int seen_load_failures = 0;
+            if (snap.song_changes != seen_song_changes) {
+                seen_song_changes = snap.song_changes;
+                hardware->addLog("✓ Song loaded: " + std::string(snap.song_path));
+                hardware->addLog("  Name: " + std::string(snap.song_name) + ", Tempo: " +
+                                 std::to_string(snap.tempo) + " BPM");
 
-                    // Update UI with loaded metadata
-                    snprintf(song_name_buf, sizeof(song_name_buf), "%s", loaded_name.c_str());
+                // Update UI with loaded metadata
+                snprintf(song_name_buf, sizeof(song_name_buf), "%s", snap.song_name);
 
-                    // Apply loaded tempo to engine
-                    engine->setTempo(loaded_tempo);
+                // Update save path to match load path (for easy resave)
+                snprintf(save_path_buf, sizeof(save_path_buf), "%s", snap.song_path);
 
-                    // Update save path to match load path (for easy resave)
-                    snprintf(save_path_buf, sizeof(save_path_buf), "%s", load_path_buf);
+                // Return to tempo beat pattern after successful load
+                engine->triggerLEDPattern(Engine::LEDPattern::TEMPO_BEAT);
+            }
+            if (snap.song_load_failures != seen_load_failures) {
+                seen_load_failures = snap.song_load_failures;
+                hardware->addLog("✗ ERROR: Failed to load a queued song");
+            }
 
-                    // Return to tempo beat pattern after successful load
-                    engine->triggerLEDPattern(Engine::LEDPattern::TEMPO_BEAT);
+            // Crash recovery: last autosave plus the edit journal, reported once the engine has run it
+            static CommandReply restore_reply;
+            static bool restore_pending = false;
+            if (restore_pending && restore_reply.isDone()) {
+                restore_pending = false;
+                if (restore_reply.getValue()) {
+                    hardware->addLog("✓ Restored last autosave and edit journal");
                 } else {
-                    hardware->addLog("✗ ERROR: Failed to load from " + std::string(load_path_buf));
+                    hardware->addLog("✗ ERROR: No autosave to restore");
                     engine->triggerLEDPattern(Engine::LEDPattern::ERROR);
                 }
             }
+            if (ImGui::Button("Recover Autosave") && !restore_pending) {
+                restore_reply.reset();
+                restore_pending = engine->postCommand(EngineCommand::restoreAutosave(), &restore_reply);
+            }
 
             ImGui::Separator();
 
@@ -599,7 +752,7 @@ int main(int argc, char* argv[]) {
             // Calculate converted values for display
             int mode_val = std::min((r1 * 15) / 128, 14);
             int tempo_val = 60 + (r2 * 180) / 127;
-            int pattern_val = std::min((r3 * 32) / 128, 31);
+            int pattern_val = std::min((r3 * Mode::NUM_PATTERNS) / 128, Mode::NUM_PATTERNS - 1);
             int track_val = std::min((r4 * 8) / 128, 7);
 
             char mode_str[16], tempo_str[16], pattern_str[16], track_str[16];
@@ -624,7 +777,7 @@ int main(int argc, char* argv[]) {
             ImGui::SameLine(0, 20);
             ImGui::BeginGroup();
 
-            int current_mode = engine->getCurrentMode();
+            int current_mode = snap.mode;
             LuaContext* lua_mode = mode_loader->getMode(current_mode);
             std::string mode_name = lua_mode && lua_mode->isValid() ? lua_mode->getModeName() : "Unknown";
             ImGui::Text("Mode %d: %s", current_mode, mode_name.c_str());
@@ -642,7 +795,7 @@ int main(int argc, char* argv[]) {
             char s1_label[64], s2_label[64], s3_label[64], s4_label[64];
             // For Mode 0, S1 represents pattern number (1-32), not raw MIDI value
             if (current_mode == 0) {
-                int pattern_num = ((s1 * 32) / 128) + 1;  // Convert 0-127 to 1-32
+                int pattern_num = ((s1 * Mode::NUM_PATTERNS) / 128) + 1;  // Convert 0-127 to 1-NUM_PATTERNS
                 snprintf(s1_label, sizeof(s1_label), "%s\n%d", slider_labels[0].c_str(), pattern_num);
             } else {
                 snprintf(s1_label, sizeof(s1_label), "%s\n%d", slider_labels[0].c_str(), s1);
@@ -675,46 +828,35 @@ int main(int argc, char* argv[]) {
             // Pattern grid visualization
             // Mode 0 always uses Track 0 - all 16 buttons program pattern sequence
             // Other modes use current track
-            int display_track_number;
-            int edit_track_index;
-            Mode* editing_mode_ptr;
-            Pattern* current_pattern_ptr;
-
-            if (engine->getCurrentMode() == 0) {
-                // Mode 0: Always uses Track 0 for pattern sequence
-                display_track_number = 1;  // Track 0 displayed as "Track 1"
-                edit_track_index = 0;  // Always Track 0 in Mode 0
-                editing_mode_ptr = &song->getMode(0);
-                current_pattern_ptr = &editing_mode_ptr->getPattern(0);
+            // (the snapshot's edit track: Mode 0 pattern 0 track 0 in Mode 0)
+            int edit_track_index = snap.edit_track;
+            int edit_mode_index = snap.edit_mode;
+            int edit_pattern_index = snap.edit_pattern;
+            int display_track_number = edit_track_index + 1;
+
+            if (snap.mode == 0) {
                 ImGui::Text("Mode 0: Pattern Sequence (Track %d)", display_track_number);
             } else {
-                // Other modes: Normal track display
-                display_track_number = engine->getCurrentTrack() + 1;
-                edit_track_index = engine->getCurrentTrack();
-                editing_mode_ptr = &song->getMode(engine->getCurrentMode());
-                current_pattern_ptr = &editing_mode_ptr->getPattern(engine->getCurrentPattern());
                 ImGui::Text("Pattern Grid (Track %d)", display_track_number);
             }
 
             ImGui::BeginGroup();
 
-            Pattern& current_pattern = *current_pattern_ptr;
-            Track& current_track = current_pattern.getTrack(edit_track_index);
-
             float step_width = 50.0f;
 
             // Track which button is being held for live editing
             static int held_button = -1;
 
             for (int step = 0; step < 16; step++) {
-                Event& evt = current_track.getEvent(step);
+                // Edit a copy and post it to the engine, which applies it on its next update()
+                Event evt = snap.edit_events[step];
                 bool has_event = evt.getSwitch();
 
                 // Color: yellow if held, red if playing, green if active, gray if empty
                 ImVec4 color;
 
                 // Mode 0 runs at 1/16th speed, so show song_mode_step_ instead of current_step_
-                int display_step = (engine->getCurrentMode() == 0) ? engine->getSongModeStep() : engine->getCurrentStep();
+                int display_step = (snap.mode == 0) ? snap.song_mode_step : snap.step;
 
                 if (held_button == step) {
                     color = ImVec4(1.0f, 1.0f, 0.0f, 1.0f); // Yellow for held button
@@ -736,6 +878,7 @@ int main(int argc, char* argv[]) {
                 // Button clicked (just pressed)
                 if (ImGui::IsItemActivated()) {
                     held_button = step;
+                    engine->postCommand(EngineCommand::beginEdit());  // Toggle and pot changes while held undo as one step
 
                     // Toggle event on first press
                     bool new_state = !evt.getSwitch();
@@ -766,7 +909,8 @@ int main(int argc, char* argv[]) {
                 }
 
                 // Button released
-                if (!is_held && held_button == step) {
+                bool released = !is_held && held_button == step;
+                if (released) {
                     held_button = -1;
 
                     // Log final values on release
@@ -780,6 +924,14 @@ int main(int argc, char* argv[]) {
                     }
                 }
 
+                if (evt.getRawData() != snap.edit_events[step].getRawData()) {
+                    engine->postCommand(EngineCommand::setEvent(edit_mode_index, edit_pattern_index,
+                                                                edit_track_index, step, evt));
+                }
+                if (released) {
+                    engine->postCommand(EngineCommand::endEdit());
+                }
+
                 ImGui::PopStyleColor();
 
                 if (step < 15) {
@@ -791,6 +943,37 @@ int main(int argc, char* argv[]) {
             }
 
             ImGui::EndGroup();
+
+            // Undo/redo (Ctrl+Z / Ctrl+Shift+Z; B16+B1 / B16+B2 on the hardware)
+            bool shortcuts = !ImGui::GetIO().WantTextInput;
+            bool can_undo = snap.can_undo;
+            bool can_redo = snap.can_redo;
+            ImGui::BeginDisabled(!can_undo);
+            bool undo_pressed = ImGui::Button("Undo");
+            ImGui::EndDisabled();
+            ImGui::SameLine();
+            ImGui::BeginDisabled(!can_redo);
+            bool redo_pressed = ImGui::Button("Redo");
+            ImGui::EndDisabled();
+            if (shortcuts && ImGui::IsKeyChordPressed(ImGuiMod_Ctrl | ImGuiKey_Z)) undo_pressed = true;
+            if (shortcuts && ImGui::IsKeyChordPressed(ImGuiMod_Ctrl | ImGuiMod_Shift | ImGuiKey_Z)) redo_pressed = true;
+            if (undo_pressed && can_undo) {
+                engine->postCommand(EngineCommand::undo());
+                hardware->addLog("Undo");
+            }
+            if (redo_pressed && can_redo) {
+                engine->postCommand(EngineCommand::redo());
+                hardware->addLog("Redo");
+            }
+
+            // Output levels per mode (peak velocity, decaying) and notes still sounding
+            float meters[Song::NUM_MODES];
+            for (int m = 0; m < Song::NUM_MODES; ++m) {
+                meters[m] = snap.mode_meters[m];
+            }
+            ImGui::PlotHistogram("##ModeMeters", meters, Song::NUM_MODES, 0, nullptr, 0.0f, 127.0f, ImVec2(300, 40));
+            ImGui::SameLine();
+            ImGui::Text("Mode levels\nNotes sounding: %d", snap.activeNoteCount());
                     ImGui::EndTabItem();
                 }
 
@@ -801,9 +984,9 @@ int main(int argc, char* argv[]) {
             ImGui::Separator();
 
             // Sync explorer position with engine's current position
-            int explorer_mode = engine->getCurrentMode();
-            int explorer_pattern = engine->getCurrentPattern();
-            int explorer_track = engine->getCurrentTrack();
+            int explorer_mode = snap.mode;
+            int explorer_pattern = snap.pattern;
+            int explorer_track = snap.track;
 
             ImGui::Text("Current Position (updates with knobs):");
             ImGui::TextColored(ImVec4(0.4f, 0.8f, 0.4f, 1.0f), "Mode: %d  Pattern: %d  Track: %d",
@@ -812,9 +995,6 @@ int main(int argc, char* argv[]) {
             ImGui::Separator();
 
             // Show events for selected mode/pattern/track in a table
-            Mode& exp_mode = song->getMode(explorer_mode);
-            Pattern& exp_pattern = exp_mode.getPattern(explorer_pattern);
-            Track& exp_track = exp_pattern.getTrack(explorer_track);
 
             ImGui::Text("Events: Mode %d, Pattern %d, Track %d", explorer_mode, explorer_pattern + 1, explorer_track + 1);  // Display patterns as 1-32, tracks as 1-8
 
@@ -829,17 +1009,14 @@ int main(int argc, char* argv[]) {
                 ImGui::TableHeadersRow();
 
                 for (int step = 0; step < 16; step++) {
-                    const Event& evt = exp_track.getEvent(step);
+                    const Event& evt = snap.track_events[step];
                     ImGui::TableNextRow();
 
                     // Highlight current step if viewing current mode/pattern/track
                     // Mode 0 runs at 1/16th speed, so compare with song_mode_step_ instead of current_step_
-                    int explorer_display_step = (explorer_mode == 0) ? engine->getSongModeStep() : engine->getCurrentStep();
+                    int explorer_display_step = (explorer_mode == 0) ? snap.song_mode_step : snap.step;
 
-                    bool is_current = (explorer_mode == engine->getCurrentMode() &&
-                                      explorer_pattern == engine->getCurrentPattern() &&
-                                      explorer_track == engine->getCurrentTrack() &&
-                                      step == explorer_display_step);
+                    bool is_current = (step == explorer_display_step);  // Explorer follows the current position
                     if (is_current) {
                         ImGui::TableSetBgColor(ImGuiTableBgTarget_RowBg0, ImGui::GetColorU32(ImVec4(0.3f, 0.3f, 0.6f, 0.3f)));
                     }
@@ -853,7 +1030,7 @@ int main(int argc, char* argv[]) {
                     ImGui::TableNextColumn();
                     // For Mode 0, S1 represents pattern number (1-32), not raw MIDI value
                     if (explorer_mode == 0) {
-                        int pattern_num = ((evt.getPot(0) * 32) / 128) + 1;  // Convert 0-127 to 1-32
+                        int pattern_num = ((evt.getPot(0) * Mode::NUM_PATTERNS) / 128) + 1;  // Convert 0-127 to 1-NUM_PATTERNS
                         ImGui::Text("%d", pattern_num);
                     } else {
                         ImGui::Text("%d", evt.getPot(0));
@@ -877,11 +1054,11 @@ int main(int argc, char* argv[]) {
             // Quick stats
             ImGui::Text("Song Overview:");
             ImGui::BulletText("15 Modes (0-14)");
-            ImGui::BulletText("32 Patterns per Mode");
+            ImGui::BulletText("%d Patterns per Mode", Mode::NUM_PATTERNS);
             ImGui::BulletText("8 Tracks per Pattern");
             ImGui::BulletText("16 Events per Track");
 
-            int total_events = 15 * 32 * 8 * 16;
+            int total_events = Song::NUM_MODES * Mode::NUM_PATTERNS * Pattern::NUM_TRACKS * Track::NUM_EVENTS;
             ImGui::Text("Total capacity: %d events", total_events);
 
                     ImGui::EndTabItem();
@@ -899,7 +1076,7 @@ int main(int argc, char* argv[]) {
             // Scrollable log area
             ImGui::BeginChild("LogScroll", ImVec2(0, 0), false, ImGuiWindowFlags_HorizontalScrollbar);
 
-            const auto& log_messages = hardware->getLogMessages();
+            const auto log_messages = hardware->getLogMessages();
             for (const auto& message : log_messages) {
                 ImGui::TextUnformatted(message.c_str());
             }
@@ -1047,7 +1224,7 @@ int main(int argc, char* argv[]) {
                         if (lua_mode->loadScript(current_filename)) {
                             // Reinit with current tempo
                             LuaInitContext context;
-                            context.tempo = engine->getTempo();
+                            context.tempo = snap.tempo;
                             context.mode_number = selected_mode;
                             context.midi_channel = selected_mode;
                             lua_mode->callInit(context);
@@ -1090,12 +1267,19 @@ int main(int argc, char* argv[]) {
         ImGui_ImplSDLRenderer2_RenderDrawData(ImGui::GetDrawData());
         SDL_RenderPresent(renderer);
 
-        // Small delay to avoid spinning
-        SDL_Delay(10);
+        // Small delay to avoid spinning. MIDI input cuts it short and runs the
+        // engine at once, so live input through process_input() isn't held to the frame rate
+        uint32_t frame_end = hardware->getMillis() + 10;
+        for (uint32_t now = hardware->getMillis(); now < frame_end; now = hardware->getMillis()) {
+            if (hardware->waitForMidiInput(frame_end - now)) {
+                engine->update();
+            }
+        }
     }
 
     // Cleanup
     engine->stop();
+    logger.stopThread();  // Its sink writes to hardware's log
     hardware->shutdown();
 
     ImGui_ImplSDLRenderer2_Shutdown();
@@ -1,13 +1,13 @@
 #include "../core/song.h"
 #include "../core/engine.h"
+#include "../core/log.h"
 #include "../lua_bridge/mode_loader.h"
 #include "desktop_hardware.h"
 
 #include <iostream>
-#include <thread>
-#include <chrono>
 #include <csignal>
 #include <atomic>
+#include <cstdlib>
 
 using namespace gruvbok;
 
@@ -49,6 +49,17 @@ int main(int /* argc */, char* /* argv */[]) {
     // Set up signal handler
     std::signal(SIGINT, signalHandler);
 
+    // Log records are formatted and printed on the logger's thread.
+    // GRUVBOK_LOG sets levels, e.g. GRUVBOK_LOG=engine=debug,lua=warn
+    Logger& logger = Logger::instance();
+    if (const char* spec = std::getenv("GRUVBOK_LOG")) {
+        if (!logger.configure(spec)) {
+            std::cerr << "GRUVBOK_LOG: can't parse '" << spec << "'" << std::endl;
+        }
+    }
+    logger.addSink(Logger::stderrSink);
+    logger.startThread();
+
     // Create hardware
     auto hardware = std::make_unique<DesktopHardware>();
     if (!hardware->init()) {
@@ -120,13 +131,19 @@ int main(int /* argc */, char* /* argv */[]) {
             printStatus(*engine);
         }
 
-        // Sleep to avoid spinning
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        // Sleep to avoid spinning; MIDI input wakes the engine early for live input
+        uint32_t frame_end = hardware->getMillis() + 10;
+        for (uint32_t now = hardware->getMillis(); now < frame_end; now = hardware->getMillis()) {
+            if (hardware->waitForMidiInput(frame_end - now)) {
+                engine->update();
+            }
+        }
     }
 
     std::cout << "\nCleaning up..." << std::endl;
     engine->stop();
     hardware->shutdown();
+    logger.stopThread();
 
     std::cout << "Goodbye!" << std::endl;
     return 0;
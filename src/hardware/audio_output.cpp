@@ -1,5 +1,5 @@
 #include "audio_output.h"
-#include <iostream>
+#include "../core/log.h"
 
 #ifdef HAVE_FLUIDSYNTH
 #include <fluidsynth.h>
@@ -43,12 +43,12 @@ AudioOutput::~AudioOutput() {
 
 bool AudioOutput::init(int sample_rate) {
 #ifdef HAVE_FLUIDSYNTH
-    std::cout << "[AudioOutput] Initializing FluidSynth at " << sample_rate << " Hz...\n";
+    logInfo(LogCategory::AUDIO, "Initializing FluidSynth at %d Hz...", sample_rate);
 
     // Create settings
     impl_->settings = new_fluid_settings();
     if (!impl_->settings) {
-        std::cerr << "[AudioOutput] Failed to create FluidSynth settings\n";
+        logError(LogCategory::AUDIO, "Failed to create FluidSynth settings");
         return false;
     }
 
@@ -61,7 +61,7 @@ bool AudioOutput::init(int sample_rate) {
     // Create synthesizer
     impl_->synth = new_fluid_synth(impl_->settings);
     if (!impl_->synth) {
-        std::cerr << "[AudioOutput] Failed to create FluidSynth synthesizer\n";
+        logError(LogCategory::AUDIO, "Failed to create FluidSynth synthesizer");
         delete_fluid_settings(impl_->settings);
         impl_->settings = nullptr;
         return false;
@@ -70,7 +70,7 @@ bool AudioOutput::init(int sample_rate) {
     // Create audio driver (automatically starts audio output)
     impl_->audio_driver = new_fluid_audio_driver(impl_->settings, impl_->synth);
     if (!impl_->audio_driver) {
-        std::cerr << "[AudioOutput] Failed to create FluidSynth audio driver\n";
+        logError(LogCategory::AUDIO, "Failed to create FluidSynth audio driver");
         delete_fluid_synth(impl_->synth);
         delete_fluid_settings(impl_->settings);
         impl_->synth = nullptr;
@@ -79,10 +79,10 @@ bool AudioOutput::init(int sample_rate) {
     }
 
     initialized_ = true;
-    std::cout << "[AudioOutput] FluidSynth initialized successfully\n";
+    logInfo(LogCategory::AUDIO, "FluidSynth initialized");
     return true;
 #else
-    std::cerr << "[AudioOutput] FluidSynth not available (compiled without HAVE_FLUIDSYNTH)\n";
+    logWarn(LogCategory::AUDIO, "FluidSynth not available (compiled without HAVE_FLUIDSYNTH)");
     return false;
 #endif
 }
@@ -90,11 +90,11 @@ bool AudioOutput::init(int sample_rate) {
 bool AudioOutput::loadSoundFont(const std::string& soundfont_path) {
 #ifdef HAVE_FLUIDSYNTH
     if (!impl_->synth) {
-        std::cerr << "[AudioOutput] Cannot load SoundFont: synth not initialized\n";
+        logError(LogCategory::AUDIO, "Cannot load SoundFont: synth not initialized");
         return false;
     }
 
-    std::cout << "[AudioOutput] Loading SoundFont: " << soundfont_path << "\n";
+    logInfo(LogCategory::AUDIO, "Loading SoundFont: %s", soundfont_path);
 
     // Unload previous SoundFont if any
     if (impl_->soundfont_id != -1) {
@@ -104,12 +104,12 @@ bool AudioOutput::loadSoundFont(const std::string& soundfont_path) {
     // Load new SoundFont
     impl_->soundfont_id = fluid_synth_sfload(impl_->synth, soundfont_path.c_str(), 1);
     if (impl_->soundfont_id == FLUID_FAILED) {
-        std::cerr << "[AudioOutput] Failed to load SoundFont: " << soundfont_path << "\n";
+        logError(LogCategory::AUDIO, "Failed to load SoundFont: %s", soundfont_path);
         impl_->soundfont_id = -1;
         return false;
     }
 
-    std::cout << "[AudioOutput] SoundFont loaded successfully (ID: " << impl_->soundfont_id << ")\n";
+    logInfo(LogCategory::AUDIO, "SoundFont loaded (ID: %d)", impl_->soundfont_id);
 
     // Set up default instruments for GRUVBOK modes
     // Mode 1 → Channel 0, Mode 2 → Channel 1, ..., Mode 10 → Channel 9 (GM drums)
@@ -118,18 +118,18 @@ bool AudioOutput::loadSoundFont(const std::string& soundfont_path) {
     // Mode 10 → Channel 9 (GM Percussion on channel 10 in user-facing terms)
     fluid_synth_bank_select(impl_->synth, 9, 128);  // Bank 128 = GM Percussion
     fluid_synth_program_change(impl_->synth, 9, 0);  // Program 0 = Standard Kit
-    std::cout << "[AudioOutput] Mode 10 (Channel 9/MIDI Ch 10): GM Drum Kit\n";
+    logInfo(LogCategory::AUDIO, "Mode 10 (Channel 9/MIDI Ch 10): GM Drum Kit");
 
     // Set sensible defaults for other modes (will be overridden by Program Change)
     fluid_synth_program_change(impl_->synth, 0, 0);   // Mode 1 → Ch 0: Acoustic Grand Piano
     fluid_synth_program_change(impl_->synth, 1, 33);  // Mode 2 → Ch 1: Electric Bass
     fluid_synth_program_change(impl_->synth, 2, 48);  // Mode 3 → Ch 2: String Ensemble
     fluid_synth_program_change(impl_->synth, 3, 81);  // Mode 4 → Ch 3: Sawtooth Lead
-    std::cout << "[AudioOutput] Default instruments set for modes 1-4\n";
+    logInfo(LogCategory::AUDIO, "Default instruments set for modes 1-4");
 
     return true;
 #else
-    std::cerr << "[AudioOutput] FluidSynth not available\n";
+    logWarn(LogCategory::AUDIO, "FluidSynth not available");
     return false;
 #endif
 }
@@ -211,7 +211,7 @@ void AudioOutput::setGain(float gain) {
 #ifdef HAVE_FLUIDSYNTH
     if (impl_ && impl_->synth) {
         fluid_synth_set_gain(impl_->synth, gain);
-        std::cout << "[AudioOutput] Gain set to " << gain << "\n";
+        logInfo(LogCategory::AUDIO, "Gain set to %.2f", gain);
     }
 #endif
 }
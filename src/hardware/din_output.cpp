@@ -0,0 +1,181 @@
+#include "din_output.h"
+
+namespace gruvbok {
+
+namespace {
+
+bool isNoteOn(const MidiMessage& message) {
+    return message.data.size() >= 3 && (message.data[0] & 0xF0) == 0x90 && message.data[2] > 0;
+}
+
+bool isNoteOff(const MidiMessage& message) {
+    if (message.data.size() < 3) {
+        return false;
+    }
+    uint8_t type = message.data[0] & 0xF0;
+    return type == 0x80 || (type == 0x90 && message.data[2] == 0);
+}
+
+} // namespace
+
+DinMidiOutput::DinMidiOutput(MidiUart* uart)
+    : uart_(uart)
+    , deadline_us_(DEFAULT_DEADLINE_US)
+    , queue_{}
+    , head_(0)
+    , count_(0)
+    , written_(0)
+    , message_start_us_(0)
+    , realtime_{}
+    , realtime_head_(0)
+    , realtime_count_(0)
+    , running_status_(0)
+    , wire_free_us_(0)
+    , queued_bytes_(0)
+    , stats_{} {
+}
+
+int DinMidiOutput::priority(const MidiMessage* burst, size_t index) {
+    const MidiMessage& message = burst[index];
+    uint8_t status = message.data.empty() ? 0 : message.data[0];
+    int channel_class = (status < 0xF0 && (status & 0x0F) == DRUM_CHANNEL) ? 1 : 2;
+    if (!isNoteOff(message)) {
+        return channel_class;
+    }
+
+    // A note-off can't overtake the note-on it ends
+    for (size_t i = 0; i < index; ++i) {
+        if (isNoteOn(burst[i]) && (burst[i].data[0] & 0x0F) == (status & 0x0F) &&
+            burst[i].data[1] == message.data[1]) {
+            return channel_class;
+        }
+    }
+    return 0;
+}
+
+void DinMidiOutput::send(const MidiMessage* messages, size_t count, uint32_t now_us) {
+    // After a long idle the receiver may have missed the status: send it again
+    if (count_ == 0 && static_cast<int32_t>(now_us - wire_free_us_) >= static_cast<int32_t>(STATUS_REFRESH_US)) {
+        running_status_ = 0;
+    }
+
+    // One pass per priority class keeps each class in its original order
+    for (int pass = 0; pass < 3; ++pass) {
+        for (size_t i = 0; i < count; ++i) {
+            const MidiMessage& message = messages[i];
+            bool realtime = !message.data.empty() && message.data[0] >= 0xF8;
+            if (pass == 0 && realtime) {
+                if (realtime_count_ == REALTIME_QUEUE_SIZE) {
+                    stats_.dropped++;
+                    continue;
+                }
+                Pending& slot = realtime_[(realtime_head_ + realtime_count_++) % REALTIME_QUEUE_SIZE];
+                slot = Pending{now_us, 1, {message.data[0], 0, 0}, false};
+                queued_bytes_++;
+            } else if (!realtime && priority(messages, i) == pass) {
+                push(message, now_us);
+            }
+        }
+    }
+
+    service(now_us);
+}
+
+void DinMidiOutput::push(const MidiMessage& message, uint32_t now_us) {
+    size_t size = message.data.size();
+    if (size == 0 || size > 3 || message.data[0] < 0x80 || count_ == QUEUE_SIZE) {
+        stats_.dropped++;
+        return;
+    }
+
+    uint8_t status = message.data[0];
+    uint8_t data[2] = {size > 1 ? message.data[1] : uint8_t(0), size > 2 ? message.data[2] : uint8_t(0)};
+    if ((status & 0xF0) == 0x80) {
+        status = 0x90 | (status & 0x0F);  // Velocity-0 note-on: same status as the note-ons around it
+        data[1] = 0;
+    }
+
+    Pending& slot = queue_[(head_ + count_++) % QUEUE_SIZE];
+    slot.due_us = now_us;
+    slot.size = 0;
+    slot.running = status < 0xF0 && status == running_status_;
+    if (!slot.running) {
+        slot.bytes[slot.size++] = status;
+    }
+    for (size_t i = 1; i < size; ++i) {
+        slot.bytes[slot.size++] = data[i - 1];
+    }
+    running_status_ = status < 0xF0 ? status : 0;  // System common cancels running status
+    queued_bytes_ += slot.size;
+}
+
+void DinMidiOutput::service(uint32_t now_us) {
+    while ((realtime_count_ > 0 || count_ > 0) && uart_->availableForWrite() > 0) {
+        // Real-time bytes may go between any two bytes, even inside a message
+        if (realtime_count_ > 0) {
+            const Pending& message = realtime_[realtime_head_];
+            finish(message, writeByte(message.bytes[0], now_us));
+            realtime_head_ = (realtime_head_ + 1) % REALTIME_QUEUE_SIZE;
+            realtime_count_--;
+            continue;
+        }
+
+        const Pending& message = queue_[head_];
+        uint32_t start_us = writeByte(message.bytes[written_], now_us);
+        if (written_++ == 0) {
+            message_start_us_ = start_us;
+        }
+        if (written_ == message.size) {
+            finish(message, message_start_us_);
+            head_ = (head_ + 1) % QUEUE_SIZE;
+            count_--;
+            written_ = 0;
+        }
+    }
+}
+
+uint32_t DinMidiOutput::writeByte(uint8_t byte, uint32_t now_us) {
+    uart_->write(byte);
+    uint32_t start_us = static_cast<int32_t>(wire_free_us_ - now_us) > 0 ? wire_free_us_ : now_us;
+    wire_free_us_ = start_us + BYTE_US;
+    queued_bytes_--;
+    stats_.bytes++;
+    return start_us;
+}
+
+void DinMidiOutput::finish(const Pending& message, uint32_t start_us) {
+    stats_.messages++;
+    if (message.running) {
+        stats_.bytes_saved++;
+    }
+    int32_t late_us = static_cast<int32_t>(start_us - message.due_us);
+    if (late_us > 0) {
+        if (static_cast<uint32_t>(late_us) > stats_.max_late_us) {
+            stats_.max_late_us = static_cast<uint32_t>(late_us);
+        }
+        if (static_cast<uint32_t>(late_us) > deadline_us_) {
+            stats_.deadline_misses++;
+        }
+    }
+}
+
+void DinMidiOutput::reset() {
+    head_ = 0;
+    count_ = 0;
+    written_ = 0;
+    realtime_head_ = 0;
+    realtime_count_ = 0;
+    running_status_ = 0;
+    queued_bytes_ = 0;
+}
+
+bool DinMidiOutput::isIdle() const {
+    return count_ == 0 && realtime_count_ == 0;
+}
+
+uint32_t DinMidiOutput::getBacklogUs(uint32_t now_us) const {
+    int32_t on_wire = static_cast<int32_t>(wire_free_us_ - now_us);
+    return (on_wire > 0 ? static_cast<uint32_t>(on_wire) : 0) + wireTimeUs(queued_bytes_);
+}
+
+} // namespace gruvbok
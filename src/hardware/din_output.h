@@ -0,0 +1,120 @@
+#pragma once
+
+#include "hardware_interface.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace gruvbok {
+
+/**
+ * Transmit side of a 31,250 baud MIDI UART (Teensy serial port, or a
+ * virtual one in tests)
+ */
+class MidiUart {
+public:
+    virtual ~MidiUart() = default;
+
+    virtual size_t availableForWrite() = 0;  // Bytes the transmit buffer takes without blocking
+    virtual void write(uint8_t byte) = 0;
+};
+
+/**
+ * DIN MIDI output stage
+ *
+ * At 31,250 baud every byte takes 320 us on the wire, so a downbeat from
+ * 14 modes is ~13 ms of bytes. This stage keeps that burst in its own queue
+ * and feeds the UART only as much as its transmit buffer takes, so it never
+ * blocks the main loop:
+ *
+ * - Each burst (one scheduler tick) is reordered: note-offs first, then the
+ *   drum channel, then everything else, otherwise keeping their order. A
+ *   note-off for a note switched on earlier in the same burst stays behind
+ *   it. Bursts go out in the order they arrive.
+ * - Real-time messages (clock, start, stop) jump the queue.
+ * - Channel messages use running status: a status byte equal to the last
+ *   one sent is left out, and note-offs are sent as velocity-0 note-ons so
+ *   they share the note-on status. The status is repeated after the wire
+ *   has been idle a while, so a device plugged in mid-stream locks on.
+ *
+ * Every byte is accounted for on a model of the wire (when it starts and
+ * finishes), which gives the backlog and each message's lateness: how long
+ * after it was due its first byte went out. Messages later than the
+ * deadline are counted as misses.
+ *
+ * SysEx isn't supported (nothing sends it): longer messages are dropped.
+ */
+class DinMidiOutput {
+public:
+    static constexpr uint32_t BYTE_US = 320;              // 10 bits (8N1) at 31,250 baud
+    static constexpr uint32_t DEFAULT_DEADLINE_US = 2000;
+    static constexpr uint32_t STATUS_REFRESH_US = 500000;  // Idle this long: repeat the status byte
+    static constexpr uint8_t DRUM_CHANNEL = 9;             // Channel 10
+    static constexpr size_t QUEUE_SIZE = 256;              // Channel messages waiting for the wire
+    static constexpr size_t REALTIME_QUEUE_SIZE = 16;
+
+    struct Stats {
+        uint32_t messages;         // Finished writing to the UART
+        uint32_t bytes;
+        uint32_t bytes_saved;      // Status bytes left out by running status
+        uint32_t deadline_misses;
+        uint32_t max_late_us;      // Worst lateness seen
+        uint32_t dropped;          // Queue full, or too long to send
+    };
+
+    explicit DinMidiOutput(MidiUart* uart);
+
+    // Lateness above this counts as a deadline miss
+    void setDeadline(uint32_t deadline_us) { deadline_us_ = deadline_us; }
+    uint32_t getDeadline() const { return deadline_us_; }
+
+    // Messages due together at now_us (a scheduler tick): queued in priority
+    // order, then written as far as the UART takes them
+    void send(const MidiMessage* messages, size_t count, uint32_t now_us);
+
+    // Feed the UART from the queues; call from the main loop
+    void service(uint32_t now_us);
+
+    // Forget queued messages and the running status (e.g. after reopening the port)
+    void reset();
+
+    bool isIdle() const;
+    uint32_t getBacklogUs(uint32_t now_us) const;  // Until everything queued has left the wire
+
+    const Stats& getStats() const { return stats_; }
+    void resetStats() { stats_ = Stats{}; }
+
+    static uint32_t wireTimeUs(size_t bytes) { return static_cast<uint32_t>(bytes) * BYTE_US; }
+
+private:
+    struct Pending {
+        uint32_t due_us;
+        uint8_t size;      // Bytes to write (status left out under running status)
+        uint8_t bytes[3];
+        bool running;      // Status byte left out
+    };
+
+    static int priority(const MidiMessage* burst, size_t index);
+    void push(const MidiMessage& message, uint32_t now_us);
+    uint32_t writeByte(uint8_t byte, uint32_t now_us);  // Returns the byte's wire start
+    void finish(const Pending& message, uint32_t start_us);
+
+    MidiUart* uart_;
+    uint32_t deadline_us_;
+
+    Pending queue_[QUEUE_SIZE];
+    size_t head_;
+    size_t count_;
+    size_t written_;           // Bytes of queue_[head_] already written
+    uint32_t message_start_us_;  // Wire start of queue_[head_]'s first byte
+    Pending realtime_[REALTIME_QUEUE_SIZE];
+    size_t realtime_head_;
+    size_t realtime_count_;
+
+    uint8_t running_status_;   // As queued: 0 = none
+    uint32_t wire_free_us_;    // When the last byte written finishes
+    uint32_t queued_bytes_;
+
+    Stats stats_;
+};
+
+} // namespace gruvbok
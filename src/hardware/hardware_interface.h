@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 
@@ -17,6 +18,16 @@ struct MidiMessage {
         : data(msg_data), timestamp_ms(time) {}
 };
 
+/**
+ * Incoming MIDI message: fixed size so it can be queued from a driver
+ * callback without allocating. SysEx doesn't fit and is dropped.
+ */
+struct MidiInputEvent {
+    uint32_t timestamp_us;  // Arrival time in microseconds (same origin as getMillis())
+    uint8_t size;           // Bytes used in data (1-3)
+    uint8_t data[3];
+};
+
 /**
  * Hardware abstraction interface
  * Implemented differently for desktop and Teensy
@@ -40,12 +51,27 @@ public:
     // MIDI output
     virtual void sendMidiMessage(const MidiMessage& msg) = 0;
 
+    // Messages due together (a scheduler tick), in order. Implementations may
+    // hold them back to send as one burst on flush(); sendMidiMessage() sends
+    // anything held first. The default sends them one at a time.
+    virtual void sendMidiBatch(const MidiMessage* messages, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            sendMidiMessage(messages[i]);
+        }
+    }
+    virtual void flush() {}
+
+    // MIDI input: next received message, oldest first; false when none are waiting.
+    // Called by the engine thread only.
+    virtual bool readMidiInput(MidiInputEvent& event) { (void)event; return false; }
+
     // LED control
     virtual void setLED(bool on) = 0;
     virtual bool getLED() const = 0;  // Get current LED state
 
     // Timing
     virtual uint32_t getMillis() = 0;  // Milliseconds since start
+    virtual uint32_t getMicros() { return getMillis() * 1000; }  // Microseconds since start (wraps after ~71 min)
 
     // Update (called in main loop)
     virtual void update() = 0;
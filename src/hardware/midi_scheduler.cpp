@@ -1,4 +1,5 @@
 #include "midi_scheduler.h"
+#include <algorithm>
 
 namespace gruvbok {
 
@@ -6,7 +7,17 @@ MidiScheduler::MidiScheduler(HardwareInterface* hardware)
     : hardware_(hardware)
     , audio_output_(nullptr)
     , use_internal_audio_(false)
-    , use_external_midi_(true) {  // Default to external MIDI
+    , use_external_midi_(true)  // Default to external MIDI
+    , active_notes_{}
+    , next_sequence_(0)
+    , controller_stats_{} {
+    for (auto& port : ports_) {
+        port.sent.assign(CONTROLLER_SLOTS, NO_VALUE);
+        port.sent_ms.assign(CONTROLLER_SLOTS, 0);
+        port.held.assign(CONTROLLER_SLOTS, NO_VALUE);
+    }
+    setControllerRateLimit(Port::EXTERNAL, DEFAULT_EXTERNAL_RATE);
+    setControllerRateLimit(Port::INTERNAL, 0);  // In-process: nothing to clog
 }
 
 void MidiScheduler::schedule(const std::vector<ScheduledMidiEvent>& events) {
@@ -29,6 +40,7 @@ void MidiScheduler::schedule(const ScheduledMidiEvent& event) {
     AbsoluteMidiEvent abs_event;
     abs_event.message = MidiMessage(data, absolute_time);
     abs_event.absolute_time_ms = absolute_time;
+    abs_event.sequence = next_sequence_++;
 
     event_queue_.push(abs_event);
 }
@@ -36,31 +48,231 @@ void MidiScheduler::schedule(const ScheduledMidiEvent& event) {
 void MidiScheduler::update() {
     uint32_t current_time = hardware_->getMillis();
 
+    due_.clear();
     while (!event_queue_.empty()) {
         const auto& next_event = event_queue_.top();
 
         if (next_event.absolute_time_ms <= current_time) {
-            // Send to external MIDI
-            if (use_external_midi_) {
-                hardware_->sendMidiMessage(next_event.message);
-            }
-
-            // Send to internal audio (FluidSynth)
-            if (use_internal_audio_ && audio_output_ && audio_output_->isReady()) {
-                audio_output_->sendMidiMessage(next_event.message.data.data(), next_event.message.data.size());
-            }
-
+            due_.push_back(next_event.message);
             event_queue_.pop();
         } else {
             break;  // No more events ready
         }
     }
+
+    // Coalesce: walking back from the newest, the first value seen for a controller wins
+    seen_slots_.clear();
+    for (size_t i = due_.size(); i-- > 0;) {
+        int slot = controllerSlot(due_[i].data);
+        if (slot < 0) {
+            continue;
+        }
+        if (std::find(seen_slots_.begin(), seen_slots_.end(), slot) != seen_slots_.end()) {
+            due_[i].data.clear();
+            controller_stats_.coalesced++;
+        } else {
+            seen_slots_.push_back(slot);
+        }
+    }
+
+    burst_.clear();
+    for (const MidiMessage& message : due_) {
+        if (message.data.empty()) {
+            continue;  // Coalesced away
+        }
+        trackNotes(message.data);
+
+        int slot = controllerSlot(message.data);
+        for (Port port : {Port::EXTERNAL, Port::INTERNAL}) {
+            if (!isPortEnabled(port)) {
+                continue;
+            }
+            if (slot < 0 || offerController(ports_[static_cast<int>(port)], slot, controllerValue(message.data), current_time)) {
+                dispatch(port, message);
+            }
+        }
+
+        if (message.data.size() >= 2 && (message.data[0] & 0xF0) == 0xB0 && message.data[1] == 121) {
+            forgetChannel(message.data[0] & 0x0F);  // Reset All Controllers
+        }
+    }
+
+    sendHeldControllers(Port::EXTERNAL, current_time);
+    sendHeldControllers(Port::INTERNAL, current_time);
+
+    if (!burst_.empty()) {
+        hardware_->sendMidiBatch(burst_.data(), burst_.size());
+        hardware_->flush();
+    }
+}
+
+void MidiScheduler::trackNotes(const std::vector<uint8_t>& data) {
+    if (data.size() < 3) {
+        return;
+    }
+    uint8_t type = data[0] & 0xF0;
+    auto& channel = active_notes_[data[0] & 0x0F];
+    uint8_t note = data[1] & 0x7F;
+    uint32_t bit = 1u << (note % 32);
+
+    if (type == 0x90 && data[2] > 0) {
+        channel[note / 32] |= bit;
+    } else if (type == 0x80 || type == 0x90) {
+        channel[note / 32] &= ~bit;  // Note off, or note on with velocity 0
+    } else if (type == 0xB0 && (data[1] == 120 || data[1] == 123)) {
+        channel.fill(0);  // All sound off / all notes off
+    }
 }
 
 void MidiScheduler::clear() {
     while (!event_queue_.empty()) {
         event_queue_.pop();
     }
+    for (auto& port : ports_) {
+        for (uint16_t slot : port.held_slots) {
+            port.held[slot] = NO_VALUE;
+        }
+        port.held_slots.clear();
+    }
+}
+
+// ============================================================================
+// Controller thinning
+// ============================================================================
+
+void MidiScheduler::setControllerRateLimit(Port port, uint32_t max_per_second) {
+    PortControllers& controllers = ports_[static_cast<int>(port)];
+    controllers.max_per_second = max_per_second;
+    // Round the interval up so the cap is never exceeded
+    controllers.min_interval_ms = max_per_second == 0 ? 0 : static_cast<uint16_t>((1000 + max_per_second - 1) / max_per_second);
+}
+
+void MidiScheduler::forgetSentControllers(Port port) {
+    PortControllers& controllers = ports_[static_cast<int>(port)];
+    std::fill(controllers.sent.begin(), controllers.sent.end(), NO_VALUE);
+    std::fill(controllers.held.begin(), controllers.held.end(), NO_VALUE);
+    controllers.held_slots.clear();
+}
+
+void MidiScheduler::forgetChannel(int channel) {
+    for (auto& port : ports_) {
+        for (int slot = channel * SLOTS_PER_CHANNEL; slot < (channel + 1) * SLOTS_PER_CHANNEL; ++slot) {
+            port.sent[slot] = NO_VALUE;
+            port.held[slot] = NO_VALUE;  // Sent before the reset, it would be wiped anyway
+        }
+    }
+}
+
+int MidiScheduler::controllerSlot(const std::vector<uint8_t>& data) {
+    if (data.size() < 2) {
+        return -1;
+    }
+    int base = (data[0] & 0x0F) * SLOTS_PER_CHANNEL;
+    switch (data[0] & 0xF0) {
+        case 0xB0: {  // Control Change
+            uint8_t controller = data[1] & 0x7F;
+            bool ordered = controller == 0 || controller == 32 ||       // Bank select (before program change)
+                           controller == 6 || controller == 38 ||       // Data entry
+                           (controller >= 96 && controller <= 101) ||   // (N)RPN select and increment
+                           controller >= 120;                           // Channel mode
+            return data.size() >= 3 && !ordered ? base + controller : -1;
+        }
+        case 0xA0:  // Poly aftertouch
+            return data.size() >= 3 ? base + 128 + (data[1] & 0x7F) : -1;
+        case 0xE0:  // Pitch bend
+            return data.size() >= 3 ? base + 256 : -1;
+        case 0xD0:  // Channel aftertouch
+            return base + 257;
+        default:
+            return -1;
+    }
+}
+
+uint16_t MidiScheduler::controllerValue(const std::vector<uint8_t>& data) {
+    switch (data[0] & 0xF0) {
+        case 0xE0:
+            return static_cast<uint16_t>((data[1] & 0x7F) | ((data[2] & 0x7F) << 7));
+        case 0xD0:
+            return data[1] & 0x7F;
+        default:
+            return data[2] & 0x7F;
+    }
+}
+
+std::vector<uint8_t> MidiScheduler::controllerMessage(int slot, uint16_t value) {
+    uint8_t channel = static_cast<uint8_t>(slot / SLOTS_PER_CHANNEL);
+    int index = slot % SLOTS_PER_CHANNEL;
+    if (index < 128) {
+        return {static_cast<uint8_t>(0xB0 | channel), static_cast<uint8_t>(index), static_cast<uint8_t>(value)};
+    } else if (index < 256) {
+        return {static_cast<uint8_t>(0xA0 | channel), static_cast<uint8_t>(index - 128), static_cast<uint8_t>(value)};
+    } else if (index == 256) {
+        return {static_cast<uint8_t>(0xE0 | channel), static_cast<uint8_t>(value & 0x7F), static_cast<uint8_t>(value >> 7)};
+    }
+    return {static_cast<uint8_t>(0xD0 | channel), static_cast<uint8_t>(value)};
+}
+
+bool MidiScheduler::isPortEnabled(Port port) const {
+    if (port == Port::EXTERNAL) {
+        return use_external_midi_;
+    }
+    return use_internal_audio_ && audio_output_ && audio_output_->isReady();
+}
+
+void MidiScheduler::dispatch(Port port, const MidiMessage& message) {
+    if (port == Port::EXTERNAL) {
+        burst_.push_back(message);  // Collected, so a downbeat leaves in one write
+    } else {
+        audio_output_->sendMidiMessage(message.data.data(), message.data.size());
+    }
+}
+
+bool MidiScheduler::offerController(PortControllers& port, int slot, uint16_t value, uint32_t now_ms) {
+    if (port.sent[slot] == value) {
+        port.held[slot] = NO_VALUE;  // Back where it was: a held change is moot
+        controller_stats_.repeats++;
+        return false;
+    }
+
+    uint16_t since_ms = static_cast<uint16_t>(static_cast<uint16_t>(now_ms) - port.sent_ms[slot]);
+    if (port.min_interval_ms == 0 || port.sent[slot] == NO_VALUE || since_ms >= port.min_interval_ms) {
+        port.sent[slot] = value;
+        port.sent_ms[slot] = static_cast<uint16_t>(now_ms);
+        port.held[slot] = NO_VALUE;
+        return true;
+    }
+
+    if (port.held[slot] == NO_VALUE) {
+        port.held_slots.push_back(static_cast<uint16_t>(slot));
+    }
+    port.held[slot] = value;
+    controller_stats_.deferred++;
+    return false;
+}
+
+void MidiScheduler::sendHeldControllers(Port port, uint32_t now_ms) {
+    PortControllers& controllers = ports_[static_cast<int>(port)];
+    if (controllers.held_slots.empty() || !isPortEnabled(port)) {
+        return;
+    }
+
+    size_t kept = 0;
+    for (uint16_t slot : controllers.held_slots) {
+        uint16_t value = controllers.held[slot];
+        if (value == NO_VALUE) {
+            continue;  // Cancelled, or already sent
+        }
+        uint16_t since_ms = static_cast<uint16_t>(static_cast<uint16_t>(now_ms) - controllers.sent_ms[slot]);
+        if (since_ms < controllers.min_interval_ms) {
+            controllers.held_slots[kept++] = slot;
+            continue;
+        }
+        controllers.held[slot] = NO_VALUE;
+        controllers.sent[slot] = value;
+        controllers.sent_ms[slot] = static_cast<uint16_t>(now_ms);
+        dispatch(port, MidiMessage(controllerMessage(slot, value), now_ms));
+    }
+    controllers.held_slots.resize(kept);
 }
 
 // ============================================================================
@@ -139,10 +351,16 @@ void MidiScheduler::setAudioOutput(AudioOutput* audio_output) {
 }
 
 void MidiScheduler::setUseInternalAudio(bool use_internal) {
+    if (use_internal && !use_internal_audio_) {
+        forgetSentControllers(Port::INTERNAL);  // It missed whatever changed while off
+    }
     use_internal_audio_ = use_internal;
 }
 
 void MidiScheduler::setUseExternalMIDI(bool use_external) {
+    if (use_external && !use_external_midi_) {
+        forgetSentControllers(Port::EXTERNAL);
+    }
     use_external_midi_ = use_external;
 }
 
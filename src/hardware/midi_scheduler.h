@@ -2,6 +2,7 @@
 
 #include "hardware_interface.h"
 #include "audio_output.h"
+#include <array>
 #include <queue>
 #include <vector>
 #include <functional>
@@ -26,9 +27,13 @@ struct ScheduledMidiEvent {
 struct AbsoluteMidiEvent {
     MidiMessage message;
     uint32_t absolute_time_ms;
+    uint64_t sequence;  // Events due at the same time leave in the order scheduled
 
     bool operator>(const AbsoluteMidiEvent& other) const {
-        return absolute_time_ms > other.absolute_time_ms;
+        if (absolute_time_ms != other.absolute_time_ms) {
+            return absolute_time_ms > other.absolute_time_ms;
+        }
+        return sequence > other.sequence;
     }
 };
 
@@ -36,6 +41,15 @@ struct AbsoluteMidiEvent {
  * MIDI Scheduler handles delta-timed MIDI events
  * Converts relative timing to absolute and sends at precise times
  * Supports routing to external MIDI and/or internal audio (FluidSynth)
+ *
+ * Continuous controllers (CC, pitch bend, aftertouch) are thinned before
+ * they reach a port: of several values for one (channel, controller) due
+ * in the same update() only the latest is kept, each port skips values it
+ * already sent, and a port's rate cap limits how often one controller is
+ * sent. A value held back by the cap goes out once the cap allows (or is
+ * replaced by a newer one), so a sweep always ends on its final value.
+ * Channel mode messages (CC 120-127), bank select and RPN/NRPN/data entry
+ * are order-sensitive and always pass through unchanged.
  */
 class MidiScheduler {
 public:
@@ -45,7 +59,8 @@ public:
     void schedule(const std::vector<ScheduledMidiEvent>& events);
     void schedule(const ScheduledMidiEvent& event);
 
-    // Update - call frequently to send scheduled events
+    // Update - call frequently to send scheduled events. Everything due goes
+    // to the hardware as one batch (sendMidiBatch + flush)
     void update();
 
     // Clear all scheduled events
@@ -58,6 +73,31 @@ public:
     bool isUsingInternalAudio() const { return use_internal_audio_; }
     bool isUsingExternalMIDI() const { return use_external_midi_; }
 
+    // Controller thinning per output port
+    enum class Port : uint8_t {
+        EXTERNAL,  // Hardware MIDI out
+        INTERNAL   // Internal audio
+    };
+    static constexpr uint32_t DEFAULT_EXTERNAL_RATE = 200;  // Per controller per second
+
+    // At most max_per_second values per controller on the port, 0 = no cap
+    void setControllerRateLimit(Port port, uint32_t max_per_second);
+    uint32_t getControllerRateLimit(Port port) const { return ports_[static_cast<int>(port)].max_per_second; }
+
+    // The port's device changed: send the next values even if unchanged
+    void forgetSentControllers(Port port);
+
+    struct ControllerStats {
+        uint32_t coalesced;  // Replaced by a later value in the same update()
+        uint32_t repeats;    // Same as the value last sent on the port
+        uint32_t deferred;   // Held back by a rate cap
+    };
+    const ControllerStats& getControllerStats() const { return controller_stats_; }
+
+    // Notes sent and not yet released: bit N % 32 of [channel][N / 32]
+    using NoteMask = std::array<std::array<uint32_t, 4>, 16>;
+    const NoteMask& getActiveNotes() const { return active_notes_; }
+
     // Utility: Create common MIDI messages
     static ScheduledMidiEvent noteOn(uint8_t pitch, uint8_t velocity, uint8_t channel, uint32_t delta = 0);
     static ScheduledMidiEvent noteOff(uint8_t pitch, uint8_t channel, uint32_t delta = 0);
@@ -75,7 +115,40 @@ private:
     AudioOutput* audio_output_;
     bool use_internal_audio_;
     bool use_external_midi_;
+    NoteMask active_notes_;
+    void trackNotes(const std::vector<uint8_t>& data);
     std::priority_queue<AbsoluteMidiEvent, std::vector<AbsoluteMidiEvent>, std::greater<AbsoluteMidiEvent>> event_queue_;
+    uint64_t next_sequence_;
+    std::vector<MidiMessage> due_;    // Due this update(), before thinning
+    std::vector<MidiMessage> burst_;  // Due this update(), sent as one batch
+
+    // Controller slots, per channel: 128 CCs, 128 poly aftertouch notes, pitch bend, channel aftertouch
+    static constexpr int SLOTS_PER_CHANNEL = 258;
+    static constexpr int CONTROLLER_SLOTS = 16 * SLOTS_PER_CHANNEL;
+    static constexpr uint16_t NO_VALUE = 0xFFFF;
+
+    struct PortControllers {
+        uint32_t max_per_second;
+        uint16_t min_interval_ms;     // 0 = no cap
+        std::vector<uint16_t> sent;     // Value last sent per slot
+        std::vector<uint16_t> sent_ms;  // When (low 16 bits of the time: only compared against the interval)
+        std::vector<uint16_t> held;     // Waiting out the cap
+        std::vector<uint16_t> held_slots;
+    };
+
+    static int controllerSlot(const std::vector<uint8_t>& data);  // -1 = not thinned
+    static uint16_t controllerValue(const std::vector<uint8_t>& data);
+    static std::vector<uint8_t> controllerMessage(int slot, uint16_t value);
+
+    bool isPortEnabled(Port port) const;
+    void dispatch(Port port, const MidiMessage& message);
+    bool offerController(PortControllers& port, int slot, uint16_t value, uint32_t now_ms);  // True: send now
+    void sendHeldControllers(Port port, uint32_t now_ms);
+    void forgetChannel(int channel);  // Reset All Controllers sent
+
+    PortControllers ports_[2];
+    std::vector<int> seen_slots_;  // Controllers already kept this update()
+    ControllerStats controller_stats_;
 };
 
 } // namespace gruvbok
@@ -1,5 +1,9 @@
 #include "lua_api.h"
 #include "../core/engine.h"
+#include "../core/pattern_ops.h"
+#include "../core/log.h"
+#include <algorithm>
+#include <cmath>
 #include <cstring>
 
 namespace gruvbok {
@@ -11,6 +15,31 @@ void LuaAPI::registerAPI(lua_State* L) {
     lua_register(L, "cc", lua_cc);
     lua_register(L, "stopall", lua_stopall);
     lua_register(L, "led", lua_led);
+    lua_register(L, "background_result", lua_background_result);
+    lua_register(L, "print", lua_print);  // Replaces the base library's stdout print
+
+    // patterns.* table
+    static const luaL_Reg pattern_funcs[] = {
+        {"rotate", lua_patterns_rotate},
+        {"shift", lua_patterns_shift},
+        {"reverse", lua_patterns_reverse},
+        {"copy", lua_patterns_copy},
+        {"merge", lua_patterns_merge},
+        {"swap", lua_patterns_swap},
+        {"add_pot", lua_patterns_add_pot},
+        {"scale_pot", lua_patterns_scale_pot},
+        {"clamp_pot", lua_patterns_clamp_pot},
+        {"fill_pot", lua_patterns_fill_pot},
+        {"fill_switch", lua_patterns_fill_switch},
+        {"randomize_pot", lua_patterns_randomize_pot},
+        {nullptr, nullptr}
+    };
+    lua_newtable(L);
+    for (const luaL_Reg* f = pattern_funcs; f->name; f++) {
+        lua_pushcfunction(L, f->func);
+        lua_setfield(L, -2, f->name);
+    }
+    lua_setglobal(L, "patterns");
 }
 
 void LuaAPI::setChannel(lua_State* L, uint8_t channel) {
@@ -30,6 +59,10 @@ void LuaAPI::setEventBuffer(lua_State* L, std::vector<ScheduledMidiEvent>* buffe
     lua_setfield(L, LUA_REGISTRYINDEX, EVENT_BUFFER_KEY);
 }
 
+void LuaAPI::setBackgroundResult(lua_State* L) {
+    lua_setfield(L, LUA_REGISTRYINDEX, BACKGROUND_RESULT_KEY);
+}
+
 Engine* LuaAPI::getEngine(lua_State* L) {
     lua_getfield(L, LUA_REGISTRYINDEX, ENGINE_KEY);
     void* ptr = lua_touserdata(L, -1);
@@ -158,4 +191,303 @@ int LuaAPI::lua_led(lua_State* L) {
     return 0;
 }
 
+// print(...)
+// Same output as Lua's print (arguments tostring'd, tab-separated), but queued
+// on the logger instead of written to stdout from the real-time thread
+int LuaAPI::lua_print(lua_State* L) {
+    char line[LogRecord::TEXT_SIZE];
+    size_t used = 0;
+    int n = lua_gettop(L);
+    for (int i = 1; i <= n; i++) {
+        size_t length;
+        const char* text = luaL_tolstring(L, i, &length);
+        if (i > 1 && used < sizeof(line) - 1) {
+            line[used++] = '\t';
+        }
+        size_t copy = std::min(length, sizeof(line) - 1 - used);
+        std::memcpy(line + used, text, copy);
+        used += copy;
+        lua_pop(L, 1);
+    }
+    line[used] = '\0';
+
+    lua_getfield(L, LUA_REGISTRYINDEX, CHANNEL_KEY);
+    int channel = static_cast<int>(lua_tointeger(L, -1));
+    lua_pop(L, 1);
+
+    logInfo(LogCategory::LUA, "ch %d: %s", channel + 1, line);
+    return 0;
+}
+
+// background_result()
+// Returns the value returned by the last completed background() run (nil until then)
+int LuaAPI::lua_background_result(lua_State* L) {
+    lua_getfield(L, LUA_REGISTRYINDEX, BACKGROUND_RESULT_KEY);
+    return 1;
+}
+
+// ============================================================================
+// patterns.* bulk transforms
+// ============================================================================
+
+namespace {
+
+// (mode, pattern, track) arguments; pattern and track may be -1 for "all"
+struct PatternTarget {
+    int mode;
+    int pattern;
+    int track;
+};
+
+PatternTarget checkTarget(lua_State* L, int idx) {
+    PatternTarget t;
+    t.mode = static_cast<int>(luaL_checkinteger(L, idx));
+    t.pattern = static_cast<int>(luaL_checkinteger(L, idx + 1));
+    t.track = static_cast<int>(luaL_checkinteger(L, idx + 2));
+    luaL_argcheck(L, t.mode >= 0 && t.mode < Song::NUM_MODES, idx, "mode must be 0-14");
+    luaL_argcheck(L, t.pattern >= -1 && t.pattern < Mode::NUM_PATTERNS, idx + 1, "pattern out of range (or -1)");
+    luaL_argcheck(L, t.track >= -1 && t.track < Pattern::NUM_TRACKS, idx + 2, "track must be 0-7 or -1");
+    return t;
+}
+
+// (mode, a, b) for copy/merge/swap; returns false when a == b (nothing to do)
+bool checkPatternPair(lua_State* L, int& mode, int& a, int& b) {
+    mode = static_cast<int>(luaL_checkinteger(L, 1));
+    a = static_cast<int>(luaL_checkinteger(L, 2));
+    b = static_cast<int>(luaL_checkinteger(L, 3));
+    luaL_argcheck(L, mode >= 0 && mode < Song::NUM_MODES, 1, "mode must be 0-14");
+    luaL_argcheck(L, a >= 0 && a < Mode::NUM_PATTERNS, 2, "pattern out of range");
+    luaL_argcheck(L, b >= 0 && b < Mode::NUM_PATTERNS, 3, "pattern out of range");
+    return a != b;
+}
+
+int checkPot(lua_State* L, int idx) {
+    int pot = static_cast<int>(luaL_checkinteger(L, idx));
+    luaL_argcheck(L, pot >= 1 && pot <= 4, idx, "pot must be 1-4");
+    return pot - 1;  // Lua pots are 1-based, like event.pots
+}
+
+uint8_t checkPotValue(lua_State* L, int idx) {
+    lua_Integer v = luaL_checkinteger(L, idx);
+    return static_cast<uint8_t>(v < 0 ? 0 : (v > 127 ? 127 : v));
+}
+
+uint16_t optStepMask(lua_State* L, int idx) {
+    return static_cast<uint16_t>(luaL_optinteger(L, idx, 0xFFFF) & 0xFFFF);
+}
+
+// Every selected pattern, through Engine::editPattern so caches, the dirty flag
+// and undo follow (one call = one undo step)
+template <typename Fn>
+void forEachPattern(Engine* engine, const PatternTarget& t, Fn fn) {
+    int first = t.pattern < 0 ? 0 : t.pattern;
+    int last = t.pattern < 0 ? Mode::NUM_PATTERNS - 1 : t.pattern;
+    engine->beginEdit();
+    for (int p = first; p <= last; p++) {
+        Pattern* pattern = engine->editPattern(t.mode, p);
+        if (pattern) fn(*pattern);
+    }
+    engine->endEdit();
+    if (t.mode == 0) {
+        engine->calculateMode0LoopLength();
+    }
+}
+
+template <typename Fn>
+void forEachTrack(Engine* engine, const PatternTarget& t, Fn fn) {
+    forEachPattern(engine, t, [&](Pattern& pattern) {
+        if (t.track >= 0) {
+            fn(pattern.getTrack(t.track));
+        } else {
+            for (int i = 0; i < Pattern::NUM_TRACKS; i++) fn(pattern.getTrack(i));
+        }
+    });
+}
+
+// Contiguous packed events: one track (16) or the whole pattern (128)
+template <typename Fn>
+void forEachSpan(Engine* engine, const PatternTarget& t, Fn fn) {
+    forEachPattern(engine, t, [&](Pattern& pattern) {
+        if (t.track >= 0) {
+            fn(PatternOps::raw(pattern.getTrack(t.track)), static_cast<size_t>(Track::NUM_EVENTS));
+        } else {
+            fn(PatternOps::raw(pattern), static_cast<size_t>(Pattern::NUM_TRACKS * Track::NUM_EVENTS));
+        }
+    });
+}
+
+} // namespace
+
+// patterns.rotate(mode, pattern, track, steps)
+int LuaAPI::lua_patterns_rotate(lua_State* L) {
+    PatternTarget t = checkTarget(L, 1);
+    int steps = static_cast<int>(luaL_checkinteger(L, 4));
+    auto* engine = getEngine(L);
+    if (engine) {
+        forEachTrack(engine, t, [&](Track& track) { PatternOps::rotate(track, steps); });
+    }
+    return 0;
+}
+
+// patterns.shift(mode, pattern, track, steps)
+int LuaAPI::lua_patterns_shift(lua_State* L) {
+    PatternTarget t = checkTarget(L, 1);
+    int steps = static_cast<int>(luaL_checkinteger(L, 4));
+    auto* engine = getEngine(L);
+    if (engine) {
+        forEachTrack(engine, t, [&](Track& track) { PatternOps::shift(track, steps); });
+    }
+    return 0;
+}
+
+// patterns.reverse(mode, pattern, track)
+int LuaAPI::lua_patterns_reverse(lua_State* L) {
+    PatternTarget t = checkTarget(L, 1);
+    auto* engine = getEngine(L);
+    if (engine) {
+        forEachTrack(engine, t, [](Track& track) { PatternOps::reverse(track); });
+    }
+    return 0;
+}
+
+// patterns.copy(mode, src, dst)
+int LuaAPI::lua_patterns_copy(lua_State* L) {
+    int mode, src, dst;
+    auto* engine = getEngine(L);
+    if (checkPatternPair(L, mode, src, dst) && engine) {
+        engine->beginEdit();
+        PatternOps::copy(engine->getSong()->getMode(mode).getPattern(src), *engine->editPattern(mode, dst));
+        engine->endEdit();
+        if (mode == 0) engine->calculateMode0LoopLength();
+    }
+    return 0;
+}
+
+// patterns.merge(mode, src, dst)
+int LuaAPI::lua_patterns_merge(lua_State* L) {
+    int mode, src, dst;
+    auto* engine = getEngine(L);
+    if (checkPatternPair(L, mode, src, dst) && engine) {
+        engine->beginEdit();
+        PatternOps::merge(engine->getSong()->getMode(mode).getPattern(src), *engine->editPattern(mode, dst));
+        engine->endEdit();
+        if (mode == 0) engine->calculateMode0LoopLength();
+    }
+    return 0;
+}
+
+// patterns.swap(mode, a, b)
+int LuaAPI::lua_patterns_swap(lua_State* L) {
+    int mode, a, b;
+    auto* engine = getEngine(L);
+    if (checkPatternPair(L, mode, a, b) && engine) {
+        engine->beginEdit();
+        PatternOps::swap(*engine->editPattern(mode, a), *engine->editPattern(mode, b));
+        engine->endEdit();
+        if (mode == 0) engine->calculateMode0LoopLength();
+    }
+    return 0;
+}
+
+// patterns.add_pot(mode, pattern, track, pot, delta)
+int LuaAPI::lua_patterns_add_pot(lua_State* L) {
+    PatternTarget t = checkTarget(L, 1);
+    int pot = checkPot(L, 4);
+    int delta = static_cast<int>(luaL_checkinteger(L, 5));
+    auto* engine = getEngine(L);
+    if (engine) {
+        forEachSpan(engine, t, [&](uint32_t* events, size_t count) {
+            PatternOps::addPot(events, count, pot, delta);
+        });
+    }
+    return 0;
+}
+
+// patterns.scale_pot(mode, pattern, track, pot, factor)
+// factor: 0.0-2.0 (1.0 = unchanged)
+int LuaAPI::lua_patterns_scale_pot(lua_State* L) {
+    PatternTarget t = checkTarget(L, 1);
+    int pot = checkPot(L, 4);
+    double factor = luaL_checknumber(L, 5);
+    long q8 = std::lround(factor * PatternOps::SCALE_ONE);
+    uint16_t scale = static_cast<uint16_t>(q8 < 0 ? 0 : (q8 > PatternOps::SCALE_MAX ? PatternOps::SCALE_MAX : q8));
+    auto* engine = getEngine(L);
+    if (engine) {
+        forEachSpan(engine, t, [&](uint32_t* events, size_t count) {
+            PatternOps::scalePot(events, count, pot, scale);
+        });
+    }
+    return 0;
+}
+
+// patterns.clamp_pot(mode, pattern, track, pot, lo, hi)
+int LuaAPI::lua_patterns_clamp_pot(lua_State* L) {
+    PatternTarget t = checkTarget(L, 1);
+    int pot = checkPot(L, 4);
+    uint8_t lo = checkPotValue(L, 5);
+    uint8_t hi = checkPotValue(L, 6);
+    auto* engine = getEngine(L);
+    if (engine) {
+        forEachSpan(engine, t, [&](uint32_t* events, size_t count) {
+            PatternOps::clampPot(events, count, pot, lo, hi);
+        });
+    }
+    return 0;
+}
+
+// patterns.fill_pot(mode, pattern, track, pot, value, [step_mask])
+int LuaAPI::lua_patterns_fill_pot(lua_State* L) {
+    PatternTarget t = checkTarget(L, 1);
+    int pot = checkPot(L, 4);
+    uint8_t value = checkPotValue(L, 5);
+    uint16_t step_mask = optStepMask(L, 6);
+    auto* engine = getEngine(L);
+    if (engine) {
+        forEachSpan(engine, t, [&](uint32_t* events, size_t count) {
+            PatternOps::fillPot(events, count, pot, value, step_mask);
+        });
+    }
+    return 0;
+}
+
+// patterns.fill_switch(mode, pattern, track, on, [step_mask])
+int LuaAPI::lua_patterns_fill_switch(lua_State* L) {
+    PatternTarget t = checkTarget(L, 1);
+    luaL_checkany(L, 4);
+    bool on = lua_toboolean(L, 4);
+    uint16_t step_mask = optStepMask(L, 5);
+    auto* engine = getEngine(L);
+    if (engine) {
+        forEachSpan(engine, t, [&](uint32_t* events, size_t count) {
+            PatternOps::fillSwitch(events, count, on, step_mask);
+        });
+    }
+    return 0;
+}
+
+// patterns.randomize_pot(mode, pattern, track, pot, lo, hi, [step_mask])
+int LuaAPI::lua_patterns_randomize_pot(lua_State* L) {
+    PatternTarget t = checkTarget(L, 1);
+    int pot = checkPot(L, 4);
+    uint8_t lo = checkPotValue(L, 5);
+    uint8_t hi = checkPotValue(L, 6);
+    uint16_t step_mask = optStepMask(L, 7);
+
+    // Seed persists per Lua state so repeated calls keep producing new values
+    lua_getfield(L, LUA_REGISTRYINDEX, RANDOM_SEED_KEY);
+    uint32_t seed = static_cast<uint32_t>(lua_tointeger(L, -1));
+    lua_pop(L, 1);
+
+    auto* engine = getEngine(L);
+    if (engine) {
+        forEachSpan(engine, t, [&](uint32_t* events, size_t count) {
+            PatternOps::randomizePot(events, count, pot, lo, hi, seed, step_mask);
+        });
+    }
+
+    lua_pushinteger(L, static_cast<lua_Integer>(seed));
+    lua_setfield(L, LUA_REGISTRYINDEX, RANDOM_SEED_KEY);
+    return 0;
+}
+
 } // namespace gruvbok
@@ -30,6 +30,9 @@ public:
     static std::vector<ScheduledMidiEvent>* getEventBuffer(lua_State* L);
     static void setEventBuffer(lua_State* L, std::vector<ScheduledMidiEvent>* buffer);
 
+    // Publish the value on top of the stack as the latest background() result (pops it)
+    static void setBackgroundResult(lua_State* L);
+
     // Get/set the Engine instance for LED control
     static Engine* getEngine(lua_State* L);
     static void setEngine(lua_State* L, Engine* engine);
@@ -41,11 +44,29 @@ private:
     static int lua_cc(lua_State* L);         // cc(controller, value, [delta])
     static int lua_stopall(lua_State* L);    // stopall([delta])
     static int lua_led(lua_State* L);        // led(pattern_name, [brightness])
+    static int lua_background_result(lua_State* L);  // background_result()
+    static int lua_print(lua_State* L);      // print(...) through the logger
+
+    // patterns.* bulk transforms (see PatternOps); pattern/track -1 = all
+    static int lua_patterns_rotate(lua_State* L);         // patterns.rotate(mode, pattern, track, steps)
+    static int lua_patterns_shift(lua_State* L);          // patterns.shift(mode, pattern, track, steps)
+    static int lua_patterns_reverse(lua_State* L);        // patterns.reverse(mode, pattern, track)
+    static int lua_patterns_copy(lua_State* L);           // patterns.copy(mode, src, dst)
+    static int lua_patterns_merge(lua_State* L);          // patterns.merge(mode, src, dst)
+    static int lua_patterns_swap(lua_State* L);           // patterns.swap(mode, a, b)
+    static int lua_patterns_add_pot(lua_State* L);        // patterns.add_pot(mode, pattern, track, pot, delta)
+    static int lua_patterns_scale_pot(lua_State* L);      // patterns.scale_pot(mode, pattern, track, pot, factor)
+    static int lua_patterns_clamp_pot(lua_State* L);      // patterns.clamp_pot(mode, pattern, track, pot, lo, hi)
+    static int lua_patterns_fill_pot(lua_State* L);       // patterns.fill_pot(mode, pattern, track, pot, value, [step_mask])
+    static int lua_patterns_fill_switch(lua_State* L);    // patterns.fill_switch(mode, pattern, track, on, [step_mask])
+    static int lua_patterns_randomize_pot(lua_State* L);  // patterns.randomize_pot(mode, pattern, track, pot, lo, hi, [step_mask])
 
     // Registry keys
     static constexpr const char* CHANNEL_KEY = "gruvbok_channel";
     static constexpr const char* EVENT_BUFFER_KEY = "gruvbok_event_buffer";
     static constexpr const char* ENGINE_KEY = "gruvbok_engine";
+    static constexpr const char* BACKGROUND_RESULT_KEY = "gruvbok_background_result";
+    static constexpr const char* RANDOM_SEED_KEY = "gruvbok_random_seed";
 };
 
 } // namespace gruvbok
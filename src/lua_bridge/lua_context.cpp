@@ -1,6 +1,9 @@
 #include "lua_context.h"
 #include "lua_api.h"
+#include "../core/log.h"
 #include <iostream>
+#include <algorithm>
+#include <cstdlib>
 
 // ============================================================================
 // Lua Version Compatibility Checks
@@ -28,12 +31,27 @@
 namespace gruvbok {
 
 LuaContext::LuaContext()
-    : L_(nullptr), is_valid_(false) {
-    L_ = luaL_newstate();
+    : L_(nullptr)
+    , is_valid_(false)
+    , generation_(0)
+    , engine_(nullptr)
+    , memory_used_(0)
+    , memory_limit_(0)
+    , has_background_(false)
+    , background_thread_(nullptr)
+    , background_thread_ref_(LUA_NOREF)
+    , background_runs_(0) {
+    // Own allocator so MEMORY_BUDGET_KB can be enforced per mode
+    L_ = lua_newstate(budgetAlloc, this);
     if (!L_) {
         setError("Failed to create Lua state");
         return;
     }
+    lua_atpanic(L_, [](lua_State* L) -> int {
+        const char* msg = lua_tostring(L, -1);
+        std::cerr << "PANIC: unprotected error in Lua: " << (msg ? msg : "unknown error") << std::endl;
+        return 0;  // Lua aborts
+    });
 
 #ifdef NO_EXCEPTIONS
     // For embedded systems (Teensy): Load only essential Lua libraries
@@ -44,12 +62,19 @@ LuaContext::LuaContext()
     luaL_requiref(L_, LUA_MATHLIBNAME, luaopen_math, 1);  // math.*
     lua_pop(L_, 4);  // Remove libs from stack
 
+#ifdef GRUVBOK_LUA_COROUTINES
+    // Optional: expose coroutine.* to scripts (~2 KB of flash)
+    luaL_requiref(L_, LUA_COLIBNAME, luaopen_coroutine, 1);
+    lua_pop(L_, 1);
+#endif
+
     // Omitted for embedded:
     // - io (liolib): File I/O not needed
     // - os (loslib): OS functions not available on Teensy
     // - package/loadlib: Dynamic loading not needed
     // - debug: Not needed for production
-    // - coroutine: Not used in our modes
+    // - coroutine: background() is driven from C via lua_newthread/lua_resume,
+    //   which is part of the Lua core, so the library itself is not required
 #else
     // Desktop: Load all standard libraries
     luaL_openlibs(L_);
@@ -78,6 +103,11 @@ LuaContext::~LuaContext() {
 
 bool LuaContext::loadScript(const std::string& filepath) {
     is_valid_ = false;
+    manifest_ = ModeManifest();
+    memory_limit_ = 0;  // Budget of a previous script doesn't apply while loading
+    has_background_ = false;
+    releaseBackgroundThread();
+    bumpGeneration();
 
     if (luaL_dofile(L_, filepath.c_str()) != LUA_OK) {
         setError(std::string("Failed to load script: ") + lua_tostring(L_, -1));
@@ -91,20 +121,86 @@ bool LuaContext::loadScript(const std::string& filepath) {
         return false;
     }
 
-    if (!functionExists("process_event")) {
+    // process_step() can stand in for process_event()
+    if (!functionExists("process_event") && !functionExists("process_step")) {
         setError("Script missing required function: process_event()");
         return false;
     }
 
+    parseManifest();
+    has_background_ = manifest_.has_background;
+    setEngine(engine_);  // The manifest decides whether the script sees it
+
+    // Enforce the budget from here on (script body is already loaded)
+    memory_limit_ = static_cast<size_t>(manifest_.memory_budget_kb) * 1024;
+    if (memory_limit_ > 0 && memory_used_ > memory_limit_) {
+        setError("Script exceeds MEMORY_BUDGET_KB after loading (" +
+                 std::to_string(memory_used_ / 1024) + " KB used)");
+        memory_limit_ = 0;
+        return false;
+    }
+
     is_valid_ = true;
     return true;
 }
 
+void LuaContext::parseManifest() {
+    lua_getglobal(L_, "MODE_NAME");
+    if (lua_isstring(L_, -1)) {
+        const char* str = lua_tostring(L_, -1);
+        if (str) manifest_.name = str;
+    }
+    lua_pop(L_, 1);
+
+    lua_getglobal(L_, "SLIDER_LABELS");
+    if (lua_istable(L_, -1)) {
+        // Read up to 4 labels from the table
+        for (int i = 0; i < 4; ++i) {
+            lua_rawgeti(L_, -1, i + 1);  // Lua arrays are 1-indexed
+            if (lua_isstring(L_, -1)) {
+                const char* str = lua_tostring(L_, -1);
+                if (str) manifest_.slider_labels[i] = str;
+            }
+            lua_pop(L_, 1);
+        }
+    }
+    lua_pop(L_, 1);
+
+    // Flags default to the conservative choice when absent
+    lua_getglobal(L_, "SWITCH_OFF_EVENTS");
+    if (!lua_isnil(L_, -1)) {
+        manifest_.wants_switch_off = lua_toboolean(L_, -1) != 0;
+    }
+    lua_pop(L_, 1);
+
+    lua_getglobal(L_, "DETERMINISTIC");
+    manifest_.deterministic = lua_toboolean(L_, -1) != 0;
+    lua_pop(L_, 1);
+
+    lua_getglobal(L_, "PARALLEL_SAFE");
+    manifest_.parallel_safe = lua_toboolean(L_, -1) != 0;
+    lua_pop(L_, 1);
+
+    lua_getglobal(L_, "MEMORY_BUDGET_KB");
+    if (lua_isnumber(L_, -1)) {
+        lua_Number kb = lua_tonumber(L_, -1);
+        manifest_.memory_budget_kb = kb > 0 ? static_cast<uint32_t>(kb) : 0;
+    }
+    lua_pop(L_, 1);
+
+    manifest_.has_step_hook = functionExists("process_step");
+    manifest_.has_background = functionExists("background");
+    manifest_.has_input_hook = functionExists("process_input");
+}
+
 bool LuaContext::callInit(const LuaInitContext& context) {
     if (!is_valid_) {
         return false;
     }
 
+    // init() may change tempo/scale/velocity state that process_event() depends on
+    bumpGeneration();
+
     lua_getglobal(L_, "init");
     if (!lua_isfunction(L_, -1)) {
         setError("init is not a function");
@@ -160,22 +256,47 @@ std::vector<ScheduledMidiEvent> LuaContext::callProcessEvent(int track, const Ev
     lua_pushinteger(L_, track);
 
     // Create event table
-    lua_newtable(L_);
+    pushEvent(event);
 
-    lua_pushboolean(L_, event.getSwitch());
-    lua_setfield(L_, -2, "switch");
+    // Call process_event(track, event)
+    if (lua_pcall(L_, 2, 1, 0) != LUA_OK) {
+        logError(LogCategory::LUA, "process_event(): %s", lua_tostring(L_, -1));
+        lua_pop(L_, 1);
+        return event_buffer_;
+    }
 
-    // Create pots array
-    lua_newtable(L_);
-    for (int i = 0; i < 4; ++i) {
-        lua_pushinteger(L_, event.getPot(i));
-        lua_rawseti(L_, -2, i + 1);  // Lua arrays are 1-indexed
+    // Return value is ignored (events are in buffer)
+    lua_pop(L_, 1);
+
+    return event_buffer_;
+}
+
+std::vector<ScheduledMidiEvent> LuaContext::callProcessStep(int step, const Event* events, int num_tracks) {
+    event_buffer_.clear();
+
+    if (!is_valid_) {
+        return event_buffer_;
     }
-    lua_setfield(L_, -2, "pots");
 
-    // Call process_event(track, event)
+    lua_getglobal(L_, "process_step");
+    if (!lua_isfunction(L_, -1)) {
+        lua_pop(L_, 1);
+        return event_buffer_;
+    }
+
+    // Push step number
+    lua_pushinteger(L_, step);
+
+    // Create events array: events[track + 1]
+    lua_createtable(L_, num_tracks, 0);
+    for (int track = 0; track < num_tracks; ++track) {
+        pushEvent(events[track]);
+        lua_rawseti(L_, -2, track + 1);  // Lua arrays are 1-indexed
+    }
+
+    // Call process_step(step, events)
     if (lua_pcall(L_, 2, 1, 0) != LUA_OK) {
-        std::cerr << "Error calling process_event(): " << lua_tostring(L_, -1) << std::endl;
+        logError(LogCategory::LUA, "process_step(): %s", lua_tostring(L_, -1));
         lua_pop(L_, 1);
         return event_buffer_;
     }
@@ -186,72 +307,227 @@ std::vector<ScheduledMidiEvent> LuaContext::callProcessEvent(int track, const Ev
     return event_buffer_;
 }
 
-void LuaContext::setChannel(uint8_t channel) {
-    LuaAPI::setChannel(L_, channel);
-}
+std::vector<ScheduledMidiEvent> LuaContext::callProcessInput(const MidiInputEvent& input) {
+    event_buffer_.clear();
 
-void LuaContext::setEngine(Engine* engine) {
-    LuaAPI::setEngine(L_, engine);
-}
+    if (!is_valid_) {
+        return event_buffer_;
+    }
 
-bool LuaContext::functionExists(const char* name) {
-    lua_getglobal(L_, name);
-    bool exists = lua_isfunction(L_, -1);
+    lua_getglobal(L_, "process_input");
+    if (!lua_isfunction(L_, -1)) {
+        lua_pop(L_, 1);
+        return event_buffer_;
+    }
+
+    // msg = {type=, channel=, data1=, data2=} plus named fields for the common types
+    uint8_t status = input.data[0] & 0xF0;
+    uint8_t data1 = input.size > 1 ? input.data[1] & 0x7F : 0;
+    uint8_t data2 = input.size > 2 ? input.data[2] & 0x7F : 0;
+    lua_createtable(L_, 0, 6);
+    lua_pushinteger(L_, input.data[0] & 0x0F);
+    lua_setfield(L_, -2, "channel");
+    lua_pushinteger(L_, data1);
+    lua_setfield(L_, -2, "data1");
+    lua_pushinteger(L_, data2);
+    lua_setfield(L_, -2, "data2");
+
+    const char* type = "other";
+    switch (status) {
+        case 0x80:
+        case 0x90:
+            type = (status == 0x90 && data2 > 0) ? "note_on" : "note_off";  // Velocity 0 = note off
+            lua_pushinteger(L_, data1);
+            lua_setfield(L_, -2, "note");
+            lua_pushinteger(L_, data2);
+            lua_setfield(L_, -2, "velocity");
+            break;
+        case 0xA0:
+            type = "poly_aftertouch";
+            lua_pushinteger(L_, data1);
+            lua_setfield(L_, -2, "note");
+            lua_pushinteger(L_, data2);
+            lua_setfield(L_, -2, "value");
+            break;
+        case 0xB0:
+            type = "cc";
+            lua_pushinteger(L_, data1);
+            lua_setfield(L_, -2, "controller");
+            lua_pushinteger(L_, data2);
+            lua_setfield(L_, -2, "value");
+            break;
+        case 0xC0:
+            type = "program";
+            lua_pushinteger(L_, data1);
+            lua_setfield(L_, -2, "value");
+            break;
+        case 0xD0:
+            type = "aftertouch";
+            lua_pushinteger(L_, data1);
+            lua_setfield(L_, -2, "value");
+            break;
+        case 0xE0:
+            type = "pitch_bend";
+            lua_pushinteger(L_, ((data2 << 7) | data1) - 8192);  // -8192 to 8191
+            lua_setfield(L_, -2, "value");
+            break;
+    }
+    lua_pushstring(L_, type);
+    lua_setfield(L_, -2, "type");
+
+    // Call process_input(msg)
+    if (lua_pcall(L_, 1, 1, 0) != LUA_OK) {
+        logError(LogCategory::LUA, "process_input(): %s", lua_tostring(L_, -1));
+        lua_pop(L_, 1);
+        return event_buffer_;
+    }
+
+    // Return value is ignored (events are in buffer)
     lua_pop(L_, 1);
-    return exists;
+
+    return event_buffer_;
 }
 
-void LuaContext::setError(const std::string& error) {
-    error_message_ = error;
-    is_valid_ = false;
-    std::cerr << "LuaContext error: " << error << std::endl;
+void LuaContext::pushEvent(const Event& event) {
+    lua_createtable(L_, 0, 2);
+
+    lua_pushboolean(L_, event.getSwitch());
+    lua_setfield(L_, -2, "switch");
+
+    // Create pots array
+    lua_createtable(L_, 4, 0);
+    for (int i = 0; i < 4; ++i) {
+        lua_pushinteger(L_, event.getPot(i));
+        lua_rawseti(L_, -2, i + 1);  // Lua arrays are 1-indexed
+    }
+    lua_setfield(L_, -2, "pots");
 }
 
-std::string LuaContext::getModeName() const {
-    if (!is_valid_ || !L_) {
-        return "Invalid";
+LuaContext::BackgroundStatus LuaContext::resumeBackground(int instruction_budget) {
+    if (!is_valid_ || !has_background_) {
+        return BackgroundStatus::IDLE;
     }
 
-    // Try to read MODE_NAME global variable
-    lua_getglobal(L_, "MODE_NAME");
+    // Start a new run: fresh coroutine with background() as its body
+    if (!background_thread_) {
+        background_thread_ = lua_newthread(L_);
+        background_thread_ref_ = luaL_ref(L_, LUA_REGISTRYINDEX);  // Pops and anchors the thread
+        lua_getglobal(background_thread_, "background");
+    }
 
-    if (lua_isstring(L_, -1)) {
-        const char* str = lua_tostring(L_, -1);
-        std::string name = str ? str : "Unnamed";
-        lua_pop(L_, 1);
-        return name;
+    // The count hook yields once the budget is spent
+    lua_sethook(background_thread_, backgroundHook, LUA_MASKCOUNT, std::max(1, instruction_budget));
+
+    int nresults = 0;
+#if LUA_VERSION_NUM >= 504
+    int status = lua_resume(background_thread_, L_, 0, &nresults);
+#else
+    int status = lua_resume(background_thread_, 0);
+    nresults = lua_gettop(background_thread_);
+#endif
+
+    if (status == LUA_YIELD) {
+        lua_pop(background_thread_, nresults);
+        return BackgroundStatus::RUNNING;
     }
 
-    lua_pop(L_, 1);
-    return "Unnamed";  // Default if MODE_NAME not defined
+    if (status != LUA_OK) {
+        const char* msg = lua_tostring(background_thread_, -1);
+        logError(LogCategory::LUA, "background(): %s", msg ? msg : "unknown error");
+        releaseBackgroundThread();
+        has_background_ = false;  // Don't retry a failing worker every slice
+        return BackgroundStatus::ERROR;
+    }
+
+    // Publish the first return value in one step so process_event() never sees partial results
+    if (nresults > 0) {
+        lua_pop(background_thread_, nresults - 1);
+        lua_xmove(background_thread_, L_, 1);
+    } else {
+        lua_pushnil(L_);
+    }
+    LuaAPI::setBackgroundResult(L_);
+
+    releaseBackgroundThread();
+    background_runs_++;
+    return BackgroundStatus::FINISHED;
 }
 
-std::vector<std::string> LuaContext::getSliderLabels() const {
-    std::vector<std::string> labels = {"S1", "S2", "S3", "S4"};  // Defaults
+void LuaContext::releaseBackgroundThread() {
+    if (background_thread_) {
+        luaL_unref(L_, LUA_REGISTRYINDEX, background_thread_ref_);
+        background_thread_ = nullptr;
+        background_thread_ref_ = LUA_NOREF;
+    }
+}
 
-    if (!is_valid_ || !L_) {
-        return labels;
+void LuaContext::backgroundHook(lua_State* L, lua_Debug* ar) {
+    (void)ar;
+    // Inside a C function (table.sort comparator, gsub callback, __gc) a yield
+    // would raise "attempt to yield across a C-call boundary": let it run on,
+    // the hook fires again once control is back in plain Lua
+    if (!lua_isyieldable(L)) {
+        return;
     }
+    // Count hooks may yield as long as they return via lua_yield(L, 0)
+    lua_yield(L, 0);
+}
 
-    // Try to read SLIDER_LABELS global table
-    lua_getglobal(L_, "SLIDER_LABELS");
+void LuaContext::setChannel(uint8_t channel) {
+    LuaAPI::setChannel(L_, channel);
+    bumpGeneration();
+}
 
-    if (lua_istable(L_, -1)) {
-        // Read up to 4 labels from the table
-        for (int i = 0; i < 4; ++i) {
-            lua_rawgeti(L_, -1, i + 1);  // Lua arrays are 1-indexed
-            if (lua_isstring(L_, -1)) {
-                const char* str = lua_tostring(L_, -1);
-                if (str) {
-                    labels[i] = str;
-                }
-            }
-            lua_pop(L_, 1);
-        }
+void* LuaContext::budgetAlloc(void* ud, void* ptr, size_t osize, size_t nsize) {
+    LuaContext* self = static_cast<LuaContext*>(ud);
+    size_t old_size = ptr ? osize : 0;  // For new blocks osize is a type tag, not a size
+
+    if (nsize == 0) {
+        free(ptr);
+        self->memory_used_ -= old_size;
+        return nullptr;
     }
 
+    // Refuse growth past the budget; Lua runs an emergency GC and then raises "not enough memory"
+    if (self->memory_limit_ > 0 && nsize > old_size &&
+        self->memory_used_ - old_size + nsize > self->memory_limit_) {
+        return nullptr;
+    }
+
+    void* block = realloc(ptr, nsize);
+    if (block) {
+        self->memory_used_ = self->memory_used_ - old_size + nsize;
+    }
+    return block;
+}
+
+void LuaContext::bumpGeneration() {
+    // Shared counter so a replaced context never reuses an old generation
+    static uint32_t next_generation = 1;
+    generation_ = next_generation++;
+}
+
+void LuaContext::setEngine(Engine* engine) {
+    engine_ = engine;
+    LuaAPI::setEngine(L_, manifest_.parallel_safe ? nullptr : engine);
+}
+
+bool LuaContext::functionExists(const char* name) {
+    lua_getglobal(L_, name);
+    bool exists = lua_isfunction(L_, -1);
     lua_pop(L_, 1);
-    return labels;
+    return exists;
+}
+
+void LuaContext::setError(const std::string& error) {
+    error_message_ = error;
+    is_valid_ = false;
+    logError(LogCategory::LUA, "%s", error);
+}
+
+const std::string& LuaContext::getModeName() const {
+    static const std::string invalid_name = "Invalid";
+    return (is_valid_ && L_) ? manifest_.name : invalid_name;
 }
 
 } // namespace gruvbok
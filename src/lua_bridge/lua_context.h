@@ -28,11 +28,47 @@ struct LuaInitContext {
     int velocity_offset; // -64 to +63, controlled by Mode 0
 };
 
+/**
+ * Mode manifest: metadata and capability flags declared by a mode script,
+ * parsed once when the script loads.
+ *
+ *   MODE_NAME = "Drums"                   -- Display name
+ *   SLIDER_LABELS = {"Vel", "Len", ...}   -- S1-S4 labels
+ *   SWITCH_OFF_EVENTS = false             -- Skip Lua for switch-off events (default true)
+ *   DETERMINISTIC = true                  -- Output depends only on (track, event)
+ *   MEMORY_BUDGET_KB = 64                 -- Lua heap limit (default unlimited)
+ *   PARALLEL_SAFE = true                  -- May run on a worker thread alongside
+ *                                            other modes; led() and patterns.*
+ *                                            do nothing in such modes
+ *   function process_step(step, events)   -- Batch hook: one call per step, all tracks
+ *   function process_input(msg)           -- Live MIDI input, played at once
+ *   function background()                 -- Idle-time worker
+ */
+struct ModeManifest {
+    std::string name = "Unnamed";
+    std::vector<std::string> slider_labels = {"S1", "S2", "S3", "S4"};
+    bool wants_switch_off = true;
+    bool deterministic = false;
+    bool has_step_hook = false;
+    bool has_input_hook = false;
+    bool has_background = false;
+    bool parallel_safe = false;
+    uint32_t memory_budget_kb = 0;  // 0 = unlimited
+};
+
 /**
  * Wrapper around lua_State for a single mode
  */
 class LuaContext {
 public:
+    // Result of resuming a mode's background() coroutine
+    enum class BackgroundStatus {
+        IDLE,       // Mode has no background() function (or it was disabled after an error)
+        RUNNING,    // Instruction budget used up, coroutine yielded and will continue next slice
+        FINISHED,   // background() returned; its result is published via background_result()
+        ERROR       // background() raised an error and has been disabled
+    };
+
     LuaContext();
     ~LuaContext();
 
@@ -50,24 +86,53 @@ public:
     // Returns MIDI events to schedule
     std::vector<ScheduledMidiEvent> callProcessEvent(int track, const Event& event);
 
+    // Call process_step(step, events) batch hook with one event per track
+    // (only for modes whose manifest has_step_hook)
+    std::vector<ScheduledMidiEvent> callProcessStep(int step, const Event* events, int num_tracks);
+
+    // Call process_input(msg) with a channel message received live
+    // (only for modes whose manifest has_input_hook)
+    std::vector<ScheduledMidiEvent> callProcessInput(const MidiInputEvent& input);
+
+    // Resume the optional background() function as a coroutine for at most
+    // instruction_budget VM instructions. A finished run is restarted on the
+    // next call, so background() behaves like an idle-time worker loop.
+    BackgroundStatus resumeBackground(int instruction_budget);
+    bool hasBackground() const { return has_background_; }
+    uint32_t getBackgroundRuns() const { return background_runs_; }  // Completed runs
+
     // Check if script is loaded and valid
     bool isValid() const { return is_valid_; }
 
+    // Metadata and capability flags parsed at load (see ModeManifest)
+    const ModeManifest& getManifest() const { return manifest_; }
+
+    // Mode declared DETERMINISTIC = true: output depends only on (track, event),
+    // so the engine may replay cached output instead of calling process_event()
+    bool isDeterministic() const { return manifest_.deterministic; }
+
+    // Changes whenever cached output could go stale (script load, init, channel)
+    uint32_t getGeneration() const { return generation_; }
+
     // Get error message if something failed
     const std::string& getError() const { return error_message_; }
 
     // Set MIDI channel for this mode
     void setChannel(uint8_t channel);
 
-    // Set Engine instance for LED control
+    // Set Engine instance for LED control and pattern edits
+    // (withheld from PARALLEL_SAFE modes, which must not touch the engine)
     void setEngine(Engine* engine);
 
-    // Get mode name (from MODE_NAME global variable in Lua)
-    std::string getModeName() const;
+    // Get mode name (from MODE_NAME global variable in Lua, cached at load)
+    const std::string& getModeName() const;
 
-    // Get slider labels (from SLIDER_LABELS global array in Lua, optional)
+    // Get slider labels (from SLIDER_LABELS global array in Lua, optional, cached at load)
     // Returns array of 4 strings (S1-S4 labels)
-    std::vector<std::string> getSliderLabels() const;
+    const std::vector<std::string>& getSliderLabels() const { return manifest_.slider_labels; }
+
+    // Lua heap usage in bytes (limited by MEMORY_BUDGET_KB)
+    size_t getMemoryUsage() const { return memory_used_; }
 
     // Get Lua state (for testing only)
     lua_State* getState() const { return L_; }
@@ -77,6 +142,28 @@ private:
     bool is_valid_;
     std::string error_message_;
     std::vector<ScheduledMidiEvent> event_buffer_;
+    ModeManifest manifest_;
+    uint32_t generation_;
+    Engine* engine_;
+
+    // Lua heap accounting (custom allocator)
+    size_t memory_used_;
+    size_t memory_limit_;  // Bytes, 0 = unlimited
+    static void* budgetAlloc(void* ud, void* ptr, size_t osize, size_t nsize);
+
+    void parseManifest();
+    void pushEvent(const Event& event);  // Push {switch=, pots={}} table
+
+    void bumpGeneration();
+
+    // background() coroutine state (thread is anchored in the registry)
+    bool has_background_;
+    lua_State* background_thread_;
+    int background_thread_ref_;
+    uint32_t background_runs_;
+
+    void releaseBackgroundThread();
+    static void backgroundHook(lua_State* L, lua_Debug* ar);
 
     // Helper to check if a function exists
     bool functionExists(const char* name);
@@ -1,5 +1,5 @@
 #include "mode_loader.h"
-#include <iostream>
+#include "../core/log.h"
 #include <filesystem>
 #include <algorithm>
 
@@ -14,14 +14,14 @@ ModeLoader::ModeLoader() {
 
 bool ModeLoader::loadMode(int mode_number, const std::string& filepath, int tempo) {
     if (mode_number < 0 || mode_number >= NUM_MODES) {
-        std::cerr << "Invalid mode number: " << mode_number << std::endl;
+        logError(LogCategory::LUA, "Invalid mode number: %d", mode_number);
         return false;
     }
 
     auto context = std::make_unique<LuaContext>();
 
     if (!context->loadScript(filepath)) {
-        std::cerr << "Failed to load mode " << mode_number << ": " << context->getError() << std::endl;
+        logError(LogCategory::LUA, "Failed to load mode %d: %s", mode_number, context->getError());
         return false;
     }
 
@@ -36,12 +36,12 @@ bool ModeLoader::loadMode(int mode_number, const std::string& filepath, int temp
     init_ctx.midi_channel = channel;  // Mode 0 = no output, Mode 1 → Ch 0 (displayed as Ch 1), etc.
 
     if (!context->callInit(init_ctx)) {
-        std::cerr << "Failed to initialize mode " << mode_number << ": " << context->getError() << std::endl;
+        logError(LogCategory::LUA, "Failed to initialize mode %d: %s", mode_number, context->getError());
         return false;
     }
 
     modes_[mode_number] = std::move(context);
-    std::cout << "Loaded mode " << mode_number << " from " << filepath << std::endl;
+    logInfo(LogCategory::LUA, "Loaded mode %d from %s", mode_number, filepath);
     return true;
 }
 
@@ -63,7 +63,7 @@ int ModeLoader::loadModesFromDirectory(const std::string& directory, int tempo)
     namespace fs = std::filesystem;
 
     if (!fs::exists(directory) || !fs::is_directory(directory)) {
-        std::cerr << "Directory does not exist: " << directory << std::endl;
+        logError(LogCategory::LUA, "Directory does not exist: %s", directory);
         return 0;
     }
 
@@ -87,7 +87,7 @@ int ModeLoader::loadModesFromDirectory(const std::string& directory, int tempo)
         }
     }
 
-    std::cout << "Loaded " << loaded_count << " modes from " << directory << std::endl;
+    logInfo(LogCategory::LUA, "Loaded %d modes from %s", loaded_count, directory);
     return loaded_count;
 }
 
@@ -8,6 +8,7 @@
 #include "teensy_hardware.h"
 #include "../core/song.h"
 #include "../core/engine.h"
+#include "../core/log.h"
 #include "../lua_bridge/mode_loader.h"
 #include <SD.h>
 
@@ -30,6 +31,11 @@ void setup() {
     Serial.begin(115200);
     delay(100);  // Give serial time to initialize
 
+    // Engine and Lua log records are printed from loop(), a few at a time
+    Logger::instance().addSink([](const LogRecord&, const char* line) {
+        Serial.println(line);
+    });
+
     Serial.println("========================================");
     Serial.println("GRUVBOK - Teensy 4.1 Firmware");
     Serial.println("========================================");
@@ -92,9 +98,13 @@ void setup() {
 }
 
 void loop() {
-    // Main update loop
+    // Main update loop: scan the controls and feed the DIN UART, then run the engine
+    hardware->update();
     engine->update();
 
+    // Print queued log records, bounded so a burst can't delay the next step
+    Logger::instance().flush(4);
+
     // Optional: Print status periodically
     static uint32_t last_status_print = 0;
     uint32_t current_time = millis();
@@ -1,5 +1,6 @@
 #include "teensy_hardware.h"
 #include "../hardware/hardware_utils.h"
+#include "../core/log.h"
 #include <usb_midi.h>
 
 namespace gruvbok {
@@ -7,7 +8,11 @@ namespace gruvbok {
 TeensyHardware::TeensyHardware()
     : led_state_(false)
     , led_brightness_(255)
-    , start_time_ms_(0) {
+    , start_time_ms_(0)
+    , din_uart_(Serial7)
+    , din_output_(&din_uart_)
+    , din_misses_reported_(0)
+    , din_report_ms_(0) {
 
     button_states_.fill(false);
     button_last_states_.fill(false);
@@ -35,6 +40,8 @@ bool TeensyHardware::init() {
         slider_pot_values_[i] = readPotRaw(SLIDER_POT_PINS[i]);
     }
 
+    Serial7.begin(DIN_BAUD);
+
     // USB MIDI is automatically initialized by Teensy USB stack
     // Just record start time
     start_time_ms_ = millis();
@@ -74,11 +81,30 @@ uint8_t TeensyHardware::readSliderPot(int pot) {
 }
 
 void TeensyHardware::sendMidiMessage(const MidiMessage& msg) {
+    writeMidiMessage(msg);
+    usbMIDI.send_now();
+    din_output_.send(&msg, 1, getMicros());
+}
+
+void TeensyHardware::sendMidiBatch(const MidiMessage* messages, size_t count) {
+    // Each message becomes a 4-byte USB-MIDI event in usbMIDI's transmit
+    // buffer; full packets go out on their own, the rest on flush()
+    for (size_t i = 0; i < count; ++i) {
+        writeMidiMessage(messages[i]);
+    }
+    din_output_.send(messages, count, getMicros());
+}
+
+void TeensyHardware::flush() {
+    usbMIDI.send_now();
+}
+
+void TeensyHardware::writeMidiMessage(const MidiMessage& msg) {
     if (msg.data.empty()) {
         return;
     }
 
-    // Parse MIDI message and send via USB MIDI
+    // Parse MIDI message and queue it for USB MIDI
     uint8_t status = msg.data[0];
     uint8_t type = status & 0xF0;
     uint8_t channel = (status & 0x0F) + 1;  // Teensy uses 1-16, we use 0-15
@@ -124,6 +150,32 @@ void TeensyHardware::sendMidiMessage(const MidiMessage& msg) {
     }
 }
 
+bool TeensyHardware::readMidiInput(MidiInputEvent& event) {
+    // USB MIDI is polled from the main loop, so there is no callback to queue from
+    while (usbMIDI.read()) {
+        uint8_t type = usbMIDI.getType();
+        if (type == usbMIDI.SystemExclusive) {
+            continue;  // Doesn't fit a MidiInputEvent
+        }
+
+        event.timestamp_us = getMicros();
+        event.data[0] = type < 0xF0 ? static_cast<uint8_t>(type | (usbMIDI.getChannel() - 1)) : type;
+        event.data[1] = usbMIDI.getData1();
+        event.data[2] = usbMIDI.getData2();
+        if (type >= 0xF8) {
+            event.size = 1;  // Real-time
+        } else if (type == 0xC0 || type == 0xD0 || type == 0xF1 || type == 0xF3) {
+            event.size = 2;
+        } else if (type == 0xF6) {
+            event.size = 1;
+        } else {
+            event.size = 3;
+        }
+        return true;
+    }
+    return false;
+}
+
 void TeensyHardware::setLED(bool on) {
     led_state_ = on;
     if (on) {
@@ -145,6 +197,10 @@ uint32_t TeensyHardware::getMillis() {
     return millis() - start_time_ms_;
 }
 
+uint32_t TeensyHardware::getMicros() {
+    return micros() - start_time_ms_ * 1000;
+}
+
 void TeensyHardware::update() {
     uint32_t current_time = millis();
 
@@ -176,9 +232,14 @@ void TeensyHardware::update() {
         slider_pot_values_[i] = HardwareUtils::applyIIRFilter(new_value, slider_pot_values_[i], 64);
     }
 
-    // Read and discard any incoming USB MIDI messages (we don't handle MIDI input yet)
-    while (usbMIDI.read()) {
-        // Discard
+    // Keep the DIN UART fed; a saturated wire shows up as deadline misses
+    din_output_.service(getMicros());
+    uint32_t misses = din_output_.getStats().deadline_misses;
+    if (misses != din_misses_reported_ && current_time - din_report_ms_ >= DIN_REPORT_MS) {
+        logWarn(LogCategory::MIDI, "DIN out: %u message(s) past the %u us deadline (worst %u us late)",
+                misses - din_misses_reported_, din_output_.getDeadline(), din_output_.getStats().max_late_us);
+        din_misses_reported_ = misses;
+        din_report_ms_ = current_time;
     }
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../hardware/hardware_interface.h"
+#include "../hardware/din_output.h"
 #include <Arduino.h>
 #include <array>
 #include <vector>
@@ -32,7 +33,26 @@ namespace gruvbok {
  * - LED: Pin 13 (onboard LED)
  *
  * MIDI: USB MIDI (no additional pins needed)
+ * - DIN MIDI out: Serial7 TX, pin 29 (Serial1's pin 1 is a button)
  */
+
+/**
+ * DIN MIDI transmit on a hardware serial port
+ */
+class SerialMidiUart : public MidiUart {
+public:
+    explicit SerialMidiUart(HardwareSerial& serial) : serial_(serial) {}
+
+    size_t availableForWrite() override {
+        int available = serial_.availableForWrite();
+        return available > 0 ? static_cast<size_t>(available) : 0;
+    }
+    void write(uint8_t byte) override { serial_.write(byte); }
+
+private:
+    HardwareSerial& serial_;
+};
+
 class TeensyHardware : public HardwareInterface {
 public:
     TeensyHardware();
@@ -46,10 +66,14 @@ public:
     uint8_t readSliderPot(int pot) override;
 
     void sendMidiMessage(const MidiMessage& msg) override;
+    void sendMidiBatch(const MidiMessage* messages, size_t count) override;
+    void flush() override;
+    bool readMidiInput(MidiInputEvent& event) override;
     void setLED(bool on) override;
     void setLEDBrightness(uint8_t brightness);  // Set PWM brightness 0-255
     bool getLED() const override { return led_state_; }
     uint32_t getMillis() override;
+    uint32_t getMicros() override;
 
     void update() override;
 
@@ -76,6 +100,11 @@ private:
 
     static constexpr int LED_PIN = 13;  // Onboard LED
 
+    static constexpr uint32_t DIN_BAUD = 31250;
+    static constexpr uint32_t DIN_REPORT_MS = 1000;  // At most one deadline-miss warning per second
+
+    void writeMidiMessage(const MidiMessage& msg);  // Queue in usbMIDI's buffer, no send_now
+
     // ADC resolution (Teensy 4.1 supports 10-bit ADC)
     static constexpr int ADC_RESOLUTION = 10;  // 0-1023
     static constexpr int ADC_MAX = (1 << ADC_RESOLUTION) - 1;  // 1023
@@ -95,6 +124,12 @@ private:
     uint8_t led_brightness_;  // 0-255 for PWM (analogWrite)
     uint32_t start_time_ms_;
 
+    // DIN MIDI out, paced by the main loop
+    SerialMidiUart din_uart_;
+    DinMidiOutput din_output_;
+    uint32_t din_misses_reported_;
+    uint32_t din_report_ms_;
+
     // Helper functions
     bool readButtonRaw(int button);
     uint16_t readPotRaw(int pin);
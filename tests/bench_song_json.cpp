@@ -0,0 +1,125 @@
+/**
+ * Throughput benchmark for JSON song save/load
+ *
+ * Compares the streaming writer/SAX reader in song_io.h against the DOM
+ * round-trip they replaced (rebuilt here), on a densely programmed song.
+ * Not part of ctest: run bin/tests/bench_song_json by hand.
+ */
+
+#include "../src/core/song.h"
+#include "../src/core/song_io.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include "../external/nlohmann/json.hpp"
+
+using namespace gruvbok;
+
+namespace {
+
+const char* SONG_PATH = "/tmp/bench_song.json";
+const int ITERATIONS = 5;
+
+// The DOM save/load song_io.h used before streaming
+bool domSave(const Song& song, const std::string& filepath) {
+    nlohmann::json j;
+    j["version"] = "1.0";
+    j["name"] = "Bench";
+    j["tempo"] = 120;
+    j["events"] = nlohmann::json::array();
+    for (int m = 0; m < Song::NUM_MODES; ++m) {
+        for (int p = 0; p < Mode::NUM_PATTERNS; ++p) {
+            for (int t = 0; t < Pattern::NUM_TRACKS; ++t) {
+                for (int s = 0; s < Track::NUM_EVENTS; ++s) {
+                    const Event& evt = song[m][p][t][s];
+                    if (evt.getSwitch()) {
+                        nlohmann::json e;
+                        e["mode"] = m;
+                        e["pattern"] = p;
+                        e["track"] = t;
+                        e["step"] = s;
+                        e["switch"] = true;
+                        e["pots"] = {evt.getPot(0), evt.getPot(1), evt.getPot(2), evt.getPot(3)};
+                        j["events"].push_back(e);
+                    }
+                }
+            }
+        }
+    }
+    std::ofstream file(filepath);
+    file << j.dump(2);
+    return file.good();
+}
+
+bool domLoad(Song& song, const std::string& filepath) {
+    std::ifstream file(filepath);
+    nlohmann::json j;
+    file >> j;
+    if (j["version"] != "1.0") {
+        return false;
+    }
+    song.clear();
+    for (const auto& e : j["events"]) {
+        Event evt;
+        evt.setSwitch(e["switch"]);
+        for (int pot = 0; pot < 4; ++pot) {
+            evt.setPot(pot, e["pots"][pot]);
+        }
+        song.setEvent(e["mode"], e["pattern"], e["track"], e["step"], evt);
+    }
+    song.compact();
+    return true;
+}
+
+template <typename Fn>
+double timeMs(Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; ++i) {
+        if (!fn()) {
+            std::cerr << "benchmark step failed" << std::endl;
+            std::exit(1);
+        }
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / ITERATIONS;
+}
+
+void report(const char* label, double ms, size_t events) {
+    std::printf("  %-16s %9.2f ms  %10.0f events/s\n", label, ms, events / (ms / 1000.0));
+}
+
+} // namespace
+
+int main() {
+    // Every step of every track on, varied pots
+    Song song;
+    size_t events = 0;
+    for (int m = 0; m < Song::NUM_MODES; ++m) {
+        for (int p = 0; p < Mode::NUM_PATTERNS; ++p) {
+            for (int t = 0; t < Pattern::NUM_TRACKS; ++t) {
+                for (int s = 0; s < Track::NUM_EVENTS; ++s) {
+                    Event evt;
+                    evt.setSwitch(true);
+                    evt.setPot(0, (m * 7 + s) & 127);
+                    evt.setPot(1, (p * 3 + t) & 127);
+                    evt.setPot(2, (s * 11) & 127);
+                    evt.setPot(3, (m + p + t + s) & 127);
+                    song.setEvent(m, p, t, s, evt);
+                    events++;
+                }
+            }
+        }
+    }
+
+    std::cout << "JSON song save/load, " << events << " events, mean of " << ITERATIONS << " runs" << std::endl;
+
+    Song loaded;
+    report("DOM save", timeMs([&] { return domSave(song, SONG_PATH); }), events);
+    report("streaming save", timeMs([&] { return song.save(SONG_PATH, "Bench", 120); }), events);
+    report("DOM load", timeMs([&] { return domLoad(loaded, SONG_PATH); }), events);
+    report("streaming load", timeMs([&] { return loaded.load(SONG_PATH); }), events);
+
+    std::remove(SONG_PATH);
+    return 0;
+}
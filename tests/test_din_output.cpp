@@ -0,0 +1,337 @@
+/**
+ * Unit tests for DinMidiOutput
+ *
+ * Runs the DIN output stage against a virtual UART on a virtual clock:
+ * - Running status
+ * - Real-time messages jumping the queue
+ * - Priority order within a burst
+ * - Wire time, backlog and deadline misses for a full downbeat
+ */
+
+#include "../src/hardware/din_output.h"
+#include "../src/hardware/midi_scheduler.h"
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <algorithm>
+
+// Simple test framework
+int test_count = 0;
+int pass_count = 0;
+int fail_count = 0;
+
+#define TEST(name) \
+    void test_##name(); \
+    void run_test_##name() { \
+        std::cout << "Running test: " << #name << "... "; \
+        try { \
+            test_##name(); \
+            std::cout << "PASS" << std::endl; \
+            pass_count++; \
+        } catch (const std::exception& e) { \
+            std::cout << "FAIL: " << e.what() << std::endl; \
+            fail_count++; \
+        } \
+        test_count++; \
+    } \
+    void test_##name()
+
+#define ASSERT_EQ(a, b) \
+    if ((a) != (b)) { \
+        throw std::runtime_error(std::string("Expected ") + #a + " == " + #b + \
+                                 ", got " + std::to_string(a) + " != " + std::to_string(b)); \
+    }
+
+#define ASSERT_TRUE(expr) \
+    if (!(expr)) { \
+        throw std::runtime_error(std::string("Expected ") + #expr + " to be true"); \
+    }
+
+#define ASSERT_FALSE(expr) \
+    if ((expr)) { \
+        throw std::runtime_error(std::string("Expected ") + #expr + " to be false"); \
+    }
+
+using namespace gruvbok;
+
+// ============================================================================
+// Virtual UART: a transmit FIFO shifting out 320 us per byte on a virtual clock
+// ============================================================================
+
+class VirtualUart : public MidiUart {
+public:
+    struct WireByte {
+        uint8_t value;
+        uint32_t start_us;  // When it starts shifting out
+    };
+
+    explicit VirtualUart(size_t fifo_size) : fifo_size_(fifo_size), now_us_(0), overflows_(0) {}
+
+    void setTime(uint32_t us) { now_us_ = us; }
+
+    size_t availableForWrite() override {
+        return fifo_size_ - waiting();
+    }
+
+    void write(uint8_t byte) override {
+        if (waiting() >= fifo_size_) {
+            overflows_++;  // A real UART write would have blocked
+        }
+        uint32_t start = wire_.empty() ? now_us_ : std::max(now_us_, wire_.back().start_us + DinMidiOutput::BYTE_US);
+        wire_.push_back({byte, start});
+    }
+
+    const std::vector<WireByte>& getWire() const { return wire_; }
+    std::vector<uint8_t> getBytes() const {
+        std::vector<uint8_t> bytes;
+        for (const auto& b : wire_) {
+            bytes.push_back(b.value);
+        }
+        return bytes;
+    }
+    int getOverflows() const { return overflows_; }
+
+private:
+    // Bytes written that haven't started shifting out yet
+    size_t waiting() const {
+        return static_cast<size_t>(std::count_if(wire_.begin(), wire_.end(),
+                                                 [this](const WireByte& b) { return b.start_us > now_us_; }));
+    }
+
+    size_t fifo_size_;
+    uint32_t now_us_;
+    int overflows_;
+    std::vector<WireByte> wire_;
+};
+
+// Hardware backend on a virtual microsecond clock, with the DIN stage as its MIDI output
+class VirtualDinHardware : public HardwareInterface {
+public:
+    explicit VirtualDinHardware(size_t fifo_size) : uart_(fifo_size), din_(&uart_), now_us_(0) {}
+
+    bool init() override { return true; }
+    void shutdown() override {}
+    bool readButton(int button) override { (void)button; return false; }
+    uint8_t readRotaryPot(int pot) override { (void)pot; return 0; }
+    uint8_t readSliderPot(int pot) override { (void)pot; return 0; }
+
+    void sendMidiMessage(const MidiMessage& msg) override { din_.send(&msg, 1, now_us_); }
+    void sendMidiBatch(const MidiMessage* messages, size_t count) override { din_.send(messages, count, now_us_); }
+
+    void setLED(bool on) override { (void)on; }
+    bool getLED() const override { return false; }
+    uint32_t getMillis() override { return now_us_ / 1000; }
+    uint32_t getMicros() override { return now_us_; }
+    void update() override { din_.service(now_us_); }
+
+    void setTime(uint32_t us) {
+        now_us_ = us;
+        uart_.setTime(us);
+    }
+
+    VirtualUart& uart() { return uart_; }
+    DinMidiOutput& din() { return din_; }
+
+private:
+    VirtualUart uart_;
+    DinMidiOutput din_;
+    uint32_t now_us_;
+};
+
+MidiMessage message(std::vector<uint8_t> data) {
+    return MidiMessage(data, 0);
+}
+
+// ============================================================================
+// Encoding
+// ============================================================================
+
+TEST(din_running_status_omits_repeated_status) {
+    VirtualUart uart(64);
+    DinMidiOutput din(&uart);
+
+    std::vector<MidiMessage> chord = {
+        message({0x90, 60, 100}), message({0x90, 64, 100}), message({0x90, 67, 100})
+    };
+    din.send(chord.data(), chord.size(), 0);
+    MidiMessage off = message({0x80, 60, 64});
+    din.send(&off, 1, 0);
+    MidiMessage cc = message({0xB0, 74, 10});
+    din.send(&cc, 1, 0);
+
+    // Note-off becomes a velocity-0 note-on under the same status
+    std::vector<uint8_t> expected = {0x90, 60, 100, 64, 100, 67, 100, 60, 0, 0xB0, 74, 10};
+    ASSERT_TRUE(uart.getBytes() == expected);
+    ASSERT_EQ(din.getStats().messages, 5u);
+    ASSERT_EQ(din.getStats().bytes, 12u);
+    ASSERT_EQ(din.getStats().bytes_saved, 3u);
+}
+
+TEST(din_status_repeated_after_idle) {
+    VirtualUart uart(64);
+    DinMidiOutput din(&uart);
+
+    MidiMessage note = message({0x90, 60, 100});
+    din.send(&note, 1, 0);
+    din.send(&note, 1, 1000);
+    din.send(&note, 1, 2 * DinMidiOutput::STATUS_REFRESH_US);
+
+    std::vector<uint8_t> expected = {0x90, 60, 100, 60, 100, 0x90, 60, 100};
+    ASSERT_TRUE(uart.getBytes() == expected);
+}
+
+TEST(din_realtime_jumps_queue_and_keeps_running_status) {
+    VirtualUart uart(1);
+    DinMidiOutput din(&uart);
+
+    // A one-byte FIFO (plus the byte shifting out): the clock goes out inside the first note
+    MidiMessage note = message({0x90, 60, 100});
+    din.send(&note, 1, 0);
+    MidiMessage clock = message({0xF8});
+    din.send(&clock, 1, 0);
+    din.send(&note, 1, 0);
+
+    for (uint32_t t = 0; !din.isIdle(); t += DinMidiOutput::BYTE_US) {
+        uart.setTime(t);
+        din.service(t);
+    }
+
+    std::vector<uint8_t> expected = {0x90, 60, 0xF8, 100, 60, 100};
+    ASSERT_TRUE(uart.getBytes() == expected);
+    ASSERT_EQ(uart.getOverflows(), 0);
+}
+
+// ============================================================================
+// Priority
+// ============================================================================
+
+TEST(din_burst_priority_note_offs_then_drums) {
+    VirtualUart uart(64);
+    DinMidiOutput din(&uart);
+
+    std::vector<MidiMessage> burst = {
+        message({0x90, 60, 100}),  // Ch 1 note-on
+        message({0x99, 36, 100}),  // Drums
+        message({0x81, 50, 64}),   // Ch 2 note-off
+        message({0x99, 38, 100})   // Drums
+    };
+    din.send(burst.data(), burst.size(), 0);
+
+    std::vector<uint8_t> expected = {0x91, 50, 0, 0x99, 36, 100, 38, 100, 0x90, 60, 100};
+    ASSERT_TRUE(uart.getBytes() == expected);
+}
+
+TEST(din_note_off_stays_behind_its_note_on) {
+    VirtualUart uart(64);
+    DinMidiOutput din(&uart);
+
+    // A zero-length note: its note-off can't be moved ahead of it
+    std::vector<MidiMessage> burst = {
+        message({0x90, 60, 100}),
+        message({0x80, 60, 64}),
+        message({0x80, 62, 64})
+    };
+    din.send(burst.data(), burst.size(), 0);
+
+    std::vector<uint8_t> expected = {0x90, 62, 0, 60, 100, 60, 0};
+    ASSERT_TRUE(uart.getBytes() == expected);
+}
+
+// ============================================================================
+// Wire time and deadlines
+// ============================================================================
+
+TEST(din_downbeat_paced_with_deadline_misses) {
+    VirtualDinHardware hw(16);
+    MidiScheduler scheduler(&hw);
+
+    // A downbeat from 14 modes, one note each on its own channel: 42 bytes
+    for (uint8_t channel = 0; channel < 14; ++channel) {
+        scheduler.schedule(MidiScheduler::noteOn(36 + channel, 100, channel, 0));
+    }
+    scheduler.update();
+
+    DinMidiOutput& din = hw.din();
+    ASSERT_EQ(din.getBacklogUs(0), DinMidiOutput::wireTimeUs(42));
+    ASSERT_FALSE(din.isIdle());  // More than the FIFO holds
+
+    // Main loop on the virtual clock
+    uint32_t t = 0;
+    while (!din.isIdle()) {
+        t += 100;
+        hw.setTime(t);
+        hw.update();
+    }
+    ASSERT_EQ(hw.uart().getOverflows(), 0);
+
+    // Back to back on the wire, drums first
+    const auto& wire = hw.uart().getWire();
+    ASSERT_EQ(wire.size(), 42u);
+    ASSERT_EQ(wire[0].value, 0x99);
+    for (size_t i = 0; i < wire.size(); ++i) {
+        ASSERT_EQ(wire[i].start_us, i * DinMidiOutput::BYTE_US);
+    }
+    ASSERT_EQ(din.getBacklogUs(t), DinMidiOutput::wireTimeUs(42) > t ? DinMidiOutput::wireTimeUs(42) - t : 0u);
+
+    // Message k starts k * 960 us late; past 2 ms from the 4th on
+    ASSERT_EQ(din.getStats().messages, 14u);
+    ASSERT_EQ(din.getStats().deadline_misses, 11u);
+    ASSERT_EQ(din.getStats().max_late_us, 13u * 3 * DinMidiOutput::BYTE_US);
+}
+
+TEST(din_running_status_shortens_downbeat) {
+    VirtualDinHardware hw(16);
+    MidiScheduler scheduler(&hw);
+
+    // 14 drum hits on one channel: 1 status byte + 14 x 2 data bytes
+    for (uint8_t note = 0; note < 14; ++note) {
+        scheduler.schedule(MidiScheduler::noteOn(36 + note, 100, 9, 0));
+    }
+    scheduler.update();
+
+    ASSERT_EQ(hw.din().getBacklogUs(0), DinMidiOutput::wireTimeUs(29));
+    uint32_t t = 0;
+    while (!hw.din().isIdle()) {
+        t += 100;
+        hw.setTime(t);
+        hw.update();
+    }
+    ASSERT_EQ(hw.din().getStats().bytes, 29u);
+    ASSERT_EQ(hw.din().getStats().bytes_saved, 13u);
+    ASSERT_EQ(hw.din().getStats().deadline_misses, 11u);  // Message k starts at byte 1 + 2k: late from the 4th
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+int main() {
+    std::cout << "========================================" << std::endl;
+    std::cout << "GRUVBOK DinMidiOutput Tests" << std::endl;
+    std::cout << "========================================" << std::endl << std::endl;
+
+    // Encoding
+    run_test_din_running_status_omits_repeated_status();
+    run_test_din_status_repeated_after_idle();
+    run_test_din_realtime_jumps_queue_and_keeps_running_status();
+
+    // Priority
+    run_test_din_burst_priority_note_offs_then_drums();
+    run_test_din_note_off_stays_behind_its_note_on();
+
+    // Wire time and deadlines
+    run_test_din_downbeat_paced_with_deadline_misses();
+    run_test_din_running_status_shortens_downbeat();
+
+    // Summary
+    std::cout << std::endl;
+    std::cout << "========================================" << std::endl;
+    std::cout << "Test Summary" << std::endl;
+    std::cout << "========================================" << std::endl;
+    std::cout << "Total:  " << test_count << std::endl;
+    std::cout << "Passed: " << pass_count << std::endl;
+    std::cout << "Failed: " << fail_count << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    return (fail_count == 0) ? 0 : 1;
+}
@@ -7,13 +7,21 @@
  * - Step progression
  * - Mode/pattern/track switching
  * - LED patterns
+ * - External MIDI clock sync
  */
 
 #include "../src/core/engine.h"
 #include "../src/core/song.h"
+#include "../src/core/pattern_ops.h"
+#include "../src/core/spsc_queue.h"
 #include "../src/lua_bridge/mode_loader.h"
 #include <iostream>
 #include <cassert>
+#include <fstream>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
 
 // Simple test framework
 int test_count = 0;
@@ -60,14 +68,13 @@ using namespace gruvbok;
 
 class MockHardware : public HardwareInterface {
 public:
-    MockHardware() : current_time_(0), led_state_(false) {}
+    MockHardware() : current_time_(0), led_state_(false), buttons_{} {}
 
     bool init() override { return true; }
     void shutdown() override {}
 
     bool readButton(int button) override {
-        (void)button;
-        return false;
+        return button >= 0 && button < 16 && buttons_[button];
     }
 
     uint8_t readRotaryPot(int pot) override {
@@ -89,6 +96,10 @@ public:
         sent_messages_.push_back(msg);
     }
 
+    bool readMidiInput(MidiInputEvent& event) override {
+        return midi_input_.pop(event);
+    }
+
     void setLED(bool on) override {
         led_state_ = on;
         led_changes_.push_back(on);
@@ -129,11 +140,23 @@ public:
         led_changes_.clear();
     }
 
+    void setButton(int button, bool pressed) {
+        buttons_[button] = pressed;
+    }
+
+    // Queue incoming MIDI, as a driver callback would (one producer thread)
+    bool receiveMidi(uint8_t status, uint8_t data1, uint8_t data2, uint32_t timestamp_us = 0) {
+        MidiInputEvent event = {timestamp_us, 3, {status, data1, data2}};
+        return midi_input_.push(event);
+    }
+
 private:
     uint32_t current_time_;
     bool led_state_;
     std::vector<MidiMessage> sent_messages_;
     std::vector<bool> led_changes_;
+    bool buttons_[16];
+    SpscQueue<MidiInputEvent, 256> midi_input_;
 };
 
 // ============================================================================
@@ -384,6 +407,878 @@ TEST(engine_set_current_pot) {
     ASSERT_EQ(evt.getPot(3), 25);
 }
 
+// Velocities of all Note On messages sent so far
+static std::vector<int> noteOnVelocities(const MockHardware& hw) {
+    std::vector<int> velocities;
+    for (const auto& msg : hw.getSentMessages()) {
+        if (msg.data.size() == 3 && (msg.data[0] & 0xF0) == 0x90) {
+            velocities.push_back(msg.data[2]);
+        }
+    }
+    return velocities;
+}
+
+TEST(engine_deterministic_mode_replays_cached_bar) {
+    // Counts its own calls so a cache hit is visible in the output.
+    // (A real deterministic mode would never do this.)
+    const char* path = "/tmp/gruvbok_test_deterministic.lua";
+    std::ofstream(path) << R"(
+        DETERMINISTIC = true
+        local calls = 0
+        function init(context) end
+        function process_event(track, event)
+            if event.switch then
+                calls = calls + 1
+                note(60, calls, 0)
+            end
+        end
+    )";
+
+    Song song;
+    MockHardware hw;
+    ModeLoader mode_loader;
+    ASSERT_TRUE(mode_loader.loadMode(1, path, 120));
+    Engine engine(&song, &hw, &mode_loader);
+
+    song.getMode(1).getPattern(0).getEvent(0, 0).setSwitch(true);
+
+    engine.start();
+    auto playBar = [&]() {
+        for (int i = 0; i < 16; i++) {
+            hw.advanceTime(126);
+            engine.update();
+        }
+    };
+
+    playBar();
+    playBar();
+    playBar();
+    engine.update();  // Flush scheduler
+
+    // Lua ran once; later bars were replayed from cache
+    std::vector<int> velocities = noteOnVelocities(hw);
+    ASSERT_EQ(velocities.size(), 3);
+    ASSERT_EQ(velocities[0], 1);
+    ASSERT_EQ(velocities[1], 1);
+    ASSERT_EQ(velocities[2], 1);
+
+    // Editing the event invalidates the cached step
+    engine.setEventPot(1, 0, 0, 0, 0, 64);
+    hw.clearMessages();
+    playBar();
+    engine.update();
+
+    velocities = noteOnVelocities(hw);
+    ASSERT_EQ(velocities.size(), 1);
+    ASSERT_EQ(velocities[0], 2);
+}
+
+TEST(engine_drains_midi_input) {
+    Song song;
+    MockHardware hw;
+    ModeLoader mode_loader;
+    Engine engine(&song, &hw, &mode_loader);
+
+    for (int i = 0; i < 20; i++) {
+        hw.receiveMidi(0xB0, 1, static_cast<uint8_t>(i), 5000);  // CC sweep
+    }
+    engine.update();
+
+    const EngineSnapshot& snap = engine.readSnapshot();
+    ASSERT_EQ(snap.midi_input_count, 20u);
+
+    // Newest first: CC values 19, 18, ...
+    for (int i = 0; i < EngineSnapshot::MIDI_INPUT_HISTORY; i++) {
+        const MidiInputEvent& event = snap.midi_input[(snap.midi_input_count - 1 - i) % EngineSnapshot::MIDI_INPUT_HISTORY];
+        ASSERT_EQ(event.data[2], 19 - i);
+        ASSERT_EQ(event.timestamp_us, 5000u);
+    }
+
+    // Drained: nothing new on the next update
+    engine.update();
+    ASSERT_EQ(engine.readSnapshot().midi_input_count, 20u);
+}
+
+TEST(engine_midi_input_from_another_thread) {
+    Song song;
+    MockHardware hw;
+    ModeLoader mode_loader;
+    Engine engine(&song, &hw, &mode_loader);
+
+    // Clock flood from a "driver" thread while the engine keeps updating
+    const uint32_t total = 20000;
+    std::thread driver([&]() {
+        for (uint32_t i = 0; i < total; i++) {
+            while (!hw.receiveMidi(0xF8, 0, 0, i)) {
+                std::this_thread::yield();  // Ring full: wait for the engine to drain it
+            }
+        }
+    });
+
+    uint32_t last_timestamp = 0;
+    bool in_order = true;
+    while (engine.readSnapshot().midi_input_count < total) {
+        engine.update();
+        const EngineSnapshot& snap = engine.readSnapshot();
+        if (snap.midi_input_count > 0) {
+            const MidiInputEvent& newest = snap.midi_input[(snap.midi_input_count - 1) % EngineSnapshot::MIDI_INPUT_HISTORY];
+            in_order = in_order && newest.timestamp_us == snap.midi_input_count - 1 && newest.timestamp_us >= last_timestamp;
+            last_timestamp = newest.timestamp_us;
+        }
+    }
+    driver.join();
+
+    ASSERT_TRUE(in_order);
+    ASSERT_EQ(engine.readSnapshot().midi_input_count, total);
+}
+
+TEST(engine_plays_live_input_at_once) {
+    const char* path = "/tmp/gruvbok_test_live_input.lua";
+    std::ofstream(path) << R"(
+        function init(context) end
+        function process_event(track, event) end
+        function process_input(msg)
+            if msg.type == "note_on" then
+                note(msg.note, msg.velocity)
+                note(msg.note + 7, msg.velocity)
+                off(msg.note + 7, 100)
+            end
+        end
+    )";
+
+    Song song;
+    MockHardware hw;
+    ModeLoader mode_loader;
+    ASSERT_TRUE(mode_loader.loadMode(1, path, 120));
+    Engine engine(&song, &hw, &mode_loader);
+    engine.update();
+    hw.clearMessages();
+
+    // Stopped, between steps: played and sent in the update that drains it
+    hw.setTime(1000);
+    hw.receiveMidi(0x90, 60, 90, 999700);
+    hw.receiveMidi(0xF8, 0, 0, 999800);  // Not a channel message
+    engine.update();
+    const auto& sent = hw.getSentMessages();
+    ASSERT_EQ(sent.size(), 2u);
+    ASSERT_EQ(sent[0].data[0], 0x90);
+    ASSERT_EQ(sent[0].data[1], 60);
+    ASSERT_EQ(sent[1].data[1], 67);
+
+    const EngineSnapshot& snap = engine.readSnapshot();
+    ASSERT_EQ(snap.live_input_count, 1u);
+    ASSERT_EQ(snap.live_latency_count, 1u);
+    ASSERT_EQ(snap.live_latency_us, 300u);
+    ASSERT_EQ(snap.live_latency_max_us, 300u);
+    ASSERT_EQ(snap.mode_meters[1], 90);
+
+    // The delayed note-off goes out through the scheduler as usual
+    hw.advanceTime(100);
+    engine.update();
+    ASSERT_EQ(hw.getSentMessages().size(), 3u);
+    ASSERT_EQ(hw.getSentMessages()[2].data[0], 0x80);
+
+    // Only the selected mode plays input
+    engine.setMode(2);
+    hw.receiveMidi(0x90, 62, 90, 1100000);
+    engine.update();
+    ASSERT_EQ(hw.getSentMessages().size(), 3u);
+    ASSERT_EQ(engine.readSnapshot().live_input_count, 1u);
+}
+
+TEST(engine_live_note_off_follows_its_note_on) {
+    const char* path = "/tmp/gruvbok_test_live_held.lua";
+    std::ofstream(path) << R"(
+        function init(context) end
+        function process_event(track, event) end
+        function process_input(msg)
+            if msg.type == "note_on" then
+                note(msg.note, msg.velocity)
+            elseif msg.type == "note_off" then
+                off(msg.note)
+            end
+        end
+    )";
+
+    Song song;
+    MockHardware hw;
+    ModeLoader mode_loader;
+    ASSERT_TRUE(mode_loader.loadMode(1, path, 120));
+    ASSERT_TRUE(mode_loader.loadMode(2, path, 120));
+    Engine engine(&song, &hw, &mode_loader);
+    engine.update();
+    hw.clearMessages();
+
+    auto last = [&]() { return hw.getSentMessages().back(); };
+
+    // Key down in mode 1, up after switching to mode 2: mode 1 releases it
+    hw.receiveMidi(0x90, 60, 90);
+    engine.update();
+    ASSERT_EQ(last().data[0], 0x90);  // Mode 1: channel 1
+    engine.setMode(2);
+    hw.receiveMidi(0x80, 60, 0);
+    engine.update();
+    ASSERT_EQ(last().data[0], 0x80);
+    ASSERT_EQ(last().data[1], 60);
+
+    // A key still held on stop is released
+    hw.receiveMidi(0x90, 64, 90);
+    engine.update();
+    size_t before = hw.getSentMessages().size();
+    engine.stop();
+    bool released = false;
+    for (size_t i = before; i < hw.getSentMessages().size(); ++i) {
+        const auto& data = hw.getSentMessages()[i].data;
+        released = released || (data[0] == 0x80 && data[1] == 64);
+    }
+    ASSERT_TRUE(released);
+
+    // ... and before the modes reinitialize
+    hw.receiveMidi(0x90, 65, 90);
+    engine.update();
+    before = hw.getSentMessages().size();
+    engine.setTempo(120);
+    hw.advanceTime(1100);
+    engine.update();
+    released = false;
+    for (size_t i = before; i < hw.getSentMessages().size(); ++i) {
+        const auto& data = hw.getSentMessages()[i].data;
+        released = released || (data[0] == 0x80 && data[1] == 65);
+    }
+    ASSERT_TRUE(released);
+
+    // Released notes aren't released again
+    before = hw.getSentMessages().size();
+    engine.stop();
+    for (size_t i = before; i < hw.getSentMessages().size(); ++i) {
+        ASSERT_TRUE(hw.getSentMessages()[i].data[0] != 0x80);
+    }
+}
+
+TEST(engine_parallel_modes_match_serial_output) {
+    // Several PARALLEL_SAFE modes plus one ordinary mode between them, which
+    // splits the pool's batch
+    const char* safe_path = "/tmp/gruvbok_test_parallel_safe.lua";
+    std::ofstream(safe_path) << R"(
+        PARALLEL_SAFE = true
+        local calls = 0
+        function init(context) end
+        function process_event(track, event)
+            if event.switch then
+                calls = calls + 1
+                for i = 1, 200 do calls = (calls * 7 + i) % 127 end
+                note(36 + track, calls, 0)
+                cc(1, event.pots[1], 1)
+            end
+        end
+    )";
+    const char* plain_path = "/tmp/gruvbok_test_parallel_plain.lua";
+    std::ofstream(plain_path) << R"(
+        function init(context) end
+        function process_event(track, event)
+            if event.switch then note(72, 100, 0) end
+        end
+    )";
+
+    auto play = [&](int threads) {
+        Song song;
+        MockHardware hw;
+        ModeLoader mode_loader;
+        for (int mode = 1; mode <= 6; ++mode) {
+            mode_loader.loadMode(mode, mode == 3 ? plain_path : safe_path, 120);
+        }
+        Engine engine(&song, &hw, &mode_loader);
+        engine.setModeThreads(threads);
+        for (int mode = 1; mode <= 6; ++mode) {
+            for (int step = 0; step < 16; step += mode) {
+                Event& event = song.getMode(mode).getPattern(0).getEvent(mode % 8, step);
+                event.setSwitch(true);
+                event.setPot(0, static_cast<uint8_t>(step * 8));
+            }
+        }
+        engine.start();
+        for (int i = 0; i < 32; i++) {
+            hw.advanceTime(126);
+            engine.update();
+        }
+        engine.update();  // Flush scheduler
+        return hw.getSentMessages();
+    };
+
+    std::vector<MidiMessage> serial = play(0);
+    std::vector<MidiMessage> parallel = play(3);
+    ASSERT_TRUE(serial.size() > 100);
+    ASSERT_EQ(serial.size(), parallel.size());
+    for (size_t i = 0; i < serial.size(); ++i) {
+        ASSERT_TRUE(serial[i].data == parallel[i].data);
+        ASSERT_EQ(serial[i].timestamp_ms, parallel[i].timestamp_ms);
+    }
+}
+
+TEST(engine_publishes_snapshot) {
+    const char* path = "/tmp/gruvbok_test_snapshot.lua";
+    std::ofstream(path) << R"(
+        function init(context) end
+        function process_event(track, event)
+            if event.switch then note(64, 100, 0) end
+        end
+    )";
+
+    Song song;
+    MockHardware hw;
+    ModeLoader mode_loader;
+    ASSERT_TRUE(mode_loader.loadMode(1, path, 120));
+    Engine engine(&song, &hw, &mode_loader);
+    ASSERT_EQ(engine.readSnapshot().version, 0u);  // Nothing published yet
+
+    engine.setEvent(1, 0, 0, 0, Event(true, 5, 0, 0, 0));
+    engine.update();
+    const EngineSnapshot& stopped = engine.readSnapshot();
+    ASSERT_EQ(stopped.version, 1u);
+    ASSERT_FALSE(stopped.playing);
+    ASSERT_EQ(stopped.mode, 1);
+    ASSERT_EQ(stopped.tempo, 120);
+    ASSERT_TRUE(stopped.dirty);
+    ASSERT_TRUE(stopped.can_undo);
+    ASSERT_EQ(stopped.edit_events[0].getPot(0), 5);
+    ASSERT_EQ(stopped.activeNoteCount(), 0);
+
+    engine.start();
+    hw.advanceTime(126);
+    engine.update();  // Step 0 renders the note
+    engine.update();  // and the scheduler sends it
+    const EngineSnapshot& playing = engine.readSnapshot();
+    ASSERT_EQ(playing.version, 3u);
+    ASSERT_TRUE(playing.playing);
+    ASSERT_EQ(playing.step, 1);
+    ASSERT_EQ(playing.mode_meters[1], 100);
+    ASSERT_EQ(playing.mode_meters[2], 0);
+    ASSERT_EQ(playing.activeNoteCount(), 1);
+
+    // No new publish: the reader keeps the buffer it has
+    ASSERT_TRUE(&engine.readSnapshot() == &playing);
+}
+
+TEST(engine_skips_switch_off_events_when_manifest_says_so) {
+    // Counts every call it receives
+    const char* path = "/tmp/gruvbok_test_switch_off.lua";
+    std::ofstream(path) << R"(
+        SWITCH_OFF_EVENTS = false
+        local calls = 0
+        function init(context) end
+        function process_event(track, event)
+            calls = calls + 1
+            if event.switch then
+                note(60, calls, 0)
+            end
+        end
+    )";
+
+    Song song;
+    MockHardware hw;
+    ModeLoader mode_loader;
+    ASSERT_TRUE(mode_loader.loadMode(1, path, 120));
+    Engine engine(&song, &hw, &mode_loader);
+
+    song.getMode(1).getPattern(0).getEvent(0, 0).setSwitch(true);
+
+    engine.start();
+    for (int i = 0; i < 32; i++) {
+        hw.advanceTime(126);
+        engine.update();
+    }
+    engine.update();  // Flush scheduler
+
+    // Only the one switch-on event reached Lua each bar
+    std::vector<int> velocities = noteOnVelocities(hw);
+    ASSERT_EQ(velocities.size(), 2);
+    ASSERT_EQ(velocities[0], 1);
+    ASSERT_EQ(velocities[1], 2);
+}
+
+TEST(engine_set_event) {
+    Song song;
+    MockHardware hw;
+    ModeLoader mode_loader;
+    Engine engine(&song, &hw, &mode_loader);
+
+    engine.setEvent(2, 3, 4, 5, Event(true, 10, 20, 30, 40));
+    ASSERT_TRUE(engine.isDirty());
+
+    const Event& evt = song.getMode(2).getPattern(3).getEvent(4, 5);
+    ASSERT_TRUE(evt.getSwitch());
+    ASSERT_EQ(evt.getPot(3), 40);
+
+    // Writing an identical event is not an edit
+    engine.clearDirty();
+    engine.setEvent(2, 3, 4, 5, Event(true, 10, 20, 30, 40));
+    ASSERT_FALSE(engine.isDirty());
+}
+
+TEST(engine_undo_redo) {
+    Song song;
+    MockHardware hw;
+    ModeLoader mode_loader;
+    Engine engine(&song, &hw, &mode_loader);
+    const Event& evt = song.getMode(2).getPattern(3).getEvent(4, 5);
+    ASSERT_FALSE(engine.canUndo());
+
+    engine.setEvent(2, 3, 4, 5, Event(true, 10, 0, 0, 0));
+    engine.setEvent(2, 3, 4, 5, Event(true, 20, 0, 0, 0));
+
+    // A transaction (a held button: toggle, then pots moving) undoes as one step
+    engine.beginEdit();
+    engine.setEvent(2, 3, 4, 5, Event(false, 20, 0, 0, 0));
+    engine.setEvent(2, 3, 4, 6, Event(true, 1, 2, 3, 4));
+    engine.setEvent(2, 3, 4, 6, Event(true, 5, 6, 7, 8));
+    engine.endEdit();
+
+    ASSERT_TRUE(engine.undo());
+    ASSERT_TRUE(evt.getSwitch());
+    ASSERT_EQ(evt.getPot(0), 20);
+    ASSERT_FALSE(song.getMode(2).getPattern(3).getEvent(4, 6).getSwitch());
+    ASSERT_TRUE(engine.undo());
+    ASSERT_EQ(evt.getPot(0), 10);
+    ASSERT_TRUE(engine.undo());
+    ASSERT_FALSE(evt.getSwitch());
+    ASSERT_FALSE(engine.undo());
+
+    engine.clearDirty();
+    ASSERT_TRUE(engine.redo());
+    ASSERT_TRUE(engine.redo());
+    ASSERT_TRUE(engine.redo());
+    ASSERT_FALSE(engine.redo());
+    ASSERT_FALSE(evt.getSwitch());
+    ASSERT_EQ(song.getMode(2).getPattern(3).getEvent(4, 6).getPot(3), 8);
+    ASSERT_TRUE(engine.isPatternDirty(2, 3));  // Undo/redo are edits like any other
+
+    // A new edit after undoing drops the redo branch
+    engine.undo();
+    engine.setEvent(9, 0, 0, 0, Event(true, 1, 1, 1, 1));
+    ASSERT_FALSE(engine.canRedo());
+
+    // A button held over many scans is one press: one toggle, one undo step
+    const Event& step = song.getMode(1).getPattern(0).getEvent(0, 7);
+    hw.setButton(7, true);
+    for (int scan = 0; scan < 4; ++scan) {
+        engine.update();
+    }
+    ASSERT_TRUE(step.getSwitch());
+    hw.setButton(7, false);
+    engine.update();
+    ASSERT_TRUE(step.getSwitch());
+
+    ASSERT_TRUE(engine.undo());
+    ASSERT_FALSE(step.getSwitch());
+    ASSERT_TRUE(song.getMode(9).getPattern(0).getEvent(0, 0).getSwitch());  // The edit before it stays
+    ASSERT_TRUE(engine.undo());
+    ASSERT_FALSE(song.getMode(9).getPattern(0).getEvent(0, 0).getSwitch());
+}
+
+TEST(engine_undo_chord_with_b16_pressed_first) {
+    Song song;
+    MockHardware hw;
+    ModeLoader mode_loader;
+    Engine engine(&song, &hw, &mode_loader);
+    const Pattern& pattern = song.getMode(1).getPattern(0);
+
+    // A real edit: tap B3
+    hw.setButton(2, true);
+    engine.update();
+    hw.setButton(2, false);
+    engine.update();
+    ASSERT_TRUE(pattern.getEvent(0, 2).getSwitch());
+
+    // B16 lands two scans before B1, and comes up before it
+    hw.setButton(15, true);
+    engine.update();
+    engine.update();
+    hw.setButton(0, true);
+    engine.update();
+    engine.update();
+    hw.setButton(15, false);
+    engine.update();
+    hw.setButton(0, false);
+    engine.update();
+
+    // The chord undid the tap on B3 and edited nothing itself
+    ASSERT_FALSE(pattern.getEvent(0, 2).getSwitch());
+    ASSERT_FALSE(pattern.getEvent(0, 15).getSwitch());
+    ASSERT_FALSE(pattern.getEvent(0, 0).getSwitch());
+    ASSERT_FALSE(engine.canUndo());
+    ASSERT_TRUE(engine.canRedo());
+
+    // Alone, B16 toggles step 16 once, when released
+    hw.setButton(15, true);
+    engine.update();
+    engine.update();
+    ASSERT_FALSE(pattern.getEvent(0, 15).getSwitch());
+    hw.setButton(15, false);
+    engine.update();
+    engine.update();
+    ASSERT_TRUE(pattern.getEvent(0, 15).getSwitch());
+}
+
+TEST(engine_undo_pattern_transform) {
+    Song song;
+    MockHardware hw;
+    ModeLoader mode_loader;
+    Engine engine(&song, &hw, &mode_loader);
+    song.getMode(6).getPattern(1).getEvent(0, 0).setSwitch(true);
+    song.getMode(6).getPattern(2).getEvent(1, 3).setPot(2, 50);
+
+    PatternOps::rotate(engine.editPattern(6, 1)->getTrack(0), 1);
+    engine.beginEdit();
+    PatternOps::swap(*engine.editPattern(6, 1), *engine.editPattern(6, 2));
+    engine.endEdit();
+    ASSERT_EQ(song.getMode(6).getPattern(1).getEvent(1, 3).getPot(2), 50);
+    ASSERT_TRUE(song.getMode(6).getPattern(2).getEvent(0, 1).getSwitch());
+
+    ASSERT_TRUE(engine.undo());  // Both sides of the swap
+    ASSERT_EQ(song.getMode(6).getPattern(2).getEvent(1, 3).getPot(2), 50);
+    ASSERT_TRUE(song.getMode(6).getPattern(1).getEvent(0, 1).getSwitch());
+    ASSERT_EQ(song.getMode(6).getSwitchMask(1, 0), 0x0002);
+    ASSERT_TRUE(engine.undo());
+    ASSERT_TRUE(song.getMode(6).getPattern(1).getEvent(0, 0).getSwitch());
+    ASSERT_FALSE(engine.canUndo());
+}
+
+TEST(engine_undo_history_is_bounded) {
+    Song song;
+    MockHardware hw;
+    ModeLoader mode_loader;
+    Engine engine(&song, &hw, &mode_loader);
+
+    // Only the newest CAPACITY edits are kept
+    const int edits = static_cast<int>(UndoHistory::CAPACITY) + 100;
+    for (int i = 0; i < edits; ++i) {
+        engine.setEvent(1 + i / 512, (i / 16) % 32, 0, i % 16, Event(true, 1, 0, 0, 0));
+    }
+    int undone = 0;
+    while (engine.undo()) undone++;
+    ASSERT_EQ(undone, static_cast<int>(UndoHistory::CAPACITY));
+    ASSERT_TRUE(song.getMode(1).getPattern(0).getEvent(0, 99 % 16).getSwitch());  // Dropped, stays edited
+    ASSERT_FALSE(song.getMode(1).getPattern(6).getEvent(0, 4).getSwitch());  // Edit 100, the oldest kept
+
+    // A transaction too big for the history can't be undone at all
+    engine.beginEdit();
+    for (int i = 0; i < edits; ++i) {
+        engine.setEvent(4 + i / 512, (i / 16) % 32, 1, i % 16, Event(true, 2, 0, 0, 0));
+    }
+    engine.endEdit();
+    ASSERT_FALSE(engine.canUndo());
+    ASSERT_FALSE(engine.canRedo());
+}
+
+TEST(engine_commands_from_other_threads) {
+    Song song;
+    MockHardware hw;
+    ModeLoader mode_loader;
+    Engine engine(&song, &hw, &mode_loader);
+
+    // Two producers, more commands than the queue holds; the engine drains in update()
+    const int per_thread = 300;
+    auto produce = [&engine](int mode) {
+        for (int i = 0; i < per_thread; ++i) {
+            EngineCommand command = EngineCommand::setEvent(mode, i / 16, 0, i % 16, Event(true, i % 128, 0, 0, 0));
+            while (!engine.postCommand(command)) {
+                std::this_thread::yield();
+            }
+        }
+    };
+    std::thread a(produce, 3);
+    std::thread b(produce, 4);
+    for (int i = 0; i < 100000 && engine.getCommandsRun() < 2u * per_thread; ++i) {
+        engine.update();
+        std::this_thread::yield();
+    }
+    a.join();
+    b.join();
+    ASSERT_EQ(engine.getCommandsRun(), 2u * per_thread);
+    ASSERT_EQ(song.getMode(3).getPattern(18).getEvent(0, 11).getPot(0), 299 % 128);
+    ASSERT_EQ(song.getMode(4).getPattern(0).getEvent(0, 5).getPot(0), 5);
+
+    // Results come back through a reply
+    CommandReply reply;
+    ASSERT_TRUE(engine.postCommand(EngineCommand::undo(), &reply));
+    ASSERT_FALSE(reply.isDone());
+    engine.update();
+    ASSERT_TRUE(reply.getStatus() == CommandReply::Status::DONE);
+    ASSERT_EQ(reply.getValue(), 1);
+
+    reply.reset();
+    engine.postCommand(EngineCommand::setEvent(15, 0, 0, 0, Event(true, 1, 1, 1, 1)), &reply);
+    engine.postCommand(EngineCommand::setTempo(123));
+    engine.update();
+    ASSERT_TRUE(reply.getStatus() == CommandReply::Status::REJECTED);
+    ASSERT_EQ(engine.getTempo(), 123);  // Within the mock R2 pot's hysteresis
+
+    // The controller rate cap is set by command and read back from the snapshot
+    ASSERT_EQ(engine.readSnapshot().controller_rate_limit, MidiScheduler::DEFAULT_EXTERNAL_RATE);
+    engine.postCommand(EngineCommand::setControllerRateLimit(MidiScheduler::Port::EXTERNAL, 50));
+    engine.update();
+    ASSERT_EQ(engine.getControllerRateLimit(MidiScheduler::Port::EXTERNAL), 50u);
+    ASSERT_EQ(engine.readSnapshot().controller_rate_limit, 50u);
+}
+
+static void waitForAutosave(Engine& engine) {
+    for (int i = 0; i < 1000 && engine.isAutosaving(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        engine.update();
+    }
+}
+
+static size_t fileSize(const std::string& filepath) {
+    std::ifstream file(filepath, std::ios::binary | std::ios::ate);
+    return file ? static_cast<size_t>(file.tellg()) : 0;
+}
+
+TEST(engine_autosave_in_background) {
+    Song song;
+    MockHardware hw;
+    ModeLoader mode_loader;
+    Engine engine(&song, &hw, &mode_loader);
+
+    const char* filepath = "/tmp/test_engine_autosave.bin";
+    std::remove(filepath);
+    engine.setAutosavePath(filepath);
+    engine.setEvent(3, 1, 2, 4, Event(true, 1, 2, 3, 4));
+
+    // The first edit needs a base file for its journal: saved right away
+    hw.advanceTime(300);
+    engine.update();
+    ASSERT_FALSE(engine.isDirty());  // Snapshot taken
+
+    // Edits during the save go into the next one, not this one
+    engine.setEvent(3, 1, 2, 4, Event(true, 9, 9, 9, 9));
+    ASSERT_TRUE(engine.isDirty());
+
+    waitForAutosave(engine);
+    ASSERT_FALSE(engine.isAutosaving());
+
+    Song loaded;
+    ASSERT_TRUE(loaded.loadBinary(filepath));
+    ASSERT_EQ(loaded.getMode(3).getPattern(1).getEvent(2, 4).getPot(0), 1);
+    ASSERT_TRUE(engine.isDirty());
+    ASSERT_TRUE(engine.isPatternDirty(3, 1));
+    ASSERT_FALSE(engine.isPatternDirty(3, 0));
+
+    // The next save only appends the changed pattern
+    size_t full_size = fileSize(filepath);
+    hw.advanceTime(20000);
+    engine.update();
+    waitForAutosave(engine);
+    ASSERT_TRUE(fileSize(filepath) - full_size < 32);
+    ASSERT_FALSE(engine.isDirty());
+
+    Song reloaded;
+    ASSERT_TRUE(reloaded.loadBinary(filepath));
+    ASSERT_EQ(reloaded.getMode(3).getPattern(1).getEvent(2, 4).getPot(0), 9);
+}
+
+TEST(engine_journal_recovery) {
+    const std::string filepath = "/tmp/test_engine_journal.bin";
+    const std::string journal_path = EditJournal::pathFor(filepath);
+    std::remove(filepath.c_str());
+    std::remove(journal_path.c_str());
+
+    {
+        Song song;
+        MockHardware hw;
+        ModeLoader mode_loader;
+        Engine engine(&song, &hw, &mode_loader);
+        engine.setAutosavePath(filepath);
+
+        engine.setEvent(2, 0, 0, 0, Event(true, 10, 0, 0, 0));
+        hw.advanceTime(300);
+        engine.update();  // Base save
+        waitForAutosave(engine);
+
+        // Edits after the save reach the journal within a flush interval,
+        // long before the next autosave
+        engine.setEvent(2, 0, 0, 0, Event(true, 20, 0, 0, 0));
+        engine.setEvent(5, 3, 7, 15, Event(true, 30, 0, 0, 0));
+        PatternOps::rotate(engine.editPattern(6, 1)->getTrack(0), 1);
+        hw.advanceTime(300);
+        engine.update();
+        for (int i = 0; i < 1000 && fileSize(journal_path) == 0; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        ASSERT_TRUE(fileSize(journal_path) > 0);
+        ASSERT_TRUE(fileSize(journal_path) < 64);
+        ASSERT_TRUE(engine.isDirty());  // Autosave still pending: "crash" now
+    }
+
+    Song song;
+    MockHardware hw;
+    ModeLoader mode_loader;
+    Engine engine(&song, &hw, &mode_loader);
+    engine.setAutosavePath(filepath);
+    CommandReply restored;
+    ASSERT_TRUE(engine.postCommand(EngineCommand::restoreAutosave(), &restored));
+    engine.update();
+    ASSERT_TRUE(restored.getStatus() == CommandReply::Status::DONE);
+    ASSERT_EQ(restored.getValue(), 1);
+    ASSERT_EQ(song.getMode(2).getPattern(0).getEvent(0, 0).getPot(0), 20);
+    ASSERT_EQ(song.getMode(5).getPattern(3).getEvent(7, 15).getPot(0), 30);
+
+    // A fresh save folds the journal in and empties it
+    engine.update();
+    waitForAutosave(engine);
+    ASSERT_EQ(fileSize(journal_path), 0u);
+    Song reloaded;
+    ASSERT_TRUE(reloaded.loadBinary(filepath));
+    ASSERT_EQ(reloaded.getMode(5).getPattern(3).getEvent(7, 15).getPot(0), 30);
+}
+
+TEST(engine_autosave_to_mapped_file) {
+    const char* filepath = "/tmp/test_engine_mapped.bin";
+    std::remove(filepath);
+    MappedSongFile file;
+    ASSERT_TRUE(file.open(filepath));
+
+    Song song;
+    MockHardware hw;
+    ModeLoader mode_loader;
+    Engine engine(&song, &hw, &mode_loader);
+    engine.setAutosaveFile(&file);
+
+    engine.setEvent(8, 4, 3, 2, Event(true, 70, 0, 0, 0));
+    hw.advanceTime(300);
+    engine.update();
+    waitForAutosave(engine);
+    ASSERT_EQ(file.getPattern(8, 4).getEvent(3, 2).getPot(0), 70);
+
+    // Later saves only touch the changed pattern's block
+    engine.setEvent(8, 4, 3, 2, Event(true, 71, 0, 0, 0));
+    hw.advanceTime(20000);
+    engine.update();
+    waitForAutosave(engine);
+    ASSERT_EQ(file.getPattern(8, 4).getEvent(3, 2).getPot(0), 71);
+
+    // Detaching waits for a save in progress to land in the file
+    engine.setEvent(8, 4, 3, 2, Event(true, 72, 0, 0, 0));
+    hw.advanceTime(20000);
+    engine.update();
+    ASSERT_TRUE(engine.isAutosaving());
+    engine.setAutosaveFile(nullptr);
+    ASSERT_FALSE(engine.isAutosaving());
+    ASSERT_EQ(file.getPattern(8, 4).getEvent(3, 2).getPot(0), 72);
+}
+
+// Until the front of the queue has loaded (or been swapped in, or dropped)
+static void waitForSongLoad(Engine& engine) {
+    for (int i = 0; i < 1000 && !engine.isNextSongReady() && engine.getQueuedSongCount() > 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        engine.update();
+    }
+}
+
+TEST(engine_song_swap_at_bar_boundary) {
+    // Tempos within the mock R2 pot's hysteresis, so handleInput() keeps them
+    const char* path_a = "/tmp/test_engine_song_a.json";
+    const char* path_b = "/tmp/test_engine_song_b.json";
+    Song a;
+    a.setEvent(1, 0, 0, 0, Event(true, 11, 0, 0, 0));
+    ASSERT_TRUE(a.save(path_a, "Song A", 123));
+    Song b;
+    b.setEvent(1, 0, 0, 0, Event(true, 22, 0, 0, 0));
+    ASSERT_TRUE(b.save(path_b, "Song B", 117));
+
+    Song song;
+    MockHardware hw;
+    ModeLoader mode_loader;
+    Engine engine(&song, &hw, &mode_loader);
+
+    // Stopped: swapped in as soon as it has loaded
+    engine.queueSong(path_a);
+    waitForSongLoad(engine);
+    ASSERT_EQ(engine.getSongChangeCount(), 1);
+    ASSERT_EQ(song[1][0][0][0].getPot(0), 11);
+    ASSERT_TRUE(engine.getSongName() == "Song A");
+    ASSERT_TRUE(std::string(engine.readSnapshot().song_name) == "Song A");
+    ASSERT_TRUE(std::string(engine.readSnapshot().song_path) == path_a);
+    ASSERT_EQ(engine.getTempo(), 123);
+    ASSERT_EQ(engine.getQueuedSongCount(), 0u);
+    ASSERT_TRUE(engine.isDirty());  // Autosave picks up the new song
+
+    // Playing: waits for the bar boundary, and for bars of the current song
+    engine.start();
+    engine.update();
+    engine.queueSong(path_b, 1);
+    engine.queueSong("/tmp/test_engine_no_such_song.json");
+    waitForSongLoad(engine);
+    ASSERT_TRUE(engine.isNextSongReady());
+
+    for (int step = 0; step < 16; ++step) {
+        hw.advanceTime(130);
+        engine.update();
+        ASSERT_EQ(song[1][0][0][0].getPot(0), 11);  // Bar 1 plays song A to the end
+    }
+    ASSERT_EQ(engine.getCurrentStep(), 0);
+    hw.advanceTime(130);
+    engine.update();
+    ASSERT_EQ(engine.getSongChangeCount(), 2);
+    ASSERT_EQ(song[1][0][0][0].getPot(0), 22);
+    ASSERT_EQ(engine.getCurrentStep(), 1);  // Step 0 of the new song has played
+    ASSERT_EQ(engine.getTempo(), 117);
+
+    // A file that doesn't load is dropped from the queue
+    waitForSongLoad(engine);
+    ASSERT_EQ(engine.getQueuedSongCount(), 0u);
+    ASSERT_EQ(engine.getSongLoadFailureCount(), 1);
+    ASSERT_EQ(engine.readSnapshot().song_load_failures, 1);
+    ASSERT_EQ(song[1][0][0][0].getPot(0), 22);
+
+    // Clearing the queue drops a loaded song
+    engine.queueSong(path_a, 4);
+    waitForSongLoad(engine);
+    engine.clearSongQueue();
+    for (int step = 0; step < 16 * 6; ++step) {
+        hw.advanceTime(130);
+        engine.update();
+    }
+    ASSERT_EQ(engine.getSongChangeCount(), 2);
+    ASSERT_EQ(song[1][0][0][0].getPot(0), 22);
+}
+
+TEST(engine_lua_pattern_transforms) {
+    // Edits another mode's patterns from Lua when its trigger plays
+    const char* path = "/tmp/gruvbok_test_pattern_ops.lua";
+    std::ofstream(path) << R"(
+        function init(context) end
+        function process_event(track, event)
+            if event.switch then
+                patterns.fill_pot(2, -1, -1, 1, 77, 1)
+                patterns.shift(2, 0, 3, 2)
+                patterns.copy(2, 0, 5)
+            end
+        end
+    )";
+
+    Song song;
+    MockHardware hw;
+    ModeLoader mode_loader;
+    ASSERT_TRUE(mode_loader.loadMode(1, path, 120));
+    Engine engine(&song, &hw, &mode_loader);
+
+    song.getMode(1).getPattern(0).getEvent(0, 0).setSwitch(true);
+    song.getMode(2).getPattern(0).getEvent(3, 0).setSwitch(true);
+
+    engine.start();
+    hw.advanceTime(126);
+    engine.update();
+
+    const Mode& target = song.getMode(2);
+    ASSERT_EQ(target.getPattern(31).getEvent(7, 0).getPot(0), 77);  // Step mask 1 = step 0 only
+    ASSERT_EQ(target.getPattern(31).getEvent(7, 1).getPot(0), 0);
+    ASSERT_TRUE(target.getPattern(0).getEvent(3, 2).getSwitch());
+    ASSERT_FALSE(target.getPattern(0).getEvent(3, 0).getSwitch());
+    ASSERT_TRUE(target.getPattern(5).getEvent(3, 2).getSwitch());
+    ASSERT_EQ(target.getSwitchMask(5, 3), 0x0004);
+    ASSERT_TRUE(engine.isDirty());
+}
+
 TEST(engine_midi_start_message) {
     Song song;
     MockHardware hw;
@@ -435,6 +1330,116 @@ TEST(engine_midi_clock_generation) {
     ASSERT_EQ(messages[0].data[0], 0xF8);  // MIDI Clock
 }
 
+// Master clock at `bpm` with up to +/-jitter_us of arrival jitter, fed while the
+// engine updates every millisecond; returns the times (ms) steps advanced at
+static std::vector<uint32_t> runExternalClock(MockHardware& hw, Engine& engine, int bpm, int ticks,
+                                              uint32_t jitter_us, uint32_t& seed) {
+    const double tick_us = 60000000.0 / (bpm * 24.0);
+    std::vector<uint32_t> step_times;
+    uint32_t start_ms = hw.getMillis();
+    int next_tick = 0;
+    int last_step = engine.getCurrentStep();
+    uint32_t end_ms = start_ms + static_cast<uint32_t>(ticks * tick_us / 1000.0);
+    while (hw.getMillis() < end_ms) {
+        hw.advanceTime(1);
+        uint32_t now_us = hw.getMicros();
+        while (true) {
+            seed = seed * 1103515245u + 12345u;
+            int32_t jitter = static_cast<int32_t>((seed >> 16) % (2 * jitter_us + 1)) - static_cast<int32_t>(jitter_us);
+            uint32_t arrival = start_ms * 1000 + static_cast<uint32_t>(next_tick * tick_us + jitter_us + jitter);
+            if (arrival > now_us) {
+                break;
+            }
+            hw.receiveMidi(0xF8, 0, 0, arrival);
+            next_tick++;
+        }
+        engine.update();
+        if (engine.getCurrentStep() != last_step) {
+            last_step = engine.getCurrentStep();
+            step_times.push_back(hw.getMillis());
+        }
+    }
+    return step_times;
+}
+
+TEST(engine_external_clock_locks_to_master) {
+    Song song;
+    MockHardware hw;
+    ModeLoader mode_loader;
+    Engine engine(&song, &hw, &mode_loader);
+    engine.setSyncMode(Engine::SyncMode::EXTERNAL);
+
+    // A beat of clock before Start, as most masters send it continuously
+    uint32_t seed = 1;
+    runExternalClock(hw, engine, 100, 24, 3000, seed);
+    ASSERT_FALSE(engine.isPlaying());
+
+    hw.receiveMidi(0xFA, 0, 0, hw.getMicros());
+    std::vector<uint32_t> steps = runExternalClock(hw, engine, 100, 16 * 6 * 2, 3000, seed);
+    ASSERT_TRUE(engine.isPlaying());
+
+    const EngineSnapshot& snap = engine.readSnapshot();
+    ASSERT_TRUE(snap.external_sync);
+    ASSERT_TRUE(snap.sync_locked);
+    ASSERT_TRUE(snap.sync_quality >= 50);
+    ASSERT_TRUE(std::fabs(snap.sync_tempo - 100.0f) < 0.5f);
+    ASSERT_EQ(engine.getTempo(), 100);  // Followed the master, not the tempo pot
+
+    // Two bars of steps, a 16th (150 ms) apart to within a couple of ms
+    // although single ticks arrive up to 3 ms early or late
+    ASSERT_TRUE(steps.size() >= 31 && steps.size() <= 32);
+    for (size_t i = 1; i < steps.size(); i++) {
+        int interval = static_cast<int>(steps[i] - steps[i - 1]);
+        ASSERT_TRUE(std::abs(interval - 150) <= 2);
+    }
+
+    // The clock is passed on
+    int clocks = 0;
+    for (const auto& msg : hw.getSentMessages()) {
+        if (msg.data[0] == 0xF8) clocks++;
+    }
+    ASSERT_TRUE(clocks >= 16 * 6 * 2 - 2 && clocks <= 16 * 6 * 2 + 1);
+}
+
+TEST(engine_external_transport) {
+    Song song;
+    MockHardware hw;
+    ModeLoader mode_loader;
+    Engine engine(&song, &hw, &mode_loader);
+
+    // Internal sync ignores the master's transport
+    uint32_t seed = 7;
+    hw.receiveMidi(0xFA, 0, 0, 0);
+    runExternalClock(hw, engine, 120, 24, 0, seed);
+    ASSERT_FALSE(engine.isPlaying());
+
+    engine.setSyncMode(Engine::SyncMode::EXTERNAL);
+    hw.receiveMidi(0xFA, 0, 0, hw.getMicros());
+    runExternalClock(hw, engine, 120, 6 * 3 - 3, 0, seed);  // Steps at ticks 0, 6 and 12
+    ASSERT_TRUE(engine.isPlaying());
+    ASSERT_EQ(engine.getCurrentStep(), 3);
+
+    hw.receiveMidi(0xFC, 0, 0, hw.getMicros());
+    engine.update();
+    ASSERT_FALSE(engine.isPlaying());
+
+    // Song Position 21 (16ths) = bar 1, step 5, then Continue
+    hw.clearMessages();
+    hw.receiveMidi(0xF2, 21, 0, hw.getMicros());
+    hw.receiveMidi(0xFB, 0, 0, hw.getMicros());
+    engine.update();
+    ASSERT_TRUE(engine.isPlaying());
+    ASSERT_EQ(engine.getCurrentStep(), 5);
+    ASSERT_EQ(hw.getSentMessages().back().data[0], 0xFB);  // Continue passed on
+
+    runExternalClock(hw, engine, 120, 3, 0, seed);  // Step 5 plays on the first clock
+    ASSERT_EQ(engine.getCurrentStep(), 6);
+
+    // Switching back stops playback and the pot sets the tempo again
+    engine.setSyncMode(Engine::SyncMode::INTERNAL);
+    ASSERT_FALSE(engine.isPlaying());
+}
+
 // ============================================================================
 // Main
 // ============================================================================
@@ -457,9 +1462,30 @@ int main() {
     run_test_engine_led_pattern_error();
     run_test_engine_edit_current_event();
     run_test_engine_set_current_pot();
+    run_test_engine_set_event();
+    run_test_engine_undo_redo();
+    run_test_engine_undo_chord_with_b16_pressed_first();
+    run_test_engine_undo_pattern_transform();
+    run_test_engine_undo_history_is_bounded();
+    run_test_engine_commands_from_other_threads();
+    run_test_engine_autosave_in_background();
+    run_test_engine_journal_recovery();
+    run_test_engine_autosave_to_mapped_file();
+    run_test_engine_song_swap_at_bar_boundary();
+    run_test_engine_skips_switch_off_events_when_manifest_says_so();
+    run_test_engine_publishes_snapshot();
+    run_test_engine_drains_midi_input();
+    run_test_engine_midi_input_from_another_thread();
+    run_test_engine_plays_live_input_at_once();
+    run_test_engine_live_note_off_follows_its_note_on();
+    run_test_engine_parallel_modes_match_serial_output();
+    run_test_engine_lua_pattern_transforms();
+    run_test_engine_deterministic_mode_replays_cached_bar();
     run_test_engine_midi_start_message();
     run_test_engine_midi_stop_message();
     run_test_engine_midi_clock_generation();
+    run_test_engine_external_clock_locks_to_master();
+    run_test_engine_external_transport();
 
     // Summary
     std::cout << std::endl;
@@ -189,6 +189,20 @@ TEST(event_copy) {
     ASSERT_EQ(evt2.getPot(3), 44);
 }
 
+TEST(event_constexpr) {
+    // Packing is usable at compile time
+    constexpr Event evt(true, 1, 2, 130, 127);
+    static_assert(evt.getSwitch(), "switch packed");
+    static_assert(evt.getPot(2) == 127, "pot clamped at compile time");
+    static_assert(evt.getPotUnchecked(1) == 2, "unchecked read");
+
+    Event copy = evt;
+    copy.setPotUnchecked(3, 5);
+    ASSERT_EQ(copy.getPot(3), 5);
+    ASSERT_EQ(copy.getPot(0), 1);
+    ASSERT_EQ(copy.getPot(4), 0);  // Checked read of a bad index
+}
+
 // ============================================================================
 // Main
 // ============================================================================
@@ -208,6 +222,7 @@ int main() {
     run_test_event_all_values_max();
     run_test_event_bit_packing_size();
     run_test_event_copy();
+    run_test_event_constexpr();
 
     // Summary
     std::cout << std::endl;
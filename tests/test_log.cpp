@@ -0,0 +1,193 @@
+/**
+ * Unit tests for the asynchronous logger
+ *
+ * Uses private Logger instances (not the global one) and flush() as the
+ * consumer, except for the threaded test.
+ */
+
+#include "../src/core/log.h"
+#include <iostream>
+#include <cassert>
+#include <thread>
+#include <vector>
+#include <string>
+
+// Simple test framework (same as test_event.cpp)
+int test_count = 0;
+int pass_count = 0;
+int fail_count = 0;
+
+#define TEST(name) \
+    void test_##name(); \
+    void run_test_##name() { \
+        std::cout << "Running test: " << #name << "... "; \
+        try { \
+            test_##name(); \
+            std::cout << "PASS" << std::endl; \
+            pass_count++; \
+        } catch (const std::exception& e) { \
+            std::cout << "FAIL: " << e.what() << std::endl; \
+            fail_count++; \
+        } \
+        test_count++; \
+    } \
+    void test_##name()
+
+#define ASSERT_EQ(a, b) \
+    if ((a) != (b)) { \
+        throw std::runtime_error(std::string("Expected ") + #a + " == " + #b + \
+                                 ", got " + std::to_string(a) + " != " + std::to_string(b)); \
+    }
+
+#define ASSERT_TRUE(expr) \
+    if (!(expr)) { \
+        throw std::runtime_error(std::string("Expected ") + #expr + " to be true"); \
+    }
+
+#define ASSERT_FALSE(expr) \
+    if ((expr)) { \
+        throw std::runtime_error(std::string("Expected ") + #expr + " to be false"); \
+    }
+
+using namespace gruvbok;
+
+// Collects formatted lines from a logger
+struct Capture {
+    std::vector<std::string> lines;
+    void attach(Logger& logger) {
+        logger.addSink([this](const LogRecord&, const char* line) { lines.push_back(line); });
+    }
+};
+
+TEST(formats_arguments_when_flushed) {
+    Logger logger;
+    Capture capture;
+    capture.attach(logger);
+
+    std::string path = "songs/demo.json";
+    logger.write(LogCategory::ENGINE, LogLevel::INFO, "Mode 0 step: %d -> %d", 3, 4);
+    logger.write(LogCategory::SONG, LogLevel::ERROR, "Failed to load %s (%u bytes)", path, 1234u);
+    logger.write(LogCategory::AUDIO, LogLevel::WARN, "Gain %.2f, id %d, %s", 0.5f, -1, "done");
+    logger.write(LogCategory::MIDI, LogLevel::INFO, "100%% and %x", static_cast<uint8_t>(0xF8));
+    ASSERT_EQ(capture.lines.size(), 0);  // Nothing formatted until a consumer runs
+
+    ASSERT_EQ(logger.flush(), 4);
+    ASSERT_EQ(capture.lines.size(), 4);
+    ASSERT_TRUE(capture.lines[0] == "[Engine] Mode 0 step: 3 -> 4");
+    ASSERT_TRUE(capture.lines[1] == "[Song] Error: Failed to load songs/demo.json (1234 bytes)");
+    ASSERT_TRUE(capture.lines[2] == "[Audio] Warning: Gain 0.50, id -1, done");
+    ASSERT_TRUE(capture.lines[3] == "[MIDI] 100% and f8");
+}
+
+TEST(long_text_is_truncated) {
+    Logger logger;
+    Capture capture;
+    capture.attach(logger);
+
+    std::string long_text(500, 'x');
+    logger.write(LogCategory::LUA, LogLevel::INFO, "%s|%s|%d", long_text, "second", 7);
+    logger.flush();
+
+    ASSERT_EQ(capture.lines.size(), 1);
+    const std::string& line = capture.lines[0];
+    ASSERT_TRUE(line.size() < 200);
+    ASSERT_TRUE(line.find("|") != std::string::npos);
+    ASSERT_TRUE(line.substr(line.size() - 2) == "|7");  // Later arguments survive
+}
+
+TEST(levels_filter_per_category) {
+    Logger logger;
+    Capture capture;
+    capture.attach(logger);
+
+    logger.write(LogCategory::ENGINE, LogLevel::DEBUG, "hidden");  // Default level INFO
+    ASSERT_TRUE(logger.configure("engine=debug,lua=error"));
+    logger.write(LogCategory::ENGINE, LogLevel::DEBUG, "engine debug");
+    logger.write(LogCategory::LUA, LogLevel::WARN, "lua warn");
+    logger.write(LogCategory::LUA, LogLevel::ERROR, "lua error");
+    logger.flush();
+
+    ASSERT_EQ(capture.lines.size(), 2);
+    ASSERT_TRUE(capture.lines[0] == "[Engine] engine debug");
+    ASSERT_TRUE(capture.lines[1] == "[Lua] Error: lua error");
+
+    ASSERT_TRUE(logger.configure("ALL=off"));
+    ASSERT_TRUE(logger.getLevel(LogCategory::AUDIO) == LogLevel::OFF);
+    ASSERT_FALSE(logger.configure("nosuch=debug"));
+    ASSERT_FALSE(logger.configure("engine=loud"));
+}
+
+TEST(full_queue_drops_and_reports) {
+    Logger logger;
+    Capture capture;
+    capture.attach(logger);
+
+    for (size_t i = 0; i < Logger::QUEUE_SIZE + 10; i++) {
+        logger.write(LogCategory::ENGINE, LogLevel::INFO, "record %u", static_cast<unsigned int>(i));
+    }
+    ASSERT_EQ(logger.getDropped(), 10);
+
+    ASSERT_EQ(logger.flush(5), 5);  // Bounded flush
+    ASSERT_EQ(logger.flush(), Logger::QUEUE_SIZE - 5);
+
+    // The loss is reported once, by the first flush after it
+    ASSERT_EQ(capture.lines.size(), Logger::QUEUE_SIZE + 1);
+    ASSERT_TRUE(capture.lines[5] == "[Engine] Warning: 10 log record(s) dropped: queue full");
+}
+
+TEST(threads_log_while_consumer_runs) {
+    Logger logger;
+    std::vector<std::string> lines;
+    logger.addSink([&lines](const LogRecord&, const char* line) { lines.push_back(line); });
+    logger.startThread();
+
+    const int per_thread = 2000;
+    std::vector<std::thread> producers;
+    for (int t = 0; t < 3; t++) {
+        producers.emplace_back([&logger, t]() {
+            for (int i = 0; i < per_thread; i++) {
+                logger.write(LogCategory::LUA, LogLevel::INFO, "thread %d line %d", t, i);
+                if (i % 64 == 0) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            }
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    logger.stopThread();  // Flushes what's left
+
+    // Every record either arrived or was counted as dropped
+    size_t records = 0;
+    for (const std::string& line : lines) {
+        if (line.find("dropped") == std::string::npos) {
+            records++;
+        }
+    }
+    ASSERT_EQ(records + logger.getDropped(), 3 * per_thread);
+}
+
+int main() {
+    std::cout << "========================================" << std::endl;
+    std::cout << "GRUVBOK Logger Tests" << std::endl;
+    std::cout << "========================================" << std::endl << std::endl;
+
+    run_test_formats_arguments_when_flushed();
+    run_test_long_text_is_truncated();
+    run_test_levels_filter_per_category();
+    run_test_full_queue_drops_and_reports();
+    run_test_threads_log_while_consumer_runs();
+
+    // Summary
+    std::cout << std::endl;
+    std::cout << "========================================" << std::endl;
+    std::cout << "Test Summary" << std::endl;
+    std::cout << "========================================" << std::endl;
+    std::cout << "Total:  " << test_count << std::endl;
+    std::cout << "Passed: " << pass_count << std::endl;
+    std::cout << "Failed: " << fail_count << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    return (fail_count == 0) ? 0 : 1;
+}
@@ -12,9 +12,12 @@
 #include "../src/lua_bridge/lua_context.h"
 #include "../src/lua_bridge/lua_api.h"
 #include "../src/core/event.h"
+#include "../src/core/log.h"
 #include <iostream>
 #include <cassert>
 #include <fstream>
+#include <string>
+#include <vector>
 
 using namespace gruvbok;
 
@@ -419,6 +422,335 @@ TEST(generate_all_notes_off) {
     ASSERT_EQ(midi_events[0].data[2], 0);
 }
 
+// ============================================================================
+// Mode Manifest Tests
+// ============================================================================
+
+TEST(manifest_defaults) {
+    std::string script = createTempLuaScript(R"(
+        function init(context)
+        end
+
+        function process_event(track, event)
+        end
+    )");
+
+    LuaContext ctx;
+    ASSERT_TRUE(ctx.loadScript(script));
+
+    const ModeManifest& manifest = ctx.getManifest();
+    ASSERT_EQ(manifest.name, std::string("Unnamed"));
+    ASSERT_EQ(manifest.slider_labels[0], std::string("S1"));
+    ASSERT_TRUE(manifest.wants_switch_off);
+    ASSERT_FALSE(manifest.deterministic);
+    ASSERT_FALSE(manifest.has_step_hook);
+    ASSERT_FALSE(manifest.has_background);
+    ASSERT_EQ(manifest.memory_budget_kb, 0);
+}
+
+TEST(manifest_parsed_once_at_load) {
+    std::string script = createTempLuaScript(R"(
+        MODE_NAME = "Test Mode"
+        SLIDER_LABELS = {"A", "B", "C", "D"}
+        SWITCH_OFF_EVENTS = false
+        DETERMINISTIC = true
+        MEMORY_BUDGET_KB = 256
+
+        function init(context)
+            MODE_NAME = "Changed"  -- Runtime changes don't affect the manifest
+        end
+
+        function process_step(step, events)
+        end
+    )");
+
+    LuaContext ctx;
+    ASSERT_TRUE(ctx.loadScript(script));
+    LuaInitContext init_ctx = {120, 0, 0, 0, 0, 0};
+    ASSERT_TRUE(ctx.callInit(init_ctx));
+
+    const ModeManifest& manifest = ctx.getManifest();
+    ASSERT_EQ(ctx.getModeName(), std::string("Test Mode"));
+    ASSERT_EQ(ctx.getSliderLabels()[3], std::string("D"));
+    ASSERT_FALSE(manifest.wants_switch_off);
+    ASSERT_TRUE(manifest.deterministic);
+    ASSERT_TRUE(manifest.has_step_hook);
+    ASSERT_EQ(manifest.memory_budget_kb, 256);
+}
+
+TEST(process_step_receives_all_tracks) {
+    std::string script = createTempLuaScript(R"(
+        function init(context)
+        end
+
+        function process_step(step, events)
+            for track = 0, 7 do
+                if events[track + 1].switch then
+                    note(step * 8 + track, events[track + 1].pots[1])
+                end
+            end
+        end
+    )");
+
+    LuaContext ctx;
+    ctx.setChannel(0);
+    ASSERT_TRUE(ctx.loadScript(script));
+
+    Event events[8];
+    events[2].setSwitch(true);
+    events[2].setPot(0, 90);
+    events[7].setSwitch(true);
+    events[7].setPot(0, 70);
+
+    auto midi_events = ctx.callProcessStep(3, events, 8);
+    ASSERT_EQ(midi_events.size(), 2);
+    ASSERT_EQ(midi_events[0].data[1], 26);  // 3 * 8 + 2
+    ASSERT_EQ(midi_events[0].data[2], 90);
+    ASSERT_EQ(midi_events[1].data[1], 31);  // 3 * 8 + 7
+}
+
+TEST(process_input_receives_message) {
+    std::string script = createTempLuaScript(R"(
+        function init(context)
+        end
+
+        function process_event(track, event)
+        end
+
+        function process_input(msg)
+            if msg.type == "note_on" then
+                note(msg.note + 12, msg.velocity)
+            elseif msg.type == "note_off" then
+                off(msg.note + 12)
+            elseif msg.type == "pitch_bend" then
+                cc(1, msg.value < 0 and 0 or 127)
+            elseif msg.type == "cc" then
+                cc(msg.controller, msg.value)
+            end
+        end
+    )");
+
+    LuaContext ctx;
+    ctx.setChannel(2);
+    ASSERT_TRUE(ctx.loadScript(script));
+    ASSERT_TRUE(ctx.getManifest().has_input_hook);
+
+    MidiInputEvent note_on = {0, 3, {0x95, 60, 100}};  // Input channel doesn't matter
+    auto midi_events = ctx.callProcessInput(note_on);
+    ASSERT_EQ(midi_events.size(), 1);
+    ASSERT_EQ(midi_events[0].data[0], 0x92);
+    ASSERT_EQ(midi_events[0].data[1], 72);
+    ASSERT_EQ(midi_events[0].data[2], 100);
+    ASSERT_EQ(midi_events[0].delta_ms, 0);
+
+    MidiInputEvent released = {0, 3, {0x90, 60, 0}};  // Velocity 0 = note off
+    midi_events = ctx.callProcessInput(released);
+    ASSERT_EQ(midi_events.size(), 1);
+    ASSERT_EQ(midi_events[0].data[0], 0x82);
+
+    MidiInputEvent bend = {0, 3, {0xE0, 0, 0x20}};  // Below center
+    midi_events = ctx.callProcessInput(bend);
+    ASSERT_EQ(midi_events.size(), 1);
+    ASSERT_EQ(midi_events[0].data[2], 0);
+
+    MidiInputEvent control = {0, 3, {0xB0, 74, 33}};
+    midi_events = ctx.callProcessInput(control);
+    ASSERT_EQ(midi_events.size(), 1);
+    ASSERT_EQ(midi_events[0].data[1], 74);
+    ASSERT_EQ(midi_events[0].data[2], 33);
+}
+
+TEST(memory_budget_enforced) {
+    std::string script = createTempLuaScript(R"(
+        MEMORY_BUDGET_KB = 128
+        local hog = {}
+
+        function init(context)
+        end
+
+        function process_event(track, event)
+            for i = 1, 100000 do
+                hog[i] = {i}
+            end
+            note(60, 100)
+        end
+    )");
+
+    LuaContext ctx;
+    ctx.setChannel(0);
+    ASSERT_TRUE(ctx.loadScript(script));
+
+    // Allocation fails inside process_event(); the error is caught and no output is produced
+    Event evt;
+    ASSERT_EQ(ctx.callProcessEvent(0, evt).size(), 0);
+    ASSERT_TRUE(ctx.getMemoryUsage() <= 128 * 1024);
+    ASSERT_TRUE(ctx.isValid());
+}
+
+// ============================================================================
+// Background Coroutine Tests
+// ============================================================================
+
+TEST(background_runs_in_slices) {
+    std::string script = createTempLuaScript(R"(
+        function init(context)
+        end
+
+        function background()
+            local sum = 0
+            for i = 1, 20000 do
+                sum = sum + 1
+            end
+            return sum
+        end
+
+        function process_event(track, event)
+            local result = background_result()
+            if result then
+                note(math.floor(result / 1000), 100)
+            end
+        end
+    )");
+
+    LuaContext ctx;
+    ctx.setChannel(0);
+    ASSERT_TRUE(ctx.loadScript(script));
+    ASSERT_TRUE(ctx.hasBackground());
+
+    Event evt;
+    evt.setSwitch(true);
+
+    // First slice can't finish 20000 iterations within 1000 instructions
+    ASSERT_TRUE(ctx.resumeBackground(1000) == LuaContext::BackgroundStatus::RUNNING);
+    ASSERT_EQ(ctx.callProcessEvent(0, evt).size(), 0);  // Nothing published yet
+
+    int slices = 1;
+    while (ctx.resumeBackground(1000) == LuaContext::BackgroundStatus::RUNNING) {
+        slices++;
+        ASSERT_TRUE(slices < 1000);
+    }
+    ASSERT_TRUE(slices > 10);
+    ASSERT_EQ(ctx.getBackgroundRuns(), 1);
+
+    auto midi_events = ctx.callProcessEvent(0, evt);
+    ASSERT_EQ(midi_events.size(), 1);
+    ASSERT_EQ(midi_events[0].data[1], 20);  // 20000 / 1000
+}
+
+TEST(background_slices_around_c_callbacks) {
+    // The budget runs out inside the comparator, under table.sort
+    std::string script = createTempLuaScript(R"(
+        function init(context)
+        end
+
+        function background()
+            local items = {}
+            for i = 1, 200 do
+                items[i] = (i * 37) % 200
+            end
+            table.sort(items, function(a, b) return a > b end)
+            return items[1]
+        end
+
+        function process_event(track, event)
+            local result = background_result()
+            if result then
+                note(result - 100, 100)
+            end
+        end
+    )");
+
+    LuaContext ctx;
+    ctx.setChannel(0);
+    ASSERT_TRUE(ctx.loadScript(script));
+
+    int slices = 0;
+    LuaContext::BackgroundStatus status;
+    while ((status = ctx.resumeBackground(100)) == LuaContext::BackgroundStatus::RUNNING) {
+        slices++;
+        ASSERT_TRUE(slices < 10000);
+    }
+    ASSERT_TRUE(status == LuaContext::BackgroundStatus::FINISHED);
+    ASSERT_TRUE(ctx.hasBackground());
+    ASSERT_TRUE(slices > 1);
+
+    Event evt;
+    evt.setSwitch(true);
+    auto midi_events = ctx.callProcessEvent(0, evt);
+    ASSERT_EQ(midi_events.size(), 1);
+    ASSERT_EQ(midi_events[0].data[1], 99);  // Largest item: 199
+}
+
+TEST(background_error_disables_worker) {
+    std::string script = createTempLuaScript(R"(
+        function init(context)
+        end
+
+        function background()
+            error("boom")
+        end
+
+        function process_event(track, event)
+            note(60, 100)
+        end
+    )");
+
+    LuaContext ctx;
+    ctx.setChannel(0);
+    ASSERT_TRUE(ctx.loadScript(script));
+
+    ASSERT_TRUE(ctx.resumeBackground(1000) == LuaContext::BackgroundStatus::ERROR);
+    ASSERT_FALSE(ctx.hasBackground());
+    ASSERT_TRUE(ctx.resumeBackground(1000) == LuaContext::BackgroundStatus::IDLE);
+
+    // process_event still works
+    Event evt;
+    ASSERT_EQ(ctx.callProcessEvent(0, evt).size(), 1);
+}
+
+TEST(mode_without_background_is_idle) {
+    std::string script = createTempLuaScript(R"(
+        function init(context)
+        end
+
+        function process_event(track, event)
+        end
+    )");
+
+    LuaContext ctx;
+    ASSERT_TRUE(ctx.loadScript(script));
+    ASSERT_FALSE(ctx.hasBackground());
+    ASSERT_TRUE(ctx.resumeBackground(1000) == LuaContext::BackgroundStatus::IDLE);
+}
+
+TEST(print_goes_through_logger) {
+    std::string script = createTempLuaScript(R"(
+        function init(context)
+            print("hello", 42, true)
+        end
+
+        function process_event(track, event)
+        end
+    )");
+
+    Logger& logger = Logger::instance();
+    logger.flush();  // Drop whatever earlier tests queued
+    std::vector<std::string> lines;
+    logger.addSink([&lines](const LogRecord&, const char* line) { lines.push_back(line); });
+
+    LuaContext ctx;
+    ctx.setChannel(2);
+    ASSERT_TRUE(ctx.loadScript(script));
+    LuaInitContext init_ctx;
+    ASSERT_TRUE(ctx.callInit(init_ctx));
+    ASSERT_EQ(lines.size(), 0);  // Queued, not printed from the calling thread
+
+    logger.flush();
+    logger.clearSinks();
+    ASSERT_EQ(lines.size(), 1);
+    ASSERT_TRUE(lines[0] == "[Lua] ch 3: hello\t42\ttrue");
+}
+
 // ============================================================================
 // Lua 5.1 Compatibility Tests (Features NOT to use)
 // ============================================================================
@@ -495,6 +827,20 @@ int main() {
     run_test_generate_control_change();
     run_test_generate_all_notes_off();
 
+    // Mode manifest
+    run_test_manifest_defaults();
+    run_test_manifest_parsed_once_at_load();
+    run_test_process_step_receives_all_tracks();
+    run_test_process_input_receives_message();
+    run_test_memory_budget_enforced();
+
+    // Background coroutines
+    run_test_background_runs_in_slices();
+    run_test_background_slices_around_c_callbacks();
+    run_test_background_error_disables_worker();
+    run_test_mode_without_background_is_idle();
+    run_test_print_goes_through_logger();
+
     // Lua 5.1 compatibility
     run_test_lua_5_1_no_integer_division();
     run_test_lua_5_1_no_bitwise_operators();
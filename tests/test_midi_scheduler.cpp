@@ -5,6 +5,8 @@
  * - Event queueing and timing
  * - MIDI message creation helpers
  * - Clock and transport messages
+ * - Due events sent as one batch
+ * - Controller coalescing, repeat dropping and rate caps
  */
 
 #include "../src/hardware/midi_scheduler.h"
@@ -87,6 +89,15 @@ public:
         sent_messages_.push_back(msg);
     }
 
+    void sendMidiBatch(const MidiMessage* messages, size_t count) override {
+        batch_sizes_.push_back(count);
+        sent_messages_.insert(sent_messages_.end(), messages, messages + count);
+    }
+
+    void flush() override {
+        flush_count_++;
+    }
+
     void setLED(bool on) override {
         led_state_ = on;
     }
@@ -120,10 +131,20 @@ public:
         sent_messages_.clear();
     }
 
+    const std::vector<size_t>& getBatchSizes() const {
+        return batch_sizes_;
+    }
+
+    int getFlushCount() const {
+        return flush_count_;
+    }
+
 private:
     uint32_t current_time_;
     bool led_state_;
     std::vector<MidiMessage> sent_messages_;
+    std::vector<size_t> batch_sizes_;
+    int flush_count_ = 0;
 };
 
 // ============================================================================
@@ -286,6 +307,37 @@ TEST(scheduler_batch_events) {
     ASSERT_EQ(hw.getSentMessages().size(), 1u);
 }
 
+TEST(scheduler_sends_due_events_as_one_batch) {
+    MockHardware hw;
+    MidiScheduler scheduler(&hw);
+
+    // A downbeat: 40 note-ons across 10 channels, plus their note-offs later
+    for (uint8_t i = 0; i < 40; i++) {
+        scheduler.schedule(MidiScheduler::noteOn(static_cast<uint8_t>(36 + i), 100, i % 10, 0));
+        scheduler.schedule(MidiScheduler::noteOff(static_cast<uint8_t>(36 + i), i % 10, 50));
+    }
+
+    scheduler.update();
+    ASSERT_EQ(hw.getBatchSizes().size(), 1u);
+    ASSERT_EQ(hw.getBatchSizes()[0], 40u);
+    ASSERT_EQ(hw.getFlushCount(), 1);
+    for (const auto& msg : hw.getSentMessages()) {
+        ASSERT_EQ(msg.data[0] & 0xF0, 0x90);
+    }
+
+    // Nothing due: no empty batch, no flush
+    hw.advanceTime(10);
+    scheduler.update();
+    ASSERT_EQ(hw.getBatchSizes().size(), 1u);
+    ASSERT_EQ(hw.getFlushCount(), 1);
+
+    hw.advanceTime(40);
+    scheduler.update();
+    ASSERT_EQ(hw.getBatchSizes().size(), 2u);
+    ASSERT_EQ(hw.getBatchSizes()[1], 40u);
+    ASSERT_EQ(hw.getFlushCount(), 2);
+}
+
 TEST(scheduler_clear) {
     MockHardware hw;
     MidiScheduler scheduler(&hw);
@@ -375,6 +427,131 @@ TEST(scheduler_event_ordering) {
     ASSERT_EQ(hw.getSentMessages()[0].data[1], 64);
 }
 
+// ============================================================================
+// Controller thinning
+// ============================================================================
+
+TEST(scheduler_coalesces_controllers_per_update) {
+    MockHardware hw;
+    MidiScheduler scheduler(&hw);
+
+    // A sweep that produced several values within the same millisecond
+    scheduler.schedule(MidiScheduler::controlChange(74, 10, 0, 0));
+    scheduler.schedule(ScheduledMidiEvent({0xE0, 0x00, 0x20}, 0, 0));  // Pitch bend
+    scheduler.schedule(MidiScheduler::controlChange(74, 20, 0, 0));
+    scheduler.schedule(MidiScheduler::noteOn(60, 100, 0, 0));
+    scheduler.schedule(MidiScheduler::controlChange(74, 30, 0, 0));
+    scheduler.schedule(MidiScheduler::controlChange(74, 99, 1, 0));     // Other channel
+    scheduler.schedule(ScheduledMidiEvent({0xE0, 0x7F, 0x3F}, 0, 0));
+
+    scheduler.update();
+
+    // Latest value per (channel, controller), at the latest one's place
+    const auto& messages = hw.getSentMessages();
+    ASSERT_EQ(messages.size(), 4u);
+    ASSERT_EQ(messages[0].data[0], 0x90);
+    ASSERT_EQ(messages[1].data[0], 0xB0);
+    ASSERT_EQ(messages[1].data[2], 30);
+    ASSERT_EQ(messages[2].data[0], 0xB1);
+    ASSERT_EQ(messages[3].data[0], 0xE0);
+    ASSERT_EQ(messages[3].data[2], 0x3F);
+    ASSERT_EQ(scheduler.getControllerStats().coalesced, 3u);
+}
+
+TEST(scheduler_passes_order_sensitive_controllers) {
+    MockHardware hw;
+    MidiScheduler scheduler(&hw);
+
+    // Two RPN writes (select, then data entry) and two All Notes Off
+    for (uint8_t rpn = 0; rpn < 2; ++rpn) {
+        scheduler.schedule(MidiScheduler::controlChange(101, 0, 0, 0));
+        scheduler.schedule(MidiScheduler::controlChange(100, rpn, 0, 0));
+        scheduler.schedule(MidiScheduler::controlChange(6, 12, 0, 0));
+    }
+    scheduler.schedule(MidiScheduler::allNotesOff(0, 0));
+    scheduler.schedule(MidiScheduler::allNotesOff(0, 0));
+
+    scheduler.update();
+    ASSERT_EQ(hw.getSentMessages().size(), 8u);
+    ASSERT_EQ(scheduler.getControllerStats().coalesced, 0u);
+}
+
+TEST(scheduler_drops_repeated_controller_values) {
+    MockHardware hw;
+    MidiScheduler scheduler(&hw);
+
+    scheduler.schedule(MidiScheduler::controlChange(74, 30, 0, 0));
+    scheduler.update();
+    ASSERT_EQ(hw.getSentMessages().size(), 1u);
+
+    // Same value again, well outside the rate cap: nothing to send
+    hw.clearMessages();
+    hw.advanceTime(100);
+    scheduler.schedule(MidiScheduler::controlChange(74, 30, 0, 0));
+    scheduler.update();
+    ASSERT_EQ(hw.getSentMessages().size(), 0u);
+    ASSERT_EQ(scheduler.getControllerStats().repeats, 1u);
+
+    scheduler.schedule(MidiScheduler::controlChange(74, 31, 0, 0));
+    scheduler.update();
+    ASSERT_EQ(hw.getSentMessages().size(), 1u);
+
+    // A new device on the port hasn't seen it: send it again
+    hw.clearMessages();
+    scheduler.forgetSentControllers(MidiScheduler::Port::EXTERNAL);
+    scheduler.schedule(MidiScheduler::controlChange(74, 31, 0, 0));
+    scheduler.update();
+    ASSERT_EQ(hw.getSentMessages().size(), 1u);
+
+    // So does Reset All Controllers
+    hw.clearMessages();
+    scheduler.schedule(MidiScheduler::controlChange(121, 0, 0, 0));
+    scheduler.schedule(MidiScheduler::controlChange(74, 31, 0, 1));
+    scheduler.update();
+    hw.advanceTime(1);
+    scheduler.update();
+    ASSERT_EQ(hw.getSentMessages().size(), 2u);
+}
+
+TEST(scheduler_rate_limits_controllers_per_port) {
+    MockHardware hw;
+    MidiScheduler scheduler(&hw);
+    scheduler.setControllerRateLimit(MidiScheduler::Port::EXTERNAL, 100);  // 10 ms apart
+    ASSERT_EQ(scheduler.getControllerRateLimit(MidiScheduler::Port::EXTERNAL), 100u);
+
+    // A sweep one value per millisecond
+    for (uint8_t value = 0; value <= 25; ++value) {
+        scheduler.schedule(MidiScheduler::controlChange(1, value, 0, value));
+    }
+    for (uint32_t t = 0; t <= 40; ++t) {
+        hw.setTime(t);
+        scheduler.update();
+    }
+
+    // 0, 10 and 20 on time, then the final 25 once the cap allows (t = 30)
+    const auto& messages = hw.getSentMessages();
+    ASSERT_EQ(messages.size(), 4u);
+    ASSERT_EQ(messages[0].data[2], 0);
+    ASSERT_EQ(messages[1].data[2], 10);
+    ASSERT_EQ(messages[2].data[2], 20);
+    ASSERT_EQ(messages[3].data[2], 25);
+    ASSERT_EQ(messages[3].timestamp_ms, 30u);
+    ASSERT_EQ(scheduler.getControllerStats().deferred, 23u);
+
+    // Other controllers have their own budget; no cap sends everything
+    hw.clearMessages();
+    scheduler.setControllerRateLimit(MidiScheduler::Port::EXTERNAL, 0);
+    for (uint8_t value = 0; value < 5; ++value) {
+        scheduler.schedule(MidiScheduler::controlChange(1, 100 + value, 0, value));
+        scheduler.schedule(MidiScheduler::controlChange(2, 100 + value, 0, value));
+    }
+    for (uint32_t t = 40; t <= 45; ++t) {
+        hw.setTime(t);
+        scheduler.update();
+    }
+    ASSERT_EQ(hw.getSentMessages().size(), 10u);
+}
+
 // ============================================================================
 // Main
 // ============================================================================
@@ -396,6 +573,7 @@ int main() {
     run_test_scheduler_delayed_event();
     run_test_scheduler_multiple_events();
     run_test_scheduler_batch_events();
+    run_test_scheduler_sends_due_events_as_one_batch();
     run_test_scheduler_clear();
     run_test_scheduler_clock_message();
     run_test_scheduler_start_message();
@@ -403,6 +581,12 @@ int main() {
     run_test_scheduler_continue_message();
     run_test_scheduler_event_ordering();
 
+    // Controller thinning
+    run_test_scheduler_coalesces_controllers_per_update();
+    run_test_scheduler_passes_order_sensitive_controllers();
+    run_test_scheduler_drops_repeated_controller_values();
+    run_test_scheduler_rate_limits_controllers_per_port();
+
     // Summary
     std::cout << std::endl;
     std::cout << "========================================" << std::endl;
@@ -270,6 +270,28 @@ TEST(pattern_full_data) {
     }
 }
 
+// ============================================================================
+// Geometry Tests
+// ============================================================================
+
+TEST(pattern_unchecked_access) {
+    Pattern pattern;
+    pattern[2][5].setSwitch(true);
+
+    ASSERT_TRUE(pattern.getEvent(2, 5).getSwitch());
+    ASSERT_TRUE(&pattern[2][5] == &pattern.getEvent(2, 5));
+}
+
+TEST(pattern_custom_geometry) {
+    BasicPattern<4, 32> pattern;
+    pattern.getEvent(3, 31).setPot(1, 42);
+
+    ASSERT_EQ(decltype(pattern)::NUM_TRACKS, 4);
+    ASSERT_EQ(decltype(pattern)::TrackType::NUM_EVENTS, 32);
+    ASSERT_EQ(pattern[3][31].getPot(1), 42);
+    ASSERT_EQ(sizeof(pattern), 4 * 32 * sizeof(uint32_t));
+}
+
 // ============================================================================
 // Main
 // ============================================================================
@@ -295,6 +317,10 @@ int main() {
     run_test_pattern_num_tracks_constant();
     run_test_pattern_full_data();
 
+    // Geometry
+    run_test_pattern_unchecked_access();
+    run_test_pattern_custom_geometry();
+
     // Summary
     std::cout << std::endl;
     std::cout << "========================================" << std::endl;
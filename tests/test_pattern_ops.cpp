@@ -0,0 +1,302 @@
+/**
+ * Unit tests for PatternOps bulk transforms
+ *
+ * Checks each operation against the Event accessors, so the SIMD paths
+ * (SSE2/NEON) and the scalar fallback must agree with the packed layout.
+ */
+
+#include "../src/core/pattern_ops.h"
+#include <iostream>
+#include <cassert>
+
+// Simple test framework (same as test_event.cpp)
+int test_count = 0;
+int pass_count = 0;
+int fail_count = 0;
+
+#define TEST(name) \
+    void test_##name(); \
+    void run_test_##name() { \
+        std::cout << "Running test: " << #name << "... "; \
+        try { \
+            test_##name(); \
+            std::cout << "PASS" << std::endl; \
+            pass_count++; \
+        } catch (const std::exception& e) { \
+            std::cout << "FAIL: " << e.what() << std::endl; \
+            fail_count++; \
+        } \
+        test_count++; \
+    } \
+    void test_##name()
+
+#define ASSERT_EQ(a, b) \
+    if ((a) != (b)) { \
+        throw std::runtime_error(std::string("Expected ") + #a + " == " + #b + \
+                                 ", got " + std::to_string(a) + " != " + std::to_string(b)); \
+    }
+
+#define ASSERT_TRUE(expr) \
+    if (!(expr)) { \
+        throw std::runtime_error(std::string("Expected ") + #expr + " to be true"); \
+    }
+
+#define ASSERT_FALSE(expr) \
+    if ((expr)) { \
+        throw std::runtime_error(std::string("Expected ") + #expr + " to be false"); \
+    }
+
+using namespace gruvbok;
+
+// Fill a pattern with varied data (deterministic)
+static void fillPattern(Pattern& pattern, uint32_t seed) {
+    for (int t = 0; t < Pattern::NUM_TRACKS; t++) {
+        for (int s = 0; s < Track::NUM_EVENTS; s++) {
+            seed = seed * 1664525u + 1013904223u;
+            Event e((seed >> 31) & 1, (seed >> 3) & 0x7F, (seed >> 10) & 0x7F,
+                    (seed >> 17) & 0x7F, (seed >> 24) & 0x7F);
+            pattern.setEvent(t, s, e);
+        }
+    }
+}
+
+// ============================================================================
+// Track Transforms
+// ============================================================================
+
+TEST(raw_view_matches_events) {
+    Pattern pattern;
+    fillPattern(pattern, 1);
+
+    const uint32_t* words = PatternOps::raw(pattern);
+    ASSERT_EQ(words[0], pattern.getEvent(0, 0).getRawData());
+    ASSERT_EQ(words[17], pattern.getEvent(1, 1).getRawData());
+    ASSERT_EQ(words[127], pattern.getEvent(7, 15).getRawData());
+    ASSERT_TRUE(PatternOps::raw(pattern.getTrack(3)) == words + 48);
+}
+
+TEST(rotate_track) {
+    Track track;
+    for (int s = 0; s < Track::NUM_EVENTS; s++) {
+        track.setEvent(s, Event(false, s, 0, 0, 0));
+    }
+
+    PatternOps::rotate(track, 3);
+    ASSERT_EQ(track.getEvent(3).getPot(0), 0);
+    ASSERT_EQ(track.getEvent(0).getPot(0), 13);
+
+    PatternOps::rotate(track, -3);
+    ASSERT_EQ(track.getEvent(0).getPot(0), 0);
+
+    PatternOps::rotate(track, 17);  // Wraps
+    ASSERT_EQ(track.getEvent(1).getPot(0), 0);
+}
+
+TEST(shift_track) {
+    Track track;
+    for (int s = 0; s < Track::NUM_EVENTS; s++) {
+        track.setEvent(s, Event(true, s, 0, 0, 0));
+    }
+
+    PatternOps::shift(track, 2);
+    ASSERT_FALSE(track.getEvent(0).getSwitch());
+    ASSERT_FALSE(track.getEvent(1).getSwitch());
+    ASSERT_EQ(track.getEvent(2).getPot(0), 0);
+    ASSERT_EQ(track.getEvent(15).getPot(0), 13);
+
+    PatternOps::shift(track, -4);
+    ASSERT_EQ(track.getEvent(0).getPot(0), 2);
+    ASSERT_FALSE(track.getEvent(15).getSwitch());
+
+    PatternOps::shift(track, 16);
+    for (int s = 0; s < Track::NUM_EVENTS; s++) {
+        ASSERT_EQ(track.getEvent(s).getRawData(), 0u);
+    }
+}
+
+TEST(reverse_track) {
+    Track track;
+    for (int s = 0; s < Track::NUM_EVENTS; s++) {
+        track.setEvent(s, Event(s % 2, s, 0, 0, 0));
+    }
+
+    PatternOps::reverse(track);
+    ASSERT_EQ(track.getEvent(0).getPot(0), 15);
+    ASSERT_TRUE(track.getEvent(0).getSwitch());
+    ASSERT_EQ(track.getEvent(15).getPot(0), 0);
+}
+
+// ============================================================================
+// Pattern Transforms
+// ============================================================================
+
+TEST(copy_and_swap_patterns) {
+    Pattern a, b;
+    fillPattern(a, 7);
+
+    PatternOps::copy(a, b);
+    for (int i = 0; i < 128; i++) {
+        ASSERT_EQ(PatternOps::raw(a)[i], PatternOps::raw(b)[i]);
+    }
+
+    Pattern c;
+    fillPattern(c, 9);
+    uint32_t c0 = c.getEvent(0, 0).getRawData();
+    uint32_t a0 = a.getEvent(0, 0).getRawData();
+    PatternOps::swap(a, c);
+    ASSERT_EQ(a.getEvent(0, 0).getRawData(), c0);
+    ASSERT_EQ(c.getEvent(0, 0).getRawData(), a0);
+}
+
+TEST(merge_patterns) {
+    Pattern src, dst, original;
+    fillPattern(src, 3);
+    fillPattern(dst, 5);
+    PatternOps::copy(dst, original);
+
+    PatternOps::merge(src, dst);
+    for (int t = 0; t < Pattern::NUM_TRACKS; t++) {
+        for (int s = 0; s < Track::NUM_EVENTS; s++) {
+            const Event& from = src.getEvent(t, s);
+            uint32_t expected = from.getSwitch() ? from.getRawData()
+                                                 : original.getEvent(t, s).getRawData();
+            ASSERT_EQ(dst.getEvent(t, s).getRawData(), expected);
+        }
+    }
+}
+
+// ============================================================================
+// Pot Lanes
+// ============================================================================
+
+TEST(add_pot_saturates) {
+    Pattern pattern;
+    fillPattern(pattern, 11);
+    Pattern before;
+    PatternOps::copy(pattern, before);
+
+    PatternOps::addPot(PatternOps::raw(pattern), 128, 2, 40);
+    for (int t = 0; t < Pattern::NUM_TRACKS; t++) {
+        for (int s = 0; s < Track::NUM_EVENTS; s++) {
+            const Event& was = before.getEvent(t, s);
+            const Event& now = pattern.getEvent(t, s);
+            int expected = was.getPot(2) + 40;
+            if (expected > 127) expected = 127;
+            ASSERT_EQ(now.getPot(2), expected);
+            // Other fields untouched
+            ASSERT_EQ(now.getSwitch(), was.getSwitch());
+            ASSERT_EQ(now.getPot(0), was.getPot(0));
+            ASSERT_EQ(now.getPot(1), was.getPot(1));
+            ASSERT_EQ(now.getPot(3), was.getPot(3));
+        }
+    }
+
+    PatternOps::addPot(PatternOps::raw(pattern), 128, 2, -200);
+    for (int i = 0; i < 128; i++) {
+        ASSERT_EQ(pattern.getEvent(i / 16, i % 16).getPot(2), 0);
+    }
+}
+
+TEST(scale_pot) {
+    Pattern pattern;
+    fillPattern(pattern, 13);
+    Pattern before;
+    PatternOps::copy(pattern, before);
+
+    PatternOps::scalePot(PatternOps::raw(pattern), 128, 3, 384);  // x1.5
+    for (int i = 0; i < 128; i++) {
+        int expected = (before.getEvent(i / 16, i % 16).getPot(3) * 384 + 128) >> 8;
+        if (expected > 127) expected = 127;
+        ASSERT_EQ(pattern.getEvent(i / 16, i % 16).getPot(3), expected);
+    }
+
+    PatternOps::scalePot(PatternOps::raw(pattern), 128, 3, 0);
+    for (int i = 0; i < 128; i++) {
+        ASSERT_EQ(pattern.getEvent(i / 16, i % 16).getPot(3), 0);
+    }
+}
+
+TEST(clamp_pot) {
+    Pattern pattern;
+    fillPattern(pattern, 17);
+
+    // Odd count exercises the scalar tail after the vector loop
+    PatternOps::clampPot(PatternOps::raw(pattern), 127, 0, 30, 90);
+    for (int i = 0; i < 127; i++) {
+        uint8_t v = pattern.getEvent(i / 16, i % 16).getPot(0);
+        ASSERT_TRUE(v >= 30 && v <= 90);
+    }
+}
+
+TEST(masked_fills) {
+    Pattern pattern;
+    fillPattern(pattern, 19);
+    Pattern before;
+    PatternOps::copy(pattern, before);
+
+    const uint16_t mask = 0x8421;  // Steps 0, 5, 10, 15
+    PatternOps::fillPot(PatternOps::raw(pattern), 128, 1, 99, mask);
+    PatternOps::fillSwitch(PatternOps::raw(pattern), 128, true, mask);
+    for (int t = 0; t < Pattern::NUM_TRACKS; t++) {
+        for (int s = 0; s < Track::NUM_EVENTS; s++) {
+            const Event& now = pattern.getEvent(t, s);
+            if ((mask >> s) & 1) {
+                ASSERT_EQ(now.getPot(1), 99);
+                ASSERT_TRUE(now.getSwitch());
+            } else {
+                ASSERT_EQ(now.getRawData(), before.getEvent(t, s).getRawData());
+            }
+        }
+    }
+}
+
+TEST(randomize_pot_stays_in_range) {
+    Pattern pattern;
+    uint32_t seed = 42;
+    PatternOps::randomizePot(PatternOps::raw(pattern.getTrack(2)), 16, 0, 40, 60, seed, 0x00FF);
+
+    for (int s = 0; s < Track::NUM_EVENTS; s++) {
+        uint8_t v = pattern.getEvent(2, s).getPot(0);
+        if (s < 8) {
+            ASSERT_TRUE(v >= 40 && v <= 60);
+        } else {
+            ASSERT_EQ(v, 0);
+        }
+    }
+    ASSERT_TRUE(seed != 42u);
+}
+
+int main() {
+    std::cout << "========================================" << std::endl;
+    std::cout << "GRUVBOK PatternOps Tests (" << PatternOps::backend() << ")" << std::endl;
+    std::cout << "========================================" << std::endl << std::endl;
+
+    // Track transforms
+    run_test_raw_view_matches_events();
+    run_test_rotate_track();
+    run_test_shift_track();
+    run_test_reverse_track();
+
+    // Pattern transforms
+    run_test_copy_and_swap_patterns();
+    run_test_merge_patterns();
+
+    // Pot lanes
+    run_test_add_pot_saturates();
+    run_test_scale_pot();
+    run_test_clamp_pot();
+    run_test_masked_fills();
+    run_test_randomize_pot_stays_in_range();
+
+    // Summary
+    std::cout << std::endl;
+    std::cout << "========================================" << std::endl;
+    std::cout << "Test Summary" << std::endl;
+    std::cout << "========================================" << std::endl;
+    std::cout << "Total:  " << test_count << std::endl;
+    std::cout << "Passed: " << pass_count << std::endl;
+    std::cout << "Failed: " << fail_count << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    return (fail_count == 0) ? 0 : 1;
+}
@@ -7,9 +7,12 @@
  */
 
 #include "../src/core/song.h"
+#include "../src/core/song_io.h"
+#include "../src/core/mapped_song_file.h"
 #include <iostream>
 #include <cassert>
 #include <fstream>
+#include "../external/nlohmann/json.hpp"
 
 // Simple test framework (same as other tests)
 int test_count = 0;
@@ -250,7 +253,7 @@ TEST(song_num_modes_constant) {
 
 TEST(song_memory_footprint) {
     // Test that memory calculation is reasonable
-    size_t footprint = Song::getMemoryFootprint();
+    size_t footprint = Song::getMaxMemoryFootprint();
 
     // Expected: 15 modes × 32 patterns × 8 tracks × 16 events × 4 bytes
     size_t expected = 15 * 32 * 8 * 16 * sizeof(uint32_t);
@@ -428,6 +431,579 @@ TEST(song_sparse_format) {
     ASSERT_EQ(event_count, 2u);
 }
 
+// Reference output: the DOM the JSON writer used to build, dumped with 2 spaces
+static std::string domJson(const Song& song, const std::string& name, int tempo) {
+    nlohmann::json j;
+    j["version"] = "1.0";
+    j["name"] = name;
+    j["tempo"] = tempo;
+    j["events"] = nlohmann::json::array();
+    for (int m = 0; m < Song::NUM_MODES; ++m) {
+        for (int p = 0; p < Mode::NUM_PATTERNS; ++p) {
+            for (int t = 0; t < Pattern::NUM_TRACKS; ++t) {
+                for (int s = 0; s < Track::NUM_EVENTS; ++s) {
+                    const Event& evt = song[m][p][t][s];
+                    if (evt.getSwitch()) {
+                        nlohmann::json e;
+                        e["mode"] = m;
+                        e["pattern"] = p;
+                        e["track"] = t;
+                        e["step"] = s;
+                        e["switch"] = true;
+                        e["pots"] = {evt.getPot(0), evt.getPot(1), evt.getPot(2), evt.getPot(3)};
+                        j["events"].push_back(e);
+                    }
+                }
+            }
+        }
+    }
+    return j.dump(2);
+}
+
+static std::string readText(const char* filepath) {
+    std::ifstream file(filepath);
+    return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+TEST(song_save_matches_dom_output) {
+    const char* filepath = "/tmp/test_stream.json";
+
+    Song empty;
+    ASSERT_TRUE(empty.save(filepath, "Untitled", 120));
+    ASSERT_TRUE(readText(filepath) == domJson(empty, "Untitled", 120));
+
+    // Dense song, and a name that needs escaping
+    Song dense;
+    uint32_t seed = 12345;
+    for (int i = 0; i < 20000; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        Event evt;
+        evt.setSwitch((seed >> 8) & 1);
+        evt.setPot(0, (seed >> 9) & 127);
+        evt.setPot(1, (seed >> 16) & 127);
+        evt.setPot(2, i & 127);
+        evt.setPot(3, (seed >> 24) & 127);
+        dense.setEvent((seed >> 3) % Song::NUM_MODES, (seed >> 12) % Mode::NUM_PATTERNS,
+                       (seed >> 20) % Pattern::NUM_TRACKS, (seed >> 26) % Track::NUM_EVENTS, evt);
+    }
+    std::string name = "Tab\there \"quoted\" \xC3\xA9\x01";
+    ASSERT_TRUE(dense.save(filepath, name, 97));
+    ASSERT_TRUE(readText(filepath) == domJson(dense, name, 97));
+
+    std::string loaded_name;
+    int loaded_tempo = 0;
+    Song loaded;
+    ASSERT_TRUE(loaded.load(filepath, &loaded_name, &loaded_tempo));
+    ASSERT_TRUE(loaded_name == name);
+    ASSERT_EQ(loaded_tempo, 97);
+    for (int m = 0; m < Song::NUM_MODES; ++m) {
+        for (int p = 0; p < Mode::NUM_PATTERNS; ++p) {
+            for (int t = 0; t < Pattern::NUM_TRACKS; ++t) {
+                for (int s = 0; s < Track::NUM_EVENTS; ++s) {
+                    // Switched-off events aren't saved
+                    const Event& want = dense[m][p][t][s];
+                    ASSERT_EQ(loaded[m][p][t][s].getRawData(), want.getSwitch() ? want.getRawData() : 0u);
+                }
+            }
+        }
+    }
+
+    // Invalid UTF-8 can't be written as JSON
+    ASSERT_FALSE(empty.save(filepath, "\xFF", 120));
+}
+
+TEST(song_load_nested_format) {
+    // Layout from docs/SONG_FORMAT.md (examples/demo_song.grv)
+    const char* filepath = "/tmp/test_nested.grv";
+    std::ofstream file(filepath);
+    file << R"({
+        "format_version": "1.0",
+        "metadata": {"title": "Demo", "author": "x", "tempo": 132},
+        "modes": {
+            "0": {"name": "Song", "patterns": {}},
+            "1": {"patterns": {"3": {"tracks": {"2": {"events": [
+                {"step": 4, "switch": true, "pots": [36, 100, 10, 64]},
+                {"step": 99, "switch": true, "pots": [1, 2, 3, 4]}
+            ]}}}}},
+            "14": {"patterns": {"31": {"tracks": {"7": {"events": [
+                {"step": 15, "switch": false, "pots": [1, 2, 3, 4]}
+            ]}}}}}
+        }
+    })";
+    file.close();
+
+    Song song;
+    std::string name;
+    int tempo = 0;
+    ASSERT_TRUE(song.load(filepath, &name, &tempo));
+    ASSERT_TRUE(name == "Demo");
+    ASSERT_EQ(tempo, 132);
+
+    const Event& evt = song[1][3][2][4];
+    ASSERT_TRUE(evt.getSwitch());
+    ASSERT_EQ(evt.getPot(0), 36);
+    ASSERT_EQ(evt.getPot(1), 100);
+    ASSERT_EQ(evt.getPot(2), 10);
+    ASSERT_EQ(evt.getPot(3), 64);
+    ASSERT_FALSE(song[14][31][7][15].getSwitch());
+    ASSERT_EQ(song[14][31][7][15].getPot(3), 4);
+    ASSERT_EQ(static_cast<unsigned>(song.getModeMask()), 1u << 1);
+}
+
+TEST(song_load_failure_leaves_song) {
+    Song song;
+    Event evt;
+    evt.setSwitch(true);
+    evt.setPot(0, 42);
+    song.setEvent(2, 3, 4, 5, evt);
+
+    // Events parse fine, but the version (which sorts last) is wrong
+    std::ofstream bad_version("/tmp/test_late_version.json");
+    bad_version << R"({"events": [{"mode": 0, "pattern": 0, "track": 0, "step": 0,
+                      "switch": true, "pots": [1, 2, 3, 4]}], "version": "2.0"})";
+    bad_version.close();
+    ASSERT_FALSE(song.load("/tmp/test_late_version.json"));
+
+    // Wrong value type halfway through
+    std::ofstream bad_type("/tmp/test_bad_type.json");
+    bad_type << R"({"version": "1.0", "events": [
+                      {"mode": 0, "pattern": 0, "track": 0, "step": 0, "switch": true, "pots": [1, 2, 3, 4]},
+                      {"mode": "one", "pattern": 0, "track": 0, "step": 1, "switch": true, "pots": [1, 2, 3, 4]}]})";
+    bad_type.close();
+    ASSERT_FALSE(song.load("/tmp/test_bad_type.json"));
+
+    ASSERT_FALSE(song[0][0][0][0].getSwitch());
+    ASSERT_EQ(song[2][3][4][5].getRawData(), evt.getRawData());
+}
+
+TEST(song_read_into_image_then_swap) {
+    Song source;
+    source.setEvent(4, 7, 1, 3, Event(true, 1, 2, 3, 4));
+    source.setEvent(9, 0, 0, 0, Event(false, 5, 0, 0, 0));  // Off, but not empty
+    ASSERT_TRUE(source.save("/tmp/test_image.json", "Image", 99));
+    ASSERT_TRUE(source.saveBinary("/tmp/test_image.bin"));
+
+    // Decoding doesn't touch the pattern pool (any thread may do it)
+    size_t live_blocks = Mode::Pool::shared().getLiveBlocks();
+    std::unique_ptr<Song::ImageType> image(new Song::ImageType());
+    std::string name;
+    int tempo = 0;
+    ASSERT_TRUE(Song::readJson("/tmp/test_image.json", *image, &name, &tempo));
+    ASSERT_EQ(Mode::Pool::shared().getLiveBlocks(), live_blocks);
+    ASSERT_TRUE(name == "Image");
+    ASSERT_EQ(tempo, 99);
+    ASSERT_EQ(image->getUsedPatterns(4), uint64_t(1) << 7);
+    ASSERT_EQ(image->getUsedPatterns(9), 0u);  // JSON keeps switch-on events only
+
+    Song incoming;
+    incoming.assign(*image);
+    ASSERT_EQ(incoming[4][7][1][3].getPot(3), 4);
+
+    ASSERT_TRUE(Song::readBinary("/tmp/test_image.bin", *image));
+    ASSERT_EQ(image->getUsedPatterns(9), 1u);
+
+    // Swap exchanges contents and masks without copying patterns
+    Song current;
+    current.setEvent(2, 2, 2, 2, Event(true, 7, 7, 7, 7));
+    const Pattern* incoming_pattern = &incoming[4][7];
+    current.swap(incoming);
+    ASSERT_TRUE(&current[4][7] == incoming_pattern);
+    ASSERT_EQ(static_cast<unsigned>(current.getModeMask()), 1u << 4);
+    ASSERT_EQ(static_cast<unsigned>(current[4].getPatternMask()), 1u << 7);
+    ASSERT_EQ(static_cast<unsigned>(incoming.getModeMask()), 1u << 2);
+    ASSERT_TRUE(incoming[2][2][2][2].getSwitch());
+}
+
+// ============================================================================
+// Occupancy Mask Tests
+// ============================================================================
+
+TEST(mode_masks_incremental) {
+    Mode mode;
+    ASSERT_EQ(mode.getPatternMask(), 0u);
+
+    Event on(true, 1, 2, 3, 4);
+    mode.setEvent(3, 2, 5, on);
+    mode.setEvent(3, 2, 15, on);
+    mode.setEvent(31, 7, 0, on);
+
+    ASSERT_EQ(mode.getSwitchMask(3, 2), (1u << 5) | (1u << 15));
+    ASSERT_EQ(mode.getTrackMask(3), 1u << 2);
+    ASSERT_EQ(mode.getPatternMask(), (1u << 3) | (1u << 31));
+
+    // Clearing the last step of a track clears the track and pattern bits
+    Event off;
+    mode.setEvent(31, 7, 0, off);
+    ASSERT_EQ(mode.getTrackMask(31), 0u);
+    ASSERT_EQ(mode.getPatternMask(), 1u << 3);
+
+    // A switch-off event with pot values is still empty
+    mode.setEvent(3, 2, 5, Event(false, 100, 100, 100, 100));
+    ASSERT_EQ(mode.getSwitchMask(3, 2), 1u << 15);
+}
+
+TEST(mode_masks_follow_reference_writes) {
+    Mode mode;
+
+    // Writes through non-const references are picked up on the next query
+    mode.getPattern(7).getEvent(4, 9).setSwitch(true);
+    ASSERT_EQ(mode.getSwitchMask(7, 4), 1u << 9);
+    ASSERT_EQ(mode.getPatternMask(), 1u << 7);
+
+    Pattern pattern;
+    pattern.getEvent(0, 0).setSwitch(true);
+    mode.setPattern(2, pattern);
+    ASSERT_EQ(mode.getPatternMask(), (1u << 2) | (1u << 7));
+
+    mode.clear();
+    ASSERT_EQ(mode.getPatternMask(), 0u);
+}
+
+TEST(song_mode_mask) {
+    Song song;
+    ASSERT_EQ(song.getModeMask(), 0u);
+
+    song.setEvent(4, 0, 0, 0, Event(true, 0, 0, 0, 0));
+    song.getMode(9).getPattern(1).getEvent(2, 3).setSwitch(true);
+    ASSERT_EQ(song.getModeMask(), (1u << 4) | (1u << 9));
+
+    song.setEvent(4, 0, 0, 0, Event());
+    ASSERT_EQ(song.getModeMask(), 1u << 9);
+
+    // Masks are rebuilt after load
+    const char* filepath = "/tmp/test_masks.json";
+    ASSERT_TRUE(song.save(filepath));
+    Song loaded;
+    loaded.setEvent(1, 1, 1, 1, Event(true, 0, 0, 0, 0));
+    ASSERT_TRUE(loaded.load(filepath));
+    ASSERT_EQ(loaded.getModeMask(), 1u << 9);
+    ASSERT_EQ(loaded.getMode(9).getSwitchMask(1, 2), 1u << 3);
+
+    const char* binpath = "/tmp/test_masks.bin";
+    ASSERT_TRUE(song.saveBinary(binpath));
+    Song loaded_bin;
+    ASSERT_TRUE(loaded_bin.loadBinary(binpath));
+    ASSERT_EQ(loaded_bin.getModeMask(), 1u << 9);
+}
+
+TEST(song_sparse_save_order) {
+    // Mask-driven save must emit events in mode/pattern/track/step order
+    Song song;
+    Event evt(true, 10, 20, 30, 40);
+    song.setEvent(7, 3, 1, 12, evt);
+    song.setEvent(2, 31, 7, 15, evt);
+    song.setEvent(7, 3, 1, 2, evt);
+    song.setEvent(7, 0, 6, 0, evt);
+
+    const char* filepath = "/tmp/test_sparse_order.json";
+    ASSERT_TRUE(song.save(filepath));
+    std::ifstream file(filepath);
+    std::string content((std::istreambuf_iterator<char>(file)),
+                        std::istreambuf_iterator<char>());
+
+    size_t a = content.find("\"pattern\": 31");
+    size_t b = content.find("\"pattern\": 0");
+    size_t c = content.find("\"step\": 2");
+    size_t d = content.find("\"step\": 12");
+    ASSERT_TRUE(a != std::string::npos && b != std::string::npos);
+    ASSERT_TRUE(a < b);
+    ASSERT_TRUE(b < c);
+    ASSERT_TRUE(c < d);
+}
+
+// ============================================================================
+// Pattern Sharing Tests
+// ============================================================================
+
+TEST(song_empty_patterns_share_storage) {
+    Song song;
+
+    // 480 empty patterns, one block
+    size_t empty = song.getMemoryFootprint();
+    ASSERT_TRUE(empty < sizeof(Song) + 2 * sizeof(PatternBlock));
+    ASSERT_TRUE(empty < Song::getMaxMemoryFootprint());
+
+    // Real content costs one block per distinct pattern
+    song.setEvent(1, 0, 0, 0, Event(true, 1, 2, 3, 4));
+    song.setEvent(2, 5, 0, 0, Event(true, 9, 9, 9, 9));
+    ASSERT_EQ(song.getMemoryFootprint(), empty + 2 * sizeof(PatternBlock));
+
+    // Back to empty and compacted: shared again
+    song.setEvent(1, 0, 0, 0, Event());
+    song.setEvent(2, 5, 0, 0, Event());
+    song.compact();
+    ASSERT_EQ(song.getMemoryFootprint(), empty);
+}
+
+TEST(mode_identical_patterns_deduplicate) {
+    Mode mode;
+    Pattern pattern;
+    pattern.getEvent(3, 7).setSwitch(true);
+
+    mode.setPattern(0, pattern);
+    mode.setPattern(1, pattern);
+    const Mode& view = mode;
+    ASSERT_TRUE(&view.getPattern(0) == &view.getPattern(1));
+    ASSERT_TRUE(&view.getPattern(0) != &view.getPattern(2));  // Content vs empty block
+
+    // Written patterns fold back together on compact()
+    Mode other;
+    other.setEvent(4, 3, 7, Event(true, 0, 0, 0, 0));
+    other.setEvent(9, 3, 7, Event(true, 0, 0, 0, 0));
+    const Mode& other_view = other;
+    ASSERT_TRUE(&other_view.getPattern(4) != &other_view.getPattern(9));
+    other.compact();
+    ASSERT_TRUE(&other_view.getPattern(4) == &other_view.getPattern(9));
+}
+
+TEST(mode_copy_on_write) {
+    Mode a;
+    a.setEvent(0, 0, 0, Event(true, 10, 0, 0, 0));
+    a.compact();
+
+    Mode b = a;
+    const Mode& va = a;
+    const Mode& vb = b;
+    ASSERT_TRUE(&va.getPattern(0) == &vb.getPattern(0));  // Shared after copy
+
+    // First write gives b its own block; a is untouched
+    b.setEvent(0, 0, 0, Event(true, 99, 0, 0, 0));
+    ASSERT_TRUE(&va.getPattern(0) != &vb.getPattern(0));
+    ASSERT_EQ(va.getPattern(0).getEvent(0, 0).getPot(0), 10);
+    ASSERT_EQ(vb.getPattern(0).getEvent(0, 0).getPot(0), 99);
+
+    // Same through a writable reference
+    b.getPattern(0).getEvent(0, 0).setPot(0, 55);
+    a.getPattern(0).getEvent(0, 0).setPot(0, 11);
+    ASSERT_EQ(va.getPattern(0).getEvent(0, 0).getPot(0), 11);
+    ASSERT_EQ(vb.getPattern(0).getEvent(0, 0).getPot(0), 55);
+}
+
+// ============================================================================
+// Binary Format Tests
+// ============================================================================
+
+static size_t fileSize(const char* filepath) {
+    std::ifstream file(filepath, std::ios::binary | std::ios::ate);
+    return static_cast<size_t>(file.tellg());
+}
+
+TEST(song_binary_roundtrip_sparse) {
+    Song song;
+    Event evt(true, 60, 100, 64, 127);
+    for (int step = 0; step < 16; step += 4) {
+        song.setEvent(1, 0, 0, step, evt);  // Four on the floor
+    }
+    song.setEvent(14, Mode::NUM_PATTERNS - 1, 7, 15, Event(false, 1, 2, 3, 4));  // Pots only
+    song.getMode(3).getPattern(5).getTrack(2).clear();
+
+    const char* filepath = "/tmp/test_binary_v2.bin";
+    ASSERT_TRUE(song.saveBinary(filepath));
+    // Header + 15 bitmaps + 2 tiny blocks instead of ~245KB of raw words
+    ASSERT_TRUE(fileSize(filepath) < 256);
+
+    Song loaded;
+    loaded.setEvent(5, 5, 5, 5, evt);  // Replaced by the load
+    ASSERT_TRUE(loaded.loadBinary(filepath));
+    ASSERT_EQ(loaded.getModeMask(), 1u << 1);  // Masks track switches only
+    ASSERT_EQ(loaded.getMode(5).getPattern(5).getEvent(5, 5).getSwitch(), false);
+    for (int step = 0; step < 16; ++step) {
+        ASSERT_EQ(loaded.getMode(1).getPattern(0).getEvent(0, step).getRawData(),
+                  step % 4 == 0 ? evt.getRawData() : 0u);
+    }
+    ASSERT_EQ(loaded.getMode(14).getPattern(Mode::NUM_PATTERNS - 1).getEvent(7, 15).getPot(3), 4);
+}
+
+TEST(song_binary_loads_v1) {
+    // Version 1: magic, version, then every event as a raw uint32
+    const char* filepath = "/tmp/test_binary_v1.bin";
+    {
+        std::vector<uint8_t> data;
+        SongFormat::putU32(data, SongFormat::MAGIC);
+        SongFormat::putU32(data, 1);
+        for (int i = 0; i < Song::NUM_MODES * Mode::NUM_PATTERNS * 8 * 16; ++i) {
+            SongFormat::putU32(data, i == 2 * Mode::NUM_PATTERNS * 128 + 17 ? Event(true, 9, 0, 0, 0).getRawData() : 0);
+        }
+        std::ofstream file(filepath, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    }
+
+    Song song;
+    ASSERT_TRUE(song.loadBinary(filepath));
+    ASSERT_EQ(song.getModeMask(), 1u << 2);
+    ASSERT_EQ(song.getMode(2).getPattern(0).getEvent(1, 1).getPot(0), 9);
+}
+
+TEST(song_binary_rejects_corruption) {
+    Song song;
+    song.setEvent(0, 0, 0, 0, Event(true, 1, 2, 3, 4));
+    song.setEvent(6, 2, 3, 4, Event(true, 5, 6, 7, 8));
+    const char* filepath = "/tmp/test_binary_corrupt.bin";
+    ASSERT_TRUE(song.saveBinary(filepath));
+
+    std::vector<uint8_t> good;
+    ASSERT_TRUE(SongFormat::readFile(filepath, good));
+
+    Song target;
+    target.setEvent(9, 9, 1, 1, Event(true, 0, 0, 0, 0));
+
+    // Flip every byte in turn, then truncate at every length: always rejected
+    for (size_t i = 0; i <= good.size(); ++i) {
+        std::vector<uint8_t> bad = good;
+        if (i < good.size()) {
+            bad[i] ^= 0x40;
+        } else {
+            bad.pop_back();
+        }
+        ASSERT_TRUE(SongFormat::writeFileAtomic(filepath, bad));
+        ASSERT_FALSE(target.loadBinary(filepath));
+    }
+    for (size_t len = 0; len < good.size(); ++len) {
+        std::vector<uint8_t> bad(good.begin(), good.begin() + len);
+        ASSERT_TRUE(SongFormat::writeFileAtomic(filepath, bad));
+        ASSERT_FALSE(target.loadBinary(filepath));
+    }
+
+    // A failed load leaves the song untouched
+    ASSERT_EQ(target.getModeMask(), 1u << 9);
+    ASSERT_TRUE(target.getMode(9).getPattern(9).getEvent(1, 1).getSwitch());
+}
+
+TEST(song_binary_patch_records) {
+    Song song;
+    song.setEvent(2, 3, 0, 0, Event(true, 1, 1, 1, 1));
+    const char* filepath = "/tmp/test_binary_patch.bin";
+    ASSERT_TRUE(song.saveBinary(filepath));
+    size_t base_size = fileSize(filepath);
+
+    // One changed step costs one small record, not a rewrite
+    song.setEvent(2, 3, 0, 0, Event(true, 2, 2, 2, 2));
+    ASSERT_TRUE(song.saveBinaryPatch(filepath, 2, 3));
+    ASSERT_TRUE(fileSize(filepath) - base_size < 32);
+
+    // Later records win; emptied patterns are recorded too
+    song.setEvent(2, 3, 0, 0, Event(true, 3, 3, 3, 3));
+    song.setEvent(7, 0, 5, 5, Event(true, 4, 4, 4, 4));
+    ASSERT_TRUE(song.saveBinaryPatch(filepath, 2, 3));
+    ASSERT_TRUE(song.saveBinaryPatch(filepath, 7, 0));
+    song.setEvent(7, 0, 5, 5, Event());
+    ASSERT_TRUE(song.saveBinaryPatch(filepath, 7, 0));
+
+    Song loaded;
+    ASSERT_TRUE(loaded.loadBinary(filepath));
+    ASSERT_EQ(loaded.getMode(2).getPattern(3).getEvent(0, 0).getPot(0), 3);
+    ASSERT_EQ(loaded.getModeMask(), 1u << 2);
+
+    // A torn final record is dropped; everything before it still applies
+    song.setEvent(2, 3, 0, 0, Event(true, 9, 9, 9, 9));
+    std::vector<uint8_t> record;
+    song.encodeBinaryPatch(2, 3, record);
+    record.pop_back();
+    {
+        std::ofstream file(filepath, std::ios::binary | std::ios::app);
+        file.write(reinterpret_cast<const char*>(record.data()), record.size());
+    }
+    Song torn;
+    ASSERT_TRUE(torn.loadBinary(filepath));
+    ASSERT_EQ(torn.getMode(2).getPattern(3).getEvent(0, 0).getPot(0), 3);
+}
+
+TEST(mapped_song_file_roundtrip) {
+    const char* filepath = "/tmp/test_mapped_song.bin";
+    std::remove(filepath);
+
+    Song song;
+    song.setEvent(4, 2, 1, 9, Event(true, 11, 22, 33, 44));
+    {
+        MappedSongFile file;
+        ASSERT_TRUE(file.open(filepath));
+        ASSERT_EQ(fileSize(filepath), MappedSongFile::FILE_SIZE);
+        ASSERT_FALSE(file.getPattern(4, 2).getEvent(1, 9).getSwitch());
+
+        file.storeFrom(song);
+        ASSERT_TRUE(file.sync());
+        ASSERT_EQ(file.getPattern(4, 2).getEvent(1, 9).getPot(3), 44);  // Reads the mapping
+    }
+
+    // Same bytes as binary v1, so loadBinary reads it too
+    Song via_binary;
+    ASSERT_TRUE(via_binary.loadBinary(filepath));
+    ASSERT_EQ(via_binary.getMode(4).getPattern(2).getEvent(1, 9).getPot(1), 22);
+
+    // Reopen: edits persisted; loading copies only the non-empty pattern
+    MappedSongFile file;
+    ASSERT_TRUE(file.open(filepath, false));
+    Pattern pattern = file.getPattern(4, 2);
+    pattern.getEvent(0, 0).setSwitch(true);
+    file.setPattern(4, 3, pattern);
+
+    Song loaded;
+    loaded.setEvent(0, 0, 0, 0, Event(true, 0, 0, 0, 0));  // Replaced by the load
+    file.loadInto(loaded);
+    ASSERT_EQ(loaded.getModeMask(), 1u << 4);
+    ASSERT_EQ(loaded.getMode(4).getPattern(3).getEvent(1, 9).getPot(0), 11);
+    ASSERT_TRUE(loaded.getMemoryFootprint() <= sizeof(Song) + 3 * sizeof(Mode::Block));
+
+    // Files of another size are left alone
+    MappedSongFile other;
+    ASSERT_FALSE(other.open("/tmp/test_binary_v2.bin", false));
+}
+
+TEST(song_format_run_length_roundtrip) {
+    uint32_t words[128] = {};
+    words[0] = 1;
+    words[1] = 0x1FFFFFFF;
+    for (int i = 10; i < 30; ++i) words[i] = 0x81;  // Repeat run
+    words[30] = 7;
+    words[31] = 7;                                  // Too short to repeat
+    words[127] = 3;
+
+    std::vector<uint8_t> encoded;
+    SongFormat::encodeWords(words, 128, encoded);
+    ASSERT_TRUE(encoded.size() < 24);
+
+    uint32_t decoded[128];
+    ASSERT_TRUE(SongFormat::decodeWords(encoded.data(), encoded.size(), decoded, 128));
+    for (int i = 0; i < 128; ++i) {
+        ASSERT_EQ(decoded[i], words[i]);
+    }
+    // Too few or too many words for the target
+    ASSERT_FALSE(SongFormat::decodeWords(encoded.data(), encoded.size(), decoded, 127));
+    encoded.push_back(0x04);  // One more zero word
+    ASSERT_FALSE(SongFormat::decodeWords(encoded.data(), encoded.size(), decoded, 128));
+}
+
+// ============================================================================
+// Geometry Tests
+// ============================================================================
+
+TEST(song_custom_geometry) {
+    // 4 modes × 64 patterns × 8 tracks × 32 steps: 64-bit pattern masks, 32-bit switch masks
+    using BigSong = BasicSong<4, 64, 8, 32>;
+    ASSERT_EQ(BigSong::getMaxMemoryFootprint(), 4u * 64 * 8 * 32 * 4);
+
+    BigSong song;
+    song.setEvent(3, 63, 7, 31, Event(true, 1, 2, 3, 4));
+    ASSERT_EQ(song.getModeMask(), 1u << 3);
+    ASSERT_TRUE(song.getMode(3).getPatternMask() == (uint64_t(1) << 63));
+    ASSERT_TRUE(song.getMode(3).getSwitchMask(63, 7) == (uint32_t(1) << 31));
+
+    // Persistence works for any geometry through song_io.h
+    const char* filepath = "/tmp/test_custom_geometry.json";
+    ASSERT_TRUE(song.save(filepath));
+    BigSong loaded;
+    ASSERT_TRUE(loaded.load(filepath));
+    ASSERT_EQ(loaded.getMode(3).getPattern(63).getEvent(7, 31).getPot(3), 4);
+
+    const char* binpath = "/tmp/test_custom_geometry.bin";
+    ASSERT_TRUE(song.saveBinary(binpath));
+    BigSong loaded_bin;
+    ASSERT_TRUE(loaded_bin.loadBinary(binpath));
+    ASSERT_EQ(loaded_bin.getMode(3).getPattern(63).getEvent(7, 31).getPot(3), 4);
+    Song wrong_geometry;
+    ASSERT_FALSE(wrong_geometry.loadBinary(binpath));
+}
+
 // ============================================================================
 // Main
 // ============================================================================
@@ -460,6 +1036,32 @@ int main() {
     run_test_song_load_invalid_json();
     run_test_song_load_wrong_version();
     run_test_song_sparse_format();
+    run_test_song_save_matches_dom_output();
+    run_test_song_load_nested_format();
+    run_test_song_load_failure_leaves_song();
+    run_test_song_read_into_image_then_swap();
+
+    // Occupancy masks
+    run_test_mode_masks_incremental();
+    run_test_mode_masks_follow_reference_writes();
+    run_test_song_mode_mask();
+    run_test_song_sparse_save_order();
+
+    // Pattern sharing
+    run_test_song_empty_patterns_share_storage();
+    run_test_mode_identical_patterns_deduplicate();
+    run_test_mode_copy_on_write();
+
+    // Binary format
+    run_test_song_binary_roundtrip_sparse();
+    run_test_song_binary_loads_v1();
+    run_test_song_binary_rejects_corruption();
+    run_test_song_binary_patch_records();
+    run_test_mapped_song_file_roundtrip();
+    run_test_song_format_run_length_roundtrip();
+
+    // Geometry
+    run_test_song_custom_geometry();
 
     // Summary
     std::cout << std::endl;